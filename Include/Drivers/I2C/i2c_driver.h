@@ -12,6 +12,7 @@
 #include "hardware/i2c.h"
 #include "hardware/dma.h"
 #include "hardware/gpio.h"
+#include "hardware/pio.h"
 #include "hardware/sync.h"
 #include <stdbool.h>
 #include <stdint.h>
@@ -20,23 +21,99 @@
 extern "C" {
 #endif
 
+/**
+ * @defgroup i2c_const I2C Configuration Constants
+ * @{
+ */
+
+/** Maximum PIO buses driven at once. */
+#define I2C_DRIVER_MAX_PIO_BUSES 8
+
+/** Maximum data bytes in one PIO bus transfer. */
+#define I2C_DRIVER_PIO_MAX_TRANSFER 32
+
+/** PIO command words around the data: start, addresses, register, restart and stop. */
+#define I2C_DRIVER_PIO_CMD_OVERHEAD 16
+
+/** Device addresses with their own error counters. */
+#define I2C_DRIVER_MAX_TRACKED_DEVICES 8
+
+/** Default retries after a failed transfer. */
+#define I2C_DRIVER_DEFAULT_RETRIES 2
+
+/** Transfers per clock fallback evaluation window. */
+#define I2C_DRIVER_FALLBACK_WINDOW 32
+
+/** Failed attempts in one window that step the clock down. */
+#define I2C_DRIVER_FALLBACK_ERRORS 4
+
+/** Consecutive error free windows before the clock steps back up. */
+#define I2C_DRIVER_RESTORE_WINDOWS 32
+
+/** @} */ // end of i2c_const group
+
 /**
  * @defgroup i2c_struct I2C Data Structures
  * @{
  */
 
+/**
+ * @brief Bus implementation behind a driver context.
+ */
+typedef enum {
+    I2C_DRIVER_BACKEND_HW = 0,      // I2C0/I2C1 controller.
+    I2C_DRIVER_BACKEND_PIO          // PIO state machine fed by DMA.
+} i2c_driver_backend_t;
+
+/**
+ * @brief Error counters for one device address.
+ */
+typedef struct {
+    uint8_t addr;                   // 7-bit device address.
+    uint32_t transfers;             // Read and write calls.
+    uint32_t errors;                // Failed attempts, including retried ones.
+    uint32_t retries;               // Attempts after the first.
+    uint32_t failures;              // Calls that failed after every retry.
+} i2c_driver_device_stats_t;
+
+/**
+ * @brief Bus error, recovery and clock statistics.
+ */
+typedef struct {
+    uint32_t transfers;             // Read and write calls.
+    uint32_t errors;                // Failed attempts, including retried ones.
+    uint32_t retries;               // Attempts after the first.
+    uint32_t failures;              // Calls that failed after every retry.
+    uint32_t recoveries;            // Bus recoveries that freed the lines.
+    uint32_t recovery_failures;     // Bus recoveries that left a line held low.
+    uint32_t clock_fallbacks;       // Automatic clock reductions.
+    uint32_t clock_restores;        // Automatic clock increases.
+    uint32_t clock_freq;            // Current clock frequency.
+    uint32_t max_clock_freq;        // Configured clock frequency.
+    uint8_t device_count;           // Valid entries in devices.
+    i2c_driver_device_stats_t devices[I2C_DRIVER_MAX_TRACKED_DEVICES]; // Per address counters.
+} i2c_driver_stats_t;
+
 /**
  * @brief I2C driver configuration structure.
+ *
+ * Setting pio selects a PIO bus instead of i2c_inst. PIO buses need SCL on
+ * the pin after SDA and always transfer using DMA.
  */
 typedef struct {
     uint32_t clock_freq;            // Clock frequency.
     int dma_tx_channel;             // DMA transmit channel (-1 for auto).
     int dma_rx_channel;             // DMA receive channel (-1 for auto).
 
+    int pio_sm;                     // PIO state machine (-1 for auto).
+
     i2c_inst_t* i2c_inst;           // I2C hardware instance.
+    PIO pio;                        // PIO block for a PIO bus (NULL for hardware I2C).
 
     uint8_t sda_pin;                // SDA pin number.
-    uint8_t scl_pin;                // SCL pin number.
+    uint8_t scl_pin;                // SCL pin number, SDA + 1 for PIO buses.
+    uint8_t max_retries;            // Retries after a failed blocking transfer.
+    bool auto_clock_fallback;       // Step 1 MHz -> 400 kHz -> 100 kHz when errors climb.
     bool use_dma;                   // Whether to use DMA.
     const char* name;               // Name for identification.
 } i2c_driver_config_t;
@@ -54,8 +131,29 @@ typedef struct i2c_driver_ctx_t {
 
     i2c_inst_t* i2c_inst;           // I2C hardware instance.
 
+    i2c_driver_backend_t backend;   // Bus implementation.
+    PIO pio;                        // PIO block (PIO backend).
+    uint8_t pio_sm;                 // PIO state machine (PIO backend).
+    uint8_t pio_offset;             // Program offset in PIO instruction memory.
+    volatile bool xfer_busy;        // PIO transfer in flight.
+    volatile bool recovering;       // Bus recovery owns the pins, transfers are refused.
+    volatile bool xfer_ok;          // Result of the last PIO transfer.
+    uint8_t* xfer_rx_dst;           // Destination of the current read.
+    size_t xfer_rx_len;             // Data bytes of the current read.
+    size_t xfer_rx_skip;            // Leading RX bytes clocked out by the header.
+    uint16_t pio_cmd[I2C_DRIVER_PIO_MAX_TRANSFER + I2C_DRIVER_PIO_CMD_OVERHEAD]; // TX FIFO words.
+    uint8_t pio_rx[I2C_DRIVER_PIO_MAX_TRANSFER + 4]; // RX FIFO bytes, including header bytes.
+
+    i2c_driver_stats_t stats;       // Error, recovery and clock statistics.
+    uint32_t max_clock_freq;        // Configured clock frequency, the fallback ceiling.
+    uint16_t window_transfers;      // Transfers in the current fallback window.
+    uint16_t window_errors;         // Failed attempts in the current fallback window.
+    uint16_t clean_windows;         // Consecutive windows without errors.
+
     uint8_t scl_pin;                // SCL pin number.
     uint8_t sda_pin;                // SDA pin number.
+    uint8_t max_retries;            // Retries after a failed blocking transfer.
+    bool auto_clock_fallback;       // Whether the clock adapts to the error rate.
     bool initialized;               // Whether driver is initialized.
     bool lock_initialized;          // Whether lock is initialized.
     bool use_dma;                   // Whether to use DMA.
@@ -85,6 +183,15 @@ bool i2c_driver_deinit(i2c_driver_ctx_t* ctx);
  */
 void i2c_driver_get_default_config(i2c_driver_config_t* config);
 
+/**
+ * @brief Get bus statistics.
+ * 
+ * @param ctx Pointer to driver context.
+ * @param stats Structure to fill.
+ * @return true if successful, false otherwise.
+ */
+bool i2c_driver_get_stats(i2c_driver_ctx_t* ctx, i2c_driver_stats_t* stats);
+
 /**
  * @brief Initialize the I2C driver.
  * 
@@ -96,6 +203,23 @@ i2c_driver_ctx_t* i2c_driver_init(const i2c_driver_config_t* config);
 
 bool i2c_driver_probe_address(i2c_driver_ctx_t* ctx, uint8_t addr);
 
+/**
+ * @brief Free a bus held by a device stuck mid-transfer.
+ * 
+ * Takes the pins from the controller, clocks SCL up to nine times until
+ * the device releases SDA, generates a STOP and hands the pins back. Called
+ * automatically when a blocking transfer fails with a line held low.
+ * 
+ * The bus is marked as recovering under the driver lock and the pins are
+ * bit-banged with the lock released, so interrupts stay enabled while a
+ * device stretches SCL. Transfers started meanwhile fail at once.
+ * 
+ * @param ctx Pointer to driver context.
+ * @return true if both lines are high afterwards, false otherwise or if
+ *         another recovery of the bus is in progress.
+ */
+bool i2c_driver_recover_bus(i2c_driver_ctx_t* ctx);
+
 /**
  * @brief Read bytes from an I2C device.
  * 
@@ -127,6 +251,68 @@ bool i2c_driver_read_bytes_dma(i2c_driver_ctx_t* ctx, uint8_t dev_addr,
     uint8_t reg_addr, uint8_t* data, size_t len,
     void (*callback)(void* user_data), void* user_data);
 
+/**
+ * @brief Check whether a DMA transfer is still in flight.
+ *
+ * Hardware buses complete their transfers before returning.
+ *
+ * @param ctx Pointer to driver context.
+ * @return true if busy, false if idle.
+ */
+bool i2c_driver_is_busy(const i2c_driver_ctx_t* ctx);
+
+/**
+ * @brief Get a timeout that comfortably covers a transfer at the current clock.
+ * 
+ * @param ctx Pointer to driver context.
+ * @param len Number of data bytes.
+ * @return Timeout in microseconds.
+ */
+uint32_t i2c_driver_transfer_timeout_us(const i2c_driver_ctx_t* ctx, size_t len);
+
+/**
+ * @brief Wait for the in-flight DMA transfer to finish.
+ *
+ * A transfer that has not finished in time is aborted and the bus is
+ * returned to idle with a STOP condition.
+ *
+ * @param ctx Pointer to driver context.
+ * @param timeout_us Maximum time to wait in microseconds.
+ * @return true if the last transfer was acknowledged throughout, false otherwise.
+ */
+bool i2c_driver_wait(i2c_driver_ctx_t* ctx, uint32_t timeout_us);
+
+/**
+ * @brief Wait for transfers started on several buses.
+ *
+ * Used to sample devices on independent PIO buses in parallel: start a
+ * DMA read on every bus, then wait for all of them with one deadline.
+ *
+ * @param ctxs Array of driver contexts, NULL entries are skipped.
+ * @param count Number of contexts.
+ * @param timeout_us Maximum total time to wait in microseconds.
+ * @return true if every transfer succeeded, false otherwise.
+ */
+bool i2c_driver_wait_all(i2c_driver_ctx_t* const* ctxs, size_t count, uint32_t timeout_us);
+
+/**
+ * @brief Reset bus statistics, keeping the current clock.
+ * 
+ * @param ctx Pointer to driver context.
+ */
+void i2c_driver_reset_stats(i2c_driver_ctx_t* ctx);
+
+/**
+ * @brief Change the bus clock.
+ * 
+ * The new clock also becomes the ceiling for automatic clock fallback.
+ * 
+ * @param ctx Pointer to driver context.
+ * @param clock_freq Clock frequency in Hz.
+ * @return true if applied, false if a transfer is in flight or the arguments are invalid.
+ */
+bool i2c_driver_set_clock(i2c_driver_ctx_t* ctx, uint32_t clock_freq);
+
 /**
  * @brief Set the callback for DMA completion.
  * 
@@ -0,0 +1,123 @@
+/**
+* @file i2c_pio.h
+* @brief PIO I2C master backend for the I2C driver.
+* @date 2025-05-26
+*
+* Runs an I2C master on a PIO state machine so more buses can run
+* concurrently than the two I2C controllers allow. Each transfer is built as
+* a list of FIFO command words in the driver context, and a pair of DMA
+* channels feeds the TX FIFO and drains the RX FIFO. Completion is signalled
+* from the DMA interrupt, and an unexpected NAK from the PIO interrupt.
+*
+* These functions are called through i2c_driver.h, not directly.
+*/
+
+#ifndef I2C_PIO_H
+#define I2C_PIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "i2c_driver.h"
+
+/**
+ * @defgroup i2c_pio_api PIO I2C Backend Interface
+ * @{
+ */
+
+/**
+ * @brief Release the state machine, DMA channels and program of a PIO bus.
+ *
+ * @param ctx Pointer to driver context.
+ */
+void i2c_pio_deinit(i2c_driver_ctx_t* ctx);
+
+/**
+ * @brief Claim a state machine and DMA channels and start the bus.
+ *
+ * @param ctx Pointer to driver context, clock_freq and pins already set.
+ * @param config Pointer to driver configuration.
+ * @return true if successful, false otherwise.
+ */
+bool i2c_pio_init(i2c_driver_ctx_t* ctx, const i2c_driver_config_t* config);
+
+/**
+ * @brief Start a read transfer.
+ *
+ * @param ctx Pointer to driver context.
+ * @param dev_addr I2C device address.
+ * @param has_reg Whether to write reg_addr before a repeated START.
+ * @param reg_addr Register address to read from.
+ * @param data Buffer to store read data, valid until completion.
+ * @param len Number of bytes to read, at most I2C_DRIVER_PIO_MAX_TRANSFER.
+ * @param callback Function to call on completion (can be NULL).
+ * @param user_data User data to pass to callback.
+ * @return true if the transfer was started, false if busy or invalid.
+ */
+__attribute__((section(".time_critical")))
+bool i2c_pio_read(i2c_driver_ctx_t* ctx, uint8_t dev_addr, bool has_reg, uint8_t reg_addr,
+    uint8_t* data, size_t len, void (*callback)(void* user_data), void* user_data);
+
+/**
+ * @brief Restart the state machine after i2c_pio_suspend().
+ *
+ * Takes the pins back from SIO and applies ctx->clock_freq.
+ *
+ * @param ctx Pointer to driver context.
+ */
+void i2c_pio_resume(i2c_driver_ctx_t* ctx);
+
+/**
+ * @brief Apply ctx->clock_freq to a running bus.
+ *
+ * @param ctx Pointer to driver context, with no transfer in flight.
+ */
+void i2c_pio_set_clock(i2c_driver_ctx_t* ctx);
+
+/**
+ * @brief Abort any transfer and stop the state machine.
+ *
+ * Leaves the pins with normal output enables so they can be driven from
+ * SIO during bus recovery.
+ *
+ * @param ctx Pointer to driver context.
+ */
+void i2c_pio_suspend(i2c_driver_ctx_t* ctx);
+
+/**
+ * @brief Wait for the in-flight transfer, aborting it on timeout.
+ *
+ * @param ctx Pointer to driver context.
+ * @param timeout_us Maximum time to wait in microseconds.
+ * @return true if the last transfer succeeded, false otherwise.
+ */
+bool i2c_pio_wait(i2c_driver_ctx_t* ctx, uint32_t timeout_us);
+
+/**
+ * @brief Start a register write transfer.
+ *
+ * @param ctx Pointer to driver context.
+ * @param dev_addr I2C device address.
+ * @param reg_addr Register address to write to.
+ * @param data Data to write, copied into the command list.
+ * @param len Number of bytes to write, at most I2C_DRIVER_PIO_MAX_TRANSFER.
+ * @param callback Function to call on completion (can be NULL).
+ * @param user_data User data to pass to callback.
+ * @return true if the transfer was started, false if busy or invalid.
+ */
+__attribute__((section(".time_critical")))
+bool i2c_pio_write(i2c_driver_ctx_t* ctx, uint8_t dev_addr, uint8_t reg_addr,
+    const uint8_t* data, size_t len, void (*callback)(void* user_data), void* user_data);
+
+/** @} */ // end of i2c_pio_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // I2C_PIO_H
@@ -0,0 +1,180 @@
+/**
+* @file spi_bus.h
+* @brief Shared SPI bus with per-device settings and prioritized transaction queueing
+* @date 2025-05-25
+*/
+
+#ifndef SPI_BUS_H
+#define SPI_BUS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "spi_driver.h"
+
+/** Maximum number of devices on one bus */
+#define SPI_BUS_MAX_DEVICES 4
+
+/** Queued transactions per priority lane */
+#define SPI_BUS_QUEUE_DEPTH 8
+
+/**
+ * @brief Priority lanes, served strictly in order
+ *
+ * Transactions are not preempted, so bulk devices should keep individual
+ * transactions short to bound the latency seen by the realtime lane.
+ */
+typedef enum {
+    SPI_BUS_LANE_REALTIME = 0, // IMU and other periodic sensor reads
+    SPI_BUS_LANE_NORMAL,       // Configuration and occasional accesses
+    SPI_BUS_LANE_BULK,         // SD card and other large transfers
+    SPI_BUS_LANE_COUNT
+} spi_bus_lane_t;
+
+/**
+ * @brief Transaction types
+ */
+typedef enum {
+    SPI_BUS_OP_READ_REG = 0,   // [reg | 0x80] then read len bytes
+    SPI_BUS_OP_WRITE_REG,      // [reg & 0x7F] then write len bytes
+    SPI_BUS_OP_TRANSFER        // Full-duplex, either buffer may be NULL
+} spi_bus_op_t;
+
+/**
+ * @brief SPI bus configuration structure
+ */
+typedef struct {
+    spi_inst_t* spi_inst;      /**< SPI hardware instance (spi0 or spi1) */
+    uint sck_pin;              /**< GPIO pin number for SCK */
+    uint mosi_pin;             /**< GPIO pin number for MOSI */
+    uint miso_pin;             /**< GPIO pin number for MISO */
+} spi_bus_config_t;
+
+/**
+ * @brief SPI device configuration structure
+ */
+typedef struct {
+    uint cs_pin;               /**< GPIO pin number for CS */
+    bool cs_active_low;        /**< Whether CS is active low */
+    uint baudrate;             /**< SPI clock frequency in Hz */
+    uint data_bits;            /**< Number of data bits, must be 8 (transfers use 8-bit DMA) */
+    spi_cpol_t cpol;           /**< Clock polarity (CPOL) */
+    spi_cpha_t cpha;           /**< Clock phase (CPHA) */
+    spi_order_t order;         /**< Bit order, must be SPI_MSB_FIRST (the only order the PL022 supports) */
+    spi_bus_lane_t lane;       /**< Priority lane for this device's transactions */
+    const char* name;          /**< Name for identification */
+} spi_device_config_t;
+
+/**
+ * @brief Forward declaration of bus and device handles
+ */
+typedef struct spi_bus_s* spi_bus_t;
+typedef struct spi_device_s* spi_device_t;
+
+/**
+ * @brief Transaction completion callback, called from the DMA interrupt
+ */
+typedef void (*spi_bus_callback_t)(bool success, void* user_data);
+
+/**
+ * @brief Queued transaction
+ *
+ * Buffers must remain valid until the callback runs.
+ */
+typedef struct {
+    spi_device_t device;       /**< Target device */
+    spi_bus_op_t op;           /**< Transaction type */
+    uint8_t reg_addr;          /**< Register address for register operations */
+    const uint8_t* tx_data;    /**< Data to write */
+    uint8_t* rx_data;          /**< Buffer for read data */
+    size_t len;                /**< Number of data bytes */
+    spi_bus_callback_t callback; /**< Completion callback (can be NULL) */
+    void* user_data;           /**< User data for the callback */
+} spi_bus_transaction_t;
+
+/**
+ * @brief Bus statistics
+ */
+typedef struct {
+    uint32_t transactions[SPI_BUS_LANE_COUNT];  /**< Completed transactions per lane */
+    uint32_t max_wait_us[SPI_BUS_LANE_COUNT];   /**< Longest queueing delay per lane */
+    uint32_t queue_full[SPI_BUS_LANE_COUNT];    /**< Rejected submissions per lane */
+    uint32_t failures;                          /**< Transactions that could not be started */
+    uint32_t reconfigurations;                  /**< Peripheral baud/format changes */
+} spi_bus_stats_t;
+
+/**
+ * @brief Add a device to the bus
+ *
+ * Bus transfers move bytes by DMA and the RP2350 SPI peripheral only
+ * shifts MSB first, so devices must use 8 data bits and SPI_MSB_FIRST.
+ *
+ * @param bus Bus handle
+ * @param config Device configuration
+ * @return Device handle, or NULL if the bus is full or the configuration is unsupported
+ */
+spi_device_t spi_bus_add_device(spi_bus_t bus, const spi_device_config_t* config);
+
+/**
+ * @brief Create a shared SPI bus
+ *
+ * The bus owns the SPI peripheral and always transfers using DMA.
+ *
+ * @param config Bus configuration
+ * @return Bus handle or NULL if creation failed
+ */
+spi_bus_t spi_bus_create(const spi_bus_config_t* config);
+
+/**
+ * @brief Destroy a bus once its queues are empty
+ *
+ * @param bus Bus handle
+ * @return true if destroyed, false if transactions are pending
+ */
+bool spi_bus_destroy(spi_bus_t bus);
+
+/**
+ * @brief Get default device configuration
+ *
+ * @param config Pointer to configuration structure to fill
+ */
+void spi_bus_get_default_device_config(spi_device_config_t* config);
+
+/**
+ * @brief Get bus statistics
+ *
+ * @param bus Bus handle
+ * @param stats Structure to fill
+ * @return true if successful, false otherwise
+ */
+bool spi_bus_get_stats(spi_bus_t bus, spi_bus_stats_t* stats);
+
+/**
+ * @brief Check whether a bus has queued or active transactions
+ *
+ * @param bus Bus handle
+ * @return true if busy, false if idle
+ */
+bool spi_bus_is_busy(spi_bus_t bus);
+
+/**
+ * @brief Queue a transaction on its device's lane
+ *
+ * The peripheral is only reconfigured when the device's baud rate or
+ * format differ from the previous transaction.
+ *
+ * @param txn Transaction, copied into the queue
+ * @return true if queued, false if the lane is full or the transaction is invalid
+ */
+__attribute__((section(".time_critical")))
+bool spi_bus_submit(const spi_bus_transaction_t* txn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SPI_BUS_H
@@ -18,6 +18,12 @@
 extern "C" {
 #endif
 
+/** Maximum number of SPI driver contexts using DMA at the same time (one per SPI block) */
+#define SPI_DRIVER_MAX_DMA_CTX 2
+
+/** Byte clocked out while reading */
+#define SPI_DRIVER_DUMMY_BYTE 0xFF
+
 /**
  * @brief SPI driver configuration structure
  */
@@ -46,8 +52,15 @@ typedef struct {
     uint cs_pin;               /**< Chip select pin */
     bool cs_active_low;        /**< Whether CS is active low */
     bool initialized;          /**< Whether the driver is initialized */
-    uint8_t dma_tx_channel;    /**< DMA channel for transmit */
-    uint8_t dma_rx_channel;    /**< DMA channel for receive */
+    uint8_t dma_tx_channel;    /**< DMA channel for transmit (command byte or full buffer) */
+    uint8_t dma_rx_channel;    /**< DMA channel for receive (captured data) */
+    uint8_t dma_tx_fill_channel;    /**< DMA channel chained after the command byte (fill or write data) */
+    uint8_t dma_rx_discard_channel; /**< DMA channel draining RX bytes that are not kept */
+    uint8_t dma_done_channel;  /**< Channel whose completion ends the current transaction */
+    uint8_t dma_cmd;           /**< Command byte streamed by the TX channel */
+    uint8_t dma_discard;       /**< Sink for discarded RX bytes */
+    volatile bool dma_busy;    /**< Whether a DMA transaction is in flight */
+    bool dma_cs_asserted;      /**< Whether CS is released by the DMA completion IRQ */
     bool use_dma;              /**< Whether DMA is enabled */
     
     // Callback for DMA completion
@@ -94,9 +107,22 @@ bool spi_driver_read_bytes(spi_driver_ctx_t* ctx,
 bool spi_driver_write_bytes(spi_driver_ctx_t* ctx,
                            uint8_t reg_addr, const uint8_t* data, size_t len);
 
+/**
+ * @brief Check whether a DMA transaction is in flight
+ * 
+ * @param ctx Pointer to driver context
+ * @return true if busy, false otherwise
+ */
+bool spi_driver_dma_busy(spi_driver_ctx_t* ctx);
+
 /**
  * @brief Read data from an SPI device using DMA
  * 
+ * The whole transaction runs on chained DMA channels: TX streams
+ * [reg_addr | 0x80, dummy...] while RX discards the command byte and
+ * captures the data. CS is asserted on start and released from the DMA
+ * completion interrupt before the callback runs.
+ * 
  * @param ctx Pointer to driver context
  * @param reg_addr Register address to read from
  * @param data Buffer to store read data
@@ -112,6 +138,10 @@ bool spi_driver_read_bytes_dma(spi_driver_ctx_t* ctx,
 /**
  * @brief Write data to an SPI device using DMA
  * 
+ * The register address and data are sent on chained DMA channels and CS
+ * is released from the DMA completion interrupt. The data buffer must
+ * remain valid until the callback runs.
+ * 
  * @param ctx Pointer to driver context
  * @param reg_addr Register address to write to
  * @param data Data to write
@@ -139,6 +169,9 @@ bool spi_driver_transfer(spi_driver_ctx_t* ctx,
 /**
  * @brief Perform a simultaneous read/write operation using DMA (full-duplex)
  * 
+ * CS is left to the caller. Either buffer may be NULL, in which case dummy
+ * bytes are sent or received bytes are discarded.
+ * 
  * @param ctx Pointer to driver context
  * @param tx_data Data to write
  * @param rx_data Buffer to store read data
@@ -167,6 +200,19 @@ bool spi_driver_select(spi_driver_ctx_t* ctx);
  */
 bool spi_driver_deselect(spi_driver_ctx_t* ctx);
 
+/**
+ * @brief Change the chip select pin driven by the driver
+ * 
+ * Configures the pin as an output at its deasserted level. Nothing is
+ * done when the pin and polarity are already in use.
+ * 
+ * @param ctx Pointer to driver context
+ * @param cs_pin GPIO pin number for CS, -1 for none
+ * @param cs_active_low Whether CS is active low
+ * @return true if successful, false otherwise
+ */
+bool spi_driver_set_cs(spi_driver_ctx_t* ctx, uint cs_pin, bool cs_active_low);
+
 /**
  * @brief Set the callback for DMA completion
  * 
@@ -0,0 +1,146 @@
+/**
+* @file interp_accel.h
+* @brief SIO interpolator accelerated clamped linear mapping.
+* @date 2025-05-25
+*
+* Maps fixed-point inputs onto an output range with clamping, as used for
+* servo angle to pulse conversion, and in batches for raw to engineering
+* unit conversion of sensor samples. On device, INTERP1 lane 0 of the calling
+* core does the sign handling and clamp in a single write/read, followed by
+* a single integer multiply. Host builds, or cores where the lane is
+* already claimed, use an equivalent software path.
+*/
+
+#ifndef INTERP_ACCEL_H
+#define INTERP_ACCEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup interp_const Interpolator Configuration Constants
+ * @{
+ */
+
+/** Samples per benchmark batch. */
+#define INTERP_ACCEL_BENCH_BATCH 256
+
+/** @} */ // end of interp_const group
+
+/**
+ * @defgroup interp_struct Interpolator Data Structures
+ * @{
+ */
+
+/**
+ * @brief Clamped linear map, precomputed by interp_accel_linear_init().
+ */
+typedef struct {
+    int32_t in_lo;                  // Lower input clamp.
+    int32_t in_hi;                  // Upper input clamp.
+    int32_t out_lo;                 // Output at in_lo.
+    int32_t gain_q16;               // Output per input unit. (Q16.16)
+} interp_accel_linear_t;
+
+/**
+ * @brief Benchmark result, times in nanoseconds per sample.
+ */
+typedef struct {
+    uint32_t samples;               // Samples converted per path.
+    uint32_t hw_ns;                 // Interpolator path.
+    uint32_t sw_ns;                 // Integer software fallback.
+    uint32_t float_ns;              // Float clamp and scale reference.
+    uint32_t mismatches;            // Samples where hardware and software differ.
+    bool hw_available;              // Interpolator usable on this core.
+} interp_accel_bench_t;
+
+/** @} */ // end of interp_struct group
+
+/**
+ * @defgroup interp_api Interpolator Application Programming Interface
+ * @{
+ */
+
+/**
+ * @brief Run the hardware, software and float paths over the same input.
+ *
+ * @param iterations Number of INTERP_ACCEL_BENCH_BATCH sample batches.
+ * @param result Structure to fill.
+ * @return true if successful.
+ * @return false if the arguments are invalid.
+ */
+bool interp_accel_benchmark(uint32_t iterations, interp_accel_bench_t* result);
+
+/**
+ * @brief Whether the interpolator is used on the calling core.
+ *
+ * Configures the core's interpolator on first use.
+ *
+ * @return true if the hardware path is active.
+ */
+bool interp_accel_hw_available(void);
+
+/**
+ * @brief Map a single input.
+ *
+ * @param map Precomputed map.
+ * @param in Input value.
+ * @return Clamped, scaled output.
+ */
+__attribute__((section(".time_critical")))
+int32_t interp_accel_linear(const interp_accel_linear_t* map, int32_t in);
+
+/**
+ * @brief Map a batch of raw 16-bit samples.
+ *
+ * No sensor adapter uses this yet: the BMM350 adapter receives compensated
+ * float data from the vendor API, and the generic I2C and SPI adapters
+ * pass sensor_data_t through unchanged. It is meant for adapters that read
+ * raw registers, and is exercised by 'hw_stats interp'.
+ *
+ * @param map Precomputed map.
+ * @param raw Raw samples.
+ * @param out Output array, may not alias raw.
+ * @param count Number of samples.
+ */
+__attribute__((section(".time_critical")))
+void interp_accel_linear_batch(const interp_accel_linear_t* map, const int16_t* raw,
+    int32_t* out, uint32_t count);
+
+/**
+ * @brief Precompute a clamped linear map.
+ *
+ * in_lo maps to out_lo and in_hi to out_hi. out_hi may be lower than
+ * out_lo to invert the mapping.
+ *
+ * @param map Map to initialize.
+ * @param in_lo Lower input bound.
+ * @param in_hi Upper input bound, must be greater than in_lo.
+ * @param out_lo Output at in_lo.
+ * @param out_hi Output at in_hi.
+ * @return true if successful.
+ * @return false if the bounds are invalid.
+ */
+bool interp_accel_linear_init(interp_accel_linear_t* map, int32_t in_lo, int32_t in_hi,
+    int32_t out_lo, int32_t out_hi);
+
+/**
+ * @brief Map a single input without the interpolator.
+ *
+ * @param map Precomputed map.
+ * @param in Input value.
+ * @return Clamped, scaled output.
+ */
+int32_t interp_accel_linear_sw(const interp_accel_linear_t* map, int32_t in);
+
+/** @} */ // end of interp_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INTERP_ACCEL_H
@@ -0,0 +1,249 @@
+/**
+* @file adc_manager.h
+* @brief DMA-driven multi-channel ADC acquisition.
+* @date 2025-05-27
+*
+* The enabled ADC inputs are sampled round robin by the free-running ADC.
+* Results go through the ADC FIFO into two DMA buffers used alternately,
+* so one fills while the other is processed. The DMA completion interrupt
+* splits each buffer by input, averages every input down by its own
+* decimation factor, converts it to a physical value, timestamps it and
+* appends it to that input's ring.
+* Consumers read a ring with their own cursor, or just take the latest
+* value, so reading a measurement never starts a conversion.
+*/
+
+#ifndef ADC_MANAGER_H
+#define ADC_MANAGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup adc_man_const ADC Manager Configuration Constants
+ * @{
+ */
+
+/** ADC inputs, GPIO26 to GPIO29 and the temperature sensor. */
+#define ADC_MANAGER_MAX_INPUTS 5
+
+/** Input connected to the on-chip temperature sensor. */
+#define ADC_MANAGER_TEMP_INPUT 4
+
+/** Samples held per input ring, must be a power of two. */
+#define ADC_MANAGER_RING_SAMPLES 256
+
+/** Round robin passes per DMA buffer. */
+#define ADC_MANAGER_PASSES_PER_BUFFER 16
+
+/** Maximum conversions per second over all inputs. */
+#define ADC_MANAGER_MAX_CONVERSION_HZ 500000
+
+/** @} */ // end of adc_man_const group
+
+/**
+ * @defgroup adc_man_enum ADC Manager Enumerations
+ * @{
+ */
+
+/**
+ * @brief What an ADC input measures.
+ */
+typedef enum {
+    ADC_ROLE_NONE = 0,              // Input not sampled.
+    ADC_ROLE_RAW,                   // Volts at the pin, scaled by gain and offset.
+    ADC_ROLE_BATTERY_VOLTAGE,       // Battery voltage in volts.
+    ADC_ROLE_SERVO_CURRENT,         // Servo supply current in amps.
+    ADC_ROLE_TEMPERATURE,           // Temperature in degrees Celsius.
+    ADC_ROLE_EMG                    // Analog EMG front end output.
+} adc_role_t;
+
+/** @} */ // end of adc_man_enum group
+
+/**
+ * @defgroup adc_man_struct ADC Manager Data Structures
+ * @{
+ */
+
+/**
+ * @brief Configuration of one ADC input.
+ *
+ * The value stored is (volts - offset) * gain, except the temperature
+ * role which applies the RP2350 sensor curve to the averaged volts.
+ */
+typedef struct {
+    adc_role_t role;                // What the input measures, ADC_ROLE_NONE to skip it.
+    uint16_t decimation;            // Raw samples averaged per stored sample, at least 1.
+    float gain;                     // Units per volt, e.g. the divider ratio or 1 / (shunt * amplifier gain).
+    float offset;                   // Volts subtracted before the gain, e.g. an amplifier bias.
+} adc_manager_input_config_t;
+
+/**
+ * @brief ADC manager configuration.
+ */
+typedef struct {
+    uint32_t sample_rate_hz;        // Raw samples per second of each enabled input.
+    adc_manager_input_config_t inputs[ADC_MANAGER_MAX_INPUTS]; // Per-input configuration.
+} adc_manager_config_t;
+
+/**
+ * @brief One stored sample.
+ */
+typedef struct {
+    uint32_t time_us;               // time_us_32() of the last raw sample averaged in.
+    float value;                    // Converted value.
+} adc_manager_sample_t;
+
+/**
+ * @brief Acquisition statistics.
+ */
+typedef struct {
+    uint32_t buffers;               // DMA buffers processed.
+    uint32_t fifo_overflows;        // Times the ADC FIFO overflowed and the round robin was restarted.
+    uint32_t samples[ADC_MANAGER_MAX_INPUTS]; // Samples stored per input.
+    uint32_t last_isr_us;           // Time spent on the last buffer.
+    uint32_t max_isr_us;            // Worst time spent on a buffer.
+} adc_manager_stats_t;
+
+/** @} */ // end of adc_man_struct group
+
+/**
+ * @defgroup adc_man_api ADC Manager Application Programming Interface
+ * @{
+ */
+
+/**
+ * @brief Find the first input with a role.
+ *
+ * @param role Role to look for.
+ * @return Input number, or -1 if no input has the role.
+ */
+int adc_manager_find_role(adc_role_t role);
+
+/**
+ * @brief Get the current configuration.
+ *
+ * @param config Configuration to fill.
+ */
+void adc_manager_get_config(adc_manager_config_t* config);
+
+/**
+ * @brief Get default configuration, the temperature sensor at 10 Hz.
+ *
+ * @param config Configuration to fill.
+ */
+void adc_manager_get_default_config(adc_manager_config_t* config);
+
+/**
+ * @brief Get the newest sample of an input.
+ *
+ * @param input ADC input.
+ * @param sample Filled with the sample.
+ * @return true if the input has produced a sample.
+ */
+__attribute__((section(".time_critical")))
+bool adc_manager_get_latest(uint8_t input, adc_manager_sample_t* sample);
+
+/**
+ * @brief Get read access to the ring of an input, without copying.
+ *
+ * Sample n (counting from 0 since the start) is at
+ * ring[n & (ADC_MANAGER_RING_SAMPLES - 1)] while head - n is at most
+ * ADC_MANAGER_RING_SAMPLES - ADC_MANAGER_PASSES_PER_BUFFER. Read the head
+ * again afterwards and discard what was read if it moved past that.
+ *
+ * @param input ADC input.
+ * @param head Set to the number of samples ever stored.
+ * @return Ring of the input, or NULL if the input is invalid.
+ */
+__attribute__((section(".time_critical")))
+const adc_manager_sample_t* adc_manager_get_ring(uint8_t input, uint32_t* head);
+
+/**
+ * @brief Get the acquisition statistics.
+ *
+ * @param stats Statistics to fill.
+ */
+void adc_manager_get_stats(adc_manager_stats_t* stats);
+
+/**
+ * @brief Sum the newest samples of every input with a role.
+ *
+ * @param role Role to look for.
+ * @param value Set to the sum.
+ * @return true if at least one input with the role has produced a sample.
+ */
+bool adc_manager_get_role_value(adc_role_t role, float* value);
+
+/**
+ * @brief Initialize the ADC and DMA and start sampling.
+ *
+ * @param config Configuration, NULL for defaults.
+ * @return true if successful, false otherwise.
+ */
+bool adc_manager_init(const adc_manager_config_t* config);
+
+/**
+ * @brief Whether the ADC is owned by the manager and sampling.
+ *
+ * While it is, other code must not call adc_read() or adc_init().
+ *
+ * @return true if sampling.
+ */
+bool adc_manager_is_running(void);
+
+/**
+ * @brief Read the samples of an input stored since a cursor.
+ *
+ * Start with a cursor of 0. Each reader keeps its own cursor, so several
+ * consumers can follow the same input. If the reader fell more than a
+ * ring behind, the oldest samples are skipped.
+ *
+ * @param input ADC input.
+ * @param cursor Reader position, advanced past the samples returned.
+ * @param samples Buffer for samples, oldest first.
+ * @param max_samples Size of samples.
+ * @param dropped Set to the number of skipped samples (can be NULL).
+ * @return Number of samples read, or -1 if the input is invalid.
+ */
+__attribute__((section(".time_critical")))
+int adc_manager_read(uint8_t input, uint32_t* cursor, adc_manager_sample_t* samples, int max_samples, uint32_t* dropped);
+
+/**
+ * @brief Apply a new configuration, restarting the acquisition.
+ *
+ * @param config New configuration.
+ * @return true if successful, false if the configuration is invalid.
+ */
+bool adc_manager_reconfigure(const adc_manager_config_t* config);
+
+/**
+ * @brief Stop sampling, the DMA channels stay claimed for a restart.
+ */
+void adc_manager_stop(void);
+
+/**
+ * @brief Shell command handler for the ADC manager.
+ *
+ * @param argc Argument count.
+ * @param argv Argument values.
+ * @return 0 on success, non-zero on failure.
+ */
+int cmd_adc(int argc, char *argv[]);
+
+/**
+ * @brief Register ADC manager shell commands.
+ */
+void register_adc_manager_commands(void);
+
+/** @} */ // end of adc_man_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADC_MANAGER_H
@@ -0,0 +1,249 @@
+/**
+* @file blackbox_manager.h
+* @brief Black-box recorder for sensor samples and servo setpoints.
+* @date 2025-05-27
+*
+* Sensor samples and servo setpoints are recorded into a RAM ring. When a
+* trigger fires (fault, task stall, shell command or GPIO edge) the samples
+* from the pre-trigger window are kept, recording continues for the
+* post-trigger window, and the capture is then compressed with ts_codec and
+* written to a flash slot a few pages per task run so the write never blocks
+* for long.
+* Captures survive a reboot and can be listed, decoded and dumped from the
+* shell.
+*/
+
+#ifndef BLACKBOX_MANAGER_H
+#define BLACKBOX_MANAGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "i2c_sensor_adapter.h"
+
+/**
+ * @defgroup blackbox_const Black Box Configuration Constants
+ * @{
+ */
+
+/** Samples held in the RAM ring, must be a power of two. */
+#define BLACKBOX_RING_SAMPLES 2048
+
+/** Flash region for captures, after the log region. */
+#define BLACKBOX_FLASH_OFFSET (1280 * 1024)
+
+/** Number of capture slots in the flash region. */
+#define BLACKBOX_SLOTS 4
+
+/** Size of one capture slot. */
+#define BLACKBOX_SLOT_SIZE (32 * 1024)
+
+/** Values stored per sample. */
+#define BLACKBOX_SAMPLE_VALUES 3
+
+/** @} */ // end of blackbox_const group
+
+/**
+ * @defgroup blackbox_enum Black Box Enumerations
+ * @{
+ */
+
+/**
+ * @brief Recorder state.
+ */
+typedef enum {
+    BLACKBOX_STATE_DISABLED = 0,    // Not initialized.
+    BLACKBOX_STATE_ARMED,           // Recording, waiting for a trigger.
+    BLACKBOX_STATE_TRIGGERED,       // Recording the post-trigger window.
+    BLACKBOX_STATE_WRITING          // Frozen while the capture is written to flash.
+} blackbox_state_t;
+
+/**
+ * @brief What fired the trigger.
+ */
+typedef enum {
+    BLACKBOX_TRIGGER_SHELL = 0,     // Shell command.
+    BLACKBOX_TRIGGER_GPIO,          // Edge on the trigger GPIO.
+    BLACKBOX_TRIGGER_STALL,         // Watchdog heartbeat missed.
+    BLACKBOX_TRIGGER_DEADLINE,      // Hard deadline missed.
+    BLACKBOX_TRIGGER_FAULT,         // MPU fault.
+    BLACKBOX_TRIGGER_USER           // Application request.
+} blackbox_trigger_t;
+
+/**
+ * @brief Kind of recorded sample.
+ */
+typedef enum {
+    BLACKBOX_SAMPLE_SENSOR = 0,     // Sensor reading, channel is the sensor type.
+    BLACKBOX_SAMPLE_SERVO           // Servo setpoint, channel is the servo ID.
+} blackbox_sample_kind_t;
+
+/** @} */ // end of blackbox_enum group
+
+/**
+ * @defgroup blackbox_struct Black Box Data Structures
+ * @{
+ */
+
+/**
+ * @brief Recorder configuration.
+ */
+typedef struct {
+    uint32_t pre_trigger_ms;        // History kept from before the trigger.
+    uint32_t post_trigger_ms;       // Recording time after the trigger.
+    int trigger_gpio;               // GPIO that triggers on a falling edge, -1 for none.
+    float sensor_scale;             // Sensor values are stored as round(value * scale), 0 for lossless.
+    float servo_scale;              // Servo setpoints are stored as round(value * scale), 0 for lossless.
+} blackbox_manager_config_t;
+
+/**
+ * @brief Decoded sample.
+ */
+typedef struct {
+    uint32_t time_us;               // time_us_32() when recorded.
+    blackbox_sample_kind_t kind;    // Sample kind.
+    uint8_t channel;                // Sensor type or servo ID.
+    float values[BLACKBOX_SAMPLE_VALUES]; // Values, servo setpoints only use the first.
+} blackbox_sample_t;
+
+/**
+ * @brief Capture stored in a flash slot.
+ */
+typedef struct {
+    uint32_t capture_id;            // Increasing capture number.
+    blackbox_trigger_t reason;      // What fired the trigger.
+    uint32_t trigger_ms;            // Milliseconds since boot at the trigger.
+    uint32_t sample_count;          // Samples in the capture.
+    uint32_t pre_samples;           // Samples recorded before the trigger.
+    uint32_t duration_us;           // Time from first to last sample.
+    uint32_t data_len;              // Compressed bytes.
+} blackbox_capture_info_t;
+
+/**
+ * @brief Called for each decoded sample, return false to stop.
+ */
+typedef bool (*blackbox_sample_callback_t)(const blackbox_sample_t* sample, void* user_data);
+
+/** @} */ // end of blackbox_struct group
+
+/**
+ * @defgroup blackbox_api Black Box Application Programming Interface
+ * @{
+ */
+
+/**
+ * @brief Decode the samples of a stored capture.
+ *
+ * Not reentrant, the decoder state is static.
+ *
+ * @param slot Capture slot.
+ * @param callback Function called for each sample, oldest first.
+ * @param user_data User data to pass to callback.
+ * @return Number of samples decoded, or -1 if the slot holds no capture.
+ */
+int blackbox_manager_decode(uint32_t slot, blackbox_sample_callback_t callback, void* user_data);
+
+/**
+ * @brief Get the capture stored in a slot.
+ *
+ * @param slot Capture slot.
+ * @param info Filled with the capture details.
+ * @param data Set to the compressed data in flash (can be NULL).
+ * @return true if the slot holds a capture.
+ */
+bool blackbox_manager_get_capture(uint32_t slot, blackbox_capture_info_t* info, const uint8_t** data);
+
+/**
+ * @brief Get default recorder configuration.
+ *
+ * @param config Configuration to fill.
+ */
+void blackbox_manager_get_default_config(blackbox_manager_config_t* config);
+
+/**
+ * @brief Get the recorder state.
+ *
+ * @return Current state.
+ */
+blackbox_state_t blackbox_manager_get_state(void);
+
+/**
+ * @brief Initialize the recorder and create its task.
+ *
+ * @param config Configuration, NULL for defaults.
+ * @return true if successful, false otherwise.
+ */
+bool blackbox_manager_init(const blackbox_manager_config_t* config);
+
+/**
+ * @brief MPU fault handler that fires the trigger.
+ *
+ * Registered with scheduler_mpu_register_fault_handler() when the MPU is used.
+ *
+ * @param task_id Faulting task.
+ * @param fault_addr Faulting address.
+ * @param fault_type Fault type.
+ */
+void blackbox_manager_mpu_fault(uint32_t task_id, void* fault_addr, uint32_t fault_type);
+
+/**
+ * @brief Record a sensor reading.
+ *
+ * @param type Sensor type.
+ * @param data Sensor reading.
+ */
+__attribute__((section(".time_critical")))
+void blackbox_manager_record_sensor(sensor_type_t type, const sensor_data_t* data);
+
+/**
+ * @brief Record a servo setpoint.
+ *
+ * @param id Servo ID.
+ * @param position Commanded position.
+ */
+__attribute__((section(".time_critical")))
+void blackbox_manager_record_servo(uint32_t id, float position);
+
+/**
+ * @brief Fire the trigger.
+ *
+ * Safe to call from interrupt context. Ignored unless armed.
+ *
+ * @param reason What fired the trigger.
+ * @return true if a capture was started.
+ */
+bool blackbox_manager_trigger(blackbox_trigger_t reason);
+
+/**
+ * @brief Recorder task, writes finished captures to flash.
+ *
+ * @param params Unused.
+ */
+void blackbox_manager_task(void* params);
+
+/**
+ * @brief Shell command handler for the recorder.
+ *
+ * @param argc Argument count.
+ * @param argv Argument values.
+ * @return 0 on success, non-zero on failure.
+ */
+int cmd_blackbox(int argc, char *argv[]);
+
+/**
+ * @brief Register recorder shell commands.
+ */
+void register_blackbox_manager_commands(void);
+
+/** @} */ // end of blackbox_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLACKBOX_MANAGER_H
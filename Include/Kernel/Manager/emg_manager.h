@@ -0,0 +1,162 @@
+/**
+* @file emg_manager.h
+* @brief Myoelectric control of the hand from ADC EMG streams.
+* @date 2025-05-27
+*
+* The ADC inputs with the EMG role are followed in input order, the first
+* is the close channel and the second, if present, the open channel. Their
+* samples run through emg_pipeline in blocks, and the resulting grasp level
+* is mapped to a position per servo between its open and closed setpoints.
+* The servos are moved together with one servo_manager_set_batch() call.
+* Control starts disabled so the hand never moves before it is calibrated.
+*/
+
+#ifndef EMG_MANAGER_H
+#define EMG_MANAGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "emg_pipeline.h"
+
+/**
+ * @defgroup emg_man_const EMG Manager Configuration Constants
+ * @{
+ */
+
+/** Servos driven by the grasp level. */
+#define EMG_MANAGER_MAX_SERVOS 8
+
+/** @} */ // end of emg_man_const group
+
+/**
+ * @defgroup emg_man_struct EMG Manager Data Structures
+ * @{
+ */
+
+/**
+ * @brief Grasp mapping of one servo.
+ */
+typedef struct {
+    uint32_t id;                    // Servo ID.
+    float open_percent;             // Position with the hand open.
+    float closed_percent;           // Position with the hand closed.
+} emg_manager_servo_t;
+
+/**
+ * @brief EMG manager configuration.
+ */
+typedef struct {
+    emg_pipeline_config_t pipeline; // Signal processing, the sample rate comes from the ADC.
+    uint32_t update_ms;             // Minimum time between servo updates.
+    float deadband;                 // Grasp change that triggers an update.
+    uint8_t servo_count;            // Servos in use.
+    emg_manager_servo_t servos[EMG_MANAGER_MAX_SERVOS]; // Servo mapping.
+} emg_manager_config_t;
+
+/**
+ * @brief EMG manager status.
+ */
+typedef struct {
+    bool enabled;                   // Whether the grasp level drives the servos.
+    uint8_t channels;               // EMG channels found.
+    uint8_t inputs[EMG_PIPELINE_MAX_CHANNELS]; // ADC input of each channel.
+    float envelope[EMG_PIPELINE_MAX_CHANNELS]; // Latest envelopes.
+    float activation[EMG_PIPELINE_MAX_CHANNELS]; // Latest activations.
+    float grasp;                    // Latest grasp level.
+    uint32_t blocks;                // Blocks processed per channel.
+    uint32_t dropped;               // Samples lost because the task fell behind the ADC.
+    uint32_t servo_updates;         // Batched servo updates issued.
+    uint32_t last_us_per_block;     // Processing time of the last block over all channels.
+    uint32_t max_us_per_block;      // Worst processing time.
+} emg_manager_status_t;
+
+/** @} */ // end of emg_man_struct group
+
+/**
+ * @defgroup emg_man_api EMG Manager Application Programming Interface
+ * @{
+ */
+
+/**
+ * @brief Store the current envelopes as the rest or maximum calibration.
+ *
+ * @param max false to calibrate rest, true to calibrate maximum contraction.
+ * @return true if there are EMG channels.
+ */
+bool emg_manager_calibrate(bool max);
+
+/**
+ * @brief Start driving the servos, rescanning the ADC for EMG inputs.
+ *
+ * @return true if at least one EMG input and one servo mapping exist.
+ */
+bool emg_manager_enable(void);
+
+/**
+ * @brief Stop driving the servos, processing continues.
+ */
+void emg_manager_disable(void);
+
+/**
+ * @brief Get default configuration, no servos mapped.
+ *
+ * @param config Configuration to fill.
+ */
+void emg_manager_get_default_config(emg_manager_config_t* config);
+
+/**
+ * @brief Get the status.
+ *
+ * @param status Status to fill.
+ */
+void emg_manager_get_status(emg_manager_status_t* status);
+
+/**
+ * @brief Initialize the manager and create its task.
+ *
+ * @param config Configuration, NULL for defaults.
+ * @return true if successful, false otherwise.
+ */
+bool emg_manager_init(const emg_manager_config_t* config);
+
+/**
+ * @brief Map a servo to the grasp level, replacing an existing mapping.
+ *
+ * @param servo Servo mapping.
+ * @return true if successful, false if all slots are used.
+ */
+bool emg_manager_map_servo(const emg_manager_servo_t* servo);
+
+/**
+ * @brief EMG task, processes new ADC samples and updates the servos.
+ *
+ * @param params Unused.
+ */
+void emg_manager_task(void* params);
+
+/**
+ * @brief Shell command handler for the EMG manager.
+ *
+ * @param argc Argument count.
+ * @param argv Argument values.
+ * @return 0 on success, non-zero on failure.
+ */
+int cmd_emg(int argc, char *argv[]);
+
+/**
+ * @brief Register EMG manager shell commands.
+ */
+void register_emg_manager_commands(void);
+
+/** @} */ // end of emg_man_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EMG_MANAGER_H
@@ -0,0 +1,185 @@
+/**
+ * @file emg_pipeline.h
+ * @brief Myoelectric signal processing from raw EMG to a grasp level
+ * @date 2025-05-27
+ *
+ * Each channel is processed in blocks of EMG_PIPELINE_BLOCK samples:
+ * - High pass, low pass and mains notch biquads in one
+ *   arm_biquad_cascade_df2T_f32 cascade, the EMG band pass.
+ * - An envelope over the last window_blocks blocks, either RMS from
+ *   arm_power_f32 or the mean absolute value of the rectified signal
+ *   from arm_abs_f32 and arm_mean_f32.
+ * - Normalization between the calibrated rest and maximum envelopes and
+ *   an on/off threshold with hysteresis, giving an activation of 0 to 1.
+ * The grasp level is the activation of the close channel minus that of
+ * the open channel, if there is one, slew limited.
+ *
+ * Only CMSIS-DSP and the C standard library are used, so emg_pipeline.c
+ * also builds on a host for Tools/emg_replay.c.
+ */
+
+#ifndef EMG_PIPELINE_H
+#define EMG_PIPELINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "arm_math.h"
+
+/**
+ * @defgroup emg_pipeline_const EMG Pipeline Constants
+ * @{
+ */
+
+/** Channels per pipeline. */
+#define EMG_PIPELINE_MAX_CHANNELS 4
+
+/** Samples per processed block. */
+#define EMG_PIPELINE_BLOCK 32
+
+/** Longest envelope window in blocks. */
+#define EMG_PIPELINE_MAX_WINDOW 16
+
+/** Biquads in the band pass cascade: high pass, low pass and notch. */
+#define EMG_PIPELINE_STAGES 3
+
+/** @} */ // end of emg_pipeline_const group
+
+/**
+ * @defgroup emg_pipeline_enum EMG Pipeline Enumerations
+ * @{
+ */
+
+/**
+ * @brief Envelope estimator.
+ */
+typedef enum {
+    EMG_ENVELOPE_RMS = 0,           // Root mean square.
+    EMG_ENVELOPE_MAV                // Mean absolute value of the rectified signal.
+} emg_envelope_t;
+
+/** @} */ // end of emg_pipeline_enum group
+
+/**
+ * @defgroup emg_pipeline_struct EMG Pipeline Data Structures
+ * @{
+ */
+
+/**
+ * @brief Calibration of one channel.
+ */
+typedef struct {
+    float rest;                     // Envelope with the muscle relaxed.
+    float max;                      // Envelope at a comfortable maximum contraction.
+} emg_pipeline_calibration_t;
+
+/**
+ * @brief Pipeline configuration.
+ */
+typedef struct {
+    float sample_rate_hz;           // Samples per second per channel.
+    float highpass_hz;              // Band pass lower edge, removes motion artifacts.
+    float lowpass_hz;               // Band pass upper edge, below half the sample rate.
+    float notch_hz;                 // Mains frequency, 0 for no notch.
+    float notch_q;                  // Notch quality factor.
+    emg_envelope_t envelope;        // Envelope estimator.
+    uint8_t window_blocks;          // Envelope window in blocks.
+    float on_threshold;             // Normalized envelope that activates a channel.
+    float off_threshold;            // Normalized envelope that releases it, below on_threshold.
+    float grasp_rate;               // Fastest grasp change per second, 0 for no limit.
+    emg_pipeline_calibration_t calibration[EMG_PIPELINE_MAX_CHANNELS]; // Per-channel calibration.
+} emg_pipeline_config_t;
+
+/**
+ * @brief State of one channel.
+ */
+typedef struct {
+    arm_biquad_cascade_df2T_instance_f32 cascade;   // Band pass cascade.
+    float state[2 * EMG_PIPELINE_STAGES];           // Cascade delay line.
+    float window[EMG_PIPELINE_MAX_WINDOW];          // Per-block sums of squares or absolute values.
+    uint8_t window_pos;                             // Next window entry.
+    uint8_t window_fill;                            // Window entries in use.
+    bool active;                                    // Above the on threshold, until below the off threshold.
+    float envelope;                                 // Latest envelope.
+    float activation;                               // Latest activation, 0 to 1.
+} emg_pipeline_channel_t;
+
+/**
+ * @brief Pipeline state.
+ */
+typedef struct {
+    emg_pipeline_config_t config;                   // Configuration.
+    uint8_t channels;                               // Channels in use.
+    uint8_t stages;                                 // Biquads in the cascade.
+    float coeffs[5 * EMG_PIPELINE_STAGES];          // Cascade coefficients, shared by all channels.
+    emg_pipeline_channel_t channel[EMG_PIPELINE_MAX_CHANNELS]; // Channel state.
+    float grasp;                                    // Latest grasp level, 0 (open) to 1 (closed).
+} emg_pipeline_t;
+
+/** @} */ // end of emg_pipeline_struct group
+
+/**
+ * @defgroup emg_pipeline_api EMG Pipeline Interface
+ * @{
+ */
+
+/**
+ * @brief Get default configuration for surface EMG at 1 kHz.
+ *
+ * @param config Configuration to fill.
+ */
+void emg_pipeline_get_default_config(emg_pipeline_config_t* config);
+
+/**
+ * @brief Initialize a pipeline, clearing all filter and envelope state.
+ *
+ * @param pipeline Pipeline to initialize.
+ * @param config Configuration.
+ * @param channels Channels to process, 1 to EMG_PIPELINE_MAX_CHANNELS.
+ * @return true if successful, false if the configuration is invalid.
+ */
+bool emg_pipeline_init(emg_pipeline_t* pipeline, const emg_pipeline_config_t* config, uint8_t channels);
+
+/**
+ * @brief Process one block of a channel.
+ *
+ * Updates the envelope and activation of the channel.
+ *
+ * @param pipeline Pipeline.
+ * @param channel Channel number.
+ * @param block EMG_PIPELINE_BLOCK raw samples, filtered in place.
+ */
+__attribute__((section(".time_critical")))
+void emg_pipeline_process(emg_pipeline_t* pipeline, uint8_t channel, float* block);
+
+/**
+ * @brief Set the calibration of a channel without clearing its state.
+ *
+ * @param pipeline Pipeline.
+ * @param channel Channel number.
+ * @param calibration Calibration.
+ */
+void emg_pipeline_set_calibration(emg_pipeline_t* pipeline, uint8_t channel, const emg_pipeline_calibration_t* calibration);
+
+/**
+ * @brief Update the grasp level from the channel activations.
+ *
+ * Call once per block, after every channel processed the block.
+ *
+ * @param pipeline Pipeline.
+ * @return Grasp level, 0 (open) to 1 (closed).
+ */
+__attribute__((section(".time_critical")))
+float emg_pipeline_update_grasp(emg_pipeline_t* pipeline);
+
+/** @} */ // end of emg_pipeline_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EMG_PIPELINE_H
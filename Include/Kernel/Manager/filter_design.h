@@ -0,0 +1,75 @@
+/**
+ * @file filter_design.h
+ * @brief Coefficient design for CMSIS-DSP filters
+ * @date 2025-05-27
+ *
+ * Biquads follow the RBJ audio EQ cookbook and FIR low pass filters are
+ * Hamming windowed-sinc. Coefficients come out in the layout the
+ * CMSIS-DSP f32 kernels expect. Only the C standard library is used, so
+ * filter_design.c also builds on a host.
+ */
+
+#ifndef FILTER_DESIGN_H
+#define FILTER_DESIGN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @defgroup filter_design_enum Filter Design Enumerations
+ * @{
+ */
+
+/**
+ * @brief Biquad response.
+ */
+typedef enum {
+    FILTER_DESIGN_LOWPASS = 0,      // Second order low pass.
+    FILTER_DESIGN_HIGHPASS,         // Second order high pass.
+    FILTER_DESIGN_NOTCH             // Notch at the cutoff frequency.
+} filter_design_type_t;
+
+/** @} */ // end of filter_design_enum group
+
+/**
+ * @defgroup filter_design_api Filter Design Interface
+ * @{
+ */
+
+/**
+ * @brief Design one biquad section.
+ *
+ * Writes {b0, b1, b2, a1, a2} normalized by a0 with the feedback
+ * coefficients negated, as arm_biquad_cascade_df2T_f32 expects.
+ *
+ * @param type Response.
+ * @param cutoff_hz Cutoff or notch frequency, below half the sample rate.
+ * @param q Quality factor, 0.707 for Butterworth.
+ * @param sample_rate_hz Sample rate.
+ * @param coeffs Five coefficients.
+ */
+void filter_design_biquad(filter_design_type_t type, float cutoff_hz, float q, float sample_rate_hz, float* coeffs);
+
+/**
+ * @brief Design a linear phase FIR low pass filter.
+ *
+ * The taps are symmetric, so they are already in the time reversed
+ * order arm_fir_f32 and arm_fir_decimate_f32 expect, and are normalized
+ * to unity gain at DC.
+ *
+ * @param taps Number of taps.
+ * @param cutoff Cutoff as a fraction of the sample rate, below 0.5.
+ * @param coeffs Filled with taps coefficients.
+ */
+void filter_design_fir_lowpass(uint32_t taps, float cutoff, float* coeffs);
+
+/** @} */ // end of filter_design_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FILTER_DESIGN_H
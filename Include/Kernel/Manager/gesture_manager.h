@@ -0,0 +1,180 @@
+/**
+* @file gesture_manager.h
+* @brief On-device grasp intent and gesture classification.
+* @date 2025-05-27
+*
+* Feature rows are sampled at a fixed rate from ADC inputs, EMG envelopes
+* and sensor axes into a sliding window. Every hop rows the window is
+* quantized and classified by an nn_engine model read in place from
+* flash, within a time budget. The model is written separately, e.g.
+*   picotool load -o 0x10180000 model.bin
+* for GESTURE_MANAGER_FLASH_OFFSET, and Tools/nn_tool.c builds and checks
+* blobs on a host bit for bit.
+*/
+
+#ifndef GESTURE_MANAGER_H
+#define GESTURE_MANAGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "i2c_sensor_adapter.h"
+
+/**
+ * @defgroup gesture_man_const Gesture Manager Configuration Constants
+ * @{
+ */
+
+/** Features per row, the model input channels. */
+#define GESTURE_MANAGER_MAX_FEATURES 8
+
+/** Rows per window, the model input length. */
+#define GESTURE_MANAGER_MAX_WINDOW 128
+
+/** Activation arena. */
+#define GESTURE_MANAGER_ARENA_SIZE (16 * 1024)
+
+/** Flash region holding the model, after the black-box region. */
+#define GESTURE_MANAGER_FLASH_OFFSET (1536 * 1024)
+
+/** Size of the model region. */
+#define GESTURE_MANAGER_FLASH_SIZE (256 * 1024)
+
+/** @} */ // end of gesture_man_const group
+
+/**
+ * @defgroup gesture_man_enum Gesture Manager Enumerations
+ * @{
+ */
+
+/**
+ * @brief Where a feature comes from.
+ */
+typedef enum {
+    GESTURE_FEATURE_NONE = 0,       // Always 0.
+    GESTURE_FEATURE_ADC,            // Newest value of an ADC input.
+    GESTURE_FEATURE_EMG,            // Envelope of an EMG channel.
+    GESTURE_FEATURE_SENSOR          // Newest value of a sensor axis.
+} gesture_feature_kind_t;
+
+/** @} */ // end of gesture_man_enum group
+
+/**
+ * @defgroup gesture_man_struct Gesture Manager Data Structures
+ * @{
+ */
+
+/**
+ * @brief One feature of a row.
+ */
+typedef struct {
+    gesture_feature_kind_t kind;    // Source.
+    uint8_t index;                  // ADC input, EMG channel or sensor axis (0 = x).
+    sensor_type_t sensor_type;      // Sensor type, for GESTURE_FEATURE_SENSOR.
+} gesture_manager_feature_t;
+
+/**
+ * @brief Gesture manager configuration.
+ */
+typedef struct {
+    uint32_t sample_hz;             // Rows per second.
+    uint16_t hop;                   // Rows between classifications.
+    uint32_t budget_us;             // Time allowed per classification.
+    float min_confidence;           // Probability needed to report a class.
+    gesture_manager_feature_t features[GESTURE_MANAGER_MAX_FEATURES]; // Row layout.
+} gesture_manager_config_t;
+
+/**
+ * @brief Gesture manager status.
+ */
+typedef struct {
+    bool loaded;                    // A valid model is loaded.
+    bool enabled;                   // Classification runs.
+    uint16_t length;                // Model input rows.
+    uint16_t channels;              // Model input features.
+    uint16_t classes;               // Model outputs.
+    uint8_t layers;                 // Model layers.
+    uint32_t macs;                  // Multiply-accumulates per classification.
+    uint32_t arena_used;            // Activation bytes.
+    int gesture;                    // Latest class, -1 if none.
+    float confidence;               // Its probability.
+    uint32_t inferences;            // Classifications completed.
+    uint32_t budget_overruns;       // Classifications abandoned over budget.
+    uint32_t late_rows;             // Rows skipped because the task ran late.
+    uint32_t last_us;               // Time of the last classification.
+    uint32_t max_us;                // Worst time.
+} gesture_manager_status_t;
+
+/** @} */ // end of gesture_man_struct group
+
+/**
+ * @defgroup gesture_man_api Gesture Manager Application Programming Interface
+ * @{
+ */
+
+/**
+ * @brief Get default configuration.
+ *
+ * 50 rows per second, a classification every 10 rows within 5 ms, rows
+ * of both EMG envelopes and the accelerometer and gyroscope axes.
+ *
+ * @param config Configuration to fill.
+ */
+void gesture_manager_get_default_config(gesture_manager_config_t* config);
+
+/**
+ * @brief Get the status.
+ *
+ * @param status Status to fill.
+ */
+void gesture_manager_get_status(gesture_manager_status_t* status);
+
+/**
+ * @brief Initialize the manager, load the model and create the task.
+ *
+ * A missing model is not an error, it can be loaded later.
+ *
+ * @param config Configuration, NULL for defaults.
+ * @return true if successful, false otherwise.
+ */
+bool gesture_manager_init(const gesture_manager_config_t* config);
+
+/**
+ * @brief Load, or reload, the model from flash.
+ *
+ * @return true if the model is valid and fits the window and arena.
+ */
+bool gesture_manager_load(void);
+
+/**
+ * @brief Gesture task, samples rows and classifies windows.
+ *
+ * @param params Unused.
+ */
+void gesture_manager_task(void* params);
+
+/**
+ * @brief Shell command handler for the gesture manager.
+ *
+ * @param argc Argument count.
+ * @param argv Argument values.
+ * @return 0 on success, non-zero on failure.
+ */
+int cmd_gesture(int argc, char *argv[]);
+
+/**
+ * @brief Register gesture manager shell commands.
+ */
+void register_gesture_manager_commands(void);
+
+/** @} */ // end of gesture_man_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GESTURE_MANAGER_H
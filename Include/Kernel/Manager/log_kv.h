@@ -0,0 +1,118 @@
+/**
+ * @file log_kv.h
+ * @brief Structured key/value log records
+ * @date 2025-05-27
+ *
+ * Fields are encoded into a compact binary payload instead of being
+ * formatted with printf. Encoding and rendering only depend on the C
+ * standard library, so log_kv.c also builds on a host to decode records
+ * read back from flash.
+ *
+ * Payload layout (multi-byte values little-endian):
+ * | u8 module_len | module | u8 event_len | event | u8 field_count | fields |
+ *
+ * Each field starts with a tag byte, type in bits 7:5 and key length in
+ * bits 4:0, followed by the key and the value:
+ * - U32: unsigned LEB128 varint
+ * - I32: zigzag encoded varint
+ * - F32: 4 raw bytes
+ * - STR: u8 length then bytes
+ * - BOOL: 1 byte
+ */
+
+#ifndef LOG_KV_H
+#define LOG_KV_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @defgroup log_kv_struct Structured Log Data Structures
+ * @{
+ */
+
+// Longest key, limited by the 5-bit tag field
+#define LOG_KV_MAX_KEY_LEN 31
+
+// Longest module, event or string value
+#define LOG_KV_MAX_STR_LEN 255
+
+// Field value types
+typedef enum {
+    LOG_KV_U32 = 0,
+    LOG_KV_I32,
+    LOG_KV_F32,
+    LOG_KV_STR,
+    LOG_KV_BOOL
+} log_kv_type_t;
+
+// One key/value field
+typedef struct {
+    const char* key;        // Field name
+    log_kv_type_t type;     // Value type
+    union {
+        uint32_t u32;
+        int32_t i32;
+        float f32;
+        const char* str;
+        bool b;
+    } value;
+} log_kv_t;
+
+/** @} */ // end of log_kv_struct group
+
+/**
+ * @defgroup log_kv_macro Field Constructors
+ * @{
+ */
+
+#define K_U32(k, v)  ((log_kv_t){ .key = (k), .type = LOG_KV_U32, .value.u32 = (uint32_t) (v) })
+#define K_I32(k, v)  ((log_kv_t){ .key = (k), .type = LOG_KV_I32, .value.i32 = (int32_t) (v) })
+#define K_F32(k, v)  ((log_kv_t){ .key = (k), .type = LOG_KV_F32, .value.f32 = (float) (v) })
+#define K_STR(k, v)  ((log_kv_t){ .key = (k), .type = LOG_KV_STR, .value.str = (v) })
+#define K_BOOL(k, v) ((log_kv_t){ .key = (k), .type = LOG_KV_BOOL, .value.b = (bool) (v) })
+
+/** @} */ // end of log_kv_macro group
+
+/**
+ * @defgroup log_kv_api Structured Log Interface
+ * @{
+ */
+
+/**
+ * @brief Encode a structured record.
+ * 
+ * @param out Buffer to write the payload to.
+ * @param out_size Size of out.
+ * @param module Module name.
+ * @param event Event name.
+ * @param fields Fields to encode.
+ * @param count Number of fields.
+ * @return Payload length, or 0 if it does not fit.
+ */
+size_t log_kv_encode(uint8_t* out, size_t out_size, const char* module, const char* event,
+                     const log_kv_t* fields, size_t count);
+
+/**
+ * @brief Render a payload as "[module] event key=value ...".
+ * 
+ * @param data Payload from log_kv_encode().
+ * @param len Payload length.
+ * @param out Buffer for the null-terminated text, truncated if too small.
+ * @param out_size Size of out.
+ * @return Length of the rendered text, or -1 if the payload is malformed.
+ */
+int log_kv_render(const uint8_t* data, size_t len, char* out, size_t out_size);
+
+/** @} */ // end of log_kv_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_KV_H
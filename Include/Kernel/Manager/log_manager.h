@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "pico/stdlib.h"
+#include "log_kv.h"
 
 /**
  * @defgroup log_enum Logging Enumerations
@@ -32,6 +33,12 @@ typedef enum {
     LOG_DEST_FLASH   = 0x04   // Output to flash memory
 } log_destination_t;
 
+// Payload format of a queued or flash record
+typedef enum {
+    LOG_FORMAT_TEXT = 0,      // Formatted text line
+    LOG_FORMAT_KV             // log_kv binary payload
+} log_format_t;
+
 /** @} */ // end of log_enum group
 
 /**
@@ -59,12 +66,61 @@ typedef struct {
     const char* sdcard_filename;    // Filename for SD card logging
     uint32_t flash_offset;          // Offset in flash for storing logs
     uint32_t flash_size;            // Size of flash region for logs
+    uint32_t drain_budget_us;       // Time spent draining records per log_process() call (0 = one record)
     bool include_timestamp;         // Include timestamp in log messages
     bool include_level;             // Include level in log messages
     bool include_core_id;           // Include core ID in log messages
     bool color_output;              // Use ANSI colors for console output
 } log_config_t;
 
+// Logging throughput and backlog statistics
+typedef struct {
+    uint32_t records_drained;       // Records written out by log_process()
+    uint32_t bytes_drained;         // Message bytes written out
+    uint32_t batches;               // log_process() calls that drained at least one record
+    uint32_t max_batch;             // Most records drained in one call
+    uint32_t drain_rate;            // Records per second over the last complete window
+    uint32_t backlog_records;       // Records waiting in the buffer
+    uint32_t backlog_bytes;         // Buffer bytes in use
+    uint32_t backlog_age_us;        // Age of the oldest waiting record
+    uint32_t max_backlog_age_us;    // Longest time a record has waited
+    uint32_t flash_pages_written;   // Full flash pages programmed
+    uint32_t sdcard_blocks_written; // Full SD card blocks written
+    uint32_t write_errors;          // Failed flash programs or SD card writes
+    uint32_t records_dropped;       // Records lost to a full buffer
+    uint32_t records_suppressed;    // Messages dropped by rate limited call sites
+} log_stats_t;
+
+// Per call site token bucket, see LOG_RATELIMITED()
+typedef struct {
+    uint32_t last_refill_us;        // Time tokens were last added
+    uint32_t tokens;                // Messages that may still be emitted
+    uint32_t suppressed;            // Messages dropped since the last emitted one
+} log_ratelimit_t;
+
+// Flash log query filter
+typedef struct {
+    bool use_since;                 // Only match records from this boot at or after since_ms
+    uint32_t since_ms;              // Milliseconds since boot
+    log_level_t min_level;          // Lowest level to match
+    const char* module;             // Module name to match, NULL for any
+    uint32_t max_records;           // Stop after this many matches (0 = no limit)
+} log_query_t;
+
+// Flash log record passed to a query callback
+typedef struct {
+    uint32_t seq;                   // Sequence number, increasing across boots
+    uint32_t timestamp_ms;          // Milliseconds since the boot that logged it
+    log_level_t level;              // Message level
+    log_format_t format;            // Format of text
+    uint32_t flash_offset;          // Offset of the record in flash
+    const char* text;               // Formatted message or log_kv payload, not null-terminated
+    uint16_t length;                // Length of text
+} log_query_record_t;
+
+// Called for each matching record, return false to stop the query
+typedef bool (*log_query_callback_t)(const log_query_record_t* record, void* user_data);
+
 /** @} */ // end of log_struct group
 
 /**
@@ -83,6 +139,15 @@ void log_flush(void);
  */
 void log_get_default_config(log_config_t* config);
 
+/**
+ * @brief Get logging throughput and backlog statistics.
+ * 
+ * @param stats Structure to fill.
+ * @return true if successful.
+ * @return false if not initialized.
+ */
+bool log_get_stats(log_stats_t* stats);
+
 /**
  * @brief Initialize the logging manager.
  * 
@@ -147,12 +212,178 @@ bool log_is_fully_initialized(void);
 __attribute__((section(".time_critical")))
 void log_message(log_level_t level, const char* module, const char* format, ...);
 
+/**
+ * @brief Write a structured record to the logging manager buffer.
+ * 
+ * Normally called through LOG_KV().
+ * 
+ * @param level Logging level to display as.
+ * @param module String representing the module the logging is occuring from.
+ * @param event Event name.
+ * @param fields Fields of the record.
+ * @param count Number of fields.
+ */
+__attribute__((section(".time_critical")))
+void log_kv_message(log_level_t level, const char* module, const char* event,
+                    const log_kv_t* fields, size_t count);
+
+/**
+ * @brief Log a structured record.
+ * 
+ * LOG_KV(LOG_LEVEL_WARN, "Scheduler", "deadline_miss", K_U32("task", id), K_F32("dt", dt));
+ */
+#define LOG_KV(level, module, event, ...) do { \
+        const log_kv_t log_kv_fields_[] = { __VA_ARGS__ }; \
+        log_kv_message((level), (module), (event), log_kv_fields_, \
+                       sizeof(log_kv_fields_) / sizeof(log_kv_fields_[0])); \
+    } while (0)
+
+/**
+ * @brief Log how many messages a call site suppressed.
+ * 
+ * Emits "...repeated N times" and adds N to the suppressed statistic.
+ * 
+ * @param level Logging level of the call site.
+ * @param module Module of the call site.
+ * @param count Number of suppressed messages.
+ */
+void log_suppressed_summary(log_level_t level, const char* module, uint32_t count);
+
+/**
+ * @brief Take a token from a call site's bucket.
+ * 
+ * One token is added every interval_us, up to burst. Only a timer read
+ * and a compare run while the site is being suppressed.
+ * 
+ * @param site Static state of the call site.
+ * @param interval_us Time to earn one token.
+ * @param burst Bucket size.
+ * @return true if the message should be emitted.
+ */
+__attribute__((always_inline))
+static inline bool log_ratelimit_take(log_ratelimit_t* site, uint32_t interval_us, uint32_t burst) {
+    uint32_t now = time_us_32();
+    uint32_t elapsed = now - site->last_refill_us;
+
+    if (elapsed >= interval_us) {
+        uint32_t refill = elapsed / interval_us;
+
+        if (refill >= burst - site->tokens) {
+            site->tokens = burst;
+            site->last_refill_us = now;
+        } else {
+            site->tokens += refill;
+            site->last_refill_us += refill * interval_us;
+        }
+    }
+
+    if (site->tokens == 0) {
+        site->suppressed++;
+        return false;
+    }
+
+    site->tokens--;
+    return true;
+}
+
+// Emit the summary for a site's suppressed messages ahead of its next message
+#define LOG_SITE_SUMMARY_(site, level, module) do { \
+        if ((site).suppressed) { \
+            log_suppressed_summary((level), (module), (site).suppressed); \
+            (site).suppressed = 0; \
+        } \
+    } while (0)
+
+/**
+ * @brief Log at most burst messages, then one per interval_ms, from this call site.
+ * 
+ * Suppressed messages are counted and reported as "...repeated N times"
+ * before the next message the site emits. The state is a static per call
+ * site and is not locked, so counts from two cores are approximate.
+ * 
+ * LOG_RATELIMITED(1000, 5, LOG_LEVEL_WARN, "I2C Driver", "Read from 0x%02X failed", addr);
+ */
+#define LOG_RATELIMITED(interval_ms, burst, level, module, ...) do { \
+        static log_ratelimit_t log_site_ = { .tokens = (burst) }; \
+        if (log_ratelimit_take(&log_site_, (interval_ms) * 1000u, (burst))) { \
+            LOG_SITE_SUMMARY_(log_site_, (level), (module)); \
+            log_message((level), (module), __VA_ARGS__); \
+        } \
+    } while (0)
+
+/**
+ * @brief Structured form of LOG_RATELIMITED().
+ */
+#define LOG_KV_RATELIMITED(interval_ms, burst, level, module, event, ...) do { \
+        static log_ratelimit_t log_site_ = { .tokens = (burst) }; \
+        if (log_ratelimit_take(&log_site_, (interval_ms) * 1000u, (burst))) { \
+            LOG_SITE_SUMMARY_(log_site_, (level), (module)); \
+            LOG_KV((level), (module), (event), __VA_ARGS__); \
+        } \
+    } while (0)
+
+/**
+ * @brief Log the first of every n calls from this call site.
+ * 
+ * Each emitted line stands for n calls, so no summary is added.
+ */
+#define LOG_SAMPLED(n, level, module, ...) do { \
+        static uint32_t log_skip_ = 0; \
+        if (log_skip_ == 0) { \
+            log_skip_ = (n) - 1; \
+            log_message((level), (module), __VA_ARGS__); \
+        } else { \
+            log_skip_--; \
+        } \
+    } while (0)
+
+/**
+ * @brief Structured form of LOG_SAMPLED().
+ */
+#define LOG_KV_SAMPLED(n, level, module, event, ...) do { \
+        static uint32_t log_skip_ = 0; \
+        if (log_skip_ == 0) { \
+            log_skip_ = (n) - 1; \
+            LOG_KV((level), (module), (event), __VA_ARGS__); \
+        } else { \
+            log_skip_--; \
+        } \
+    } while (0)
+
 /**
  * @brief Process logging messages in buffer.
+ * 
+ * Drains records for up to drain_budget_us, gathering SD card and flash
+ * output into blocks that are written once full.
  */
 __attribute__((section(".time_critical")))
 void log_process(void);
 
+/**
+ * @brief Find flash log records matching a filter.
+ * 
+ * Pending records are flushed to flash first. The per-sector index is used
+ * to skip sectors with no matching level, module or time, and to seek to
+ * the first candidate record within a sector. Records are visited oldest
+ * first.
+ * 
+ * @param query Filter to apply.
+ * @param callback Function called for each matching record.
+ * @param user_data User data to pass to callback.
+ * @return Number of matching records visited.
+ */
+uint32_t log_query(const log_query_t* query, log_query_callback_t callback, void* user_data);
+
+/**
+ * @brief Register logging shell commands.
+ */
+void register_log_commands(void);
+
+/**
+ * @brief Reset logging statistics.
+ */
+void log_reset_stats(void);
+
 /**
  * @brief scheduler task for launching logging manager.
  * 
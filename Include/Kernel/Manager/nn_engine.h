@@ -0,0 +1,237 @@
+/**
+ * @file nn_engine.h
+ * @brief Quantized int8 neural network runtime
+ * @date 2025-05-27
+ *
+ * Runs a model stored as one blob, normally in flash, with activations in
+ * a caller supplied arena. Weights are used in place, nothing is copied.
+ * Tensors are int8, laid out [time][channel] so the receptive field of a
+ * 1D convolution output is contiguous and every output is one
+ * arm_dot_prod_q7 call.
+ *
+ * Arithmetic is integer only from the quantized input on: exact int32
+ * dot products, bias with the input zero point folded in, and a Q31
+ * multiplier with rounding shift to requantize. Building with
+ * NN_ENGINE_REFERENCE replaces the CMSIS-DSP kernels with plain C loops
+ * that give the same results bit for bit, which is how Tools/nn_tool.c
+ * runs models on a host.
+ *
+ * Blob layout (little-endian):
+ * | nn_engine_header_t | nn_engine_layer_t[layer_count] | weights, biases, tables | test vector |
+ * - Dense and conv1d weights are int8 [out][kernel][in], dense has a
+ *   kernel of 1 over the flattened input. Biases are int32 [out] holding
+ *   bias - input_zero_point * sum(weights).
+ * - Softmax has a uint16 [256] table, table[d] = 32767 * exp(-d * input scale),
+ *   and outputs probabilities with scale 1/256 and zero point -128.
+ * - The optional test vector is an int8 input followed by the expected
+ *   int8 output.
+ */
+
+#ifndef NN_ENGINE_H
+#define NN_ENGINE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @defgroup nn_engine_const Neural Network Engine Constants
+ * @{
+ */
+
+/** "NNQ8" */
+#define NN_ENGINE_MAGIC 0x38514E4Eu
+
+/** Blob format version. */
+#define NN_ENGINE_VERSION 1
+
+/** Layers per model. */
+#define NN_ENGINE_MAX_LAYERS 16
+
+/** Entries in a softmax table. */
+#define NN_ENGINE_SOFTMAX_TABLE 256
+
+/** @} */ // end of nn_engine_const group
+
+/**
+ * @defgroup nn_engine_enum Neural Network Engine Enumerations
+ * @{
+ */
+
+/**
+ * @brief Layer types.
+ */
+typedef enum {
+    NN_LAYER_DENSE = 1,             // Fully connected over the flattened input.
+    NN_LAYER_CONV1D,                // Valid 1D convolution over time.
+    NN_LAYER_RELU,                  // Clamp below the zero point, quantization unchanged.
+    NN_LAYER_SOFTMAX                // Probabilities over the channels of the last time step.
+} nn_layer_type_t;
+
+/** @} */ // end of nn_engine_enum group
+
+/**
+ * @defgroup nn_engine_struct Neural Network Engine Data Structures
+ * @{
+ */
+
+/**
+ * @brief Blob header.
+ */
+typedef struct {
+    uint32_t magic;                 // NN_ENGINE_MAGIC.
+    uint16_t version;               // NN_ENGINE_VERSION.
+    uint16_t layer_count;           // Layers after the header.
+    uint32_t size;                  // Blob bytes, header included.
+    uint32_t crc32;                 // CRC-32 of the bytes after the header.
+    uint16_t input_length;          // Time steps per window.
+    uint16_t input_channels;        // Features per time step.
+    float input_scale;              // Feature units per quantization step.
+    int32_t input_zero_point;       // Quantized value of a zero feature.
+    uint32_t test_offset;           // Test vector, 0 for none.
+    uint32_t reserved[3];
+} nn_engine_header_t;
+
+/**
+ * @brief Layer record.
+ */
+typedef struct {
+    uint8_t type;                   // nn_layer_type_t.
+    uint8_t relu;                   // Fused ReLU on dense and conv1d outputs.
+    uint16_t out_channels;          // Dense outputs or conv1d filters.
+    uint16_t kernel;                // Conv1d kernel length.
+    uint16_t stride;                // Conv1d stride.
+    int32_t multiplier;             // Requantization multiplier, Q31.
+    int32_t shift;                  // Requantization shift, left if positive.
+    int32_t output_zero_point;      // Output zero point.
+    float output_scale;             // Output units per step, for dequantization.
+    uint32_t weights_offset;        // Weights or softmax table.
+    uint32_t bias_offset;           // Biases, 4 byte aligned.
+} nn_engine_layer_t;
+
+/**
+ * @brief Shape of a tensor.
+ */
+typedef struct {
+    uint16_t length;                // Time steps.
+    uint16_t channels;              // Channels per step.
+} nn_engine_shape_t;
+
+/**
+ * @brief Loaded model.
+ *
+ * Tensor i is the input of layer i, the last one is the output. The arena
+ * plan alternates tensors between the bottom and the top of the arena, so
+ * it needs the largest sum of two consecutive tensors.
+ */
+typedef struct {
+    const uint8_t* blob;                            // Model, used in place.
+    const nn_engine_header_t* header;               // Header in the blob.
+    const nn_engine_layer_t* layers;                // Layers in the blob.
+    uint8_t* arena;                                 // Activation memory.
+    size_t arena_used;                              // Bytes the plan needs.
+    float input_inverse_scale;                      // Quantization steps per feature unit.
+    nn_engine_shape_t shapes[NN_ENGINE_MAX_LAYERS + 1]; // Tensor shapes.
+    int32_t zero_points[NN_ENGINE_MAX_LAYERS + 1];  // Tensor zero points.
+    uint32_t offsets[NN_ENGINE_MAX_LAYERS + 1];     // Tensor offsets in the arena.
+    uint32_t macs;                                  // Multiply-accumulates per inference.
+} nn_engine_t;
+
+/**
+ * @brief Microsecond clock for the time budget.
+ */
+typedef uint32_t (*nn_engine_clock_t)(void);
+
+/** @} */ // end of nn_engine_struct group
+
+/**
+ * @defgroup nn_engine_api Neural Network Engine Interface
+ * @{
+ */
+
+/**
+ * @brief Index of the largest output.
+ *
+ * @param engine Loaded model.
+ * @param value Set to the largest output (can be NULL).
+ * @return Output channel.
+ */
+int nn_engine_argmax(const nn_engine_t* engine, int8_t* value);
+
+/**
+ * @brief CRC-32 (IEEE 802.3) of a buffer.
+ *
+ * @param data Data.
+ * @param len Length.
+ * @return CRC.
+ */
+uint32_t nn_engine_crc32(const uint8_t* data, size_t len);
+
+/**
+ * @brief Input tensor, length * channels values.
+ *
+ * @param engine Loaded model.
+ * @return Input in the arena.
+ */
+int8_t* nn_engine_input(nn_engine_t* engine);
+
+/**
+ * @brief Validate a blob and plan its activations.
+ *
+ * @param engine Engine to fill.
+ * @param blob Model blob.
+ * @param size Bytes available at blob.
+ * @param arena Activation memory, 4 byte aligned.
+ * @param arena_size Size of arena.
+ * @return true if successful, false if the blob is invalid or the arena too small.
+ */
+bool nn_engine_load(nn_engine_t* engine, const uint8_t* blob, size_t size, uint8_t* arena, size_t arena_size);
+
+/**
+ * @brief Output tensor.
+ *
+ * @param engine Loaded model.
+ * @param count Set to the number of outputs (can be NULL).
+ * @return Output in the arena.
+ */
+const int8_t* nn_engine_output(const nn_engine_t* engine, uint32_t* count);
+
+/**
+ * @brief Quantize features into the input tensor.
+ *
+ * @param engine Loaded model.
+ * @param values length * channels features, [time][channel].
+ */
+void nn_engine_quantize_input(nn_engine_t* engine, const float* values);
+
+/**
+ * @brief Run the model on the input tensor.
+ *
+ * @param engine Loaded model.
+ * @param clock Microsecond clock, NULL for no budget.
+ * @param budget_us Time allowed, the run is abandoned after the layer that exceeds it.
+ * @return true if every layer ran.
+ */
+__attribute__((section(".time_critical")))
+bool nn_engine_run(nn_engine_t* engine, nn_engine_clock_t clock, uint32_t budget_us);
+
+/**
+ * @brief Run the test vector of the blob.
+ *
+ * @param engine Loaded model.
+ * @param mismatches Set to the number of outputs that differ (can be NULL).
+ * @return 1 if the output matches bit for bit, 0 if not, -1 if the blob has no test vector.
+ */
+int nn_engine_self_test(nn_engine_t* engine, uint32_t* mismatches);
+
+/** @} */ // end of nn_engine_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NN_ENGINE_H
@@ -0,0 +1,205 @@
+/**
+* @file sensor_filter.h
+* @brief Per-sensor DSP filter chains for the sensor pipeline.
+* @date 2025-05-27
+*
+* Each sensor type can have a filter chain that runs on every axis of its
+* samples. Samples are collected into blocks and each block goes through
+* the chain in order:
+* - Median spike rejection over 3 or 5 samples.
+* - A cascade of biquads (low pass, high pass, notch) run with
+*   arm_biquad_cascade_df2T_f32.
+* - A windowed-sinc FIR decimator run with arm_fir_decimate_f32.
+* Chains are configured from the shell. Sensor types without a chain pass
+* through untouched. The cost of each block is measured with the DWT cycle
+* counter and reported as cycles per input sample.
+*/
+
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "i2c_sensor_adapter.h"
+
+/**
+ * @defgroup sensor_filter_const Sensor Filter Configuration Constants
+ * @{
+ */
+
+/** Number of sensor types that can have a chain. */
+#define SENSOR_FILTER_MAX_TYPES (SENSOR_TYPE_ENV + 1)
+
+/** Axes filtered per sample. */
+#define SENSOR_FILTER_AXES 3
+
+/** Maximum biquad sections in a chain. */
+#define SENSOR_FILTER_MAX_BIQUADS 4
+
+/** Maximum samples per block, also the most outputs one push can return. */
+#define SENSOR_FILTER_MAX_BLOCK 16
+
+/** Maximum FIR decimator taps. */
+#define SENSOR_FILTER_MAX_TAPS 32
+
+/** Widest median window. */
+#define SENSOR_FILTER_MAX_MEDIAN 5
+
+/** @} */ // end of sensor_filter_const group
+
+/**
+ * @defgroup sensor_filter_enum Sensor Filter Enumerations
+ * @{
+ */
+
+/**
+ * @brief Biquad section response.
+ */
+typedef enum {
+    SENSOR_FILTER_LOWPASS = 0,      // Second order low pass.
+    SENSOR_FILTER_HIGHPASS,         // Second order high pass.
+    SENSOR_FILTER_NOTCH             // Notch at the cutoff frequency.
+} sensor_filter_biquad_type_t;
+
+/** @} */ // end of sensor_filter_enum group
+
+/**
+ * @defgroup sensor_filter_struct Sensor Filter Data Structures
+ * @{
+ */
+
+/**
+ * @brief One biquad section.
+ */
+typedef struct {
+    sensor_filter_biquad_type_t type;   // Response.
+    float cutoff_hz;                    // Cutoff or notch frequency, below half the sample rate.
+    float q;                            // Quality factor, 0.707 for Butterworth.
+} sensor_filter_biquad_t;
+
+/**
+ * @brief Filter chain configuration.
+ */
+typedef struct {
+    bool enabled;                       // Whether samples go through the chain.
+    float sample_rate_hz;               // Input sample rate used to design the filters.
+    uint8_t block_size;                 // Samples per block, a multiple of decimation.
+    uint8_t median_window;              // 0 for off, 3 or 5.
+    uint8_t biquad_count;               // Biquad sections in use.
+    sensor_filter_biquad_t biquads[SENSOR_FILTER_MAX_BIQUADS]; // Biquad sections, run in order.
+    uint8_t decimation;                 // Output one sample in this many, 1 for no FIR stage.
+    uint8_t fir_taps;                   // FIR decimator taps, 0 for a default.
+} sensor_filter_config_t;
+
+/**
+ * @brief Filter chain statistics.
+ */
+typedef struct {
+    uint32_t samples_in;                // Samples pushed.
+    uint32_t samples_out;               // Samples produced.
+    uint32_t blocks;                    // Blocks processed.
+    uint32_t last_cycles_per_sample;    // Cost of the last block.
+    uint32_t max_cycles_per_sample;     // Worst block.
+    uint64_t total_cycles;              // Cycles over all blocks.
+} sensor_filter_stats_t;
+
+/** @} */ // end of sensor_filter_struct group
+
+/**
+ * @defgroup sensor_filter_api Sensor Filter Application Programming Interface
+ * @{
+ */
+
+/**
+ * @brief Configure the filter chain of a sensor type.
+ *
+ * The filters are designed from the configuration and their state is
+ * cleared. Samples still waiting for a full block are dropped.
+ *
+ * @param type Sensor type.
+ * @param config Chain configuration.
+ * @return true if successful, false if the configuration is invalid.
+ */
+bool sensor_filter_configure(sensor_type_t type, const sensor_filter_config_t* config);
+
+/**
+ * @brief Get the filter chain configuration of a sensor type.
+ *
+ * @param type Sensor type.
+ * @param config Filled with the configuration, or the defaults if there is no chain.
+ * @return true if the type has a chain.
+ */
+bool sensor_filter_get_config(sensor_type_t type, sensor_filter_config_t* config);
+
+/**
+ * @brief Get default chain configuration, disabled with no filters.
+ *
+ * @param config Configuration to fill.
+ */
+void sensor_filter_get_default_config(sensor_filter_config_t* config);
+
+/**
+ * @brief Get the statistics of a filter chain.
+ *
+ * @param type Sensor type.
+ * @param stats Filled with the statistics.
+ * @return true if the type has a chain.
+ */
+bool sensor_filter_get_stats(sensor_type_t type, sensor_filter_stats_t* stats);
+
+/**
+ * @brief Initialize the sensor filters and the cycle counter.
+ *
+ * @return true if successful, false otherwise.
+ */
+bool sensor_filter_init(void);
+
+/**
+ * @brief Push a sample through the chain of its sensor type.
+ *
+ * Samples are buffered until a block is full, so most calls return 0 and
+ * the call that completes a block returns block_size / decimation samples.
+ *
+ * @param type Sensor type.
+ * @param in Sample.
+ * @param out Buffer for filtered samples.
+ * @param max_out Size of out, at least SENSOR_FILTER_MAX_BLOCK.
+ * @return Number of filtered samples in out, or -1 if the type is not filtered.
+ */
+__attribute__((section(".time_critical")))
+int sensor_filter_push(sensor_type_t type, const sensor_data_t* in, sensor_data_t* out, int max_out);
+
+/**
+ * @brief Clear the filter state and statistics of a chain.
+ *
+ * @param type Sensor type.
+ * @return true if the type has a chain.
+ */
+bool sensor_filter_reset(sensor_type_t type);
+
+/**
+ * @brief Shell command handler for the sensor filters.
+ *
+ * @param argc Argument count.
+ * @param argv Argument values.
+ * @return 0 on success, non-zero on failure.
+ */
+int cmd_filter(int argc, char *argv[]);
+
+/**
+ * @brief Register sensor filter shell commands.
+ */
+void register_sensor_filter_commands(void);
+
+/** @} */ // end of sensor_filter_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SENSOR_FILTER_H
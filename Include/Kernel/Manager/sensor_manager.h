@@ -26,6 +26,16 @@ extern "C" {
  */
 #define SENSOR_MANAGER_MAX_SENSORS 8
 
+/**
+ * @brief Sampling period multiplier applied while the scheduler is degraded.
+ */
+#define SENSOR_MANAGER_DEGRADED_PERIOD_FACTOR 4
+
+/**
+ * @brief Maximum time between sensor task heartbeats.
+ */
+#define SENSOR_MANAGER_HEARTBEAT_MS 500
+
 /** @} */ // end of sensor_man_const group
 
 /**
@@ -107,6 +117,19 @@ int sensor_manager_get_all_statuses(sensor_manager_t manager,
 __attribute__((section(".time_critical")))
 bool sensor_manager_get_data(sensor_manager_t manager, sensor_type_t type, sensor_data_t* data);
 
+/**
+ * @brief Get the newest sample delivered for a sensor type, without a bus transaction.
+ *
+ * This is the sample after the filter chain, as passed to the callback.
+ *
+ * @param manager Sensor manager handle.
+ * @param type Sensor type.
+ * @param data Pointer to data structure to fill.
+ * @return true if the type has delivered a sample, false otherwise.
+ */
+__attribute__((section(".time_critical")))
+bool sensor_manager_get_latest(sensor_manager_t manager, sensor_type_t type, sensor_data_t* data);
+
 /**
  * @brief Get default sensor manager configuration.
  * 
@@ -235,6 +258,22 @@ bool sensor_manager_stop_sensor(sensor_manager_t manager, sensor_type_t type);
 __attribute__((section(".time_critical")))
 void sensor_manager_task(void* param);
 
+/**
+ * @brief Parse a sensor type name as used by the shell.
+ * 
+ * @param type_str One of mag, accel, gyro, temp, press or hum.
+ * @return Sensor type, SENSOR_TYPE_UNKNOWN if not recognized.
+ */
+sensor_type_t sensor_manager_type_from_string(const char* type_str);
+
+/**
+ * @brief Get a display name for a sensor type.
+ * 
+ * @param type Sensor type.
+ * @return Display name.
+ */
+const char* sensor_manager_type_to_string(sensor_type_t type);
+
 /**
  * @brief Unlock access to the sensor manager.
  * 
@@ -25,6 +25,11 @@ extern "C" {
  */
 #define SERVO_MANAGER_MAX_SERVOS 16
 
+/**
+ * @brief Maximum time between servo task heartbeats, a miss stops feeding the watchdog.
+ */
+#define SERVO_MANAGER_HEARTBEAT_MS 200
+
 /** @} */ // end of servo_man_const group
 
 /**
@@ -45,6 +50,15 @@ typedef struct {
     bool enable_all_on_start;      // Whether to enable all servos on manager start.
 } servo_manager_config_t;
 
+/**
+ * @brief One entry of a batched servo update.
+ */
+typedef struct {
+    uint id;                       // Servo ID.
+    float value;                   // Position in degrees, or percentage if is_percent.
+    bool is_percent;               // Whether value is a percentage. (0.0 to 100.0)
+} servo_manager_command_t;
+
 /** @} */ // end of servo_man_struct group
 
 /**
@@ -184,6 +198,20 @@ bool servo_manager_register_callback(servo_manager_t manager,
  */
 bool servo_manager_remove_servo(servo_manager_t manager, uint id);
 
+/**
+ * @brief Set the positions of several servos under one lock.
+ * 
+ * All commands are applied before any other task can move a servo, so
+ * a grasp moves every finger in the same task run.
+ * 
+ * @param manager Servo manager handle.
+ * @param commands Commands to apply, in order.
+ * @param count Number of commands.
+ * @return Number of commands applied, unknown servo IDs are skipped.
+ */
+__attribute__((section(".time_critical")))
+int servo_manager_set_batch(servo_manager_t manager, const servo_manager_command_t* commands, int count);
+
 /**
  * @brief Set operation mode for a specific servo.
  * 
@@ -0,0 +1,227 @@
+/**
+* @file spectrum_manager.h
+* @brief Vibration and tremor analysis of IMU and servo current streams.
+* @date 2025-05-27
+*
+* Each analyzer follows one stream, an ADC input or one axis of a sensor
+* type, and takes Hann windowed frames of fft_size samples every half
+* frame. Frames are read straight from the sample ring, the ADC manager's
+* for ADC inputs or a ring kept here for sensors, into the
+* arm_rfft_fast_f32 input. The power spectrum is averaged over frames and
+* reduced to the RMS level in each configured band and the strongest
+* peaks, e.g. servo chatter, gearbox tones or tremor during a grip.
+* A low priority task processes at most one frame per run, results are
+* published as LOG_KV records and shown by the sys_stats command.
+*/
+
+#ifndef SPECTRUM_MANAGER_H
+#define SPECTRUM_MANAGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "i2c_sensor_adapter.h"
+
+/**
+ * @defgroup spectrum_man_const Spectrum Manager Configuration Constants
+ * @{
+ */
+
+/** Streams analyzed at once. */
+#define SPECTRUM_MANAGER_MAX_ANALYZERS 4
+
+/** Bands per analyzer. */
+#define SPECTRUM_MANAGER_MAX_BANDS 4
+
+/** Peaks reported per analyzer. */
+#define SPECTRUM_MANAGER_PEAKS 3
+
+/** Smallest and largest frame, powers of two. ADC frames are limited to 128 by the ADC ring. */
+#define SPECTRUM_MANAGER_MIN_FFT 32
+#define SPECTRUM_MANAGER_MAX_FFT 256
+
+/** Samples held per sensor ring, must be a power of two. */
+#define SPECTRUM_MANAGER_RING_SAMPLES 512
+
+/** @} */ // end of spectrum_man_const group
+
+/**
+ * @defgroup spectrum_man_enum Spectrum Manager Enumerations
+ * @{
+ */
+
+/**
+ * @brief Stream an analyzer follows.
+ */
+typedef enum {
+    SPECTRUM_SOURCE_NONE = 0,       // Analyzer unused.
+    SPECTRUM_SOURCE_ADC,            // An ADC manager input.
+    SPECTRUM_SOURCE_SENSOR          // One axis of a sensor type.
+} spectrum_source_t;
+
+/**
+ * @brief Sensor axis analyzed.
+ */
+typedef enum {
+    SPECTRUM_AXIS_X = 0,
+    SPECTRUM_AXIS_Y,
+    SPECTRUM_AXIS_Z,
+    SPECTRUM_AXIS_MAGNITUDE         // Vector length, independent of orientation.
+} spectrum_axis_t;
+
+/** @} */ // end of spectrum_man_enum group
+
+/**
+ * @defgroup spectrum_man_struct Spectrum Manager Data Structures
+ * @{
+ */
+
+/**
+ * @brief Frequency band.
+ */
+typedef struct {
+    float low_hz;                   // Lower edge.
+    float high_hz;                  // Upper edge, 0 for half the sample rate.
+} spectrum_manager_band_t;
+
+/**
+ * @brief Configuration of one analyzer.
+ */
+typedef struct {
+    spectrum_source_t source;       // Stream to follow.
+    uint8_t adc_input;              // ADC input, for SPECTRUM_SOURCE_ADC.
+    sensor_type_t sensor_type;      // Sensor type, for SPECTRUM_SOURCE_SENSOR.
+    spectrum_axis_t axis;           // Sensor axis, for SPECTRUM_SOURCE_SENSOR.
+    uint16_t fft_size;              // Samples per frame, a power of two.
+    uint8_t averages;               // Frames in the exponential spectrum average, 1 for none.
+    uint8_t band_count;             // Bands in use.
+    spectrum_manager_band_t bands[SPECTRUM_MANAGER_MAX_BANDS]; // Bands.
+} spectrum_manager_analyzer_config_t;
+
+/**
+ * @brief Spectrum manager configuration.
+ */
+typedef struct {
+    uint32_t publish_ms;            // Time between LOG_KV records, 0 for none.
+    spectrum_manager_analyzer_config_t analyzers[SPECTRUM_MANAGER_MAX_ANALYZERS]; // Analyzers.
+} spectrum_manager_config_t;
+
+/**
+ * @brief Latest result of one analyzer.
+ */
+typedef struct {
+    bool valid;                     // At least one frame was processed.
+    float sample_rate_hz;           // Sample rate of the stream.
+    float bin_hz;                   // Frequency resolution.
+    float total_rms;                // RMS over all bins except DC.
+    float band_rms[SPECTRUM_MANAGER_MAX_BANDS]; // RMS per band.
+    float peak_hz[SPECTRUM_MANAGER_PEAKS];  // Strongest peaks, strongest first, 0 if none.
+    float peak_rms[SPECTRUM_MANAGER_PEAKS]; // RMS of each peak.
+    uint32_t frames;                // Frames processed.
+    uint32_t overruns;              // Frames skipped because the task fell behind the ring.
+    uint32_t last_us;               // Processing time of the last frame.
+    uint32_t max_us;                // Worst processing time.
+} spectrum_manager_result_t;
+
+/** @} */ // end of spectrum_man_struct group
+
+/**
+ * @defgroup spectrum_man_api Spectrum Manager Application Programming Interface
+ * @{
+ */
+
+/**
+ * @brief Configure an analyzer, clearing its spectrum.
+ *
+ * @param id Analyzer number.
+ * @param config Configuration, source SPECTRUM_SOURCE_NONE to stop it.
+ * @return true if successful, false if the configuration is invalid.
+ */
+bool spectrum_manager_configure(uint8_t id, const spectrum_manager_analyzer_config_t* config);
+
+/**
+ * @brief Get the configuration of an analyzer.
+ *
+ * @param id Analyzer number.
+ * @param config Configuration to fill.
+ * @return true if successful, false if the analyzer does not exist.
+ */
+bool spectrum_manager_get_config(uint8_t id, spectrum_manager_analyzer_config_t* config);
+
+/**
+ * @brief Get default configuration.
+ *
+ * Accelerometer magnitude with tremor, chatter and high frequency bands,
+ * plus the first ADC input with the servo current role, if any.
+ *
+ * @param config Configuration to fill.
+ */
+void spectrum_manager_get_default_config(spectrum_manager_config_t* config);
+
+/**
+ * @brief Get the latest result of an analyzer.
+ *
+ * @param id Analyzer number.
+ * @param result Result to fill.
+ * @return true if the analyzer is in use and has a result.
+ */
+bool spectrum_manager_get_result(uint8_t id, spectrum_manager_result_t* result);
+
+/**
+ * @brief Initialize the manager and create its task.
+ *
+ * @param config Configuration, NULL for defaults.
+ * @return true if successful, false otherwise.
+ */
+bool spectrum_manager_init(const spectrum_manager_config_t* config);
+
+/**
+ * @brief Whether the manager is initialized.
+ *
+ * @return true if running.
+ */
+bool spectrum_manager_is_running(void);
+
+/**
+ * @brief Append a sensor sample to the rings of the analyzers following it.
+ *
+ * Called from the sensor manager for every raw sample.
+ *
+ * @param type Sensor type.
+ * @param data Sample.
+ */
+__attribute__((section(".time_critical")))
+void spectrum_manager_record_sensor(sensor_type_t type, const sensor_data_t* data);
+
+/**
+ * @brief Spectrum task, processes at most one frame per run.
+ *
+ * @param params Unused.
+ */
+void spectrum_manager_task(void* params);
+
+/**
+ * @brief Shell command handler for the spectrum manager.
+ *
+ * @param argc Argument count.
+ * @param argv Argument values.
+ * @return 0 on success, non-zero on failure.
+ */
+int cmd_spectrum(int argc, char *argv[]);
+
+/**
+ * @brief Register spectrum manager shell commands.
+ */
+void register_spectrum_manager_commands(void);
+
+/** @} */ // end of spectrum_man_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SPECTRUM_MANAGER_H
@@ -0,0 +1,187 @@
+/**
+ * @file ts_codec.h
+ * @brief Streaming compression for sensor time series
+ * @date 2025-05-27
+ *
+ * Samples are a channel number, a microsecond timestamp and up to four
+ * float values. They are packed MSB first into a bit stream with state
+ * kept per channel, so interleaved channels compress as well as separate
+ * streams. Every sample costs a bounded number of operations and at most
+ * TS_CODEC_MAX_SAMPLE_BYTES, whatever the data. Encoding and decoding only
+ * depend on the C standard library, so ts_codec.c also builds on a host.
+ *
+ * Stream header:
+ * | u8 'T' | u8 'S' | u8 version | u8 channel_bits | u8 scale_shift | u8 scale_count | f32 scales[] |
+ *
+ * Sample:
+ * | channel (channel_bits) | value count - 1 (2) | timestamp | values |
+ *
+ * The timestamp is the delta-of-delta against the previous sample of the
+ * same channel, in a prefix coded bucket:
+ * - '0': unchanged interval
+ * - '10' + 7 bits, '110' + 10 bits, '1110' + 14 bits: signed difference
+ * - '1111' + 32 bits: anything else, including the first sample
+ *
+ * Each value is coded against the previous value of the same channel in
+ * one of two ways, chosen by the scale of the channel (scales[channel >>
+ * scale_shift], 0 if out of range):
+ * - Scale 0, lossless: the XOR of the float bits. '0' if equal, '10' and
+ *   the meaningful bits if they fit the previous leading/trailing zero
+ *   window, else '11' + 5 bits leading zeros + 5 bits length - 1 + bits.
+ * - Scale > 0, quantized: round(value * scale), clamped to +/-1e9, and the
+ *   zigzag difference from the previous quantized value in a bucket of
+ *   '0' (unchanged), '10' + 6, '110' + 12, '1110' + 20 or '1111' + 32 bits.
+ *   The only loss is the rounding, at most 0.5 / scale.
+ *
+ * The stream has no end marker, the container records the sample count.
+ */
+
+#ifndef TS_CODEC_H
+#define TS_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @defgroup ts_codec_const Time Series Codec Constants
+ * @{
+ */
+
+// Widest channel field, which sets the channel state table size
+#define TS_CODEC_MAX_CHANNEL_BITS 7
+#define TS_CODEC_MAX_CHANNELS (1 << TS_CODEC_MAX_CHANNEL_BITS)
+
+// Values per sample
+#define TS_CODEC_MAX_VALUES 4
+
+// Entries in the scale table
+#define TS_CODEC_MAX_SCALES 8
+
+// Largest encoded sample, including a partial byte carried from the previous one
+#define TS_CODEC_MAX_SAMPLE_BYTES 29
+
+// Largest stream header
+#define TS_CODEC_MAX_HEADER_BYTES (6 + (4 * TS_CODEC_MAX_SCALES))
+
+/** @} */ // end of ts_codec_const group
+
+/**
+ * @defgroup ts_codec_struct Time Series Codec Data Structures
+ * @{
+ */
+
+// Stream configuration, carried in the stream header
+typedef struct {
+    uint8_t channel_bits;               // Bits per channel number, 0 for a single channel
+    uint8_t scale_shift;                // Channel is shifted right by this to index scales
+    uint8_t scale_count;                // Entries in scales
+    float scales[TS_CODEC_MAX_SCALES];  // Quantization scale, 0 for lossless
+} ts_codec_config_t;
+
+// One sample
+typedef struct {
+    uint32_t time_us;                   // Timestamp in microseconds
+    uint8_t channel;                    // Channel number
+    uint8_t count;                      // Values used, 1 to TS_CODEC_MAX_VALUES
+    float values[TS_CODEC_MAX_VALUES];  // Values
+} ts_codec_sample_t;
+
+// Per-channel coder state
+typedef struct {
+    uint32_t last_us;                   // Previous timestamp
+    uint32_t last_delta;                // Previous interval
+    uint32_t prev[TS_CODEC_MAX_VALUES]; // Previous float bits or quantized value
+    uint8_t lead[TS_CODEC_MAX_VALUES];  // Previous XOR leading zeros, 0xFF if none
+    uint8_t trail[TS_CODEC_MAX_VALUES]; // Previous XOR trailing zeros
+} ts_codec_channel_t;
+
+// Encoder state
+typedef struct {
+    ts_codec_config_t config;
+    ts_codec_channel_t channels[TS_CODEC_MAX_CHANNELS];
+    uint64_t acc;                       // Bits not yet emitted
+    uint32_t bits;                      // Number of bits in acc, below 8 between calls
+} ts_codec_encoder_t;
+
+// Decoder state
+typedef struct {
+    ts_codec_config_t config;
+    ts_codec_channel_t channels[TS_CODEC_MAX_CHANNELS];
+    const uint8_t* data;                // Stream
+    size_t len;                         // Stream length
+    size_t pos;                         // Next byte to read
+    uint64_t acc;                       // Bits read but not consumed
+    uint32_t bits;                      // Number of bits in acc
+} ts_codec_decoder_t;
+
+/** @} */ // end of ts_codec_struct group
+
+/**
+ * @defgroup ts_codec_api Time Series Codec Interface
+ * @{
+ */
+
+/**
+ * @brief Start a stream and write its header.
+ *
+ * @param enc Encoder to initialize.
+ * @param config Stream configuration.
+ * @param out Buffer of at least TS_CODEC_MAX_HEADER_BYTES.
+ * @return Header length, or 0 if the configuration is invalid.
+ */
+size_t ts_codec_encoder_init(ts_codec_encoder_t* enc, const ts_codec_config_t* config, uint8_t* out);
+
+/**
+ * @brief Encode one sample.
+ *
+ * Only whole bytes are emitted, the remaining bits are carried into the
+ * next call.
+ *
+ * @param enc Encoder.
+ * @param sample Sample to encode, channel must fit channel_bits.
+ * @param out Buffer of at least TS_CODEC_MAX_SAMPLE_BYTES.
+ * @return Bytes written to out.
+ */
+__attribute__((section(".time_critical")))
+size_t ts_codec_encode(ts_codec_encoder_t* enc, const ts_codec_sample_t* sample, uint8_t* out);
+
+/**
+ * @brief End the stream, padding the last byte with zeros.
+ *
+ * @param enc Encoder.
+ * @param out Buffer of at least 1 byte.
+ * @return Bytes written to out, 0 or 1.
+ */
+size_t ts_codec_finish(ts_codec_encoder_t* enc, uint8_t* out);
+
+/**
+ * @brief Start decoding a stream and read its header.
+ *
+ * @param dec Decoder to initialize.
+ * @param data Stream, starting with the header.
+ * @param len Stream length.
+ * @return true if the header is valid.
+ */
+bool ts_codec_decoder_init(ts_codec_decoder_t* dec, const uint8_t* data, size_t len);
+
+/**
+ * @brief Decode the next sample.
+ *
+ * @param dec Decoder.
+ * @param sample Decoded sample.
+ * @return true if a sample was decoded, false at the end of the data.
+ */
+bool ts_codec_decode(ts_codec_decoder_t* dec, ts_codec_sample_t* sample);
+
+/** @} */ // end of ts_codec_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TS_CODEC_H
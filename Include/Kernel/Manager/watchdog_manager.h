@@ -0,0 +1,239 @@
+/**
+* @file watchdog_manager.h
+* @brief Per-task software watchdog supervision for the hardware watchdog.
+* @date 2025-05-24
+*
+* Tasks register a heartbeat with an expected check-in interval. The
+* supervisor only feeds the hardware watchdog while every critical task
+* has checked in on time. A missed heartbeat triggers a configurable
+* recovery action and the stalled task is recorded in the watchdog
+* scratch registers so it can be reported after a reboot.
+*
+* Heartbeats are checked from a timer IRQ, so a task that never returns
+* is still attributed. The scheduler also notes each dispatched task in
+* a scratch register, which names the running task after any watchdog
+* reset.
+*/
+
+#ifndef WATCHDOG_MANAGER_H
+#define WATCHDOG_MANAGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup wdg_man_const Watchdog Manager Configuration Constants
+ * @{
+ */
+
+/** Maximum number of supervised heartbeats. */
+#define WATCHDOG_MANAGER_MAX_ENTRIES 16
+
+/** Maximum heartbeat name length including null terminator. */
+#define WATCHDOG_MANAGER_NAME_LEN 16
+
+/** Supervisor timer period. (ms) */
+#define WATCHDOG_MANAGER_SUPERVISE_MS 10
+
+/** Consecutive failed recoveries before escalating to a reboot. */
+#define WATCHDOG_MANAGER_MAX_RECOVERIES 3
+
+/** @} */ // end of wdg_man_const group
+
+/**
+ * @defgroup wdg_man_enum Watchdog Manager Enumerations
+ * @{
+ */
+
+/**
+ * @brief Action taken when a heartbeat is missed.
+ */
+typedef enum {
+    WATCHDOG_ACTION_NONE = 0,       // Record and log only.
+    WATCHDOG_ACTION_RESTART_TASK,   // Call the recovery function to restart the task.
+    WATCHDOG_ACTION_RESET_BUS,      // Call the recovery function to reset the bus.
+    WATCHDOG_ACTION_REBOOT          // Record the stall and reboot.
+} watchdog_action_t;
+
+/** @} */ // end of wdg_man_enum group
+
+/**
+ * @defgroup wdg_man_struct Watchdog Manager Data structures
+ * @{
+ */
+
+/**
+ * @brief Recovery function for restart and bus reset actions.
+ *
+ * @param user_data User data supplied at registration.
+ * @return true if recovery succeeded, false to count towards escalation.
+ */
+typedef bool (*watchdog_recovery_t)(void* user_data);
+
+/**
+ * @brief Heartbeat information, as reported by watchdog_manager_get_info().
+ */
+typedef struct {
+    uint32_t interval_ms;           // Expected check-in interval.
+    uint32_t last_checkin_ms;       // Time of last check-in since boot.
+    uint32_t checkins;              // Total check-ins.
+    uint32_t misses;                // Total missed intervals.
+    uint32_t recoveries;            // Consecutive recoveries without a check-in.
+    int task_id;                    // Scheduler task ID, or -1.
+    watchdog_action_t action;       // Action on miss.
+    bool critical;                  // Gate the hardware watchdog on this heartbeat.
+    bool stalled;                   // Currently overdue.
+    char name[WATCHDOG_MANAGER_NAME_LEN]; // Heartbeat name.
+} watchdog_entry_info_t;
+
+/** @} */ // end of wdg_man_struct group
+
+/**
+ * @defgroup wdg_man_api Watchdog Manager Application Programming Interface
+ * @{
+ */
+
+/**
+ * @brief Check in a heartbeat.
+ *
+ * @param handle Handle returned by watchdog_manager_register().
+ */
+__attribute__((section(".time_critical")))
+void watchdog_manager_checkin(int handle);
+
+/**
+ * @brief Enable the hardware watchdog under supervisor control.
+ *
+ * Restarts every registered heartbeat interval, so time spent in
+ * initialization does not count as a miss.
+ *
+ * @param timeout_ms Hardware watchdog timeout. (minimum 100 ms)
+ * @return true if successful.
+ * @return false if the manager is not initialized.
+ */
+bool watchdog_manager_enable_hardware(uint32_t timeout_ms);
+
+/**
+ * @brief Retrieve the tasks dispatched when the watchdog last reset the chip.
+ *
+ * Task IDs follow creation order, so they name the same tasks after the reset.
+ *
+ * @param core0_task Filled with the task ID on core 0, 0 if none.
+ * @param core1_task Filled with the task ID on core 1, 0 if none.
+ * @return true if the last reset was caused by the watchdog.
+ * @return false otherwise.
+ */
+bool watchdog_manager_get_last_dispatch(uint32_t* core0_task, uint32_t* core1_task);
+
+/**
+ * @brief Retrieve information about a heartbeat.
+ *
+ * @param handle Heartbeat handle.
+ * @param info Structure to fill.
+ * @return true if the handle is valid.
+ * @return false otherwise.
+ */
+bool watchdog_manager_get_info(int handle, watchdog_entry_info_t* info);
+
+/**
+ * @brief Retrieve the task recorded as stalled before the last reboot.
+ *
+ * @param name Buffer for the task name.
+ * @param len Length of the name buffer.
+ * @param task_id Filled with the stalled task ID.
+ * @return true if the last reboot was caused by a supervised stall.
+ * @return false otherwise.
+ */
+bool watchdog_manager_get_last_stall(char* name, uint32_t len, int* task_id);
+
+/**
+ * @brief Initialize the watchdog manager.
+ *
+ * Heartbeats can be registered once this returns, the hardware watchdog
+ * is enabled separately with watchdog_manager_enable_hardware().
+ *
+ * @return true if successful.
+ * @return false if failed.
+ */
+bool watchdog_manager_init(void);
+
+/**
+ * @brief Note the task about to run on a core.
+ *
+ * Called by the scheduler around each dispatch. The ID is kept in a
+ * watchdog scratch register, so it survives a reset.
+ *
+ * @param core Core the task runs on.
+ * @param task_id Task ID, 0 when the core returns to the kernel loop.
+ */
+__attribute__((section(".time_critical")))
+void watchdog_manager_note_dispatch(uint8_t core, uint32_t task_id);
+
+/**
+ * @brief Register a heartbeat.
+ *
+ * @param name Heartbeat name, usually the task name.
+ * @param task_id Scheduler task ID, or -1 if not tied to a task.
+ * @param interval_ms Maximum time between check-ins.
+ * @param critical If true, the hardware watchdog is only fed while this heartbeat is healthy.
+ * @param action Action taken on a miss.
+ * @param recovery Recovery function for restart and bus reset actions. (can be NULL)
+ * @param user_data User data passed to the recovery function.
+ * @return Handle on success, -1 on failure.
+ */
+int watchdog_manager_register(const char* name, int task_id, uint32_t interval_ms,
+    bool critical, watchdog_action_t action, watchdog_recovery_t recovery, void* user_data);
+
+/**
+ * @brief Run the recovery actions for missed heartbeats.
+ *
+ * The supervisor timer checks every heartbeat and feeds the hardware
+ * watchdog only if all critical heartbeats are healthy and this has run
+ * since the last feed. Called from the kernel main loop.
+ */
+__attribute__((section(".time_critical")))
+void watchdog_manager_supervise(void);
+
+/**
+ * @brief Remove a heartbeat from supervision.
+ *
+ * @param handle Heartbeat handle.
+ * @return true if removed.
+ * @return false if the handle is invalid.
+ */
+bool watchdog_manager_unregister(int handle);
+
+/** @} */ // end of wdg_man_api group
+
+/**
+ * @defgroup wdg_man_cmd Watchdog Manager Command Interface
+ * @{
+ */
+
+/**
+ * @brief Watchdog command handler.
+ *
+ * Usage: wdt <status|last>
+ *
+ * @param argc Argument count.
+ * @param argv Argument array.
+ * @return 0 on success, 1 on error.
+ */
+int cmd_wdt(int argc, char *argv[]);
+
+/**
+ * @brief Register the watchdog manager commands with a shell.
+ */
+void register_watchdog_manager_commands(void);
+
+/** @} */ // end of wdg_man_cmd group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WATCHDOG_MANAGER_H
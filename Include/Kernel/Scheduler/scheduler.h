@@ -16,6 +16,8 @@
 * - Core affinity settings.
 * - Thread-safe operations.
 * - Runtime statistics.
+* - Mixed-criticality mode switching under overload.
+* - Rate/deadline-monotonic priority assignment with response-time analysis.
 * 
 * @section usage Basic Usage.
 * @code
@@ -61,6 +63,18 @@ extern "C" {
 /** Maximum task name length including null terminator. */
 #define TASK_NAME_LEN 16
 
+/** Maximum number of registered mode change handlers. */
+#define SCHEDULER_MAX_MODE_HANDLERS 4
+
+/** Minimum interval between runs of a medium criticality task in degraded mode. (ms) */
+#define SCHEDULER_DEGRADED_PERIOD_MS 100
+
+/** Time without a violation before degraded mode may be left. (ms) */
+#define SCHEDULER_RESTORE_HOLD_MS 1000
+
+/** Minimum hard-deadline slack, as a percentage of the deadline, required to restore. */
+#define SCHEDULER_RESTORE_SLACK_PCT 25
+
 /** @} */ // end of scheduler_constant group
 
 /**
@@ -132,8 +146,58 @@ typedef enum {
     TASK_TYPE_PERSISTENT      /**< Task runs indefinitely. */
 } task_type_t;
 
+/**
+ * @enum task_criticality_t
+ * @brief Task criticality levels for mixed-criticality scheduling.
+ * 
+ * Criticality is independent of priority. It decides what happens to a
+ * task when the scheduler enters degraded mode under overload.
+ */
+typedef enum {
+    TASK_CRITICALITY_LOW = 0,   /**< Shed entirely in degraded mode. */
+    TASK_CRITICALITY_MEDIUM,    /**< Rate limited in degraded mode. */
+    TASK_CRITICALITY_HIGH       /**< Always scheduled, guarantees are kept. */
+} task_criticality_t;
+
+/**
+ * @enum scheduler_mode_t
+ * @brief Scheduler criticality modes.
+ * 
+ * The scheduler enters degraded mode on the first hard-deadline miss or
+ * when a high criticality task overruns its budget, and returns to normal
+ * mode once slack has been restored.
+ */
+typedef enum {
+    SCHEDULER_MODE_NORMAL = 0,  /**< All tasks are scheduled. */
+    SCHEDULER_MODE_DEGRADED     /**< Low criticality tasks shed, medium rate limited. */
+} scheduler_mode_t;
+
+/**
+ * @enum scheduler_policy_t
+ * @brief Fixed priority assignment policies.
+ * 
+ * Automatic policies derive a fine-grained fixed priority for periodic
+ * tasks, used to order tasks sharing the same task_priority_t level.
+ */
+typedef enum {
+    SCHEDULER_POLICY_MANUAL = 0,        /**< Round-robin within each priority level. */
+    SCHEDULER_POLICY_RATE_MONOTONIC,    /**< Shorter period runs first. */
+    SCHEDULER_POLICY_DEADLINE_MONOTONIC /**< Shorter relative deadline runs first. */
+} scheduler_policy_t;
+
 /** @} */ // end of scheduler_enum
 
+/**
+ * @typedef scheduler_mode_handler_t
+ * @brief Mode change handler prototype.
+ * 
+ * Called from task context after the scheduler has changed mode, allowing
+ * subsystems to degrade or restore their own rates.
+ * 
+ * @param mode The newly entered mode.
+ */
+typedef void (*scheduler_mode_handler_t)(scheduler_mode_t mode);
+
 /**
  * @defgroup scheduler_struct Scheduler Data Structures
  * @{
@@ -183,8 +247,37 @@ typedef struct {
     uint32_t task_deletes;            /**< Total tasks deleted. */
     uint32_t core0_switches;          /**< Context switches on core 0. */
     uint32_t core1_switches;          /**< Context switches on core 1. */
+    uint32_t mode_switches;           /**< Number of criticality mode changes. */
+    uint32_t hard_misses;             /**< Total hard-deadline misses. */
+    scheduler_mode_t mode;            /**< Current criticality mode. */
+    char mode_trigger[TASK_NAME_LEN]; /**< Task that caused the last mode change. */
 } scheduler_stats_t;
 
+/**
+ * @struct scheduler_rta_result_t
+ * @brief Response-time analysis result for one periodic task.
+ * 
+ * Response time is computed for non-preemptive fixed priority scheduling,
+ * R = B + C + sum(ceil(R / Tj) * Cj) over periodic tasks with the same or a
+ * higher key on the same core, where B is the longest lower priority
+ * execution time on that core plus a tick of release latency when a task
+ * that is always ready can hold the core.
+ */
+typedef struct {
+    uint32_t task_id;                 /**< Task identifier. */
+    uint32_t period_us;               /**< Task period. */
+    uint32_t deadline_us;             /**< Relative deadline. */
+    uint32_t wcet_us;                 /**< Measured worst case execution time. */
+    uint32_t blocking_us;             /**< Blocking by lower priority tasks. */
+    uint32_t response_us;             /**< Worst case response time. */
+    int32_t slack_us;                 /**< Deadline minus response time. */
+    uint16_t fixed_priority;          /**< Derived fixed priority. */
+    uint8_t core;                     /**< Core the task is listed on. */
+    bool schedulable;                 /**< Response time within deadline. */
+    bool starved;                     /**< Never dispatched, an always ready task has a higher key. */
+    char name[TASK_NAME_LEN];         /**< Task name. */
+} scheduler_rta_result_t;
+
 /**
  * @struct task_control_block_t
  * @brief Task Control Block (TCB) with TrustZone support.
@@ -201,9 +294,12 @@ typedef struct {
     uint32_t fault_count;             /**< Number of MPU/secure faults. */
     uint32_t task_id;                 /**< Unique task identifier. */
     uint32_t run_count;               /**< Number of times task has run. */
+    uint32_t max_exec_time_us;        /**< Longest measured execution time. */
     task_func_t function;             /**< Task entry point function. */
     task_state_t state;               /**< Current task state. */
     task_priority_t priority;         /**< Task priority level. */
+    task_criticality_t criticality;   /**< Task criticality level. */
+    uint16_t fixed_priority;          /**< Derived RM/DM priority, higher runs first. */
     task_type_t type;                 /**< Task execution type. */
     void *params;                     /**< Parameters passed to task. */
     
@@ -224,6 +320,28 @@ typedef struct {
  * @{
  */
 
+/**
+ * @brief Run response-time analysis over all periodic tasks.
+ * 
+ * Uses the measured worst case execution time of each task, falling back
+ * to its execution budget until it has run. Follows the order of
+ * scheduler_get_next_task(): priority level, then fixed priority, with
+ * equal keys dispatched round-robin so each counts as interference for the
+ * others. Periodic tasks are released once per period. Tasks without a
+ * period are always ready: one with a higher key starves the task, one
+ * with an equal key takes a tick per round-robin turn.
+ * 
+ * The hard-deadline override in scheduler_get_next_deadline(), which
+ * promotes a task near its deadline regardless of fixed priority, is not
+ * modelled. A task promoted that way can delay higher fixed priority
+ * tasks beyond the reported response time.
+ * 
+ * @param results Array to fill with one entry per periodic task.
+ * @param max_results Capacity of the results array.
+ * @return Number of entries written.
+ */
+int scheduler_analyze(scheduler_rta_result_t* results, int max_results);
+
 /**
  * @brief Create a new task.
  * 
@@ -280,7 +398,9 @@ bool scheduler_delete_task(int task_id);
  * 
  * @param ms Milliseconds to delay.
  * 
- * @note This is a blocking delay for the calling task only.
+ * @note This is a blocking delay for the calling task only. The other
+ *       tasks of the calling core are dispatched from inside the call,
+ *       so the caller must not hold a lock they take.
  */
 __attribute__((section(".time_critical")))
 void scheduler_delay(uint32_t ms);
@@ -327,6 +447,14 @@ task_control_block_t* scheduler_get_current_task_ptr(uint8_t core);
 __attribute__((section(".time_critical")))
 bool scheduler_get_deadline_info(int task_id, deadline_info_t *info);
 
+/**
+ * @brief Get the current criticality mode.
+ * 
+ * @return Current scheduler mode.
+ */
+__attribute__((section(".time_critical")))
+scheduler_mode_t scheduler_get_mode(void);
+
 /**
  * @brief Get scheduler statistics.
  * 
@@ -377,6 +505,14 @@ bool scheduler_get_task_info(int task_id, task_control_block_t *tcb);
  */
 bool scheduler_init(void);
 
+/**
+ * @brief Register a handler to be notified of mode changes.
+ * 
+ * @param handler Function to call after each mode change.
+ * @return true if registered, false if the handler table is full.
+ */
+bool scheduler_register_mode_handler(scheduler_mode_handler_t handler);
+
 /**
  * @brief Resume a suspended task.
  * 
@@ -409,6 +545,18 @@ bool scheduler_resume_task(int task_id);
 __attribute__((section(".time_critical")))
 void scheduler_run_pending_tasks(void);
 
+/**
+ * @brief Set the criticality level of a task.
+ * 
+ * Tasks default to a criticality derived from their priority at creation.
+ * 
+ * @param task_id Task ID to configure.
+ * @param criticality New criticality level.
+ * @return true if successful, false otherwise.
+ */
+__attribute__((section(".time_critical")))
+bool scheduler_set_criticality(int task_id, task_criticality_t criticality);
+
 /**
  * @brief Set the current task for a specific core.
  * 
@@ -447,6 +595,26 @@ __attribute__((section(".time_critical")))
 bool scheduler_set_deadline_miss_handler(int task_id, 
     void (*handler)(uint32_t task_id));
 
+/**
+ * @brief Force a criticality mode change.
+ * 
+ * Automatic restore still applies, a forced degraded mode is left once
+ * the restore conditions are met.
+ * 
+ * @param mode Mode to enter.
+ */
+void scheduler_set_mode(scheduler_mode_t mode);
+
+/**
+ * @brief Select the fixed priority assignment policy.
+ * 
+ * Priorities are derived immediately and again whenever a deadline
+ * is changed.
+ * 
+ * @param policy Assignment policy.
+ */
+void scheduler_set_policy(scheduler_policy_t policy);
+
 /**
  * @brief Set MPU protection for a task.
  * 
@@ -565,7 +733,7 @@ int cmd_ps(int argc, char *argv[]);
  * 
  * Controls the scheduler state and displays status information.
  * 
- * Usage: scheduler <start|stop|status>
+ * Usage: scheduler <start|stop|status|mode|crit|policy|analyze>
  * 
  * @param argc Argument count.
  * @param argv Argument array.
@@ -575,6 +743,10 @@ int cmd_ps(int argc, char *argv[]);
  * scheduler start    // Start the scheduler. NOSONAR - Code
  * scheduler stop     // Stop the scheduler. NOSONAR - Code
  * scheduler status   // Display scheduler status. NOSONAR - Code
+ * scheduler mode degraded  // Force degraded mode. NOSONAR - Code
+ * scheduler crit 3 low     // Set task 3 to low criticality. NOSONAR - Code
+ * scheduler policy rm      // Rate-monotonic priorities. NOSONAR - Code
+ * scheduler analyze        // Per-task response time and slack. NOSONAR - Code
  * @endcode
  */
 int cmd_scheduler(int argc, char *argv[]);
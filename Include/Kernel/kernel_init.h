@@ -45,7 +45,12 @@ typedef enum {
     SYS_INIT_FLAG_SERVOS        = 0x08,  // Initialize servos.           (0b1 << 3)
     SYS_INIT_FLAG_MPU           = 0x10,  // Initialize MPU.              (0b1 << 4)
     SYS_INIT_FLAG_TZ            = 0x20,  // Initialize TZ.               (0b1 << 5)
-    SYS_INIT_FLAG_DEFAULT       = 0x04 | 0x02 | 0x01  // Default.
+    SYS_INIT_FLAG_BLACKBOX      = 0x40,  // Enable black-box recorder.   (0b1 << 6)
+    SYS_INIT_FLAG_ADC           = 0x80,  // Enable ADC streaming.        (0b1 << 7)
+    SYS_INIT_FLAG_EMG           = 0x100, // Enable EMG grasp control.    (0b1 << 8)
+    SYS_INIT_FLAG_SPECTRUM      = 0x200, // Enable vibration analysis.   (0b1 << 9)
+    SYS_INIT_FLAG_GESTURE       = 0x400, // Enable gesture inference.    (0b1 << 10)
+    SYS_INIT_FLAG_DEFAULT       = 0x200 | 0x80 | 0x40 | 0x04 | 0x02 | 0x01  // Default.
 } kernel_flags_t;
 
 /** @} */ // end of kernel_enum group
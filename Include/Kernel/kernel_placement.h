@@ -0,0 +1,167 @@
+/**
+* @file kernel_placement.h
+* @brief Code and data placement macros with XIP cache miss profiling.
+* @date 2025-05-25
+*
+* Hot paths are moved out of XIP flash by giving them a ".time_critical.<group>"
+* section, which the RP2350 default linker script copies to SRAM at boot.
+* Per-core data is placed in the SCRATCH_X/Y banks so each core accesses its
+* own bank without contending with the other core on the main SRAM striping.
+*
+* When built with ROBOHAND_XIP_PROFILE, functions marked with
+* KERNEL_PROFILE_FUNC() sample the XIP cache hit/access counters on entry and
+* exit, so 'hw_stats xip' can report which functions miss most. Those are the
+* next candidates for KERNEL_RAM_FUNC.
+*/
+
+#ifndef KERNEL_PLACEMENT_H
+#define KERNEL_PLACEMENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @defgroup placement_const Placement Configuration Constants
+ * @{
+ */
+
+/** Maximum number of profiled functions. */
+#define KERNEL_PLACEMENT_MAX_PROBES 24
+
+/** @} */ // end of placement_const group
+
+/**
+ * @defgroup placement_macro Placement Macros
+ * @{
+ */
+
+/** Place a function in SRAM, grouped by subsystem. (sched, isr, servo, ...) */
+#define KERNEL_RAM_FUNC(group) __attribute__((section(".time_critical." #group)))
+
+/** Place an interrupt service routine and its direct callees in SRAM. */
+#define KERNEL_ISR_FUNC KERNEL_RAM_FUNC(isr)
+
+/** Place data in SCRATCH_Y, next to the core 0 stack. */
+#define KERNEL_CORE0_DATA __attribute__((section(".scratch_y.core0")))
+
+/** Place data in SCRATCH_X, next to the core 1 stack. */
+#define KERNEL_CORE1_DATA __attribute__((section(".scratch_x.core1")))
+
+#if defined(ROBOHAND_XIP_PROFILE)
+/**
+ * Attribute XIP cache accesses and misses to the enclosing function until it
+ * returns. Must be the first statement of the function.
+ */
+#define KERNEL_PROFILE_FUNC() \
+    static int kernel_probe_id = -1; \
+    kernel_placement_sample_t kernel_probe_sample \
+        __attribute__((cleanup(kernel_placement_profile_end))) = \
+        kernel_placement_profile_begin(__func__, &kernel_probe_id)
+#else
+#define KERNEL_PROFILE_FUNC() ((void)0)
+#endif
+
+/** @} */ // end of placement_macro group
+
+/**
+ * @defgroup placement_struct Placement Data Structures
+ * @{
+ */
+
+/**
+ * @brief Counter snapshot taken on entry to a profiled function.
+ */
+typedef struct {
+    int probe;                      // Probe index, or -1 if not recording.
+    uint32_t hits;                  // XIP cache hits at entry.
+    uint32_t accesses;              // XIP cache accesses at entry.
+} kernel_placement_sample_t;
+
+/**
+ * @brief Accumulated XIP statistics for a profiled function.
+ */
+typedef struct {
+    const char* name;               // Function name.
+    uint32_t calls;                 // Number of sampled calls.
+    uint32_t accesses;              // XIP cache accesses while running.
+    uint32_t misses;                // XIP cache misses while running.
+} kernel_placement_probe_info_t;
+
+/** @} */ // end of placement_struct group
+
+/**
+ * @defgroup placement_api Placement Application Programming Interface
+ * @{
+ */
+
+/**
+ * @brief Read the global XIP cache counters.
+ *
+ * @param hits Filled with the number of cache hits.
+ * @param accesses Filled with the number of cacheable accesses.
+ */
+__attribute__((section(".time_critical")))
+void kernel_placement_get_xip_counters(uint32_t* hits, uint32_t* accesses);
+
+/**
+ * @brief Get the profiled functions, sorted by misses, highest first.
+ *
+ * @param probes Array to fill.
+ * @param max_probes Size of the array.
+ * @return Number of entries filled.
+ */
+int kernel_placement_get_profile(kernel_placement_probe_info_t* probes, int max_probes);
+
+/**
+ * @brief Initialize the placement profiler.
+ *
+ * @return true if successful.
+ * @return false if no spinlock could be allocated.
+ */
+bool kernel_placement_init(void);
+
+/**
+ * @brief Start sampling a profiled function, registering it on first use.
+ *
+ * Used through KERNEL_PROFILE_FUNC().
+ *
+ * @param name Function name.
+ * @param probe_id Cached probe index of the caller.
+ * @return Counter snapshot.
+ */
+__attribute__((section(".time_critical")))
+kernel_placement_sample_t kernel_placement_profile_begin(const char* name, int* probe_id);
+
+/**
+ * @brief Finish sampling a profiled function.
+ *
+ * Used as the cleanup handler of KERNEL_PROFILE_FUNC().
+ *
+ * @param sample Snapshot taken on entry.
+ */
+__attribute__((section(".time_critical")))
+void kernel_placement_profile_end(const kernel_placement_sample_t* sample);
+
+/**
+ * @brief Whether the build records per-function profiles.
+ *
+ * @return true if built with ROBOHAND_XIP_PROFILE.
+ */
+bool kernel_placement_profiling_enabled(void);
+
+/**
+ * @brief Clear the XIP counters and all per-function profiles.
+ */
+void kernel_placement_reset(void);
+
+/** @} */ // end of placement_api group
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KERNEL_PLACEMENT_H
@@ -0,0 +1,159 @@
+/**
+ * @file ekf.h
+ * @brief Fixed-size extended Kalman filter
+ *
+ * Small EKFs for sensor fusion, servo state estimation and calibration:
+ * - Storage is sized at compile time by EKF_MAX_STATE and
+ *   EKF_MAX_MEASUREMENT, nothing is allocated
+ * - The covariance is symmetric and stored packed, lower triangle by rows
+ * - Measurements are applied one scalar at a time, correlated noise is
+ *   first whitened with a Cholesky factor, so no matrix is ever inverted
+ * - Every scalar update uses the Joseph form, which keeps the covariance
+ *   symmetric positive definite in float arithmetic
+ */
+
+#ifndef EKF_H
+#define EKF_H
+
+#include "vector_math.h"
+
+/* Largest state dimension */
+#define EKF_MAX_STATE 16
+
+/* Largest measurement dimension of one ekf_update() */
+#define EKF_MAX_MEASUREMENT 8
+
+/* Packed size of a symmetric n x n matrix */
+#define EKF_SYM_SIZE(n) ((size_t) (((n) * ((n) + 1)) / 2))
+
+/* Packed index of element (i, j) with i >= j */
+#define EKF_SYM_INDEX(i, j) ((((i) * ((i) + 1)) / 2) + (j))
+
+/* Calls timed together by ekf_benchmark() */
+#define EKF_BENCH_BATCH 32
+
+/**
+ * @brief State transition
+ *
+ * @param context User context given to ekf_init()
+ * @param x Current state
+ * @param dt Time step in seconds
+ * @param x_next Pointer to store the predicted state
+ * @param jacobian n x n row-major Jacobian of x_next with respect to x, zeroed before the call
+ */
+typedef void (*EkfTransition)(void* context, const float* x, float dt, float* x_next, float* jacobian);
+
+/**
+ * @brief Microsecond clock for ekf_benchmark()
+ */
+typedef uint32_t (*EkfClock)(void);
+
+/**
+ * @brief Extended Kalman filter state
+ */
+typedef struct {
+    uint8_t n;                                          /* State dimension */
+    float x[EKF_MAX_STATE];                             /* State estimate */
+    float P[EKF_SYM_SIZE(EKF_MAX_STATE)];               /* Covariance, packed */
+    float Q[EKF_SYM_SIZE(EKF_MAX_STATE)];               /* Process noise per second, packed */
+    float jacobian[EKF_MAX_STATE * EKF_MAX_STATE];      /* Transition Jacobian of the last prediction */
+    EkfTransition transition;                           /* State transition, NULL for a constant state */
+    void* context;                                      /* User context for the transition */
+} Ekf;
+
+/**
+ * @brief Result of ekf_benchmark()
+ */
+typedef struct {
+    uint8_t n;                /* State dimension */
+    uint8_t m;                /* Measurement dimension */
+    uint32_t iterations;      /* Predict and update cycles run */
+    uint32_t predict_ns;      /* Time per ekf_predict() */
+    uint32_t update_ns;       /* Time per ekf_update() */
+    bool healthy;             /* Covariance stayed finite with a positive diagonal */
+} EkfBench;
+
+/**
+ * @brief Initialize a filter
+ *
+ * @param ekf Pointer to filter to initialize
+ * @param n State dimension, 1 to EKF_MAX_STATE
+ * @param x0 Initial state (can be NULL for zero)
+ * @param p0 Initial variance of each state
+ * @param q Process noise variance per second of each state
+ * @param transition State transition (can be NULL for a constant state)
+ * @param context User context for the transition
+ * @return VectorError Error code
+ */
+VectorError ekf_init(Ekf* ekf, uint8_t n, const float* x0, const float* p0, const float* q,
+                     EkfTransition transition, void* context);
+
+/**
+ * @brief Get a covariance element
+ *
+ * @param ekf Filter
+ * @param i Row
+ * @param j Column
+ * @return float Covariance of states i and j
+ */
+float ekf_get_covariance(const Ekf* ekf, uint8_t i, uint8_t j);
+
+/**
+ * @brief Predict the state over a time step
+ *
+ * x = f(x), P = F P F' + Q dt.
+ *
+ * @param ekf Filter
+ * @param dt Time step in seconds
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError ekf_predict(Ekf* ekf, float dt);
+
+/**
+ * @brief Apply one scalar measurement
+ *
+ * @param ekf Filter
+ * @param innovation Measurement minus its prediction
+ * @param h n measurement Jacobian entries
+ * @param r Measurement noise variance
+ * @return VectorError Error code, VECTOR_INCOMPATIBLE_OPERATION if the innovation variance is not positive
+ */
+__attribute__((section(".time_critical")))
+VectorError ekf_update_scalar(Ekf* ekf, float innovation, const float* h, float r);
+
+/**
+ * @brief Apply a measurement vector with correlated noise
+ *
+ * R is factored as L L', the innovations and H rows are whitened by
+ * forward substitution and applied as m scalar updates, relinearized
+ * about the prior state so the result matches a batch update.
+ *
+ * @param ekf Filter
+ * @param m Measurement dimension, 1 to EKF_MAX_MEASUREMENT
+ * @param innovation m measurements minus their predictions
+ * @param H m x n row-major measurement Jacobian
+ * @param R m x m noise covariance, packed
+ * @return VectorError Error code, VECTOR_INCOMPATIBLE_OPERATION if R is not positive definite
+ */
+__attribute__((section(".time_critical")))
+VectorError ekf_update(Ekf* ekf, uint8_t m, const float* innovation, const float* H, const float* R);
+
+/**
+ * @brief Time predict and update cycles of a synthetic filter
+ *
+ * Runs n / 2 constant velocity axes measured by m correlated position
+ * sensors for the given number of cycles, then times ekf_predict() and
+ * ekf_update() separately from that state, in batches of
+ * EKF_BENCH_BATCH calls.
+ *
+ * @param n State dimension, 2 to EKF_MAX_STATE
+ * @param m Measurement dimension, 1 to EKF_MAX_MEASUREMENT
+ * @param iterations Number of cycles
+ * @param clock Microsecond clock
+ * @param bench Pointer to store the result
+ * @return VectorError Error code
+ */
+VectorError ekf_benchmark(uint8_t n, uint8_t m, uint32_t iterations, EkfClock clock, EkfBench* bench);
+
+#endif /* EKF_H */
@@ -0,0 +1,132 @@
+/**
+ * @file matrix_solve.h
+ * @brief Dense linear solvers for VectorND matrices
+ *
+ * Factorizations for inverse kinematics, calibration fitting and system
+ * identification:
+ * - LU with partial pivoting for general square systems and determinants
+ * - Cholesky for symmetric positive definite systems
+ * - Householder QR for overdetermined least squares
+ *
+ * Factorizations work in place in the matrix data and solves in place in
+ * the right-hand side, so the numeric work allocates nothing. Only unit
+ * bookkeeping allocates, as elsewhere in VectorND. Matrices and vectors
+ * must have uniform units, and a solution of A x = b has the unit of b
+ * divided by the unit of A.
+ *
+ * The blocked variants do the same arithmetic in a different order, to
+ * keep a panel of columns in cache on large matrices. Without a data
+ * cache, as on the RP2350 SRAM, the unblocked ones are as fast.
+ */
+
+#ifndef MATRIX_SOLVE_H
+#define MATRIX_SOLVE_H
+
+#include "vector_math.h"
+
+/* Default panel width of the blocked variants */
+#define MATRIX_SOLVE_BLOCK 16
+
+/**
+ * @brief Factor a square matrix as P A = L U in place
+ *
+ * L has a unit diagonal and is stored below it, U on and above it.
+ *
+ * @param matrix Square matrix, replaced by its factors
+ * @param pivots matrix->rows entries, step k swapped rows k and pivots[k]
+ * @param sign Pointer to store the sign of the permutation (can be NULL)
+ * @return VectorError Error code, VECTOR_INCOMPATIBLE_OPERATION if the matrix is singular
+ */
+__attribute__((section(".time_critical")))
+VectorError matrix_lu_decompose(Matrix* matrix, uint16_t* pivots, int8_t* sign);
+
+/**
+ * @brief Blocked matrix_lu_decompose()
+ *
+ * @param matrix Square matrix, replaced by its factors
+ * @param pivots matrix->rows entries
+ * @param sign Pointer to store the sign of the permutation (can be NULL)
+ * @param block Panel width, 0 for MATRIX_SOLVE_BLOCK
+ * @return VectorError Error code
+ */
+VectorError matrix_lu_decompose_blocked(Matrix* matrix, uint16_t* pivots, int8_t* sign, uint16_t block);
+
+/**
+ * @brief Solve A x = b with the factors of matrix_lu_decompose()
+ *
+ * @param lu Factored matrix, with the unit of A
+ * @param pivots Pivots of the factorization
+ * @param b Right-hand side, replaced by x
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError matrix_lu_solve(const Matrix* lu, const uint16_t* pivots, Vector* b);
+
+/**
+ * @brief Factor a symmetric positive definite matrix as A = L L' in place
+ *
+ * Only the lower triangle is read. L replaces it and the strict upper
+ * triangle is zeroed.
+ *
+ * @param matrix Square matrix, replaced by L
+ * @return VectorError Error code, VECTOR_INCOMPATIBLE_OPERATION if not positive definite
+ */
+__attribute__((section(".time_critical")))
+VectorError matrix_cholesky_decompose(Matrix* matrix);
+
+/**
+ * @brief Blocked matrix_cholesky_decompose()
+ *
+ * @param matrix Square matrix, replaced by L
+ * @param block Panel width, 0 for MATRIX_SOLVE_BLOCK
+ * @return VectorError Error code
+ */
+VectorError matrix_cholesky_decompose_blocked(Matrix* matrix, uint16_t block);
+
+/**
+ * @brief Solve A x = b with the factor of matrix_cholesky_decompose()
+ *
+ * @param l Factor L, with the unit of A
+ * @param b Right-hand side, replaced by x
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError matrix_cholesky_solve(const Matrix* l, Vector* b);
+
+/**
+ * @brief Factor a matrix with at least as many rows as columns as A = Q R in place
+ *
+ * R is stored on and above the diagonal, the Householder vectors below
+ * it with an implicit leading 1, so Q = H(0) ... H(n-1) with
+ * H(k) = I - tau[k] v v'.
+ *
+ * @param matrix m x n matrix with m >= n, replaced by its factors
+ * @param tau matrix->cols Householder scales
+ * @return VectorError Error code
+ */
+VectorError matrix_qr_decompose(Matrix* matrix, float* tau);
+
+/**
+ * @brief Least squares solution of A x = b with the factors of matrix_qr_decompose()
+ *
+ * @param x Vector of matrix->cols entries to store the solution
+ * @param qr Factored matrix, with the unit of A
+ * @param tau Householder scales
+ * @param b Right-hand side of matrix->rows entries, replaced by Q' b
+ * @param residual Pointer to store the residual norm |A x - b| (can be NULL)
+ * @return VectorError Error code, VECTOR_INCOMPATIBLE_OPERATION if A is rank deficient
+ */
+VectorError matrix_qr_solve(Vector* x, const Matrix* qr, const float* tau, Vector* b, float* residual);
+
+/**
+ * @brief Check the solvers against known solutions
+ *
+ * Solves fixed systems with every factorization, blocked and unblocked,
+ * and checks matrix_determinant().
+ *
+ * @param max_error Pointer to store the largest relative error found (can be NULL)
+ * @return VectorError Error code, VECTOR_INCOMPATIBLE_OPERATION if an error is too large
+ */
+VectorError matrix_solve_self_test(float* max_error);
+
+#endif /* MATRIX_SOLVE_H */
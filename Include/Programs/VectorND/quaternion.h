@@ -0,0 +1,252 @@
+/**
+ * @file quaternion.h
+ * @brief Quaternion and rotation library for orientation work
+ *
+ * Fixed-size value types for rotations, passed and returned by value:
+ * - Quat is a quaternion w + xi + yj + zk, unit length when it is a rotation
+ * - Vec3 is a 3D vector, Mat3 a row-major 3x3 matrix
+ * - Nothing is allocated and no units are tracked, the types carry
+ *   orientations and directions only
+ *
+ * Rotations follow the Hamilton convention: quat_rotate(q, v) is q v q*,
+ * and quat_multiply(a, b) rotates by b first, then by a. An array of Quat
+ * has the w, x, y, z layout vec3_batch_rotate() expects.
+ */
+
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+#include "vector_batch.h"
+
+/**
+ * @brief Quaternion
+ */
+typedef struct {
+    float w;              /* Scalar part */
+    float x;              /* Vector part */
+    float y;
+    float z;
+} Quat;
+
+/**
+ * @brief 3D vector
+ */
+typedef struct {
+    float x;
+    float y;
+    float z;
+} Vec3;
+
+/**
+ * @brief 3x3 matrix in row-major order
+ */
+typedef struct {
+    float m[9];
+} Mat3;
+
+/**
+ * @brief Approximate 1 / sqrt(value)
+ *
+ * Bit-level initial guess refined by two Newton steps, relative error
+ * below 5e-6 for positive normal values.
+ *
+ * @param value Positive value
+ * @return float Inverse square root
+ */
+__attribute__((section(".time_critical")))
+float quat_fast_inv_sqrt(float value);
+
+/**
+ * @brief Identity rotation
+ *
+ * @return Quat 1 + 0i + 0j + 0k
+ */
+Quat quat_identity(void);
+
+/**
+ * @brief Hamilton product a b
+ *
+ * @param a First quaternion, applied last
+ * @param b Second quaternion, applied first
+ * @return Quat Product
+ */
+__attribute__((section(".time_critical")))
+Quat quat_multiply(Quat a, Quat b);
+
+/**
+ * @brief Conjugate, the inverse of a unit quaternion
+ *
+ * @param q Quaternion
+ * @return Quat w - xi - yj - zk
+ */
+__attribute__((section(".time_critical")))
+Quat quat_conjugate(Quat q);
+
+/**
+ * @brief Inverse of any non-zero quaternion
+ *
+ * @param q Quaternion
+ * @return Quat Inverse, or the identity for a zero quaternion
+ */
+Quat quat_inverse(Quat q);
+
+/**
+ * @brief Dot product of two quaternions
+ *
+ * @param a First quaternion
+ * @param b Second quaternion
+ * @return float Dot product
+ */
+__attribute__((section(".time_critical")))
+float quat_dot(Quat a, Quat b);
+
+/**
+ * @brief Length of a quaternion
+ *
+ * @param q Quaternion
+ * @return float Length
+ */
+float quat_norm(Quat q);
+
+/**
+ * @brief Scale a quaternion to unit length with quat_fast_inv_sqrt()
+ *
+ * @param q Quaternion
+ * @return Quat Unit quaternion, or the identity for a zero quaternion
+ */
+__attribute__((section(".time_critical")))
+Quat quat_normalize(Quat q);
+
+/**
+ * @brief Rotate a vector by a unit quaternion
+ *
+ * @param q Unit quaternion
+ * @param v Vector
+ * @return Vec3 q v q*
+ */
+__attribute__((section(".time_critical")))
+Vec3 quat_rotate(Quat q, Vec3 v);
+
+/**
+ * @brief Rotation matrix of a unit quaternion
+ *
+ * @param q Unit quaternion
+ * @return Mat3 Matrix R with R v = quat_rotate(q, v)
+ */
+__attribute__((section(".time_critical")))
+Mat3 quat_to_mat3(Quat q);
+
+/**
+ * @brief Unit quaternion of a rotation matrix
+ *
+ * Uses the largest of the four diagonal combinations, so it stays
+ * accurate for every rotation angle.
+ *
+ * @param m Rotation matrix
+ * @return Quat Unit quaternion with w >= 0
+ */
+Quat quat_from_mat3(const Mat3* m);
+
+/**
+ * @brief Rotation about an axis
+ *
+ * @param axis Rotation axis, need not be unit length
+ * @param angle Angle in radians, right-handed
+ * @return Quat Unit quaternion, or the identity for a zero axis
+ */
+Quat quat_from_axis_angle(Vec3 axis, float angle);
+
+/**
+ * @brief Axis and angle of a unit quaternion
+ *
+ * @param q Unit quaternion
+ * @param axis Pointer to store the unit axis, x for a zero rotation
+ * @param angle Pointer to store the angle in radians, 0 to pi
+ */
+void quat_to_axis_angle(Quat q, Vec3* axis, float* angle);
+
+/**
+ * @brief Normalized linear interpolation along the shorter arc
+ *
+ * Cheaper than quat_slerp() with a non-uniform angular rate, good for
+ * small steps and filtering.
+ *
+ * @param a Start, unit quaternion
+ * @param b End, unit quaternion
+ * @param t Fraction from 0 (a) to 1 (b)
+ * @return Quat Unit quaternion
+ */
+__attribute__((section(".time_critical")))
+Quat quat_nlerp(Quat a, Quat b, float t);
+
+/**
+ * @brief Spherical linear interpolation along the shorter arc
+ *
+ * Constant angular rate, for blending trajectories. Falls back to
+ * quat_nlerp() when the ends are nearly equal.
+ *
+ * @param a Start, unit quaternion
+ * @param b End, unit quaternion
+ * @param t Fraction from 0 (a) to 1 (b)
+ * @return Quat Unit quaternion
+ */
+__attribute__((section(".time_critical")))
+Quat quat_slerp(Quat a, Quat b, float t);
+
+/**
+ * @brief Multiply a matrix by a vector
+ *
+ * @param m Matrix
+ * @param v Vector
+ * @return Vec3 m v
+ */
+__attribute__((section(".time_critical")))
+Vec3 mat3_multiply_vec3(const Mat3* m, Vec3 v);
+
+/**
+ * @brief Multiply corresponding quaternions of two arrays
+ *
+ * @param result count products, may be a or b
+ * @param a First quaternions
+ * @param b Second quaternions
+ * @param count Number of quaternions
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError quat_batch_multiply(Quat* result, const Quat* a, const Quat* b, uint32_t count);
+
+/**
+ * @brief Normalize an array of quaternions in place
+ *
+ * @param qs Quaternions
+ * @param count Number of quaternions
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError quat_batch_normalize(Quat* qs, uint32_t count);
+
+/**
+ * @brief Interpolate corresponding quaternions of two arrays
+ *
+ * @param result count quaternions, may be a or b
+ * @param a Start quaternions
+ * @param b End quaternions
+ * @param count Number of quaternions
+ * @param t Fraction from 0 (a) to 1 (b)
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError quat_batch_slerp(Quat* result, const Quat* a, const Quat* b, uint32_t count, float t);
+
+/**
+ * @brief Rotate every vector of a batch by one unit quaternion
+ *
+ * @param result Batch to store the result, with the unit of the input
+ * @param q Unit quaternion
+ * @param a Input batch
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError quat_batch_rotate(Vec3Batch* result, Quat q, const Vec3Batch* a);
+
+#endif /* QUATERNION_H */
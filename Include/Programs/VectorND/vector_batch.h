@@ -0,0 +1,166 @@
+/**
+ * @file vector_batch.h
+ * @brief Batched structure-of-arrays kernels for 3D vectors
+ *
+ * Operates on many 3D vectors per call, such as a point cloud or a block
+ * of IMU samples:
+ * - Components are stored as separate x, y and z arrays owned by the caller
+ * - Dimensions and units are validated once per call, not per vector
+ * - Element-wise operations run on the ARM DSP kernels, the others on
+ *   tight scalar loops over the FPU
+ * - Nothing is allocated except the optional result units
+ *
+ * A result batch may be one of the input batches.
+ */
+
+#ifndef VECTOR_BATCH_H
+#define VECTOR_BATCH_H
+
+#include "vector_math.h"
+
+/**
+ * @brief Batch of 3D vectors in structure-of-arrays layout
+ */
+typedef struct {
+    float* x;             /* X components */
+    float* y;             /* Y components */
+    float* z;             /* Z components */
+    uint32_t count;       /* Number of vectors */
+    const Unit* unit;     /* Unit of all components, NULL for dimensionless */
+} Vec3Batch;
+
+/**
+ * @brief Wrap caller storage as a batch
+ *
+ * @param batch Pointer to batch structure to initialize
+ * @param x X components
+ * @param y Y components
+ * @param z Z components
+ * @param count Number of vectors
+ * @param unit Unit of all components (can be NULL for dimensionless), not copied
+ * @return VectorError Error code
+ */
+VectorError vec3_batch_init(Vec3Batch* batch, float* x, float* y, float* z, uint32_t count, const Unit* unit);
+
+/**
+ * @brief Copy interleaved x, y, z triples into a batch
+ *
+ * @param batch Destination batch
+ * @param xyz batch->count triples
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_load_interleaved(Vec3Batch* batch, const float* xyz);
+
+/**
+ * @brief Copy a batch out as interleaved x, y, z triples
+ *
+ * @param xyz Destination for batch->count triples
+ * @param batch Source batch
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_store_interleaved(float* xyz, const Vec3Batch* batch);
+
+/**
+ * @brief Add two batches
+ *
+ * @param result Batch to store the result, with the unit of the inputs
+ * @param a First batch
+ * @param b Second batch
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_add(Vec3Batch* result, const Vec3Batch* a, const Vec3Batch* b);
+
+/**
+ * @brief Subtract batch b from batch a
+ *
+ * @param result Batch to store the result, with the unit of the inputs
+ * @param a First batch
+ * @param b Second batch
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_subtract(Vec3Batch* result, const Vec3Batch* a, const Vec3Batch* b);
+
+/**
+ * @brief Scale a batch by a unitless scalar
+ *
+ * @param result Batch to store the result, with the unit of the input
+ * @param a Input batch
+ * @param scalar Scalar value
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_scale(Vec3Batch* result, const Vec3Batch* a, float scalar);
+
+/**
+ * @brief Dot products of corresponding vectors
+ *
+ * @param result a->count dot products
+ * @param result_unit Unit of the result, initialized here and freed by the caller (can be NULL)
+ * @param a First batch
+ * @param b Second batch
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_dot(float* result, Unit* result_unit, const Vec3Batch* a, const Vec3Batch* b);
+
+/**
+ * @brief Cross products of corresponding vectors
+ *
+ * @param result Batch to store the result, with the product of the input units
+ * @param a First batch
+ * @param b Second batch
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_cross(Vec3Batch* result, const Vec3Batch* a, const Vec3Batch* b);
+
+/**
+ * @brief Magnitudes of the vectors of a batch
+ *
+ * @param result a->count magnitudes
+ * @param result_unit Unit of the result, initialized here and freed by the caller (can be NULL)
+ * @param a Input batch
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_magnitude(float* result, Unit* result_unit, const Vec3Batch* a);
+
+/**
+ * @brief Normalize the vectors of a batch
+ *
+ * Zero vectors stay zero.
+ *
+ * @param result Batch to store the result, dimensionless
+ * @param a Input batch
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_normalize(Vec3Batch* result, const Vec3Batch* a);
+
+/**
+ * @brief Multiply every vector of a batch by a 3x3 matrix
+ *
+ * @param result Batch to store the result, with the product of the matrix and input units
+ * @param matrix 3x3 matrix with uniform units
+ * @param a Input batch
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_transform(Vec3Batch* result, const Matrix* matrix, const Vec3Batch* a);
+
+/**
+ * @brief Rotate every vector of a batch by its own unit quaternion
+ *
+ * @param result Batch to store the result, with the unit of the input
+ * @param qs a->count quaternions as w, x, y, z
+ * @param a Input batch
+ * @return VectorError Error code
+ */
+__attribute__((section(".time_critical")))
+VectorError vec3_batch_rotate(Vec3Batch* result, const float* qs, const Vec3Batch* a);
+
+#endif /* VECTOR_BATCH_H */
@@ -0,0 +1,601 @@
+/**
+ * @file vector_expr.hpp
+ * @brief Expression templates for fused element-wise VectorND arithmetic
+ *
+ * The C API evaluates one operation per call, so a + b * s - c makes three
+ * passes over memory and allocates the intermediate Vectors. Here the
+ * operators only build a small expression object, and evaluating it
+ * computes every element in a single loop with no temporaries:
+ *
+ *   vnd::ConstRef<vnd::Meters> a, b, c;
+ *   vnd::bind(&a, &va); vnd::bind(&b, &vb); vnd::bind(&c, &vc);
+ *   VectorError err = vnd::evaluate(&result, a + b * 2.0f - c);
+ *
+ * Units are types, so adding metres to seconds does not compile and the
+ * unit of a product is worked out by the compiler. Dimensions are template
+ * parameters when known, checked by the compiler, or Dynamic and checked
+ * once per evaluation. A runtime Vector is checked once when it is bound
+ * to a typed reference, after which no unit bookkeeping is done.
+ *
+ * Only element-wise operations fuse: +, -, unary -, and * and / which act
+ * element by element, with scalars broadcast. Every output element depends
+ * only on the same element of the operands, so the destination may also
+ * appear in the expression. Cross products and matrix products stay in the
+ * C API.
+ *
+ * Expressions hold Fixed vectors by reference. Evaluate an expression
+ * before the vectors in it go out of scope, and do not store one in a
+ * variable that outlives them.
+ */
+
+#ifndef VECTOR_EXPR_HPP
+#define VECTOR_EXPR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "vector_math.h"
+
+namespace vnd {
+
+/* Dimension known only at runtime */
+constexpr uint16_t Dynamic = 0;
+
+/* Number of UnitType values, the length of every Units pack */
+constexpr size_t UnitTypeCount = static_cast<size_t>(UNIT_CUSTOM) + 1;
+
+/**
+ * @brief Unit known at compile time, one exponent per UnitType value
+ */
+template <int... Exponents>
+struct Units {
+    static_assert(sizeof...(Exponents) == UnitTypeCount, "Units needs one exponent per UnitType");
+
+    /**
+     * @brief Check whether a runtime unit is this unit
+     *
+     * @param unit Unit to check
+     * @return bool True if every component exponent matches
+     */
+    static bool matches(const Unit* unit) {
+        static constexpr int expected[] = {Exponents...};
+        int found[UnitTypeCount] = {};
+
+        if (unit == nullptr) {
+            return false;
+        }
+
+        for (uint8_t i = 0; i < unit->count; i++) {
+            size_t type = static_cast<size_t>(unit->components[i].type);
+            if (type >= UnitTypeCount) {
+                return false;
+            }
+            found[type] += unit->components[i].exponent;
+        }
+
+        for (size_t type = 0; type < UnitTypeCount; type++) {
+            if (found[type] != expected[type]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Build the runtime unit, to be freed with unit_free()
+     *
+     * @param unit Pointer to the unit to initialize
+     * @return VectorError Error code
+     */
+    static VectorError to_unit(Unit* unit) {
+        static constexpr int exponents[] = {Exponents...};
+        uint8_t count = 0;
+
+        for (size_t type = 0; type < UnitTypeCount; type++) {
+            if (exponents[type] != 0) {
+                count++;
+            }
+        }
+
+        VectorError err = unit_init(unit, count);
+        if (err != VECTOR_SUCCESS) {
+            return err;
+        }
+
+        for (size_t type = 0; type < UnitTypeCount; type++) {
+            if (exponents[type] == 0) {
+                continue;
+            }
+            err = unit_add_component(unit, static_cast<UnitType>(type), static_cast<int8_t>(exponents[type]));
+            if (err != VECTOR_SUCCESS) {
+                unit_free(unit);
+                return err;
+            }
+        }
+
+        return VECTOR_SUCCESS;
+    }
+};
+
+namespace detail {
+
+template <UnitType Type, int Exponent, size_t... Index>
+Units<((Index == static_cast<size_t>(Type)) ? Exponent : 0)...> base_unit(std::index_sequence<Index...>);
+
+template <int... A, int... B>
+Units<(A + B)...> multiply_units(Units<A...>, Units<B...>);
+
+template <int... A, int... B>
+Units<(A - B)...> divide_units(Units<A...>, Units<B...>);
+
+} // namespace detail
+
+/* Single UnitType raised to a power */
+template <UnitType Type, int Exponent = 1>
+using BaseUnit = decltype(detail::base_unit<Type, Exponent>(std::make_index_sequence<UnitTypeCount>{}));
+
+template <class A, class B>
+using MultiplyUnits = decltype(detail::multiply_units(A{}, B{}));
+
+template <class A, class B>
+using DivideUnits = decltype(detail::divide_units(A{}, B{}));
+
+using Dimensionless = BaseUnit<UNIT_NONE, 0>;
+using Meters = BaseUnit<UNIT_METER>;
+using Seconds = BaseUnit<UNIT_SECOND>;
+using Kilograms = BaseUnit<UNIT_KILOGRAM>;
+using Radians = BaseUnit<UNIT_RADIAN>;
+using Newtons = BaseUnit<UNIT_NEWTON>;
+using Volts = BaseUnit<UNIT_VOLT>;
+using Amperes = BaseUnit<UNIT_AMPERE>;
+using MetersPerSecond = DivideUnits<Meters, Seconds>;
+using MetersPerSecondSquared = DivideUnits<MetersPerSecond, Seconds>;
+using RadiansPerSecond = DivideUnits<Radians, Seconds>;
+
+/**
+ * @brief Scalar with a unit, broadcast over every element in an expression
+ */
+template <class U>
+struct Quantity {
+    float value;
+};
+
+namespace detail {
+
+/* Base of every expression node */
+struct ExprTag {};
+
+template <class T>
+constexpr bool is_expr = std::is_base_of<ExprTag, std::decay_t<T>>::value;
+
+template <class T>
+struct IsQuantity : std::false_type {};
+
+template <class U>
+struct IsQuantity<Quantity<U>> : std::true_type {};
+
+template <class T>
+constexpr bool is_operand = is_expr<T> || IsQuantity<std::decay_t<T>>::value ||
+                            std::is_arithmetic<std::decay_t<T>>::value;
+
+constexpr bool dims_agree(uint16_t a, uint16_t b) {
+    return (a == Dynamic) || (b == Dynamic) || (a == b);
+}
+
+constexpr uint16_t common_dim(uint16_t a, uint16_t b) {
+    return (a == Dynamic) ? b : a;
+}
+
+/* Nodes that own storage are held by reference, everything else by value */
+template <class E>
+using Operand = std::conditional_t<E::owning, const E&, const E>;
+
+/**
+ * @brief Scalar broadcast over every element
+ */
+template <class U>
+class Broadcast : public ExprTag {
+public:
+    using unit = U;
+    static constexpr uint16_t dim = Dynamic;
+    static constexpr bool scalar = true;
+    static constexpr bool owning = false;
+
+    explicit Broadcast(float value) : value_(value) {}
+
+    uint16_t size() const { return 0; }
+    bool fits(uint16_t) const { return true; }
+    float operator[](uint16_t) const { return value_; }
+
+private:
+    float value_;
+};
+
+struct Add {
+    template <class A, class B>
+    using result_unit = A;
+    static float apply(float a, float b) { return a + b; }
+};
+
+struct Subtract {
+    template <class A, class B>
+    using result_unit = A;
+    static float apply(float a, float b) { return a - b; }
+};
+
+struct Multiply {
+    template <class A, class B>
+    using result_unit = MultiplyUnits<A, B>;
+    static float apply(float a, float b) { return a * b; }
+};
+
+struct Divide {
+    template <class A, class B>
+    using result_unit = DivideUnits<A, B>;
+    static float apply(float a, float b) { return a / b; }
+};
+
+/**
+ * @brief Element-wise binary operation
+ */
+template <class Op, class L, class R>
+class Binary : public ExprTag {
+    static_assert(dims_agree(L::dim, R::dim), "vector dimensions differ");
+
+public:
+    using unit = typename Op::template result_unit<typename L::unit, typename R::unit>;
+    static constexpr uint16_t dim = common_dim(L::dim, R::dim);
+    static constexpr bool scalar = L::scalar && R::scalar;
+    static constexpr bool owning = false;
+
+    Binary(const L& l, const R& r) : l_(l), r_(r) {}
+
+    uint16_t size() const { return L::scalar ? r_.size() : l_.size(); }
+    bool fits(uint16_t n) const { return l_.fits(n) && r_.fits(n); }
+    float operator[](uint16_t i) const { return Op::apply(l_[i], r_[i]); }
+
+private:
+    Operand<L> l_;
+    Operand<R> r_;
+};
+
+/**
+ * @brief Element-wise negation
+ */
+template <class E>
+class Negate : public ExprTag {
+public:
+    using unit = typename E::unit;
+    static constexpr uint16_t dim = E::dim;
+    static constexpr bool scalar = E::scalar;
+    static constexpr bool owning = false;
+
+    explicit Negate(const E& e) : e_(e) {}
+
+    uint16_t size() const { return e_.size(); }
+    bool fits(uint16_t n) const { return e_.fits(n); }
+    float operator[](uint16_t i) const { return -e_[i]; }
+
+private:
+    Operand<E> e_;
+};
+
+/**
+ * @brief Typed view of the data of a runtime Vector, see bind()
+ */
+template <class U, uint16_t N, class T>
+class View : public ExprTag {
+public:
+    using unit = U;
+    static constexpr uint16_t dim = N;
+    static constexpr bool scalar = false;
+    static constexpr bool owning = false;
+
+    uint16_t size() const { return (N != Dynamic) ? N : size_; }
+    bool fits(uint16_t n) const { return size() == n; }
+    float operator[](uint16_t i) const { return data_[i]; }
+    T* data() const { return data_; }
+
+private:
+    T* data_ = nullptr;
+    uint16_t size_ = 0;
+
+    template <class V, uint16_t M, class S, class P>
+    friend VectorError bind_view(View<V, M, S>* view, P* vector);
+};
+
+/* Helper function to check a Vector against a view type and point the view at it */
+template <class U, uint16_t N, class T, class P>
+VectorError bind_view(View<U, N, T>* view, P* vector) {
+    if (view == nullptr || vector == nullptr || vector->data == nullptr || vector->units == nullptr) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    if ((N != Dynamic) && (vector->dim != N)) {
+        return VECTOR_DIMENSION_MISMATCH;
+    }
+
+    uint16_t unit_count = vector->uniform_units ? 1 : vector->dim;
+    for (uint16_t i = 0; i < unit_count; i++) {
+        if (!U::matches(&vector->units[i])) {
+            return VECTOR_UNIT_MISMATCH;
+        }
+    }
+
+    view->data_ = vector->data;
+    view->size_ = vector->dim;
+    return VECTOR_SUCCESS;
+}
+
+} // namespace detail
+
+/* Writable view of a Vector, bound with bind() */
+template <class U, uint16_t N = Dynamic>
+using Ref = detail::View<U, N, float>;
+
+/* Read-only view of a Vector, bound with bind() */
+template <class U, uint16_t N = Dynamic>
+using ConstRef = detail::View<U, N, const float>;
+
+/**
+ * @brief Vector with its dimension and unit in the type and its storage inline
+ */
+template <uint16_t N, class U = Dimensionless>
+class Fixed : public detail::ExprTag {
+    static_assert(N != Dynamic, "Fixed needs a dimension");
+
+public:
+    using unit = U;
+    static constexpr uint16_t dim = N;
+    static constexpr bool scalar = false;
+    static constexpr bool owning = true;
+
+    Fixed() = default;
+
+    template <class... T, std::enable_if_t<(sizeof...(T) == N) && (std::is_arithmetic<T>::value && ...), int> = 0>
+    explicit Fixed(T... values) : data_{static_cast<float>(values)...} {}
+
+    template <class E, std::enable_if_t<detail::is_expr<E>, int> = 0>
+    Fixed(const E& expr) {
+        *this = expr;
+    }
+
+    /**
+     * @brief Evaluate an expression of the same dimension and unit into this vector
+     *
+     * The dimension of the expression must be known at compile time, use
+     * assign() for expressions over Dynamic views.
+     */
+    template <class E, std::enable_if_t<detail::is_expr<E>, int> = 0>
+    Fixed& operator=(const E& expr) {
+        static_assert(std::is_same<typename E::unit, U>::value, "expression unit differs from the vector unit");
+        static_assert(E::dim == N, "expression dimension is not N, or only known at runtime");
+
+        for (uint16_t i = 0; i < N; i++) {
+            data_[i] = expr[i];
+        }
+        return *this;
+    }
+
+    uint16_t size() const { return N; }
+    bool fits(uint16_t n) const { return n == N; }
+    float operator[](uint16_t i) const { return data_[i]; }
+    float& operator[](uint16_t i) { return data_[i]; }
+    float* data() { return data_; }
+    const float* data() const { return data_; }
+
+private:
+    float data_[N] = {};
+};
+
+namespace detail {
+
+template <class E, std::enable_if_t<is_expr<E>, int> = 0>
+const E& as_expr(const E& expr) {
+    return expr;
+}
+
+template <class U>
+Broadcast<U> as_expr(const Quantity<U>& quantity) {
+    return Broadcast<U>(quantity.value);
+}
+
+template <class T, std::enable_if_t<std::is_arithmetic<T>::value, int> = 0>
+Broadcast<Dimensionless> as_expr(T value) {
+    return Broadcast<Dimensionless>(static_cast<float>(value));
+}
+
+template <class T>
+using ExprOf = std::decay_t<decltype(as_expr(std::declval<const T&>()))>;
+
+/* Operators apply to two operands of which at least one is an expression */
+template <class L, class R>
+using EnableOperator = std::enable_if_t<is_operand<L> && is_operand<R> && (is_expr<L> || is_expr<R>), int>;
+
+} // namespace detail
+
+template <class L, class R, detail::EnableOperator<L, R> = 0>
+detail::Binary<detail::Add, detail::ExprOf<L>, detail::ExprOf<R>> operator+(const L& l, const R& r) {
+    static_assert(std::is_same<typename detail::ExprOf<L>::unit, typename detail::ExprOf<R>::unit>::value,
+                  "operands of + have different units");
+    return {detail::as_expr(l), detail::as_expr(r)};
+}
+
+template <class L, class R, detail::EnableOperator<L, R> = 0>
+detail::Binary<detail::Subtract, detail::ExprOf<L>, detail::ExprOf<R>> operator-(const L& l, const R& r) {
+    static_assert(std::is_same<typename detail::ExprOf<L>::unit, typename detail::ExprOf<R>::unit>::value,
+                  "operands of - have different units");
+    return {detail::as_expr(l), detail::as_expr(r)};
+}
+
+template <class L, class R, detail::EnableOperator<L, R> = 0>
+detail::Binary<detail::Multiply, detail::ExprOf<L>, detail::ExprOf<R>> operator*(const L& l, const R& r) {
+    return {detail::as_expr(l), detail::as_expr(r)};
+}
+
+template <class L, class R, detail::EnableOperator<L, R> = 0>
+detail::Binary<detail::Divide, detail::ExprOf<L>, detail::ExprOf<R>> operator/(const L& l, const R& r) {
+    return {detail::as_expr(l), detail::as_expr(r)};
+}
+
+template <class E, std::enable_if_t<detail::is_expr<E>, int> = 0>
+detail::Negate<E> operator-(const E& e) {
+    return detail::Negate<E>(e);
+}
+
+/**
+ * @brief Check a Vector once and bind a writable view to it
+ *
+ * Every unit of the vector must be U and, unless N is Dynamic, its
+ * dimension must be N. The view points at the vector data, which must
+ * outlive it and not be reallocated.
+ *
+ * @param ref View to bind
+ * @param vector Vector to view
+ * @return VectorError Error code
+ */
+template <class U, uint16_t N>
+VectorError bind(Ref<U, N>* ref, Vector* vector) {
+    return detail::bind_view(ref, vector);
+}
+
+/**
+ * @brief Check a Vector once and bind a read-only view to it
+ *
+ * @param ref View to bind
+ * @param vector Vector to view
+ * @return VectorError Error code
+ */
+template <class U, uint16_t N>
+VectorError bind(ConstRef<U, N>* ref, const Vector* vector) {
+    return detail::bind_view(ref, vector);
+}
+
+/**
+ * @brief Evaluate an expression into a Vector in one pass
+ *
+ * Like the C API, result is reinitialized if its dimension differs, and
+ * its unit is set to the unit of the expression.
+ *
+ * @param result Pointer to store the result
+ * @param expr Expression to evaluate
+ * @return VectorError Error code, VECTOR_DIMENSION_MISMATCH if runtime dimensions differ
+ */
+template <class E, std::enable_if_t<detail::is_expr<E>, int> = 0>
+VectorError evaluate(Vector* result, const E& expr) {
+    static_assert(!E::scalar, "expression has no vector operand");
+
+    if (result == nullptr) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    uint16_t n = expr.size();
+    if (!expr.fits(n)) {
+        return VECTOR_DIMENSION_MISMATCH;
+    }
+
+    if ((result->dim != n) || !result->uniform_units) {
+        VectorError err = vector_free(result);
+        if (err != VECTOR_SUCCESS) return err;
+
+        err = vector_init(result, n, true);
+        if (err != VECTOR_SUCCESS) return err;
+    }
+
+    if (!E::unit::matches(result->units)) {
+        Unit unit;
+        VectorError err = E::unit::to_unit(&unit);
+        if (err != VECTOR_SUCCESS) return err;
+
+        err = vector_set_uniform_unit(result, &unit);
+        unit_free(&unit);
+        if (err != VECTOR_SUCCESS) return err;
+    }
+
+    float* out = result->data;
+    for (uint16_t i = 0; i < n; i++) {
+        out[i] = expr[i];
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+/**
+ * @brief Evaluate an expression in one pass into a Fixed vector or writable view
+ *
+ * Units and known dimensions are checked at compile time, Dynamic ones
+ * here.
+ *
+ * @param dst Fixed vector or Ref to store the result
+ * @param expr Expression to evaluate
+ * @return VectorError Error code, VECTOR_DIMENSION_MISMATCH if runtime dimensions differ
+ */
+template <class D, class E, std::enable_if_t<detail::is_expr<D> && detail::is_expr<E>, int> = 0>
+VectorError assign(D& dst, const E& expr) {
+    static_assert(std::is_same<typename E::unit, typename D::unit>::value,
+                  "expression unit differs from the destination unit");
+    static_assert(detail::dims_agree(D::dim, E::dim), "expression dimension differs from the destination");
+    static_assert(!E::scalar, "expression has no vector operand");
+
+    uint16_t n = dst.size();
+    if (!expr.fits(n)) {
+        return VECTOR_DIMENSION_MISMATCH;
+    }
+
+    float* out = dst.data();
+    for (uint16_t i = 0; i < n; i++) {
+        out[i] = expr[i];
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+/**
+ * @brief Sum the elements of an expression in one pass
+ *
+ * @param result Pointer to store the sum, its unit must be the expression unit
+ * @param expr Expression to sum
+ * @return VectorError Error code
+ */
+template <class Q, class E, std::enable_if_t<detail::is_expr<E>, int> = 0>
+VectorError sum(Quantity<Q>* result, const E& expr) {
+    static_assert(std::is_same<Q, typename E::unit>::value, "result unit differs from the expression unit");
+    static_assert(!E::scalar, "expression has no vector operand");
+
+    if (result == nullptr) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    uint16_t n = expr.size();
+    if (!expr.fits(n)) {
+        return VECTOR_DIMENSION_MISMATCH;
+    }
+
+    float total = 0.0f;
+    for (uint16_t i = 0; i < n; i++) {
+        total += expr[i];
+    }
+
+    result->value = total;
+    return VECTOR_SUCCESS;
+}
+
+/**
+ * @brief Dot product of two expressions in one pass
+ *
+ * @param result Pointer to store the product, its unit must be the product of the operand units
+ * @param a First expression
+ * @param b Second expression
+ * @return VectorError Error code
+ */
+template <class Q, class A, class B, std::enable_if_t<detail::is_expr<A> && detail::is_expr<B>, int> = 0>
+VectorError dot(Quantity<Q>* result, const A& a, const B& b) {
+    return sum(result, a * b);
+}
+
+} // namespace vnd
+
+#endif /* VECTOR_EXPR_HPP */
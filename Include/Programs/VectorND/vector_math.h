@@ -20,6 +20,10 @@
 /* Include ARM DSP headers for SIMD operations */
 #include "arm_math.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Enumeration of supported physical units
  */
@@ -387,4 +391,8 @@ VectorError matrix_vector_multiply(Vector* result, const Matrix* matrix, const V
 __attribute__((section(".time_critical")))
 VectorError matrix_multiply(Matrix* result, const Matrix* a, const Matrix* b);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* VECTOR_MATH_H */
\ No newline at end of file
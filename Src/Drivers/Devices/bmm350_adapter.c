@@ -286,7 +286,6 @@ static void bmm350_adapter_task_inner_checks(uint32_t current_time, bmm350_task_
                     sensor_data.xyz.x = tcb->mag_data.x;
                     sensor_data.xyz.y = tcb->mag_data.y;
                     sensor_data.xyz.z = tcb->mag_data.z;
-                    sensor_data.timestamp = (float) get_absolute_time();
                     
                     // Update the adapter with new data
                     i2c_sensor_adapter_update_data(
@@ -5,6 +5,8 @@
 */
 
 #include "servo_controller.h"
+#include "interp_accel.h"
+#include "kernel_placement.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -24,6 +26,10 @@ struct servo_controller_s {
     uint channel;                    // PWM channel
     uint actual_freq;                // Actual PWM frequency
     float clock_div;                 // Clock divider
+    uint16_t wrap;                   // PWM counter wrap value
+    uint32_t compare_per_us_q16;     // PWM compare counts per microsecond (Q16.16)
+    interp_accel_linear_t angle_map; // Millidegrees to pulse width, clamped
+    interp_accel_linear_t pulse_map; // Pulse width to millidegrees, clamped
     float current_position;          // Current position in degrees
     uint current_pulse_us;           // Current pulse width in microseconds
     servo_mode_t mode;               // Operation mode
@@ -83,8 +89,25 @@ servo_controller_t servo_controller_create(const servo_config_t* config) {
     // Configure PWM
     pwm_config pwm_cfg = pwm_get_default_config();
     pwm_config_set_clkdiv(&pwm_cfg, (float)clock_div);
-    pwm_config_set_wrap(&pwm_cfg, (uint16_t) ((wrap_value - 1) & 0xFF));
+    pwm_config_set_wrap(&pwm_cfg, (uint16_t) ((wrap_value - 1) & 0xFFFF));
     pwm_init(controller->slice_num, &pwm_cfg, false);
+
+    // Precompute the integer conversions used on the update path
+    controller->wrap = (uint16_t) ((wrap_value - 1) & 0xFFFF);
+    controller->compare_per_us_q16 = (uint32_t) (((uint64_t) controller->wrap * controller->actual_freq << 16) / 1000000u);
+
+    int32_t min_mdeg = (int32_t) (config->min_angle_deg * 1000.0f);
+    int32_t max_mdeg = (int32_t) (config->max_angle_deg * 1000.0f);
+    int32_t min_pulse = (int32_t) config->min_pulse_us;
+    int32_t max_pulse = (int32_t) config->max_pulse_us;
+
+    if (!interp_accel_linear_init(&controller->angle_map, min_mdeg, max_mdeg,
+        config->inverted ? max_pulse : min_pulse, config->inverted ? min_pulse : max_pulse) ||
+        !interp_accel_linear_init(&controller->pulse_map, min_pulse, max_pulse,
+        config->inverted ? max_mdeg : min_mdeg, config->inverted ? min_mdeg : max_mdeg)) {
+        free(controller);
+        return NULL;
+    }
     
     // Initialize sweep parameters
     controller->sweep_min_pos = config->min_angle_deg;
@@ -114,65 +137,33 @@ void servo_controller_get_default_config(servo_config_t* config) {
     config->gpio_pin = 0;               // Default GPIO pin 0
 }
 
-static uint32_t angle_to_pulse(servo_controller_t controller, float angle) {
-    // Clamp angle to valid range
-    if (angle < controller->config.min_angle_deg) {
-        angle = controller->config.min_angle_deg;
-    }
-    else if (angle > controller->config.max_angle_deg) {
-        angle = controller->config.max_angle_deg;
-    }
+KERNEL_RAM_FUNC(servo) static uint32_t angle_to_pulse(servo_controller_t controller, float angle) {
+    // Clamp and scale in fixed point, VCVT saturates out of range angles
+    int32_t angle_mdeg = (int32_t) (angle * 1000.0f);
     
-    // Calculate the pulse width in microseconds
-    float angle_range = controller->config.max_angle_deg - controller->config.min_angle_deg;
-    float pulse_range = (float) (controller->config.max_pulse_us - controller->config.min_pulse_us);
-    
-    float angle_normalized = (angle - controller->config.min_angle_deg) / angle_range;
-    if (controller->config.inverted) {
-        angle_normalized = 1.0f - angle_normalized;
-    }
-    
-    return (uint32_t)((float) (controller->config.min_pulse_us) + (angle_normalized * pulse_range));
+    return (uint32_t) interp_accel_linear(&controller->angle_map, angle_mdeg);
 }
 
-static float pulse_to_angle(servo_controller_t controller, uint32_t pulse_us) {
-    // Clamp pulse to valid range
-    if (pulse_us < controller->config.min_pulse_us) {
-        pulse_us = controller->config.min_pulse_us;
-    }
-    else if (pulse_us > controller->config.max_pulse_us) {
-        pulse_us = controller->config.max_pulse_us;
-    }
-    
-    // Calculate the angle in degrees
-    float angle_range = controller->config.max_angle_deg - controller->config.min_angle_deg;
-    float pulse_range = (float) (controller->config.max_pulse_us - controller->config.min_pulse_us);
-    
-    float pulse_normalized = (float)(pulse_us - controller->config.min_pulse_us) / pulse_range;
-    if (controller->config.inverted) {
-        pulse_normalized = 1.0f - pulse_normalized;
-    }
-    
-    return controller->config.min_angle_deg + (pulse_normalized * angle_range);
+KERNEL_RAM_FUNC(servo) static float pulse_to_angle(servo_controller_t controller, uint32_t pulse_us) {
+    // Clamp and scale in fixed point, pulse widths are far below INT32_MAX
+    int32_t angle_mdeg = interp_accel_linear(&controller->pulse_map, (int32_t) pulse_us);
+
+    return (float) angle_mdeg / 1000.0f;
 }
 
-static void set_pwm_duty_cycle(servo_controller_t controller, uint32_t pulse_us) {
+KERNEL_RAM_FUNC(servo) static void set_pwm_duty_cycle(servo_controller_t controller, uint32_t pulse_us) {
     if (!controller->is_enabled) {
         return;
     }
     
-    // Calculate duty cycle from pulse width
-    uint32_t period_us = 1000000 / controller->actual_freq;
-    float duty_cycle = (float)pulse_us / (float)period_us;
-    
-    // Get wrap value from PWM slice
-    uint16_t wrap = (uint16_t) CLOCK_FREQ / (uint16_t) ((float) controller->actual_freq * controller->clock_div) - 1;
-    
-    // Calculate compare value for the desired duty cycle
-    uint16_t compare = (uint16_t)(duty_cycle * (float)wrap);
+    // Calculate compare value for the desired pulse width
+    uint32_t compare = (uint32_t) (((uint64_t) pulse_us * controller->compare_per_us_q16) >> 16);
+    if (compare > controller->wrap) {
+        compare = controller->wrap;
+    }
     
     // Set PWM duty cycle
-    pwm_set_chan_level(controller->slice_num, controller->channel, compare);
+    pwm_set_chan_level(controller->slice_num, controller->channel, (uint16_t) compare);
 }
 
 bool servo_controller_set_position(servo_controller_t controller, float position) {
@@ -7,6 +7,7 @@
 #include "log_manager.h"
 #include "scheduler.h"
 #include "i2c_driver.h"
+#include "i2c_pio.h"
 #include "spinlock_manager.h"
 #include "pico/stdlib.h"
 #include "hardware/i2c.h"
@@ -19,6 +20,37 @@
 // Global context for DMA ISR
 static i2c_driver_ctx_t* g_i2c_dma_ctx = NULL;
 
+// Clock fallback steps, fastest first
+static const uint32_t g_i2c_clock_steps[] = {1000000, 400000, 100000};
+
+// Bus recovery timing, run at 100 kHz whatever the bus clock
+#define I2C_RECOVERY_HALF_PERIOD_US 5
+#define I2C_RECOVERY_STRETCH_TIMEOUT_US 1000
+
+static void i2c_driver_adapt_clock(i2c_driver_ctx_t* ctx, uint16_t window_errors);
+static bool i2c_driver_apply_clock(i2c_driver_ctx_t* ctx, uint32_t clock_freq);
+static bool i2c_driver_bus_held(const i2c_driver_ctx_t* ctx);
+static bool i2c_driver_clear_bus(uint sda, uint scl);
+static bool i2c_driver_read_once(i2c_driver_ctx_t* ctx, uint8_t dev_addr,
+    uint8_t reg_addr, uint8_t* data, size_t len);
+static void i2c_driver_record(i2c_driver_ctx_t* ctx, uint8_t dev_addr, bool success,
+    uint32_t errors, uint32_t retries);
+static bool i2c_driver_write_once(i2c_driver_ctx_t* ctx, uint8_t dev_addr,
+    uint8_t reg_addr, const uint8_t* data, size_t len);
+
+/**
+ * @brief Raw spinlock helpers, the lock is optional
+ */
+static inline uint32_t i2c_driver_lock(i2c_driver_ctx_t* ctx) {
+    return (ctx->lock_initialized && ctx->i2c_spin_lock) ? spin_lock_blocking(ctx->i2c_spin_lock) : 0;
+}
+
+static inline void i2c_driver_unlock(i2c_driver_ctx_t* ctx, uint32_t save) {
+    if (ctx->lock_initialized && ctx->i2c_spin_lock) {
+        spin_unlock(ctx->i2c_spin_lock, save);
+    }
+}
+
 // DMA interrupt handler
 static void i2c_driver_dma_handler(void) {
     if (g_i2c_dma_ctx == NULL || g_i2c_dma_ctx->dma_complete_callback == NULL) {
@@ -64,7 +96,7 @@ static bool i2c_spinlock_callback(spinlock_init_phase_t phase, void* context) {
  * @brief Initialize I2C driver with thread safety (FIXED)
  */
 i2c_driver_ctx_t* i2c_driver_init(const i2c_driver_config_t* config) {
-    if (config == NULL || config->i2c_inst == NULL) {
+    if (config == NULL || (config->i2c_inst == NULL && config->pio == NULL)) {
         return NULL;
     }
     
@@ -76,23 +108,41 @@ i2c_driver_ctx_t* i2c_driver_init(const i2c_driver_config_t* config) {
     
     // Initialize context
     memset(ctx, 0, sizeof(struct i2c_driver_ctx_t));
+    ctx->backend = (config->pio != NULL) ? I2C_DRIVER_BACKEND_PIO : I2C_DRIVER_BACKEND_HW;
     ctx->i2c_inst = config->i2c_inst;
     ctx->sda_pin = config->sda_pin;
     ctx->scl_pin = config->scl_pin;
     ctx->clock_freq = config->clock_freq > 0 ? config->clock_freq : 100000;
+    ctx->max_clock_freq = ctx->clock_freq;
+    ctx->max_retries = config->max_retries;
+    ctx->auto_clock_fallback = config->auto_clock_fallback;
     ctx->use_dma = config->use_dma;
     ctx->name = config->name ? strdup(config->name) : NULL;
     
-    // Initialize hardware
-    i2c_init(ctx->i2c_inst, ctx->clock_freq);
-    
-    // Configure pins
-    gpio_set_function(ctx->sda_pin, GPIO_FUNC_I2C);
-    gpio_set_function(ctx->scl_pin, GPIO_FUNC_I2C);
-    
-    // Enable pull-ups
-    gpio_pull_up(ctx->sda_pin);
-    gpio_pull_up(ctx->scl_pin);
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        // PIO buses are always fed by DMA
+        ctx->i2c_inst = NULL;
+        ctx->use_dma = true;
+        
+        if (!i2c_pio_init(ctx, config)) {
+            log_message(LOG_LEVEL_ERROR, "I2C Driver", "Failed to start PIO bus on pins SDA:%u SCL:%u.",
+                ctx->sda_pin, ctx->scl_pin);
+            free(ctx->name);
+            free(ctx);
+            return NULL;
+        }
+    } else {
+        // Initialize hardware
+        i2c_init(ctx->i2c_inst, ctx->clock_freq);
+        
+        // Configure pins
+        gpio_set_function(ctx->sda_pin, GPIO_FUNC_I2C);
+        gpio_set_function(ctx->scl_pin, GPIO_FUNC_I2C);
+        
+        // Enable pull-ups
+        gpio_pull_up(ctx->sda_pin);
+        gpio_pull_up(ctx->scl_pin);
+    }
     
     // Create a spinlock - bootstrap it
     ctx->i2c_lock_num = hw_spinlock_bootstrap_claim(true);
@@ -115,8 +165,13 @@ i2c_driver_ctx_t* i2c_driver_init(const i2c_driver_config_t* config) {
             i2c_spinlock_callback, ctx);
     }
     
-    log_message(LOG_LEVEL_INFO, "I2C Driver", "I2C Driver initialized on pins SDA:%u SCL:%u at %luHz\n", 
-        ctx->sda_pin, ctx->scl_pin, ctx->clock_freq);
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        log_message(LOG_LEVEL_INFO, "I2C Driver", "I2C Driver initialized on PIO%u SM%u, pins SDA:%u SCL:%u at %luHz", 
+            pio_get_index(ctx->pio), ctx->pio_sm, ctx->sda_pin, ctx->scl_pin, ctx->clock_freq);
+    } else {
+        log_message(LOG_LEVEL_INFO, "I2C Driver", "I2C Driver initialized on pins SDA:%u SCL:%u at %luHz\n", 
+            ctx->sda_pin, ctx->scl_pin, ctx->clock_freq);
+    }
     
     return ctx;
 }
@@ -135,10 +190,75 @@ void i2c_driver_get_default_config(i2c_driver_config_t* config) {
     config->use_dma = false;
     config->dma_tx_channel = -1;
     config->dma_rx_channel = -1;
+    config->pio = NULL;
+    config->pio_sm = -1;
+    config->max_retries = I2C_DRIVER_DEFAULT_RETRIES;
+    config->auto_clock_fallback = false;
+}
+
+bool i2c_driver_get_stats(i2c_driver_ctx_t* ctx, i2c_driver_stats_t* stats) {
+    if (ctx == NULL || !ctx->initialized || stats == NULL) {
+        return false;
+    }
+    
+    uint32_t save = i2c_driver_lock(ctx);
+    
+    *stats = ctx->stats;
+    stats->clock_freq = ctx->clock_freq;
+    stats->max_clock_freq = ctx->max_clock_freq;
+    
+    i2c_driver_unlock(ctx, save);
+    
+    return true;
+}
+
+bool i2c_driver_is_busy(const i2c_driver_ctx_t* ctx) {
+    if (ctx == NULL || !ctx->initialized) {
+        return false;
+    }
+    
+    return ctx->backend == I2C_DRIVER_BACKEND_PIO && ctx->xfer_busy;
+}
+
+bool i2c_driver_wait(i2c_driver_ctx_t* ctx, uint32_t timeout_us) {
+    if (ctx == NULL || !ctx->initialized) {
+        return false;
+    }
+    
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        return i2c_pio_wait(ctx, timeout_us);
+    }
+    
+    return true;
+}
+
+bool i2c_driver_wait_all(i2c_driver_ctx_t* const* ctxs, size_t count, uint32_t timeout_us) {
+    if (ctxs == NULL) {
+        return false;
+    }
+    
+    uint64_t deadline = time_us_64() + timeout_us;
+    bool success = true;
+    
+    // Every bus gets the remaining time, buses that already finished return at once
+    for (size_t i = 0; i < count; i++) {
+        if (ctxs[i] == NULL) {
+            continue;
+        }
+        
+        uint64_t now = time_us_64();
+        uint32_t remaining = (now < deadline) ? (uint32_t)(deadline - now) : 0;
+        
+        if (!i2c_driver_wait(ctxs[i], remaining)) {
+            success = false;
+        }
+    }
+    
+    return success;
 }
 
 /**
- * @brief Thread-safe I2C read operation (FIXED)
+ * @brief Thread-safe I2C read operation with retries and bus recovery
  */
 bool i2c_driver_read_bytes(i2c_driver_ctx_t* ctx, uint8_t dev_addr, 
     uint8_t reg_addr, uint8_t* data, size_t len) {
@@ -146,33 +266,132 @@ bool i2c_driver_read_bytes(i2c_driver_ctx_t* ctx, uint8_t dev_addr,
         return false;
     }
 
-    uint32_t save = 0;
-    
-    // Acquire lock if available - use raw SDK spinlock functions
-    if (ctx->lock_initialized && ctx->i2c_spin_lock) {
-        save = spin_lock_blocking(ctx->i2c_spin_lock);
+    uint32_t errors = 0;
+    bool success = i2c_driver_read_once(ctx, dev_addr, reg_addr, data, len);
+
+    while (!success) {
+        errors++;
+
+        // A device left driving a line blocks every later transfer, free it first
+        if (i2c_driver_bus_held(ctx)) {
+            i2c_driver_recover_bus(ctx);
+        }
+
+        if (errors > ctx->max_retries) {
+            break;
+        }
+
+        success = i2c_driver_read_once(ctx, dev_addr, reg_addr, data, len);
     }
 
-    // Set up I2C transfer for register address
-    int result = i2c_write_blocking(ctx->i2c_inst, dev_addr, &reg_addr, 1, true);
-    bool success = false;
+    i2c_driver_record(ctx, dev_addr, success, errors, success ? errors : errors - 1);
 
-    if (result == 1) {
-        // Read data from the register
-        result = i2c_read_blocking(ctx->i2c_inst, dev_addr, data, len, false);
-        success = (result == (int)len);
+    return success;
+}
+
+bool i2c_driver_recover_bus(i2c_driver_ctx_t* ctx) {
+    if (ctx == NULL || !ctx->initialized) {
+        return false;
     }
 
-    // Release lock if it was acquired
-    if (ctx->lock_initialized && ctx->i2c_spin_lock) {
-        spin_unlock(ctx->i2c_spin_lock, save);
+    // Claim the bus under the lock, but bit-bang without it: a device
+    // stretching SCL would otherwise keep interrupts off for milliseconds
+    uint32_t save = i2c_driver_lock(ctx);
+    bool claimed = !ctx->recovering;
+    ctx->recovering = true;
+    i2c_driver_unlock(ctx, save);
+
+    if (!claimed) {
+        return false;
     }
 
-    return success;
+    // Take the pins from the controller and drive them from SIO
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        i2c_pio_suspend(ctx);
+    }
+
+    gpio_init(ctx->sda_pin);
+    gpio_init(ctx->scl_pin);
+    gpio_pull_up(ctx->sda_pin);
+    gpio_pull_up(ctx->scl_pin);
+
+    bool freed = i2c_driver_clear_bus(ctx->sda_pin, ctx->scl_pin);
+
+    // Re-initializing the controller also drops any half finished transfer
+    if (ctx->backend == I2C_DRIVER_BACKEND_HW) {
+        i2c_init(ctx->i2c_inst, ctx->clock_freq);
+        gpio_set_function(ctx->sda_pin, GPIO_FUNC_I2C);
+        gpio_set_function(ctx->scl_pin, GPIO_FUNC_I2C);
+    }
+
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        i2c_pio_resume(ctx);
+    }
+
+    save = i2c_driver_lock(ctx);
+
+    if (freed) {
+        ctx->stats.recoveries++;
+    } else {
+        ctx->stats.recovery_failures++;
+    }
+    ctx->recovering = false;
+
+    i2c_driver_unlock(ctx, save);
+
+    if (freed) {
+        log_message(LOG_LEVEL_WARN, "I2C Driver", "Bus on SDA:%u SCL:%u recovered.", ctx->sda_pin, ctx->scl_pin);
+    } else {
+        log_message(LOG_LEVEL_ERROR, "I2C Driver", "Bus on SDA:%u SCL:%u still held low after recovery.",
+            ctx->sda_pin, ctx->scl_pin);
+    }
+
+    return freed;
+}
+
+void i2c_driver_reset_stats(i2c_driver_ctx_t* ctx) {
+    if (ctx == NULL || !ctx->initialized) {
+        return;
+    }
+
+    uint32_t save = i2c_driver_lock(ctx);
+
+    memset(&ctx->stats, 0, sizeof(i2c_driver_stats_t));
+    ctx->window_transfers = 0;
+    ctx->window_errors = 0;
+    ctx->clean_windows = 0;
+
+    i2c_driver_unlock(ctx, save);
+}
+
+bool i2c_driver_set_clock(i2c_driver_ctx_t* ctx, uint32_t clock_freq) {
+    if (ctx == NULL || !ctx->initialized || clock_freq == 0) {
+        return false;
+    }
+
+    if (!i2c_driver_apply_clock(ctx, clock_freq)) {
+        return false;
+    }
+
+    ctx->max_clock_freq = clock_freq;
+    ctx->clean_windows = 0;
+
+    log_message(LOG_LEVEL_INFO, "I2C Driver", "Bus on SDA:%u SCL:%u set to %lu Hz.",
+        ctx->sda_pin, ctx->scl_pin, clock_freq);
+
+    return true;
+}
+
+uint32_t i2c_driver_transfer_timeout_us(const i2c_driver_ctx_t* ctx, size_t len) {
+    uint32_t freq = (ctx != NULL && ctx->clock_freq > 0) ? ctx->clock_freq : 100000;
+
+    // Nine bit periods per byte, doubled for clock stretching, plus scheduling slack
+    uint64_t bits = (uint64_t)(len + I2C_DRIVER_PIO_CMD_OVERHEAD) * 9u;
+    return (uint32_t)((bits * 2000000u) / freq) + 1000u;
 }
 
 /**
- * @brief Thread-safe I2C write operation (FIXED)
+ * @brief Thread-safe I2C write operation with retries and bus recovery
  */
 bool i2c_driver_write_bytes(i2c_driver_ctx_t* ctx, uint8_t dev_addr,
     uint8_t reg_addr, const uint8_t* data, size_t len) {
@@ -180,32 +399,24 @@ bool i2c_driver_write_bytes(i2c_driver_ctx_t* ctx, uint8_t dev_addr,
         return false;
     }
 
-    uint32_t save = 0;
-    
-    // Acquire lock if available - use raw SDK spinlock functions
-    if (ctx->lock_initialized && ctx->i2c_spin_lock) {
-        save = spin_lock_blocking(ctx->i2c_spin_lock);
-    }
+    uint32_t errors = 0;
+    bool success = i2c_driver_write_once(ctx, dev_addr, reg_addr, data, len);
 
-    // Prepare buffer: [register address, data...]
-    uint8_t* buffer = (uint8_t*)malloc(len + 1);
-    bool success = false;
+    while (!success) {
+        errors++;
 
-    if (buffer != NULL) {
-        buffer[0] = reg_addr;
-        memcpy(buffer + 1, data, len);
+        if (i2c_driver_bus_held(ctx)) {
+            i2c_driver_recover_bus(ctx);
+        }
 
-        // Write to device
-        int result = i2c_write_blocking(ctx->i2c_inst, dev_addr, buffer, len + 1, false);
-        success = (result == (int)(len + 1));
+        if (errors > ctx->max_retries) {
+            break;
+        }
 
-        free(buffer);
+        success = i2c_driver_write_once(ctx, dev_addr, reg_addr, data, len);
     }
 
-    // Release lock if it was acquired
-    if (ctx->lock_initialized && ctx->i2c_spin_lock) {
-        spin_unlock(ctx->i2c_spin_lock, save);
-    }
+    i2c_driver_record(ctx, dev_addr, success, errors, success ? errors : errors - 1);
 
     return success;
 }
@@ -217,6 +428,14 @@ bool i2c_driver_read_bytes_dma(i2c_driver_ctx_t* ctx, uint8_t dev_addr,
         return false;
     }
     
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        return i2c_pio_read(ctx, dev_addr, true, reg_addr, data, len, callback, user_data);
+    }
+    
+    if (ctx->recovering) {
+        return false;
+    }
+    
     ctx->dma_complete_callback = callback;
     ctx->dma_user_data = user_data;
     
@@ -247,6 +466,14 @@ bool i2c_driver_write_bytes_dma(i2c_driver_ctx_t* ctx, uint8_t dev_addr,
         return false;
     }
     
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        return i2c_pio_write(ctx, dev_addr, reg_addr, data, len, callback, user_data);
+    }
+    
+    if (ctx->recovering) {
+        return false;
+    }
+    
     ctx->dma_complete_callback = callback;
     ctx->dma_user_data = user_data;
     
@@ -295,7 +522,9 @@ bool i2c_driver_deinit(i2c_driver_ctx_t* ctx) {
         return false;
     }
     
-    if (ctx->use_dma) {
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        i2c_pio_deinit(ctx);
+    } else if (ctx->use_dma) {
         dma_channel_set_irq0_enabled(ctx->dma_rx_channel, false);
         dma_channel_set_irq0_enabled(ctx->dma_tx_channel, false);
         
@@ -324,6 +553,19 @@ bool i2c_driver_probe_with_read(i2c_driver_ctx_t* ctx, uint8_t addr, bool debug)
         return false;
     }
 
+    uint8_t dummy_data;
+
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        bool acked = i2c_pio_read(ctx, addr, false, 0, &dummy_data, 1, NULL, NULL) &&
+            i2c_pio_wait(ctx, 2000);
+        
+        if (debug) {
+            log_message(LOG_LEVEL_INFO, "I2C Driver", "Addr 0x%02X. (pio read) -> %s.", addr, acked ? "ACK" : "NACK");
+        }
+        
+        return acked;
+    }
+
     uint32_t save = 0;
     
     if (ctx->lock_initialized && ctx->i2c_spin_lock) {
@@ -331,7 +573,6 @@ bool i2c_driver_probe_with_read(i2c_driver_ctx_t* ctx, uint8_t addr, bool debug)
     }
 
     bool success = false;
-    uint8_t dummy_data;
     
     // Try to read 1 byte - this is often more reliable than write-only probe
     int result = i2c_read_timeout_us(ctx->i2c_inst, addr, &dummy_data, 1, false, 2000); // 2ms timeout
@@ -392,4 +633,294 @@ int i2c_scan(i2c_driver_ctx_t* ctx) {
     log_message(LOG_LEVEL_ERROR, "I2C Driver", "Devices found: %d devices.", res_found);
     
     return res_found;
-}
\ No newline at end of file
+}
+/**
+ * @brief Step the clock after a fallback window
+ * 
+ * @param ctx Pointer to driver context
+ * @param window_errors Failed attempts in the window that just ended
+ */
+static void i2c_driver_adapt_clock(i2c_driver_ctx_t* ctx, uint16_t window_errors) {
+    if (window_errors >= I2C_DRIVER_FALLBACK_ERRORS) {
+        ctx->clean_windows = 0;
+        
+        // Next step below the current clock
+        for (size_t i = 0; i < count_of(g_i2c_clock_steps); i++) {
+            uint32_t lower = g_i2c_clock_steps[i];
+            if (lower < ctx->clock_freq) {
+                if (i2c_driver_apply_clock(ctx, lower)) {
+                    ctx->stats.clock_fallbacks++;
+                    log_message(LOG_LEVEL_WARN, "I2C Driver", "%u errors in %u transfers, SDA:%u SCL:%u lowered to %lu Hz.",
+                        window_errors, I2C_DRIVER_FALLBACK_WINDOW, ctx->sda_pin, ctx->scl_pin, lower);
+                }
+                break;
+            }
+        }
+    } else if (window_errors == 0 && ctx->clock_freq < ctx->max_clock_freq) {
+        if (++ctx->clean_windows < I2C_DRIVER_RESTORE_WINDOWS) {
+            return;
+        }
+        
+        ctx->clean_windows = 0;
+        
+        // Next step above the current clock, capped at the configured clock
+        uint32_t higher = ctx->max_clock_freq;
+        for (size_t i = 0; i < count_of(g_i2c_clock_steps); i++) {
+            uint32_t step = g_i2c_clock_steps[i];
+            if (step > ctx->clock_freq && step < higher) {
+                higher = step;
+            }
+        }
+        
+        if (i2c_driver_apply_clock(ctx, higher)) {
+            ctx->stats.clock_restores++;
+            log_message(LOG_LEVEL_INFO, "I2C Driver", "SDA:%u SCL:%u error free, raised to %lu Hz.",
+                ctx->sda_pin, ctx->scl_pin, higher);
+        }
+    } else {
+        ctx->clean_windows = 0;
+    }
+}
+
+/**
+ * @brief Change the bus clock between transfers
+ * 
+ * @param ctx Pointer to driver context
+ * @param clock_freq Clock frequency in Hz
+ * @return true if applied, false if a transfer is in flight
+ */
+static bool i2c_driver_apply_clock(i2c_driver_ctx_t* ctx, uint32_t clock_freq) {
+    uint32_t save = i2c_driver_lock(ctx);
+    
+    bool idle = !i2c_driver_is_busy(ctx) && !ctx->recovering;
+    if (idle) {
+        ctx->clock_freq = clock_freq;
+        
+        if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+            i2c_pio_set_clock(ctx);
+        } else {
+            i2c_set_baudrate(ctx->i2c_inst, clock_freq);
+        }
+    }
+    
+    i2c_driver_unlock(ctx, save);
+    
+    return idle;
+}
+
+/**
+ * @brief Check whether a device is holding SDA or SCL low on an idle bus
+ * 
+ * @param ctx Pointer to driver context
+ * @return true if either line reads low
+ */
+static bool i2c_driver_bus_held(const i2c_driver_ctx_t* ctx) {
+    return !gpio_get(ctx->sda_pin) || !gpio_get(ctx->scl_pin);
+}
+
+/**
+ * @brief Release a line, letting the pull-up take it high
+ */
+static inline void i2c_driver_line_release(uint pin) {
+    gpio_set_dir(pin, GPIO_IN);
+}
+
+/**
+ * @brief Drive a line low, the output value is left at 0 by gpio_init()
+ */
+static inline void i2c_driver_line_low(uint pin) {
+    gpio_put(pin, 0);
+    gpio_set_dir(pin, GPIO_OUT);
+}
+
+/**
+ * @brief Release SCL and wait for a stretching device to let it rise
+ */
+static inline void i2c_driver_scl_release(uint scl) {
+    i2c_driver_line_release(scl);
+    
+    uint32_t start = time_us_32();
+    while (!gpio_get(scl) && (time_us_32() - start) < I2C_RECOVERY_STRETCH_TIMEOUT_US) {
+        tight_loop_contents();
+    }
+}
+
+/**
+ * @brief Clock a stuck device off the bus and generate a STOP
+ * 
+ * A device reset mid-read can be left driving SDA low while it waits for
+ * the rest of a byte. Up to nine SCL pulses let it finish the byte and see
+ * a NAK, after which a STOP returns every device to idle.
+ * 
+ * @param sda SDA pin, configured for SIO
+ * @param scl SCL pin, configured for SIO
+ * @return true if both lines are high afterwards
+ */
+static bool i2c_driver_clear_bus(uint sda, uint scl) {
+    i2c_driver_line_release(sda);
+    i2c_driver_scl_release(scl);
+    busy_wait_us_32(I2C_RECOVERY_HALF_PERIOD_US);
+    
+    for (int i = 0; i < 9 && !gpio_get(sda); i++) {
+        i2c_driver_line_low(scl);
+        busy_wait_us_32(I2C_RECOVERY_HALF_PERIOD_US);
+        i2c_driver_scl_release(scl);
+        busy_wait_us_32(I2C_RECOVERY_HALF_PERIOD_US);
+    }
+    
+    // STOP: SDA rises while SCL is high
+    i2c_driver_line_low(scl);
+    busy_wait_us_32(I2C_RECOVERY_HALF_PERIOD_US);
+    i2c_driver_line_low(sda);
+    busy_wait_us_32(I2C_RECOVERY_HALF_PERIOD_US);
+    i2c_driver_scl_release(scl);
+    busy_wait_us_32(I2C_RECOVERY_HALF_PERIOD_US);
+    i2c_driver_line_release(sda);
+    busy_wait_us_32(I2C_RECOVERY_HALF_PERIOD_US);
+    
+    return gpio_get(sda) && gpio_get(scl);
+}
+
+/**
+ * @brief Single register read attempt
+ * 
+ * @param ctx Pointer to driver context
+ * @param dev_addr I2C device address
+ * @param reg_addr Register address to read from
+ * @param data Buffer to store read data
+ * @param len Number of bytes to read
+ * @return true if every byte was acknowledged in time
+ */
+static bool i2c_driver_read_once(i2c_driver_ctx_t* ctx, uint8_t dev_addr,
+    uint8_t reg_addr, uint8_t* data, size_t len) {
+    uint32_t timeout_us = i2c_driver_transfer_timeout_us(ctx, len);
+
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        return i2c_pio_read(ctx, dev_addr, true, reg_addr, data, len, NULL, NULL) &&
+            i2c_pio_wait(ctx, timeout_us);
+    }
+
+    uint32_t save = i2c_driver_lock(ctx);
+
+    if (ctx->recovering) {
+        i2c_driver_unlock(ctx, save);
+        return false;
+    }
+
+    // Timeouts keep a device stretching SCL forever from hanging the caller
+    int result = i2c_write_timeout_us(ctx->i2c_inst, dev_addr, &reg_addr, 1, true, timeout_us);
+    bool success = false;
+
+    if (result == 1) {
+        result = i2c_read_timeout_us(ctx->i2c_inst, dev_addr, data, len, false, timeout_us);
+        success = (result == (int)len);
+    }
+
+    i2c_driver_unlock(ctx, save);
+
+    return success;
+}
+
+/**
+ * @brief Update the bus and device counters after a blocking transfer
+ * 
+ * @param ctx Pointer to driver context
+ * @param dev_addr I2C device address
+ * @param success Whether the transfer succeeded in the end
+ * @param errors Failed attempts
+ * @param retries Attempts after the first
+ */
+static void i2c_driver_record(i2c_driver_ctx_t* ctx, uint8_t dev_addr, bool success,
+    uint32_t errors, uint32_t retries) {
+    uint32_t save = i2c_driver_lock(ctx);
+    
+    i2c_driver_stats_t* stats = &ctx->stats;
+    stats->transfers++;
+    stats->errors += errors;
+    stats->retries += retries;
+    stats->failures += success ? 0 : 1;
+    
+    i2c_driver_device_stats_t* device = NULL;
+    for (uint8_t i = 0; i < stats->device_count; i++) {
+        if (stats->devices[i].addr == dev_addr) {
+            device = &stats->devices[i];
+            break;
+        }
+    }
+    
+    if (device == NULL && stats->device_count < I2C_DRIVER_MAX_TRACKED_DEVICES) {
+        device = &stats->devices[stats->device_count++];
+        memset(device, 0, sizeof(i2c_driver_device_stats_t));
+        device->addr = dev_addr;
+    }
+    
+    if (device != NULL) {
+        device->transfers++;
+        device->errors += errors;
+        device->retries += retries;
+        device->failures += success ? 0 : 1;
+    }
+    
+    // Close the fallback window under the lock, adapt outside it
+    ctx->window_transfers++;
+    ctx->window_errors = (uint16_t)(ctx->window_errors + errors);
+    
+    bool window_done = ctx->window_transfers >= I2C_DRIVER_FALLBACK_WINDOW;
+    uint16_t window_errors = ctx->window_errors;
+    
+    if (window_done) {
+        ctx->window_transfers = 0;
+        ctx->window_errors = 0;
+    }
+    
+    i2c_driver_unlock(ctx, save);
+    
+    if (!success) {
+        LOG_KV_RATELIMITED(1000, 5, LOG_LEVEL_WARN, "I2C Driver", "transfer_failed",
+            K_U32("sda", ctx->sda_pin), K_U32("addr", dev_addr), K_U32("attempts", errors));
+    }
+    
+    if (window_done && ctx->auto_clock_fallback) {
+        i2c_driver_adapt_clock(ctx, window_errors);
+    }
+}
+
+/**
+ * @brief Single register write attempt
+ * 
+ * @param ctx Pointer to driver context
+ * @param dev_addr I2C device address
+ * @param reg_addr Register address to write to
+ * @param data Data to write
+ * @param len Number of bytes to write
+ * @return true if every byte was acknowledged in time
+ */
+static bool i2c_driver_write_once(i2c_driver_ctx_t* ctx, uint8_t dev_addr,
+    uint8_t reg_addr, const uint8_t* data, size_t len) {
+    uint32_t timeout_us = i2c_driver_transfer_timeout_us(ctx, len);
+
+    if (ctx->backend == I2C_DRIVER_BACKEND_PIO) {
+        return i2c_pio_write(ctx, dev_addr, reg_addr, data, len, NULL, NULL) &&
+            i2c_pio_wait(ctx, timeout_us);
+    }
+
+    uint32_t save = i2c_driver_lock(ctx);
+
+    // Prepare buffer: [register address, data...]
+    uint8_t* buffer = ctx->recovering ? NULL : (uint8_t*)malloc(len + 1);
+    bool success = false;
+
+    if (buffer != NULL) {
+        buffer[0] = reg_addr;
+        memcpy(buffer + 1, data, len);
+
+        int result = i2c_write_timeout_us(ctx->i2c_inst, dev_addr, buffer, len + 1, false, timeout_us);
+        success = (result == (int)(len + 1));
+
+        free(buffer);
+    }
+
+    i2c_driver_unlock(ctx, save);
+
+    return success;
+}
@@ -0,0 +1,622 @@
+/**
+* @file i2c_pio.c
+* @brief PIO I2C master backend implementation
+* @date 2025-05-26
+*/
+
+#include "i2c_pio.h"
+#include "i2c_pio.pio.h"
+
+#include "log_manager.h"
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+
+#include <string.h>
+
+// Contexts with a PIO bus, searched by the shared interrupt handlers
+static i2c_driver_ctx_t* volatile g_i2c_pio_ctx[I2C_DRIVER_MAX_PIO_BUSES];
+
+// The program is loaded once per PIO block and shared by its state machines
+static uint8_t g_i2c_pio_offset[NUM_PIOS];
+static uint8_t g_i2c_pio_users[NUM_PIOS];
+static bool g_i2c_pio_irq_installed[NUM_PIOS];
+static bool g_i2c_pio_dma_irq_installed = false;
+
+// Write transfers drain their RX FIFO entries here
+static uint8_t g_i2c_pio_rx_discard;
+
+static bool i2c_pio_claim(i2c_driver_ctx_t* ctx, void (*callback)(void* user_data), void* user_data);
+static float i2c_pio_clkdiv(const i2c_driver_ctx_t* ctx);
+static void i2c_pio_configure_sm(i2c_driver_ctx_t* ctx);
+static void i2c_pio_dma_handler(void);
+static void i2c_pio_finish(i2c_driver_ctx_t* ctx, bool success);
+static void i2c_pio_irq_handler(void);
+static size_t i2c_pio_put_repstart(uint16_t* cmd, size_t n);
+static size_t i2c_pio_put_start(uint16_t* cmd, size_t n);
+static size_t i2c_pio_put_stop(uint16_t* cmd, size_t n);
+static void i2c_pio_recover(i2c_driver_ctx_t* ctx);
+static void i2c_pio_start_dma(i2c_driver_ctx_t* ctx, size_t cmd_words, volatile void* rx_dst,
+    bool rx_increment, size_t rx_count);
+
+/**
+ * @brief Encode an address byte, releasing SDA for the target's ACK
+ */
+static inline uint16_t i2c_pio_addr_word(uint8_t dev_addr, bool read) {
+    uint16_t byte = (uint16_t) (((uint16_t) dev_addr << 1) | (read ? 1u : 0u));
+    return (uint16_t) ((byte << I2C_PIO_DATA_LSB) | (1u << I2C_PIO_NAK_LSB));
+}
+
+/**
+ * @brief Write one command word so it reaches the OSR in full
+ */
+static inline void i2c_pio_put16(PIO pio, uint sm, uint16_t word) {
+    *(io_rw_16*) &pio->txf[sm] = word;
+}
+
+void i2c_pio_deinit(i2c_driver_ctx_t* ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+
+    if (ctx->xfer_busy) {
+        i2c_pio_finish(ctx, false);
+    }
+
+    uint index = pio_get_index(ctx->pio);
+
+    pio_sm_set_enabled(ctx->pio, ctx->pio_sm, false);
+    pio_set_irq0_source_enabled(ctx->pio, (pio_interrupt_source_t) (pis_interrupt0 + ctx->pio_sm), false);
+    pio_sm_unclaim(ctx->pio, ctx->pio_sm);
+
+    dma_channel_set_irq0_enabled(ctx->dma_rx_channel, false);
+    dma_channel_abort(ctx->dma_tx_channel);
+    dma_channel_abort(ctx->dma_rx_channel);
+    dma_channel_unclaim(ctx->dma_tx_channel);
+    dma_channel_unclaim(ctx->dma_rx_channel);
+
+    for (int i = 0; i < I2C_DRIVER_MAX_PIO_BUSES; i++) {
+        if (g_i2c_pio_ctx[i] == ctx) {
+            g_i2c_pio_ctx[i] = NULL;
+        }
+    }
+
+    if (g_i2c_pio_users[index] > 0 && --g_i2c_pio_users[index] == 0) {
+        pio_remove_program(ctx->pio, &i2c_pio_program, g_i2c_pio_offset[index]);
+    }
+}
+
+bool i2c_pio_init(i2c_driver_ctx_t* ctx, const i2c_driver_config_t* config) {
+    if (ctx == NULL || config == NULL || config->pio == NULL) {
+        return false;
+    }
+
+    // WAIT on SCL is relative to the SDA input pin
+    if (config->scl_pin != config->sda_pin + 1) {
+        log_message(LOG_LEVEL_ERROR, "I2C PIO", "SCL must be the pin after SDA (SDA:%u SCL:%u).",
+            config->sda_pin, config->scl_pin);
+        return false;
+    }
+
+    // Buses are created during startup, so the tables are not locked
+    int slot = -1;
+    for (int i = 0; i < I2C_DRIVER_MAX_PIO_BUSES; i++) {
+        if (g_i2c_pio_ctx[i] == NULL) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot < 0) {
+        log_message(LOG_LEVEL_ERROR, "I2C PIO", "No free PIO bus slot.");
+        return false;
+    }
+
+    PIO pio = config->pio;
+    uint index = pio_get_index(pio);
+
+    int sm = config->pio_sm;
+    if (sm < 0) {
+        sm = pio_claim_unused_sm(pio, false);
+    } else if (pio_sm_is_claimed(pio, (uint) sm)) {
+        sm = -1;
+    } else {
+        pio_sm_claim(pio, (uint) sm);
+    }
+
+    if (sm < 0) {
+        log_message(LOG_LEVEL_ERROR, "I2C PIO", "No free state machine on PIO%u.", index);
+        return false;
+    }
+
+    if (g_i2c_pio_users[index] == 0) {
+        if (!pio_can_add_program(pio, &i2c_pio_program)) {
+            log_message(LOG_LEVEL_ERROR, "I2C PIO", "No instruction memory left on PIO%u.", index);
+            pio_sm_unclaim(pio, (uint) sm);
+            return false;
+        }
+
+        g_i2c_pio_offset[index] = (uint8_t) (pio_add_program(pio, &i2c_pio_program) & 0xFF);
+    }
+
+    int tx_channel = config->dma_tx_channel;
+    if (tx_channel < 0) {
+        tx_channel = dma_claim_unused_channel(false);
+    } else {
+        dma_channel_claim((uint) tx_channel);
+    }
+
+    int rx_channel = config->dma_rx_channel;
+    if (rx_channel < 0) {
+        rx_channel = dma_claim_unused_channel(false);
+    } else {
+        dma_channel_claim((uint) rx_channel);
+    }
+
+    if (tx_channel < 0 || rx_channel < 0) {
+        log_message(LOG_LEVEL_ERROR, "I2C PIO", "Failed to claim DMA channels.");
+
+        if (tx_channel >= 0) {
+            dma_channel_unclaim((uint) tx_channel);
+        }
+
+        if (rx_channel >= 0) {
+            dma_channel_unclaim((uint) rx_channel);
+        }
+
+        if (g_i2c_pio_users[index] == 0) {
+            pio_remove_program(pio, &i2c_pio_program, g_i2c_pio_offset[index]);
+        }
+
+        pio_sm_unclaim(pio, (uint) sm);
+        return false;
+    }
+
+    g_i2c_pio_users[index]++;
+
+    ctx->pio = pio;
+    ctx->pio_sm = (uint8_t) sm;
+    ctx->pio_offset = g_i2c_pio_offset[index];
+    ctx->dma_tx_channel = (unsigned int) tx_channel;
+    ctx->dma_rx_channel = (unsigned int) rx_channel;
+    ctx->xfer_busy = false;
+    ctx->xfer_ok = true;
+
+    i2c_pio_configure_sm(ctx);
+
+    g_i2c_pio_ctx[slot] = ctx;
+
+    // Completion comes from the RX channel, unexpected NAKs from the PIO block
+    if (!g_i2c_pio_dma_irq_installed) {
+        irq_add_shared_handler(DMA_IRQ_0, i2c_pio_dma_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0, true);
+        g_i2c_pio_dma_irq_installed = true;
+    }
+
+    if (!g_i2c_pio_irq_installed[index]) {
+        uint irq = pio_get_irq_num(pio, 0);
+        irq_add_shared_handler(irq, i2c_pio_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(irq, true);
+        g_i2c_pio_irq_installed[index] = true;
+    }
+
+    return true;
+}
+
+bool i2c_pio_read(i2c_driver_ctx_t* ctx, uint8_t dev_addr, bool has_reg, uint8_t reg_addr,
+    uint8_t* data, size_t len, void (*callback)(void* user_data), void* user_data) {
+    if (ctx == NULL || data == NULL || len == 0 || len > I2C_DRIVER_PIO_MAX_TRANSFER) {
+        return false;
+    }
+
+    if (!i2c_pio_claim(ctx, callback, user_data)) {
+        return false;
+    }
+
+    uint16_t* cmd = ctx->pio_cmd;
+    size_t n = i2c_pio_put_start(cmd, 0);
+
+    if (has_reg) {
+        cmd[n++] = i2c_pio_addr_word(dev_addr, false);
+        cmd[n++] = (uint16_t) (((uint16_t) reg_addr << I2C_PIO_DATA_LSB) | (1u << I2C_PIO_NAK_LSB));
+        n = i2c_pio_put_repstart(cmd, n);
+    }
+
+    cmd[n++] = i2c_pio_addr_word(dev_addr, true);
+
+    // Shift out ones so the target drives SDA, ACK every byte but the last
+    for (size_t i = 0; i < len; i++) {
+        uint16_t word = (uint16_t) (0xFFu << I2C_PIO_DATA_LSB);
+        if (i == len - 1) {
+            word |= (uint16_t) ((1u << I2C_PIO_FINAL_LSB) | (1u << I2C_PIO_NAK_LSB));
+        }
+        cmd[n++] = word;
+    }
+
+    n = i2c_pio_put_stop(cmd, n);
+
+    // Header bytes are clocked into the RX FIFO too and skipped on completion
+    ctx->xfer_rx_skip = has_reg ? 3 : 1;
+    ctx->xfer_rx_dst = data;
+    ctx->xfer_rx_len = len;
+
+    i2c_pio_start_dma(ctx, n, ctx->pio_rx, true, ctx->xfer_rx_skip + len);
+
+    return true;
+}
+
+void i2c_pio_resume(i2c_driver_ctx_t* ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+
+    i2c_pio_configure_sm(ctx);
+}
+
+void i2c_pio_set_clock(i2c_driver_ctx_t* ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+
+    pio_sm_set_clkdiv(ctx->pio, ctx->pio_sm, i2c_pio_clkdiv(ctx));
+}
+
+void i2c_pio_suspend(i2c_driver_ctx_t* ctx) {
+    if (ctx == NULL) {
+        return;
+    }
+
+    if (ctx->xfer_busy) {
+        i2c_pio_finish(ctx, false);
+    }
+
+    pio_sm_set_enabled(ctx->pio, ctx->pio_sm, false);
+
+    gpio_set_oeover(ctx->sda_pin, GPIO_OVERRIDE_NORMAL);
+    gpio_set_oeover(ctx->scl_pin, GPIO_OVERRIDE_NORMAL);
+}
+
+bool i2c_pio_wait(i2c_driver_ctx_t* ctx, uint32_t timeout_us) {
+    if (ctx == NULL) {
+        return false;
+    }
+
+    uint64_t deadline = time_us_64() + timeout_us;
+    uint32_t done_mask = 1u << ctx->dma_rx_channel;
+
+    // Interrupts may be masked on this core, so completion and NAKs are also polled
+    while (ctx->xfer_busy) {
+        if (pio_interrupt_get(ctx->pio, ctx->pio_sm)) {
+            i2c_pio_finish(ctx, false);
+            break;
+        }
+
+        if ((dma_hw->intr & done_mask) != 0) {
+            i2c_pio_finish(ctx, true);
+            break;
+        }
+
+        if (time_us_64() >= deadline) {
+            log_message(LOG_LEVEL_WARN, "I2C PIO", "Transfer timed out on PIO%u SM%u.",
+                pio_get_index(ctx->pio), ctx->pio_sm);
+            i2c_pio_finish(ctx, false);
+            break;
+        }
+
+        tight_loop_contents();
+    }
+
+    return ctx->xfer_ok;
+}
+
+bool i2c_pio_write(i2c_driver_ctx_t* ctx, uint8_t dev_addr, uint8_t reg_addr,
+    const uint8_t* data, size_t len, void (*callback)(void* user_data), void* user_data) {
+    if (ctx == NULL || data == NULL || len == 0 || len > I2C_DRIVER_PIO_MAX_TRANSFER) {
+        return false;
+    }
+
+    if (!i2c_pio_claim(ctx, callback, user_data)) {
+        return false;
+    }
+
+    uint16_t* cmd = ctx->pio_cmd;
+    size_t n = i2c_pio_put_start(cmd, 0);
+
+    cmd[n++] = i2c_pio_addr_word(dev_addr, false);
+    cmd[n++] = (uint16_t) (((uint16_t) reg_addr << I2C_PIO_DATA_LSB) | (1u << I2C_PIO_NAK_LSB));
+
+    // A NAK on the final byte is tolerated, as by the I2C controller
+    for (size_t i = 0; i < len; i++) {
+        uint16_t word = (uint16_t) (((uint16_t) data[i] << I2C_PIO_DATA_LSB) | (1u << I2C_PIO_NAK_LSB));
+        if (i == len - 1) {
+            word |= (uint16_t) (1u << I2C_PIO_FINAL_LSB);
+        }
+        cmd[n++] = word;
+    }
+
+    n = i2c_pio_put_stop(cmd, n);
+
+    ctx->xfer_rx_skip = 0;
+    ctx->xfer_rx_dst = NULL;
+    ctx->xfer_rx_len = 0;
+
+    i2c_pio_start_dma(ctx, n, &g_i2c_pio_rx_discard, false, len + 2);
+
+    return true;
+}
+
+/**
+ * @brief Reserve a bus for a new transfer
+ *
+ * @param ctx Pointer to driver context.
+ * @param callback Function to call on completion.
+ * @param user_data User data to pass to callback.
+ * @return true if reserved, false if a transfer is already in flight.
+ */
+static bool i2c_pio_claim(i2c_driver_ctx_t* ctx, void (*callback)(void* user_data), void* user_data) {
+    uint32_t save = 0;
+
+    if (ctx->lock_initialized && ctx->i2c_spin_lock) {
+        save = spin_lock_blocking(ctx->i2c_spin_lock);
+    }
+
+    // Bus recovery drives the pins from SIO until it hands them back
+    bool claimed = !ctx->xfer_busy && !ctx->recovering;
+    if (claimed) {
+        ctx->xfer_busy = true;
+        ctx->xfer_ok = false;
+        ctx->dma_complete_callback = callback;
+        ctx->dma_user_data = user_data;
+    }
+
+    if (ctx->lock_initialized && ctx->i2c_spin_lock) {
+        spin_unlock(ctx->i2c_spin_lock, save);
+    }
+
+    return claimed;
+}
+
+/**
+ * @brief State machine clock divider for ctx->clock_freq
+ *
+ * @param ctx Pointer to driver context.
+ * @return Clock divider.
+ */
+static float i2c_pio_clkdiv(const i2c_driver_ctx_t* ctx) {
+    return (float) clock_get_hz(clk_sys) / (float) (I2C_PIO_CYCLES_PER_BIT * ctx->clock_freq);
+}
+
+/**
+ * @brief Configure the pins and state machine of a bus and start it
+ *
+ * @param ctx Pointer to driver context.
+ */
+static void i2c_pio_configure_sm(i2c_driver_ctx_t* ctx) {
+    PIO pio = ctx->pio;
+    uint sm = ctx->pio_sm;
+    uint sda = ctx->sda_pin;
+    uint scl = ctx->scl_pin;
+
+    pio_sm_config config = i2c_pio_program_get_default_config(ctx->pio_offset);
+
+    sm_config_set_out_pins(&config, sda, 1);
+    sm_config_set_set_pins(&config, sda, 1);
+    sm_config_set_in_pins(&config, sda);
+    sm_config_set_sideset_pins(&config, scl);
+    sm_config_set_jmp_pin(&config, sda);
+
+    // Autopull 16 bit command words, autopush every received byte
+    sm_config_set_out_shift(&config, false, true, 16);
+    sm_config_set_in_shift(&config, false, true, 8);
+
+    sm_config_set_clkdiv(&config, i2c_pio_clkdiv(ctx));
+
+    // Drive low when the PIO asserts OE, otherwise the pull-ups release the line
+    uint32_t both_pins = (1u << sda) | (1u << scl);
+    gpio_pull_up(scl);
+    gpio_pull_up(sda);
+    pio_sm_set_pins_with_mask(pio, sm, both_pins, both_pins);
+    pio_sm_set_pindirs_with_mask(pio, sm, both_pins, both_pins);
+    pio_gpio_init(pio, sda);
+    gpio_set_oeover(sda, GPIO_OVERRIDE_INVERT);
+    pio_gpio_init(pio, scl);
+    gpio_set_oeover(scl, GPIO_OVERRIDE_INVERT);
+    pio_sm_set_pins_with_mask(pio, sm, 0, both_pins);
+
+    // The NAK flag of this state machine raises the block's IRQ 0
+    pio_interrupt_clear(pio, sm);
+    pio_set_irq0_source_enabled(pio, (pio_interrupt_source_t) (pis_interrupt0 + sm), true);
+
+    pio_sm_init(pio, sm, ctx->pio_offset + i2c_pio_offset_entry_point, &config);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+// DMA interrupt handler, shared with other DMA users on DMA_IRQ_0
+static void i2c_pio_dma_handler(void) {
+    for (int i = 0; i < I2C_DRIVER_MAX_PIO_BUSES; i++) {
+        i2c_driver_ctx_t* ctx = g_i2c_pio_ctx[i];
+        if (ctx == NULL || !ctx->xfer_busy) {
+            continue;
+        }
+
+        if ((dma_hw->ints0 & (1u << ctx->dma_rx_channel)) != 0) {
+            i2c_pio_finish(ctx, true);
+        }
+    }
+}
+
+/**
+ * @brief Complete the in-flight transfer and run its callback
+ *
+ * Safe to call from the interrupt handlers and a waiting thread at once,
+ * only the first call for a transfer has any effect.
+ *
+ * @param ctx Pointer to driver context.
+ * @param success Whether every byte was acknowledged.
+ */
+static void i2c_pio_finish(i2c_driver_ctx_t* ctx, bool success) {
+    uint32_t save = 0;
+
+    if (ctx->lock_initialized && ctx->i2c_spin_lock) {
+        save = spin_lock_blocking(ctx->i2c_spin_lock);
+    }
+
+    bool was_busy = ctx->xfer_busy;
+    uint32_t done_mask = 1u << ctx->dma_rx_channel;
+
+    if (was_busy) {
+        dma_channel_set_irq0_enabled(ctx->dma_rx_channel, false);
+
+        if (!success) {
+            dma_channel_abort(ctx->dma_tx_channel);
+            dma_channel_abort(ctx->dma_rx_channel);
+        } else if (ctx->xfer_rx_dst != NULL) {
+            memcpy(ctx->xfer_rx_dst, ctx->pio_rx + ctx->xfer_rx_skip, ctx->xfer_rx_len);
+        }
+
+        // Only clear our own flag, other handlers share this IRQ
+        dma_hw->ints0 = done_mask;
+    }
+
+    // Also clears a NAK flag raised after the transfer already finished
+    if (!success) {
+        i2c_pio_recover(ctx);
+    }
+
+    void (*callback)(void* user_data) = ctx->dma_complete_callback;
+    void* user_data = ctx->dma_user_data;
+
+    if (was_busy) {
+        ctx->xfer_ok = success;
+        __dmb();
+        ctx->xfer_busy = false;
+    }
+
+    if (ctx->lock_initialized && ctx->i2c_spin_lock) {
+        spin_unlock(ctx->i2c_spin_lock, save);
+    }
+
+    if (was_busy && callback != NULL) {
+        callback(user_data);
+    }
+}
+
+// PIO interrupt handler, raised when a state machine stalls on an unexpected NAK
+static void i2c_pio_irq_handler(void) {
+    for (int i = 0; i < I2C_DRIVER_MAX_PIO_BUSES; i++) {
+        i2c_driver_ctx_t* ctx = g_i2c_pio_ctx[i];
+        if (ctx != NULL && pio_interrupt_get(ctx->pio, ctx->pio_sm)) {
+            i2c_pio_finish(ctx, false);
+        }
+    }
+}
+
+/**
+ * @brief Append a repeated START condition
+ *
+ * @param cmd Command word buffer.
+ * @param n Words already in the buffer.
+ * @return Words in the buffer afterwards.
+ */
+static size_t i2c_pio_put_repstart(uint16_t* cmd, size_t n) {
+    cmd[n++] = (uint16_t) (3u << I2C_PIO_ICOUNT_LSB);
+    cmd[n++] = i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC0_SD1];
+    cmd[n++] = i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC1_SD1];
+    cmd[n++] = i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC1_SD0];
+    cmd[n++] = i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC0_SD0];
+    return n;
+}
+
+/**
+ * @brief Append a START condition, the bus is idle beforehand
+ *
+ * @param cmd Command word buffer.
+ * @param n Words already in the buffer.
+ * @return Words in the buffer afterwards.
+ */
+static size_t i2c_pio_put_start(uint16_t* cmd, size_t n) {
+    cmd[n++] = (uint16_t) (1u << I2C_PIO_ICOUNT_LSB);
+    cmd[n++] = i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC1_SD0];
+    cmd[n++] = i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC0_SD0];
+    return n;
+}
+
+/**
+ * @brief Append a STOP condition, leaving the bus idle
+ *
+ * @param cmd Command word buffer.
+ * @param n Words already in the buffer.
+ * @return Words in the buffer afterwards.
+ */
+static size_t i2c_pio_put_stop(uint16_t* cmd, size_t n) {
+    cmd[n++] = (uint16_t) (2u << I2C_PIO_ICOUNT_LSB);
+    cmd[n++] = i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC0_SD0];
+    cmd[n++] = i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC1_SD0];
+    cmd[n++] = i2c_pio_set_scl_sda_program_instructions[I2C_PIO_SC1_SD1];
+    return n;
+}
+
+/**
+ * @brief Return a stalled or aborted state machine to idle
+ *
+ * Drops the queued commands, jumps back to the entry point and issues a
+ * STOP so the next transfer starts from an idle bus.
+ *
+ * @param ctx Pointer to driver context.
+ */
+static void i2c_pio_recover(i2c_driver_ctx_t* ctx) {
+    PIO pio = ctx->pio;
+    uint sm = ctx->pio_sm;
+
+    pio_sm_drain_tx_fifo(pio, sm);
+    pio_sm_clear_fifos(pio, sm);
+
+    // Replaces a stalled IRQ wait, so the flag can be cleared afterwards
+    pio_sm_exec(pio, sm, pio_encode_jmp(ctx->pio_offset + i2c_pio_offset_entry_point));
+    pio_interrupt_clear(pio, sm);
+
+    uint16_t stop[4];
+    size_t n = i2c_pio_put_stop(stop, 0);
+    for (size_t i = 0; i < n; i++) {
+        i2c_pio_put16(pio, sm, stop[i]);
+    }
+}
+
+/**
+ * @brief Start the TX and RX channels of a transfer
+ *
+ * @param ctx Pointer to driver context.
+ * @param cmd_words Command words in ctx->pio_cmd.
+ * @param rx_dst Destination of the RX FIFO bytes.
+ * @param rx_increment Whether rx_dst is a buffer or a single discard byte.
+ * @param rx_count Number of RX FIFO bytes, one per byte on the bus.
+ */
+static void i2c_pio_start_dma(i2c_driver_ctx_t* ctx, size_t cmd_words, volatile void* rx_dst,
+    bool rx_increment, size_t rx_count) {
+    // Halfword writes are replicated across the FIFO register, as with i2c_pio_put16()
+    dma_channel_config tx_config = dma_channel_get_default_config(ctx->dma_tx_channel);
+    channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_16);
+    channel_config_set_read_increment(&tx_config, true);
+    channel_config_set_write_increment(&tx_config, false);
+    channel_config_set_dreq(&tx_config, pio_get_dreq(ctx->pio, ctx->pio_sm, true));
+    dma_channel_configure(ctx->dma_tx_channel, &tx_config, &ctx->pio->txf[ctx->pio_sm],
+        ctx->pio_cmd, (uint32_t) cmd_words, false);
+
+    // Autopush leaves each byte in the low bits of its FIFO entry
+    dma_channel_config rx_config = dma_channel_get_default_config(ctx->dma_rx_channel);
+    channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+    channel_config_set_read_increment(&rx_config, false);
+    channel_config_set_write_increment(&rx_config, rx_increment);
+    channel_config_set_dreq(&rx_config, pio_get_dreq(ctx->pio, ctx->pio_sm, false));
+    dma_channel_configure(ctx->dma_rx_channel, &rx_config, rx_dst,
+        &ctx->pio->rxf[ctx->pio_sm], (uint32_t) rx_count, false);
+
+    dma_hw->ints0 = 1u << ctx->dma_rx_channel;
+    dma_channel_set_irq0_enabled(ctx->dma_rx_channel, true);
+
+    dma_start_channel_mask((1u << ctx->dma_tx_channel) | (1u << ctx->dma_rx_channel));
+}
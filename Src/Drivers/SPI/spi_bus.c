@@ -0,0 +1,383 @@
+/**
+* @file spi_bus.c
+* @brief Shared SPI bus with per-device settings and prioritized transaction queueing
+* @date 2025-05-25
+*/
+
+#include "scheduler.h"
+#include "spi_bus.h"
+#include "spinlock_manager.h"
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+
+#include <limits.h>
+#include <string.h>
+#include <stdlib.h>
+
+/**
+ * @brief Queued transaction with its submission time
+ */
+typedef struct {
+    spi_bus_transaction_t txn;         // Transaction
+    uint64_t submit_time_us;           // Time the transaction was queued
+} spi_bus_entry_t;
+
+/**
+ * @brief Ring buffer for one priority lane
+ */
+typedef struct {
+    spi_bus_entry_t entries[SPI_BUS_QUEUE_DEPTH];
+    uint8_t head;                      // Next entry to dequeue
+    uint8_t count;                     // Number of queued entries
+} spi_bus_queue_t;
+
+/**
+ * @brief SPI device structure
+ */
+struct spi_device_s {
+    spi_bus_t bus;                     // Owning bus
+    spi_device_config_t config;        // Device settings
+    bool in_use;                       // Slot allocated
+};
+
+/**
+ * @brief SPI bus structure
+ */
+struct spi_bus_s {
+    spi_driver_ctx_t* driver;          // Underlying DMA driver, CS switched per device
+    uint32_t lock_num;                 // Spinlock for queues and state
+    struct spi_device_s devices[SPI_BUS_MAX_DEVICES];
+    spi_bus_queue_t queues[SPI_BUS_LANE_COUNT];
+    spi_device_t configured;           // Device whose settings the peripheral has
+    spi_bus_entry_t current;           // Transaction in flight
+    volatile bool active;              // Whether a transaction is in flight
+    spi_bus_stats_t stats;             // Statistics
+};
+
+static void spi_bus_apply_device(spi_bus_t bus, spi_device_t device);
+static void spi_bus_dma_complete(void* user_data);
+static bool spi_bus_same_settings(const spi_device_config_t* a, const spi_device_config_t* b);
+static bool spi_bus_start(spi_bus_t bus, const spi_bus_transaction_t* txn);
+static void spi_bus_start_next(spi_bus_t bus);
+
+spi_device_t spi_bus_add_device(spi_bus_t bus, const spi_device_config_t* config) {
+    if (bus == NULL || config == NULL || config->cs_pin == (uint)-1 ||
+        config->lane >= SPI_BUS_LANE_COUNT) {
+        return NULL;
+    }
+
+    // Transfers are 8-bit DMA and the PL022 only shifts MSB first
+    if (config->data_bits != 8 || config->order != SPI_MSB_FIRST) {
+        return NULL;
+    }
+
+    uint32_t save = hw_spinlock_acquire(bus->lock_num, scheduler_get_current_task());
+
+    spi_device_t device = NULL;
+    for (int i = 0; i < SPI_BUS_MAX_DEVICES; i++) {
+        if (!bus->devices[i].in_use) {
+            device = &bus->devices[i];
+            device->bus = bus;
+            device->config = *config;
+            device->in_use = true;
+            break;
+        }
+    }
+
+    hw_spinlock_release(bus->lock_num, save);
+
+    if (device != NULL) {
+        // Deassert CS before the device is ever addressed
+        gpio_init(config->cs_pin);
+        gpio_set_dir(config->cs_pin, GPIO_OUT);
+        gpio_put(config->cs_pin, config->cs_active_low);
+    }
+
+    return device;
+}
+
+spi_bus_t spi_bus_create(const spi_bus_config_t* config) {
+    if (config == NULL) {
+        return NULL;
+    }
+
+    spi_bus_t bus = (spi_bus_t)malloc(sizeof(struct spi_bus_s));
+    if (bus == NULL) {
+        return NULL;
+    }
+
+    memset(bus, 0, sizeof(struct spi_bus_s));
+
+    bus->lock_num = hw_spinlock_allocate(SPINLOCK_CAT_SPI, "spi_bus");
+    if (bus->lock_num == UINT_MAX) {
+        free(bus);
+        return NULL;
+    }
+
+    // The driver owns the pins and DMA channels, devices provide CS and format
+    spi_driver_config_t driver_config;
+    spi_driver_get_default_config(&driver_config);
+    driver_config.spi_inst = config->spi_inst;
+    driver_config.sck_pin = config->sck_pin;
+    driver_config.mosi_pin = config->mosi_pin;
+    driver_config.miso_pin = config->miso_pin;
+    driver_config.cs_pin = (uint)-1;
+    driver_config.use_dma = true;
+
+    bus->driver = spi_driver_init(&driver_config);
+    if (bus->driver == NULL) {
+        hw_spinlock_free(bus->lock_num);
+        free(bus);
+        return NULL;
+    }
+
+    return bus;
+}
+
+bool spi_bus_destroy(spi_bus_t bus) {
+    if (bus == NULL || spi_bus_is_busy(bus)) {
+        return false;
+    }
+
+    spi_driver_deinit(bus->driver);
+    hw_spinlock_free(bus->lock_num);
+    free(bus);
+
+    return true;
+}
+
+void spi_bus_get_default_device_config(spi_device_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+
+    memset(config, 0, sizeof(spi_device_config_t));
+
+    config->cs_pin = 17;                    // Default CS pin for spi0
+    config->cs_active_low = true;           // Default CS is active low
+    config->baudrate = 1000000;             // Default to 1 MHz
+    config->data_bits = 8;                  // Default to 8 bits
+    config->cpol = SPI_CPOL_0;              // Default to CPOL 0
+    config->cpha = SPI_CPHA_0;              // Default to CPHA 0
+    config->order = SPI_MSB_FIRST;          // Default to MSB first
+    config->lane = SPI_BUS_LANE_NORMAL;     // Default to the normal lane
+    config->name = "spi_device";
+}
+
+bool spi_bus_get_stats(spi_bus_t bus, spi_bus_stats_t* stats) {
+    if (bus == NULL || stats == NULL) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(bus->lock_num, scheduler_get_current_task());
+    *stats = bus->stats;
+    hw_spinlock_release(bus->lock_num, save);
+
+    return true;
+}
+
+bool spi_bus_is_busy(spi_bus_t bus) {
+    if (bus == NULL) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(bus->lock_num, scheduler_get_current_task());
+
+    bool busy = bus->active;
+    for (int lane = 0; lane < SPI_BUS_LANE_COUNT && !busy; lane++) {
+        busy = bus->queues[lane].count > 0;
+    }
+
+    hw_spinlock_release(bus->lock_num, save);
+
+    return busy;
+}
+
+bool spi_bus_submit(const spi_bus_transaction_t* txn) {
+    if (txn == NULL || txn->device == NULL || !txn->device->in_use || txn->len == 0) {
+        return false;
+    }
+
+    if ((txn->op == SPI_BUS_OP_READ_REG && txn->rx_data == NULL) ||
+        (txn->op == SPI_BUS_OP_WRITE_REG && txn->tx_data == NULL) ||
+        (txn->op == SPI_BUS_OP_TRANSFER && txn->tx_data == NULL && txn->rx_data == NULL)) {
+        return false;
+    }
+
+    spi_bus_t bus = txn->device->bus;
+    spi_bus_lane_t lane = txn->device->config.lane;
+
+    uint32_t save = hw_spinlock_acquire(bus->lock_num, scheduler_get_current_task());
+
+    spi_bus_queue_t* queue = &bus->queues[lane];
+    bool queued = queue->count < SPI_BUS_QUEUE_DEPTH;
+
+    if (queued) {
+        uint8_t tail = (uint8_t)((queue->head + queue->count) % SPI_BUS_QUEUE_DEPTH);
+        queue->entries[tail].txn = *txn;
+        queue->entries[tail].submit_time_us = time_us_64();
+        queue->count++;
+    } else {
+        bus->stats.queue_full[lane]++;
+    }
+
+    hw_spinlock_release(bus->lock_num, save);
+
+    // Start immediately if the bus is idle, otherwise the completion IRQ picks it up
+    if (queued) {
+        spi_bus_start_next(bus);
+    }
+
+    return queued;
+}
+
+/**
+ * @brief Point the driver at a device, reconfiguring only if settings differ
+ *
+ * @param bus Bus handle
+ * @param device Device about to be addressed
+ */
+static void spi_bus_apply_device(spi_bus_t bus, spi_device_t device) {
+    spi_driver_ctx_t* driver = bus->driver;
+
+    // The driver asserts and releases whichever CS it is given
+    spi_driver_set_cs(driver, device->config.cs_pin, device->config.cs_active_low);
+
+    if (bus->configured != NULL &&
+        spi_bus_same_settings(&bus->configured->config, &device->config)) {
+        bus->configured = device;
+        return;
+    }
+
+    spi_set_baudrate(driver->spi_inst, device->config.baudrate);
+    spi_set_format(driver->spi_inst, device->config.data_bits,
+                   device->config.cpol, device->config.cpha, device->config.order);
+
+    bus->configured = device;
+    bus->stats.reconfigurations++;
+}
+
+/**
+ * @brief DMA completion handler, runs the callback and starts the next transaction
+ *
+ * @param user_data Bus handle
+ */
+static void spi_bus_dma_complete(void* user_data) {
+    spi_bus_t bus = (spi_bus_t)user_data;
+    spi_bus_transaction_t txn = bus->current.txn;
+
+    // Register operations release CS in the driver, raw transfers do it here
+    if (txn.op == SPI_BUS_OP_TRANSFER) {
+        spi_driver_deselect(bus->driver);
+    }
+
+    bus->stats.transactions[txn.device->config.lane]++;
+    bus->active = false;
+
+    if (txn.callback != NULL) {
+        txn.callback(true, txn.user_data);
+    }
+
+    spi_bus_start_next(bus);
+}
+
+/**
+ * @brief Compare the peripheral settings of two devices
+ *
+ * @param a First device configuration
+ * @param b Second device configuration
+ * @return true if no reconfiguration is needed between them
+ */
+static bool spi_bus_same_settings(const spi_device_config_t* a, const spi_device_config_t* b) {
+    return a->baudrate == b->baudrate && a->data_bits == b->data_bits &&
+           a->cpol == b->cpol && a->cpha == b->cpha && a->order == b->order;
+}
+
+/**
+ * @brief Start a transaction on the driver
+ *
+ * @param bus Bus handle
+ * @param txn Transaction to start
+ * @return true if the DMA was started
+ */
+static bool spi_bus_start(spi_bus_t bus, const spi_bus_transaction_t* txn) {
+    spi_bus_apply_device(bus, txn->device);
+
+    switch (txn->op) {
+        case SPI_BUS_OP_READ_REG:
+            return spi_driver_read_bytes_dma(bus->driver, txn->reg_addr, txn->rx_data, txn->len,
+                                             spi_bus_dma_complete, bus);
+
+        case SPI_BUS_OP_WRITE_REG:
+            return spi_driver_write_bytes_dma(bus->driver, txn->reg_addr, txn->tx_data, txn->len,
+                                              spi_bus_dma_complete, bus);
+
+        case SPI_BUS_OP_TRANSFER:
+            spi_driver_select(bus->driver);
+            if (!spi_driver_transfer_dma(bus->driver, txn->tx_data, txn->rx_data, txn->len,
+                                         spi_bus_dma_complete, bus)) {
+                spi_driver_deselect(bus->driver);
+                return false;
+            }
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Start the highest priority queued transaction if the bus is idle
+ *
+ * @param bus Bus handle
+ */
+static void spi_bus_start_next(spi_bus_t bus) {
+    while (true) {
+        uint32_t save = hw_spinlock_acquire(bus->lock_num, scheduler_get_current_task());
+
+        if (bus->active) {
+            hw_spinlock_release(bus->lock_num, save);
+            return;
+        }
+
+        // Strict priority, lower lanes only run when higher lanes are empty
+        spi_bus_queue_t* queue = NULL;
+        for (int lane = 0; lane < SPI_BUS_LANE_COUNT; lane++) {
+            if (bus->queues[lane].count > 0) {
+                queue = &bus->queues[lane];
+                break;
+            }
+        }
+
+        if (queue == NULL) {
+            hw_spinlock_release(bus->lock_num, save);
+            return;
+        }
+
+        bus->current = queue->entries[queue->head];
+        queue->head = (uint8_t)((queue->head + 1) % SPI_BUS_QUEUE_DEPTH);
+        queue->count--;
+        bus->active = true;
+
+        spi_bus_lane_t lane = bus->current.txn.device->config.lane;
+        uint32_t wait_us = (uint32_t)(time_us_64() - bus->current.submit_time_us);
+        if (wait_us > bus->stats.max_wait_us[lane]) {
+            bus->stats.max_wait_us[lane] = wait_us;
+        }
+
+        hw_spinlock_release(bus->lock_num, save);
+
+        if (spi_bus_start(bus, &bus->current.txn)) {
+            return;
+        }
+
+        // Could not start, report the failure and try the next one
+        spi_bus_transaction_t failed = bus->current.txn;
+        bus->stats.failures++;
+        bus->active = false;
+
+        if (failed.callback != NULL) {
+            failed.callback(false, failed.user_data);
+        }
+    }
+}
@@ -16,37 +16,46 @@
 #include <string.h>
 #include <stdlib.h>
 
-// Global context for DMA ISR
-static spi_driver_ctx_t* g_spi_dma_ctx = NULL;
+// Contexts with DMA enabled, checked by the shared DMA ISR
+static spi_driver_ctx_t* g_spi_dma_ctx[SPI_DRIVER_MAX_DMA_CTX] = {NULL, NULL};
+static bool g_spi_dma_irq_installed = false;
 static uint spi_lock_num = UINT_MAX;
 
-// DMA interrupt handler
+// Fill byte for reads, in RAM so the DMA does not fetch from XIP flash
+static uint8_t g_spi_dummy_tx = SPI_DRIVER_DUMMY_BYTE;
+
+static bool spi_driver_dma_claim(spi_driver_ctx_t* ctx, void (*callback)(void* user_data), void* user_data);
+static void spi_driver_dma_setup(spi_driver_ctx_t* ctx, uint channel, bool is_tx, bool increment,
+                                 uint chain_to, volatile void* dst, const volatile void* src, uint32_t count);
+static void spi_driver_dma_start(spi_driver_ctx_t* ctx, uint done_channel, uint32_t start_mask, bool select);
+
+// DMA interrupt handler, shared with other DMA users on DMA_IRQ_0
 static void spi_driver_dma_handler(void) {
-    if (g_spi_dma_ctx == NULL || g_spi_dma_ctx->dma_complete_callback == NULL) {
-        return;
-    }
-    
-    // Check if either channel raised the interrupt
-    bool tx_complete = dma_hw->ints0 & (1u << g_spi_dma_ctx->dma_tx_channel);
-    bool rx_complete = dma_hw->ints0 & (1u << g_spi_dma_ctx->dma_rx_channel);
-    
-    if (tx_complete || rx_complete) {
-        // Clear the interrupt flags
-        if (tx_complete) {
-            dma_hw->ints0 = 1u << g_spi_dma_ctx->dma_tx_channel;
+    for (int i = 0; i < SPI_DRIVER_MAX_DMA_CTX; i++) {
+        spi_driver_ctx_t* ctx = g_spi_dma_ctx[i];
+        if (ctx == NULL || !ctx->dma_busy) {
+            continue;
         }
-        if (rx_complete) {
-            dma_hw->ints0 = 1u << g_spi_dma_ctx->dma_rx_channel;
+        
+        uint32_t mask = 1u << ctx->dma_done_channel;
+        if ((dma_hw->ints0 & mask) == 0) {
+            continue;
         }
         
-        // Wait for both channels to complete
-        if (tx_complete && rx_complete) {
-            // For read operations, we wait for both TX (command) and RX (data) to complete
-            g_spi_dma_ctx->dma_complete_callback(g_spi_dma_ctx->dma_user_data);
+        // Only clear our own flag, other handlers share this IRQ
+        dma_hw->ints0 = mask;
+        dma_channel_set_irq0_enabled(ctx->dma_done_channel, false);
+        
+        // The last RX byte has arrived, so the bus is idle and CS can be released
+        if (ctx->dma_cs_asserted) {
+            spi_driver_deselect(ctx);
+            ctx->dma_cs_asserted = false;
         }
-        else if (tx_complete && g_spi_dma_ctx->dma_rx_channel == (uint8_t)-1) {
-            // For write-only operations (no RX DMA), we only wait for TX
-            g_spi_dma_ctx->dma_complete_callback(g_spi_dma_ctx->dma_user_data);
+        
+        ctx->dma_busy = false;
+        
+        if (ctx->dma_complete_callback != NULL) {
+            ctx->dma_complete_callback(ctx->dma_user_data);
         }
     }
 }
@@ -109,18 +118,43 @@ spi_driver_ctx_t* spi_driver_init(const spi_driver_config_t* config) {
             ctx->dma_rx_channel = (uint8_t) (dma_claim_unused_channel(true) & 0xFF);
         }
         
+        // Chained channels for the fill/data phase and for discarded RX bytes
+        ctx->dma_tx_fill_channel = (uint8_t) (dma_claim_unused_channel(true) & 0xFF);
+        ctx->dma_rx_discard_channel = (uint8_t) (dma_claim_unused_channel(true) & 0xFF);
+        
         // Check if channel allocation succeeded
-        if (ctx->dma_tx_channel == (uint8_t)-1 || ctx->dma_rx_channel == (uint8_t)-1) {
+        if (ctx->dma_tx_channel == (uint8_t)-1 || ctx->dma_rx_channel == (uint8_t)-1 ||
+            ctx->dma_tx_fill_channel == (uint8_t)-1 || ctx->dma_rx_discard_channel == (uint8_t)-1) {
             free(ctx);
             return NULL;
         }
         
-        // Set up DMA interrupt handler
-        irq_set_exclusive_handler(DMA_IRQ_0, spi_driver_dma_handler);
-        irq_set_enabled(DMA_IRQ_0, true);
-        
         // Store this context for the ISR
-        g_spi_dma_ctx = ctx;
+        int slot = -1;
+        for (int i = 0; i < SPI_DRIVER_MAX_DMA_CTX; i++) {
+            if (g_spi_dma_ctx[i] == NULL) {
+                slot = i;
+                break;
+            }
+        }
+        
+        if (slot < 0) {
+            dma_channel_unclaim(ctx->dma_tx_channel);
+            dma_channel_unclaim(ctx->dma_rx_channel);
+            dma_channel_unclaim(ctx->dma_tx_fill_channel);
+            dma_channel_unclaim(ctx->dma_rx_discard_channel);
+            free(ctx);
+            return NULL;
+        }
+        
+        g_spi_dma_ctx[slot] = ctx;
+        
+        // Set up DMA interrupt handler
+        if (!g_spi_dma_irq_installed) {
+            irq_add_shared_handler(DMA_IRQ_0, spi_driver_dma_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+            irq_set_enabled(DMA_IRQ_0, true);
+            g_spi_dma_irq_installed = true;
+        }
     }
     
     ctx->initialized = true;
@@ -146,8 +180,8 @@ void spi_driver_get_default_config(spi_driver_config_t* config) {
     config->cpha = SPI_CPHA_0;      // Default to CPHA 0
     config->order = SPI_MSB_FIRST;  // Default to MSB first
     config->use_dma = false;        // Default to not using DMA
-    config->dma_tx_channel = -1;    // Auto-allocate
-    config->dma_rx_channel = -1;    // Auto-allocate
+    config->dma_tx_channel = (uint8_t)-1;    // Auto-allocate
+    config->dma_rx_channel = (uint8_t)-1;    // Auto-allocate
 }
 
 bool spi_driver_select(spi_driver_ctx_t* ctx) {
@@ -170,9 +204,30 @@ bool spi_driver_deselect(spi_driver_ctx_t* ctx) {
     return true;
 }
 
+bool spi_driver_set_cs(spi_driver_ctx_t* ctx, uint cs_pin, bool cs_active_low) {
+    if (ctx == NULL || !ctx->initialized) {
+        return false;
+    }
+
+    // Already driving this pin, nothing to configure
+    if (cs_pin == ctx->cs_pin && cs_active_low == ctx->cs_active_low) {
+        return true;
+    }
+
+    if (cs_pin != (uint)-1) {
+        gpio_init(cs_pin);
+        gpio_put(cs_pin, cs_active_low); // Deasserted level before the pin is driven
+        gpio_set_dir(cs_pin, GPIO_OUT);
+    }
+
+    ctx->cs_pin = cs_pin;
+    ctx->cs_active_low = cs_active_low;
+    return true;
+}
+
 bool spi_driver_transfer(spi_driver_ctx_t* ctx, 
                         const uint8_t* tx_data, uint8_t* rx_data, size_t len) {
-    if (ctx == NULL || !ctx->initialized || (tx_data == NULL && rx_data == NULL) || len == 0) {
+    if (ctx == NULL || !ctx->initialized || (tx_data == NULL && rx_data == NULL) || len == 0 || ctx->dma_busy) {
         return false;
     }
     
@@ -185,17 +240,17 @@ bool spi_driver_transfer(spi_driver_ctx_t* ctx,
     // If only transmitting, use write_blocking
     if (tx_data != NULL && rx_data == NULL) {
         int result = spi_write_blocking(ctx->spi_inst, tx_data, len);
-        success = (result == len);
+        success = (result == (int)len);
     }
     // If only receiving, use read_blocking
     else if (tx_data == NULL && rx_data != NULL) {
         int result = spi_read_blocking(ctx->spi_inst, 0, rx_data, len);
-        success = (result == len);
+        success = (result == (int)len);
     }
     // If both transmitting and receiving, use write_read_blocking
     else {
         int result = spi_write_read_blocking(ctx->spi_inst, tx_data, rx_data, len);
-        success = (result == len);
+        success = (result == (int)len);
     }
     
     // Release lock
@@ -207,7 +262,7 @@ bool spi_driver_transfer(spi_driver_ctx_t* ctx,
 
 bool spi_driver_read_bytes(spi_driver_ctx_t* ctx, 
                           uint8_t reg_addr, uint8_t* data, size_t len) {
-    if (ctx == NULL || !ctx->initialized || data == NULL || len == 0) {
+    if (ctx == NULL || !ctx->initialized || data == NULL || len == 0 || ctx->dma_busy) {
         return false;
     }
 
@@ -227,7 +282,7 @@ bool spi_driver_read_bytes(spi_driver_ctx_t* ctx,
     if (result == 1) {
         // Read the data from the register
         result = spi_read_blocking(ctx->spi_inst, 0, data, len);
-        success = (result == len);
+        success = (result == (int)len);
     }
     
     // Deselect the device
@@ -242,7 +297,7 @@ bool spi_driver_read_bytes(spi_driver_ctx_t* ctx,
 
 bool spi_driver_write_bytes(spi_driver_ctx_t* ctx,
                            uint8_t reg_addr, const uint8_t* data, size_t len) {
-    if (ctx == NULL || !ctx->initialized || data == NULL || len == 0) {
+    if (ctx == NULL || !ctx->initialized || data == NULL || len == 0 || ctx->dma_busy) {
         return false;
     }
 
@@ -262,7 +317,7 @@ bool spi_driver_write_bytes(spi_driver_ctx_t* ctx,
         
         // Write to device
         int result = spi_write_blocking(ctx->spi_inst, buffer, len + 1);
-        success = (result == len + 1);
+        success = (result == (int)len + 1);
         
         // Deselect the device
         spi_driver_deselect(ctx);
@@ -277,6 +332,10 @@ bool spi_driver_write_bytes(spi_driver_ctx_t* ctx,
     return success;
 }
 
+bool spi_driver_dma_busy(spi_driver_ctx_t* ctx) {
+    return ctx != NULL && ctx->dma_busy;
+}
+
 bool spi_driver_transfer_dma(spi_driver_ctx_t* ctx,
                             const uint8_t* tx_data, uint8_t* rx_data, size_t len,
                             void (*callback)(void* user_data), void* user_data) {
@@ -285,53 +344,22 @@ bool spi_driver_transfer_dma(spi_driver_ctx_t* ctx,
         return false;
     }
     
-    // Store callback information
-    ctx->dma_complete_callback = callback;
-    ctx->dma_user_data = user_data;
-    
-    // Configure DMA for transmit if needed
-    if (tx_data != NULL) {
-        dma_channel_config tx_config = dma_channel_get_default_config(ctx->dma_tx_channel);
-        channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_8);
-        channel_config_set_read_increment(&tx_config, true);
-        channel_config_set_write_increment(&tx_config, false);
-        channel_config_set_dreq(&tx_config, spi_get_dreq(ctx->spi_inst, true));
-        
-        dma_channel_configure(
-            ctx->dma_tx_channel,
-            &tx_config,
-            &spi_get_hw(ctx->spi_inst)->dr,  // Destination: SPI data register
-            tx_data,                         // Source: tx_data
-            len,                             // Number of transfers
-            true                             // Start immediately
-        );
-        
-        // Enable the TX DMA interrupt if we're not using RX
-        if (rx_data == NULL) {
-            dma_channel_set_irq0_enabled(ctx->dma_tx_channel, true);
-        }
+    if (!spi_driver_dma_claim(ctx, callback, user_data)) {
+        return false;
     }
     
-    // Configure DMA for receive if needed
-    if (rx_data != NULL) {
-        dma_channel_config rx_config = dma_channel_get_default_config(ctx->dma_rx_channel);
-        channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
-        channel_config_set_read_increment(&rx_config, false);
-        channel_config_set_write_increment(&rx_config, true);
-        channel_config_set_dreq(&rx_config, spi_get_dreq(ctx->spi_inst, false));
-        
-        dma_channel_configure(
-            ctx->dma_rx_channel,
-            &rx_config,
-            rx_data,                         // Destination: rx_data
-            &spi_get_hw(ctx->spi_inst)->dr,  // Source: SPI data register
-            len,                             // Number of transfers
-            true                             // Start immediately
-        );
-        
-        // Enable the RX DMA interrupt
-        dma_channel_set_irq0_enabled(ctx->dma_rx_channel, true);
-    }
+    volatile void* dr = &spi_get_hw(ctx->spi_inst)->dr;
+    
+    // TX: caller data, or dummy bytes for receive-only transfers
+    spi_driver_dma_setup(ctx, ctx->dma_tx_channel, true, tx_data != NULL, ctx->dma_tx_channel,
+                         dr, (tx_data != NULL) ? tx_data : &g_spi_dummy_tx, (uint32_t)len);
+    
+    // RX: always drained, so no stale bytes are left in the FIFO
+    uint rx_channel = (rx_data != NULL) ? ctx->dma_rx_channel : ctx->dma_rx_discard_channel;
+    spi_driver_dma_setup(ctx, rx_channel, false, rx_data != NULL, rx_channel,
+                         (rx_data != NULL) ? (volatile void*)rx_data : &ctx->dma_discard, dr, (uint32_t)len);
+    
+    spi_driver_dma_start(ctx, rx_channel, (1u << rx_channel) | (1u << ctx->dma_tx_channel), false);
     
     return true;
 }
@@ -343,61 +371,27 @@ bool spi_driver_read_bytes_dma(spi_driver_ctx_t* ctx,
         return false;
     }
     
-    // Store callback information
-    ctx->dma_complete_callback = callback;
-    ctx->dma_user_data = user_data;
+    if (!spi_driver_dma_claim(ctx, callback, user_data)) {
+        return false;
+    }
     
-    // Select the device
-    spi_driver_select(ctx);
+    volatile void* dr = &spi_get_hw(ctx->spi_inst)->dr;
+    ctx->dma_cmd = reg_addr | 0x80; // Common convention for read bit
     
-    // First, we need to send the register address (with read bit set)
-    uint8_t read_addr = reg_addr | 0x80; // Common convention for read bit
+    // TX: command byte, chained to the dummy bytes that clock the data in
+    spi_driver_dma_setup(ctx, ctx->dma_tx_channel, true, false, ctx->dma_tx_fill_channel,
+                         dr, &ctx->dma_cmd, 1);
+    spi_driver_dma_setup(ctx, ctx->dma_tx_fill_channel, true, false, ctx->dma_tx_fill_channel,
+                         dr, &g_spi_dummy_tx, (uint32_t)len);
+    
+    // RX: drop the byte received during the command, chained to the data capture
+    spi_driver_dma_setup(ctx, ctx->dma_rx_discard_channel, false, false, ctx->dma_rx_channel,
+                         &ctx->dma_discard, dr, 1);
+    spi_driver_dma_setup(ctx, ctx->dma_rx_channel, false, true, ctx->dma_rx_channel,
+                         data, dr, (uint32_t)len);
     
-    // Wait for SPI to be available
-    while (spi_is_busy(ctx->spi_inst));
-    
-    // Send the address (blocking)
-    spi_write_blocking(ctx->spi_inst, &read_addr, 1);
-    
-    // Now set up DMA for reading data
-    dma_channel_config rx_config = dma_channel_get_default_config(ctx->dma_rx_channel);
-    channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
-    channel_config_set_read_increment(&rx_config, false);
-    channel_config_set_write_increment(&rx_config, true);
-    channel_config_set_dreq(&rx_config, spi_get_dreq(ctx->spi_inst, false));
-    
-    // Configure and start DMA
-    dma_channel_configure(
-        ctx->dma_rx_channel,
-        &rx_config,
-        data,                             // Destination
-        &spi_get_hw(ctx->spi_inst)->dr,   // Source
-        len,                              // Number of transfers
-        true                              // Start immediately
-    );
-    
-    // Configure a transmit DMA for sending dummy bytes while receiving
-    dma_channel_config tx_config = dma_channel_get_default_config(ctx->dma_tx_channel);
-    channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_8);
-    channel_config_set_read_increment(&tx_config, false);
-    channel_config_set_write_increment(&tx_config, false);
-    channel_config_set_dreq(&tx_config, spi_get_dreq(ctx->spi_inst, true));
-    
-    // For reading, we'll send repeated dummy bytes (0xFF)
-    uint8_t dummy_byte = 0xFF;
-    dma_channel_configure(
-        ctx->dma_tx_channel,
-        &tx_config,
-        &spi_get_hw(ctx->spi_inst)->dr,   // Destination
-        &dummy_byte,                      // Source: dummy byte
-        len,                              // Number of transfers
-        true                              // Start immediately
-    );
-    
-    // Enable DMA interrupts
-    dma_channel_set_irq0_enabled(ctx->dma_rx_channel, true);
-    
-    // Note: We don't deselect the device here - that will be done in the callback
+    spi_driver_dma_start(ctx, ctx->dma_rx_channel,
+                         (1u << ctx->dma_rx_discard_channel) | (1u << ctx->dma_tx_channel), true);
     
     return true;
 }
@@ -409,45 +403,25 @@ bool spi_driver_write_bytes_dma(spi_driver_ctx_t* ctx,
         return false;
     }
     
-    // Store callback information
-    ctx->dma_complete_callback = callback;
-    ctx->dma_user_data = user_data;
-    
-    // Prepare buffer: [register address, data...]
-    uint8_t* buffer = (uint8_t*)malloc(len + 1);
-    if (buffer == NULL) {
+    if (!spi_driver_dma_claim(ctx, callback, user_data)) {
         return false;
     }
     
-    buffer[0] = reg_addr & 0x7F; // Clear read bit (if using bit 7 convention)
-    memcpy(buffer + 1, data, len);
+    volatile void* dr = &spi_get_hw(ctx->spi_inst)->dr;
+    ctx->dma_cmd = reg_addr & 0x7F; // Clear read bit (if using bit 7 convention)
     
-    // Select the device
-    spi_driver_select(ctx);
+    // TX: register address, chained to the caller's data, no bounce buffer needed
+    spi_driver_dma_setup(ctx, ctx->dma_tx_channel, true, false, ctx->dma_tx_fill_channel,
+                         dr, &ctx->dma_cmd, 1);
+    spi_driver_dma_setup(ctx, ctx->dma_tx_fill_channel, true, true, ctx->dma_tx_fill_channel,
+                         dr, data, (uint32_t)len);
+    
+    // RX: drain every byte, its completion means the last bit has been shifted out
+    spi_driver_dma_setup(ctx, ctx->dma_rx_discard_channel, false, false, ctx->dma_rx_discard_channel,
+                         &ctx->dma_discard, dr, (uint32_t)(len + 1));
     
-    // Configure DMA for transmit
-    dma_channel_config tx_config = dma_channel_get_default_config(ctx->dma_tx_channel);
-    channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_8);
-    channel_config_set_read_increment(&tx_config, true);
-    channel_config_set_write_increment(&tx_config, false);
-    channel_config_set_dreq(&tx_config, spi_get_dreq(ctx->spi_inst, true));
-    
-    // Configure and start DMA
-    dma_channel_configure(
-        ctx->dma_tx_channel,
-        &tx_config,
-        &spi_get_hw(ctx->spi_inst)->dr,   // Destination
-        buffer,                          // Source
-        len + 1,                         // Number of transfers (including register address)
-        true                             // Start immediately
-    );
-    
-    // Enable DMA interrupt
-    dma_channel_set_irq0_enabled(ctx->dma_tx_channel, true);
-    
-    // Note: We don't deselect the device here - that will be done in the callback
-    // Note: We don't free the buffer here because DMA is still using it.
-    // We'd need to make a callback to free it after DMA completes.
+    spi_driver_dma_start(ctx, ctx->dma_rx_discard_channel,
+                         (1u << ctx->dma_rx_discard_channel) | (1u << ctx->dma_tx_channel), true);
     
     return true;
 }
@@ -473,14 +447,23 @@ bool spi_driver_deinit(spi_driver_ctx_t* ctx) {
     // Clean up DMA resources if used
     if (ctx->use_dma) {
         dma_channel_set_irq0_enabled(ctx->dma_rx_channel, false);
-        dma_channel_set_irq0_enabled(ctx->dma_tx_channel, false);
+        dma_channel_set_irq0_enabled(ctx->dma_rx_discard_channel, false);
+        
+        for (int i = 0; i < SPI_DRIVER_MAX_DMA_CTX; i++) {
+            if (g_spi_dma_ctx[i] == ctx) {
+                g_spi_dma_ctx[i] = NULL;
+            }
+        }
+        
+        dma_channel_abort(ctx->dma_tx_channel);
+        dma_channel_abort(ctx->dma_tx_fill_channel);
+        dma_channel_abort(ctx->dma_rx_discard_channel);
+        dma_channel_abort(ctx->dma_rx_channel);
         
         dma_channel_unclaim(ctx->dma_rx_channel);
         dma_channel_unclaim(ctx->dma_tx_channel);
-        
-        if (g_spi_dma_ctx == ctx) {
-            g_spi_dma_ctx = NULL;
-        }
+        dma_channel_unclaim(ctx->dma_tx_fill_channel);
+        dma_channel_unclaim(ctx->dma_rx_discard_channel);
     }
     
     // Reset CS pin to input (if used)
@@ -492,4 +475,70 @@ bool spi_driver_deinit(spi_driver_ctx_t* ctx) {
     free(ctx);
     
     return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Reserve the DMA channels of a context for a new transaction
+ * 
+ * @param ctx Pointer to driver context
+ * @param callback Function to call when the transaction completes
+ * @param user_data User data to pass to callback
+ * @return true if reserved, false if a transaction is already in flight
+ */
+static bool spi_driver_dma_claim(spi_driver_ctx_t* ctx, void (*callback)(void* user_data), void* user_data) {
+    uint32_t save = hw_spinlock_acquire(spi_lock_num, scheduler_get_current_task());
+    
+    bool claimed = !ctx->dma_busy;
+    if (claimed) {
+        ctx->dma_busy = true;
+        ctx->dma_complete_callback = callback;
+        ctx->dma_user_data = user_data;
+    }
+    
+    hw_spinlock_release(spi_lock_num, save);
+    
+    return claimed;
+}
+
+/**
+ * @brief Configure one byte-wide SPI DMA channel without starting it
+ * 
+ * @param ctx Pointer to driver context
+ * @param channel DMA channel to configure
+ * @param is_tx true if paced by the TX DREQ, false for RX
+ * @param increment Whether the memory side address increments
+ * @param chain_to Channel to trigger on completion (the channel itself for none)
+ * @param dst Write address
+ * @param src Read address
+ * @param count Number of bytes
+ */
+static void spi_driver_dma_setup(spi_driver_ctx_t* ctx, uint channel, bool is_tx, bool increment,
+                                 uint chain_to, volatile void* dst, const volatile void* src, uint32_t count) {
+    dma_channel_config config = dma_channel_get_default_config(channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, is_tx && increment);
+    channel_config_set_write_increment(&config, !is_tx && increment);
+    channel_config_set_dreq(&config, spi_get_dreq(ctx->spi_inst, is_tx));
+    channel_config_set_chain_to(&config, chain_to);
+    
+    dma_channel_configure(channel, &config, dst, src, count, false);
+}
+
+/**
+ * @brief Arm the completion interrupt, assert CS and start the first channels
+ * 
+ * @param ctx Pointer to driver context
+ * @param done_channel Channel whose completion ends the transaction
+ * @param start_mask Channels started together, the rest are chained
+ * @param select Whether to assert CS and release it on completion
+ */
+static void spi_driver_dma_start(spi_driver_ctx_t* ctx, uint done_channel, uint32_t start_mask, bool select) {
+    ctx->dma_done_channel = (uint8_t) (done_channel & 0xFF);
+    ctx->dma_cs_asserted = select && spi_driver_select(ctx);
+    
+    dma_hw->ints0 = 1u << done_channel;
+    dma_channel_set_irq0_enabled(done_channel, true);
+    
+    // RX and TX start in the same cycle, the SPI DREQs pace the rest
+    dma_start_channel_mask(start_mask);
+}
@@ -0,0 +1,234 @@
+/**
+* @file interp_accel.c
+* @brief SIO interpolator accelerated clamped linear mapping implementation
+* @date 2025-05-25
+*/
+
+#include "interp_accel.h"
+
+#include "pico/stdlib.h"
+
+#if defined(PICO_ON_DEVICE) && PICO_ON_DEVICE
+#include "hardware/claim.h"
+#include "hardware/interp.h"
+#define INTERP_ACCEL_HAVE_HW 1
+#else
+#define INTERP_ACCEL_HAVE_HW 0
+#endif
+
+#include <string.h>
+
+/**
+ * @brief Per-core interpolator state
+ */
+typedef enum {
+    INTERP_CORE_UNCONFIGURED = 0,
+    INTERP_CORE_HW,
+    INTERP_CORE_SW
+} interp_core_state_t;
+
+// Each core has its own interpolators, so the configuration is per core
+static volatile interp_core_state_t g_core_state[2] = {
+    INTERP_CORE_UNCONFIGURED, INTERP_CORE_UNCONFIGURED
+};
+
+// INTERP1 lane 0 claim, shared by both cores and made once by the first user
+static volatile bool g_claim_started = false;
+static volatile bool g_claim_done = false;
+static volatile bool g_lane_owned = false;
+
+static interp_core_state_t interp_accel_configure_core(void);
+static inline int32_t interp_accel_scale(const interp_accel_linear_t* map, int32_t clamped);
+
+bool interp_accel_benchmark(uint32_t iterations, interp_accel_bench_t* result) {
+    if (result == NULL || iterations == 0) {
+        return false;
+    }
+
+    static int16_t raw[INTERP_ACCEL_BENCH_BATCH];
+    static int32_t out_hw[INTERP_ACCEL_BENCH_BATCH];
+    static int32_t out_sw[INTERP_ACCEL_BENCH_BATCH];
+    static float out_float[INTERP_ACCEL_BENCH_BATCH];
+
+    memset(result, 0, sizeof(interp_accel_bench_t));
+    result->hw_available = interp_accel_hw_available();
+    result->samples = iterations * INTERP_ACCEL_BENCH_BATCH;
+
+    // Full scale raw samples, so some fall outside the clamp range
+    uint32_t seed = 0x12345678u;
+    for (int i = 0; i < INTERP_ACCEL_BENCH_BATCH; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        raw[i] = (int16_t)(seed >> 16);
+    }
+
+    interp_accel_linear_t map;
+    interp_accel_linear_init(&map, -30000, 30000, -16000, 16000);
+
+    uint64_t start = time_us_64();
+    for (uint32_t it = 0; it < iterations; it++) {
+        interp_accel_linear_batch(&map, raw, out_hw, INTERP_ACCEL_BENCH_BATCH);
+    }
+    uint64_t hw_us = time_us_64() - start;
+
+    start = time_us_64();
+    for (uint32_t it = 0; it < iterations; it++) {
+        for (int i = 0; i < INTERP_ACCEL_BENCH_BATCH; i++) {
+            out_sw[i] = interp_accel_linear_sw(&map, raw[i]);
+        }
+    }
+    uint64_t sw_us = time_us_64() - start;
+
+    const float in_lo = -30000.0f;
+    const float in_hi = 30000.0f;
+    const float scale = 32000.0f / 60000.0f;
+
+    start = time_us_64();
+    for (uint32_t it = 0; it < iterations; it++) {
+        for (int i = 0; i < INTERP_ACCEL_BENCH_BATCH; i++) {
+            float x = (float)raw[i];
+            if (x < in_lo) {
+                x = in_lo;
+            } else if (x > in_hi) {
+                x = in_hi;
+            }
+            out_float[i] = -16000.0f + (x - in_lo) * scale;
+        }
+    }
+    uint64_t float_us = time_us_64() - start;
+
+    for (int i = 0; i < INTERP_ACCEL_BENCH_BATCH; i++) {
+        if (out_hw[i] != out_sw[i]) {
+            result->mismatches++;
+        }
+    }
+
+    result->hw_ns = (uint32_t)((hw_us * 1000u) / result->samples);
+    result->sw_ns = (uint32_t)((sw_us * 1000u) / result->samples);
+    result->float_ns = (uint32_t)((float_us * 1000u) / result->samples);
+
+    // Keep the float loop from being optimized away
+    (void)*(volatile float*)&out_float[0];
+
+    return true;
+}
+
+bool interp_accel_hw_available(void) {
+    uint core = get_core_num();
+    if (g_core_state[core] == INTERP_CORE_UNCONFIGURED) {
+        g_core_state[core] = interp_accel_configure_core();
+    }
+
+    return g_core_state[core] == INTERP_CORE_HW;
+}
+
+int32_t interp_accel_linear(const interp_accel_linear_t* map, int32_t in) {
+#if INTERP_ACCEL_HAVE_HW
+    if (interp_accel_hw_available()) {
+        // Clamp mode compares signed ACCUM0 against BASE0/BASE1
+        interp1->base[0] = (uint32_t)map->in_lo;
+        interp1->base[1] = (uint32_t)map->in_hi;
+        interp1->accum[0] = (uint32_t)in;
+        return interp_accel_scale(map, (int32_t)interp1->peek[0]);
+    }
+#endif
+
+    return interp_accel_linear_sw(map, in);
+}
+
+void interp_accel_linear_batch(const interp_accel_linear_t* map, const int16_t* raw,
+    int32_t* out, uint32_t count) {
+#if INTERP_ACCEL_HAVE_HW
+    if (interp_accel_hw_available()) {
+        interp1->base[0] = (uint32_t)map->in_lo;
+        interp1->base[1] = (uint32_t)map->in_hi;
+
+        for (uint32_t i = 0; i < count; i++) {
+            interp1->accum[0] = (uint32_t)(int32_t)raw[i];
+            out[i] = interp_accel_scale(map, (int32_t)interp1->peek[0]);
+        }
+        return;
+    }
+#endif
+
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = interp_accel_linear_sw(map, raw[i]);
+    }
+}
+
+bool interp_accel_linear_init(interp_accel_linear_t* map, int32_t in_lo, int32_t in_hi,
+    int32_t out_lo, int32_t out_hi) {
+    if (map == NULL || in_hi <= in_lo) {
+        return false;
+    }
+
+    map->in_lo = in_lo;
+    map->in_hi = in_hi;
+    map->out_lo = out_lo;
+    map->gain_q16 = (int32_t)((((int64_t)out_hi - out_lo) * 65536) / ((int64_t)in_hi - in_lo));
+
+    return true;
+}
+
+int32_t interp_accel_linear_sw(const interp_accel_linear_t* map, int32_t in) {
+    int32_t clamped = in;
+    if (clamped < map->in_lo) {
+        clamped = map->in_lo;
+    } else if (clamped > map->in_hi) {
+        clamped = map->in_hi;
+    }
+
+    return interp_accel_scale(map, clamped);
+}
+
+/**
+ * @brief Claim and configure INTERP1 lane 0 of the calling core for clamping
+ *
+ * @return INTERP_CORE_HW if the interpolator can be used, INTERP_CORE_SW otherwise.
+ */
+static interp_core_state_t interp_accel_configure_core(void) {
+#if INTERP_ACCEL_HAVE_HW
+    // interp_claim_lane() takes the claim lock itself, so only elect the claimer under it
+    uint32_t save = hw_claim_lock();
+    bool claimer = !g_claim_started;
+    g_claim_started = true;
+    hw_claim_unlock(save);
+
+    // The claim covers both cores' INTERP1, leave it alone if someone else owns it
+    if (claimer) {
+        g_lane_owned = !interp_lane_is_claimed(interp1, 0);
+        if (g_lane_owned) {
+            interp_claim_lane(interp1, 0);
+        }
+        g_claim_done = true;
+    }
+
+    while (!g_claim_done) {
+        tight_loop_contents();
+    }
+
+    if (!g_lane_owned) {
+        return INTERP_CORE_SW;
+    }
+
+    interp_config cfg = interp_default_config();
+    interp_config_set_clamp(&cfg, true);
+    interp_config_set_signed(&cfg, true);
+    interp_set_config(interp1, 0, &cfg);
+
+    return INTERP_CORE_HW;
+#else
+    return INTERP_CORE_SW;
+#endif
+}
+
+/**
+ * @brief Scale a clamped input onto the output range
+ *
+ * @param map Precomputed map.
+ * @param clamped Input already clamped to [in_lo, in_hi].
+ * @return Output value, rounded to nearest.
+ */
+static inline int32_t interp_accel_scale(const interp_accel_linear_t* map, int32_t clamped) {
+    int64_t offset = (int64_t)(clamped - map->in_lo) * map->gain_q16;
+    return map->out_lo + (int32_t)((offset + 32768) >> 16);
+}
@@ -0,0 +1,694 @@
+/**
+* @file adc_manager.c
+* @brief DMA-driven multi-channel ADC acquisition implementation
+* @date 2025-05-27
+*/
+
+#include "adc_manager.h"
+
+#include "log_manager.h"
+#include "usb_shell.h"
+
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ADC_MANAGER_RING_MASK       (ADC_MANAGER_RING_SAMPLES - 1)
+#define ADC_MANAGER_BUFFER_MAX      (ADC_MANAGER_MAX_INPUTS * ADC_MANAGER_PASSES_PER_BUFFER)
+#define ADC_MANAGER_CLOCK_HZ        48000000.0f  // ADC clock from the USB PLL
+#define ADC_MANAGER_VREF            3.3f
+#define ADC_MANAGER_COUNTS          4096.0f
+#define ADC_MANAGER_FIRST_GPIO      26           // GPIO of input 0
+#define ADC_MANAGER_DEFAULT_RATE_HZ 1000
+
+/**
+ * @brief Acquisition state of one input
+ */
+typedef struct {
+    uint32_t acc_sum;                               // Raw counts summed for the next sample
+    uint16_t acc_count;                             // Raw samples in acc_sum
+    volatile uint32_t head;                         // Samples ever stored, ring index is head & mask
+    adc_manager_sample_t ring[ADC_MANAGER_RING_SAMPLES]; // Stored samples
+} adc_manager_input_t;
+
+/**
+ * @brief ADC manager state
+ */
+typedef struct {
+    bool initialized;
+    volatile bool running;
+    bool irq_installed;
+    adc_manager_config_t config;
+    adc_manager_stats_t stats;
+
+    uint8_t order[ADC_MANAGER_MAX_INPUTS];          // Enabled inputs in round robin order
+    uint8_t input_count;                            // Enabled inputs
+    uint32_t buffer_len;                            // Raw samples per DMA buffer
+    float conversion_us;                            // Time between two conversions
+    uint dma_channels[2];                           // Ping-pong channels, each chains to the other
+    uint16_t buffers[2][ADC_MANAGER_BUFFER_MAX];    // DMA buffers
+
+    adc_manager_input_t inputs[ADC_MANAGER_MAX_INPUTS];
+} adc_manager_state_t;
+
+static adc_manager_state_t g_adc = {
+    .initialized = false,
+    .running = false
+};
+
+static void adc_manager_dma_handler(void);
+static bool adc_manager_start(void);
+static bool adc_manager_validate(const adc_manager_config_t* config);
+
+static const char* adc_role_to_string(adc_role_t role) {
+    switch (role) {
+        case ADC_ROLE_NONE:             return "off";
+        case ADC_ROLE_RAW:              return "raw";
+        case ADC_ROLE_BATTERY_VOLTAGE:  return "battery";
+        case ADC_ROLE_SERVO_CURRENT:    return "current";
+        case ADC_ROLE_TEMPERATURE:      return "temp";
+        case ADC_ROLE_EMG:              return "emg";
+        default:                        return "?";
+    }
+}
+
+static bool adc_role_from_string(const char* str, adc_role_t* role) {
+    for (int r = ADC_ROLE_NONE; r <= ADC_ROLE_EMG; r++) {
+        if (strcmp(str, adc_role_to_string((adc_role_t) r)) == 0) {
+            *role = (adc_role_t) r;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Convert averaged volts to the value stored for an input
+ */
+static inline float adc_manager_convert(const adc_manager_input_config_t* input, float volts) {
+    if (input->role == ADC_ROLE_TEMPERATURE) {
+        return 27.0f - ((volts - 0.706f) / 0.001721f);
+    }
+
+    return (volts - input->offset) * input->gain;
+}
+
+/**
+ * @brief Split a filled DMA buffer by input, decimate and store the samples
+ *
+ * Runs in the DMA interrupt. end_us is the time of the last conversion in
+ * the buffer, earlier conversions are placed one conversion period apart.
+ */
+static void __not_in_flash_func(adc_manager_process)(const uint16_t* buffer, uint32_t end_us) {
+    const uint32_t count = g_adc.input_count;
+    uint32_t k = 0;
+
+    for (uint32_t pass = 0; pass < ADC_MANAGER_PASSES_PER_BUFFER; pass++) {
+        for (uint32_t slot = 0; slot < count; slot++, k++) {
+            uint8_t id = g_adc.order[slot];
+            adc_manager_input_t* input = &g_adc.inputs[id];
+            const adc_manager_input_config_t* config = &g_adc.config.inputs[id];
+
+            input->acc_sum += buffer[k];
+            input->acc_count++;
+
+            if (input->acc_count < config->decimation) {
+                continue;
+            }
+
+            float volts = ((float) input->acc_sum * (ADC_MANAGER_VREF / ADC_MANAGER_COUNTS)) / (float) input->acc_count;
+            adc_manager_sample_t* sample = &input->ring[input->head & ADC_MANAGER_RING_MASK];
+
+            sample->time_us = end_us - (uint32_t) ((float) (g_adc.buffer_len - 1u - k) * g_adc.conversion_us);
+            sample->value = adc_manager_convert(config, volts);
+
+            // Publish the sample before the head that makes it visible
+            __dmb();
+            input->head++;
+
+            input->acc_sum = 0;
+            input->acc_count = 0;
+            g_adc.stats.samples[id]++;
+        }
+    }
+}
+
+/**
+ * @brief Stop the ADC and both DMA channels and empty the FIFO
+ */
+static void adc_manager_halt(void) {
+    // The handler ignores completions from here on
+    g_adc.running = false;
+    adc_run(false);
+
+    for (int i = 0; i < 2; i++) {
+        dma_channel_set_irq0_enabled(g_adc.dma_channels[i], false);
+        dma_channel_abort(g_adc.dma_channels[i]);
+        dma_hw->ints0 = 1u << g_adc.dma_channels[i];
+    }
+
+    adc_fifo_drain();
+}
+
+/**
+ * @brief Restart the round robin from the first input
+ *
+ * A FIFO overflow loses a conversion and with it the position in the
+ * round robin, so the acquisition is restarted to realign.
+ */
+static void adc_manager_restart(void) {
+    adc_manager_halt();
+    adc_manager_start();
+}
+
+// DMA interrupt handler, shared with other DMA users on DMA_IRQ_0
+static void __not_in_flash_func(adc_manager_dma_handler)(void) {
+    if (!g_adc.running) {
+        return;
+    }
+
+    uint32_t start_us = time_us_32();
+    bool processed = false;
+
+    for (int i = 0; i < 2; i++) {
+        uint32_t mask = 1u << g_adc.dma_channels[i];
+        if ((dma_hw->ints0 & mask) == 0) {
+            continue;
+        }
+
+        // Only clear our own flag, other handlers share this IRQ
+        dma_hw->ints0 = mask;
+
+        // Ready for when the other channel chains back, the count reloads by itself
+        dma_channel_set_write_addr(g_adc.dma_channels[i], g_adc.buffers[i], false);
+
+        adc_manager_process(g_adc.buffers[i], start_us);
+        g_adc.stats.buffers++;
+        processed = true;
+    }
+
+    if (!processed) {
+        return;
+    }
+
+    if (adc_hw->fcs & ADC_FCS_OVER_BITS) {
+        // Write one to clear
+        hw_set_bits(&adc_hw->fcs, ADC_FCS_OVER_BITS);
+        g_adc.stats.fifo_overflows++;
+        adc_manager_restart();
+    }
+
+    g_adc.stats.last_isr_us = time_us_32() - start_us;
+    if (g_adc.stats.last_isr_us > g_adc.stats.max_isr_us) {
+        g_adc.stats.max_isr_us = g_adc.stats.last_isr_us;
+    }
+}
+
+static bool adc_manager_validate(const adc_manager_config_t* config) {
+    uint32_t count = 0;
+
+    for (int i = 0; i < ADC_MANAGER_MAX_INPUTS; i++) {
+        const adc_manager_input_config_t* input = &config->inputs[i];
+
+        if (input->role == ADC_ROLE_NONE) {
+            continue;
+        }
+
+        if (input->role > ADC_ROLE_EMG || input->decimation == 0) {
+            log_message(LOG_LEVEL_WARN, "ADC Manager", "Input %d needs a valid role and a decimation of at least 1.", i);
+            return false;
+        }
+
+        if ((input->role == ADC_ROLE_TEMPERATURE) != (i == ADC_MANAGER_TEMP_INPUT)) {
+            log_message(LOG_LEVEL_WARN, "ADC Manager", "Only input %d is the temperature sensor.", ADC_MANAGER_TEMP_INPUT);
+            return false;
+        }
+
+        count++;
+    }
+
+    if (count == 0) {
+        log_message(LOG_LEVEL_WARN, "ADC Manager", "No inputs enabled.");
+        return false;
+    }
+
+    if (config->sample_rate_hz == 0 || (config->sample_rate_hz * count) > ADC_MANAGER_MAX_CONVERSION_HZ) {
+        log_message(LOG_LEVEL_WARN, "ADC Manager", "%lu Hz on %lu inputs exceeds %d conversions per second.",
+            config->sample_rate_hz, count, ADC_MANAGER_MAX_CONVERSION_HZ);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Program the ADC and DMA from g_adc.config and start sampling
+ */
+static bool adc_manager_start(void) {
+    g_adc.input_count = 0;
+    for (uint8_t i = 0; i < ADC_MANAGER_MAX_INPUTS; i++) {
+        g_adc.inputs[i].acc_sum = 0;
+        g_adc.inputs[i].acc_count = 0;
+
+        if (g_adc.config.inputs[i].role != ADC_ROLE_NONE) {
+            g_adc.order[g_adc.input_count++] = i;
+        }
+    }
+
+    if (g_adc.input_count == 0) {
+        return false;
+    }
+
+    float conversion_hz = (float) (g_adc.config.sample_rate_hz * g_adc.input_count);
+    g_adc.buffer_len = (uint32_t) g_adc.input_count * ADC_MANAGER_PASSES_PER_BUFFER;
+    g_adc.conversion_us = 1e6f / conversion_hz;
+
+    // Round robin over the enabled inputs, starting at the first
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < g_adc.input_count; i++) {
+        mask |= 1u << g_adc.order[i];
+    }
+
+    adc_set_round_robin(mask);
+    adc_select_input(g_adc.order[0]);
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv((ADC_MANAGER_CLOCK_HZ / conversion_hz) - 1.0f);
+
+    for (int i = 0; i < 2; i++) {
+        uint channel = g_adc.dma_channels[i];
+        dma_channel_config c = dma_channel_get_default_config(channel);
+
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, true);
+        channel_config_set_dreq(&c, DREQ_ADC);
+        channel_config_set_chain_to(&c, g_adc.dma_channels[i ^ 1]);
+
+        dma_channel_configure(channel, &c, g_adc.buffers[i], &adc_hw->fifo, g_adc.buffer_len, false);
+        dma_channel_set_irq0_enabled(channel, true);
+    }
+
+    g_adc.running = true;
+    dma_channel_start(g_adc.dma_channels[0]);
+    adc_run(true);
+
+    return true;
+}
+
+void adc_manager_get_default_config(adc_manager_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+
+    memset(config, 0, sizeof(adc_manager_config_t));
+    config->sample_rate_hz = ADC_MANAGER_DEFAULT_RATE_HZ;
+
+    for (int i = 0; i < ADC_MANAGER_MAX_INPUTS; i++) {
+        config->inputs[i].role = ADC_ROLE_NONE;
+        config->inputs[i].decimation = 1;
+        config->inputs[i].gain = 1.0f;
+        config->inputs[i].offset = 0.0f;
+    }
+
+    // Temperature needs no external hardware, average it down to 10 Hz
+    config->inputs[ADC_MANAGER_TEMP_INPUT].role = ADC_ROLE_TEMPERATURE;
+    config->inputs[ADC_MANAGER_TEMP_INPUT].decimation = 100;
+}
+
+bool adc_manager_init(const adc_manager_config_t* config) {
+    if (g_adc.initialized) {
+        return (config == NULL) || adc_manager_reconfigure(config);
+    }
+
+    if (config != NULL) {
+        if (!adc_manager_validate(config)) {
+            return false;
+        }
+        g_adc.config = *config;
+    }
+    else {
+        adc_manager_get_default_config(&g_adc.config);
+    }
+
+    int channels[2] = {dma_claim_unused_channel(false), dma_claim_unused_channel(false)};
+    if (channels[0] < 0 || channels[1] < 0) {
+        if (channels[0] >= 0) {
+            dma_channel_unclaim((uint) channels[0]);
+        }
+        log_message(LOG_LEVEL_ERROR, "ADC Manager", "No free DMA channels.");
+        return false;
+    }
+
+    g_adc.dma_channels[0] = (uint) channels[0];
+    g_adc.dma_channels[1] = (uint) channels[1];
+
+    adc_init();
+    adc_set_temp_sensor_enabled(true);
+
+    for (uint i = 0; i < ADC_MANAGER_TEMP_INPUT; i++) {
+        if (g_adc.config.inputs[i].role != ADC_ROLE_NONE) {
+            adc_gpio_init(ADC_MANAGER_FIRST_GPIO + i);
+        }
+    }
+
+    if (!g_adc.irq_installed) {
+        irq_add_shared_handler(DMA_IRQ_0, adc_manager_dma_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0, true);
+        g_adc.irq_installed = true;
+    }
+
+    g_adc.initialized = true;
+
+    if (!adc_manager_start()) {
+        return false;
+    }
+
+    log_message(LOG_LEVEL_INFO, "ADC Manager", "Sampling %u inputs at %lu Hz on DMA %u/%u.",
+        g_adc.input_count, g_adc.config.sample_rate_hz, g_adc.dma_channels[0], g_adc.dma_channels[1]);
+
+    return true;
+}
+
+bool adc_manager_reconfigure(const adc_manager_config_t* config) {
+    if (!g_adc.initialized || config == NULL || !adc_manager_validate(config)) {
+        return false;
+    }
+
+    uint32_t save = save_and_disable_interrupts();
+
+    if (g_adc.running) {
+        adc_manager_halt();
+    }
+
+    g_adc.config = *config;
+
+    for (uint i = 0; i < ADC_MANAGER_TEMP_INPUT; i++) {
+        if (g_adc.config.inputs[i].role != ADC_ROLE_NONE) {
+            adc_gpio_init(ADC_MANAGER_FIRST_GPIO + i);
+        }
+    }
+
+    bool started = adc_manager_start();
+
+    restore_interrupts(save);
+
+    return started;
+}
+
+void adc_manager_stop(void) {
+    if (!g_adc.initialized || !g_adc.running) {
+        return;
+    }
+
+    uint32_t save = save_and_disable_interrupts();
+    adc_manager_halt();
+    restore_interrupts(save);
+}
+
+bool adc_manager_is_running(void) {
+    return g_adc.running;
+}
+
+void adc_manager_get_config(adc_manager_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+
+    if (!g_adc.initialized) {
+        adc_manager_get_default_config(config);
+        return;
+    }
+
+    *config = g_adc.config;
+}
+
+void adc_manager_get_stats(adc_manager_stats_t* stats) {
+    if (stats != NULL) {
+        *stats = g_adc.stats;
+    }
+}
+
+int adc_manager_read(uint8_t input, uint32_t* cursor, adc_manager_sample_t* samples, int max_samples, uint32_t* dropped) {
+    if (input >= ADC_MANAGER_MAX_INPUTS || cursor == NULL || samples == NULL || max_samples <= 0) {
+        return -1;
+    }
+
+    const adc_manager_input_t* state = &g_adc.inputs[input];
+    uint32_t head = state->head;
+    uint32_t skipped = 0;
+
+    __dmb();
+
+    // Leave a margin, the producer may be writing the oldest entry
+    if ((head - *cursor) > (ADC_MANAGER_RING_SAMPLES - ADC_MANAGER_PASSES_PER_BUFFER)) {
+        uint32_t oldest = head - (ADC_MANAGER_RING_SAMPLES - ADC_MANAGER_PASSES_PER_BUFFER);
+        skipped = oldest - *cursor;
+        *cursor = oldest;
+    }
+
+    int count = 0;
+    while (*cursor != head && count < max_samples) {
+        samples[count++] = state->ring[*cursor & ADC_MANAGER_RING_MASK];
+        (*cursor)++;
+    }
+
+    if (dropped != NULL) {
+        *dropped = skipped;
+    }
+
+    return count;
+}
+
+const adc_manager_sample_t* adc_manager_get_ring(uint8_t input, uint32_t* head) {
+    if (input >= ADC_MANAGER_MAX_INPUTS || head == NULL) {
+        return NULL;
+    }
+
+    *head = g_adc.inputs[input].head;
+    __dmb();
+
+    return g_adc.inputs[input].ring;
+}
+
+bool adc_manager_get_latest(uint8_t input, adc_manager_sample_t* sample) {
+    if (input >= ADC_MANAGER_MAX_INPUTS || sample == NULL) {
+        return false;
+    }
+
+    const adc_manager_input_t* state = &g_adc.inputs[input];
+    uint32_t head = state->head;
+
+    if (head == 0) {
+        return false;
+    }
+
+    __dmb();
+    *sample = state->ring[(head - 1u) & ADC_MANAGER_RING_MASK];
+
+    return true;
+}
+
+int adc_manager_find_role(adc_role_t role) {
+    for (int i = 0; i < ADC_MANAGER_MAX_INPUTS; i++) {
+        if (g_adc.config.inputs[i].role == role) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool adc_manager_get_role_value(adc_role_t role, float* value) {
+    if (value == NULL || !g_adc.initialized) {
+        return false;
+    }
+
+    bool found = false;
+    float sum = 0.0f;
+
+    for (uint8_t i = 0; i < ADC_MANAGER_MAX_INPUTS; i++) {
+        adc_manager_sample_t sample;
+
+        if (g_adc.config.inputs[i].role == role && adc_manager_get_latest(i, &sample)) {
+            sum += sample.value;
+            found = true;
+        }
+    }
+
+    if (found) {
+        *value = sum;
+    }
+
+    return found;
+}
+
+static void handle_adc_status(void) {
+    adc_manager_stats_t stats;
+    adc_manager_get_stats(&stats);
+
+    printf("ADC: %s, %lu Hz per input, %u inputs, DMA %u/%u\n\r",
+        g_adc.running ? "running" : "stopped", g_adc.config.sample_rate_hz, g_adc.input_count,
+        g_adc.dma_channels[0], g_adc.dma_channels[1]);
+    printf("Buffers: %lu, FIFO overflows: %lu, ISR last %lu us max %lu us\n\r",
+        stats.buffers, stats.fifo_overflows, stats.last_isr_us, stats.max_isr_us);
+
+    printf("In  Role     Decim  Rate(Hz)  Gain      Offset    Samples   Latest\n\r");
+    for (uint8_t i = 0; i < ADC_MANAGER_MAX_INPUTS; i++) {
+        const adc_manager_input_config_t* input = &g_adc.config.inputs[i];
+        adc_manager_sample_t sample;
+
+        if (input->role == ADC_ROLE_NONE) {
+            continue;
+        }
+
+        printf("%-3u %-8s %-6u %-9.1f %-9.4f %-9.4f %-9lu ", i, adc_role_to_string(input->role), input->decimation,
+            (double) g_adc.config.sample_rate_hz / (double) input->decimation,
+            (double) input->gain, (double) input->offset, stats.samples[i]);
+
+        if (adc_manager_get_latest(i, &sample)) {
+            printf("%.4f\n\r", (double) sample.value);
+        }
+        else {
+            printf("-\n\r");
+        }
+    }
+}
+
+static int handle_adc_show(uint8_t input, uint32_t n) {
+    adc_manager_sample_t samples[16];
+    uint32_t cursor = g_adc.inputs[input].head - n;
+
+    if (n > g_adc.inputs[input].head) {
+        cursor = 0;
+    }
+
+    printf("t_us,value\n\r");
+
+    for (;;) {
+        int count = adc_manager_read(input, &cursor, samples, 16, NULL);
+        if (count <= 0) {
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            printf("%lu,%.5f\n\r", samples[i].time_us, (double) samples[i].value);
+        }
+    }
+
+    return 0;
+}
+
+static int handle_adc_input(int argc, char* argv[]) {
+    if (argc < 4) {
+        printf("Usage: adc input <n> <off|raw|battery|current|temp|emg> [decimation] [gain] [offset]\n\r");
+        return 1;
+    }
+
+    int id = atoi(argv[2]);
+    adc_role_t role;
+
+    if (id < 0 || id >= ADC_MANAGER_MAX_INPUTS || !adc_role_from_string(argv[3], &role)) {
+        printf("Invalid input or role\n\r");
+        return 1;
+    }
+
+    adc_manager_config_t config;
+    adc_manager_get_config(&config);
+
+    adc_manager_input_config_t* input = &config.inputs[id];
+    input->role = role;
+    if (argc > 4) {
+        input->decimation = (uint16_t) atoi(argv[4]);
+    }
+    if (argc > 5) {
+        input->gain = strtof(argv[5], NULL);
+    }
+    if (argc > 6) {
+        input->offset = strtof(argv[6], NULL);
+    }
+
+    if (!adc_manager_reconfigure(&config)) {
+        printf("Configuration rejected\n\r");
+        return 1;
+    }
+
+    return 0;
+}
+
+int cmd_adc(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: adc <status|show|input|rate|start|stop>\n\r");
+        printf("  adc show <n> [count]\n\r");
+        printf("  adc input <n> <off|raw|battery|current|temp|emg> [decimation] [gain] [offset]\n\r");
+        printf("  adc rate <hz>\n\r");
+        return 1;
+    }
+
+    if (!g_adc.initialized) {
+        printf("ADC manager not initialized\n\r");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "status") == 0) {
+        handle_adc_status();
+    }
+    else if (strcmp(argv[1], "show") == 0) {
+        if (argc < 3 || atoi(argv[2]) < 0 || atoi(argv[2]) >= ADC_MANAGER_MAX_INPUTS) {
+            printf("Usage: adc show <n> [count]\n\r");
+            return 1;
+        }
+
+        uint32_t n = (argc > 3) ? (uint32_t) strtoul(argv[3], NULL, 10) : 16;
+        return handle_adc_show((uint8_t) atoi(argv[2]), n);
+    }
+    else if (strcmp(argv[1], "input") == 0) {
+        return handle_adc_input(argc, argv);
+    }
+    else if (strcmp(argv[1], "rate") == 0) {
+        if (argc < 3) {
+            printf("Usage: adc rate <hz>\n\r");
+            return 1;
+        }
+
+        adc_manager_config_t config;
+        adc_manager_get_config(&config);
+        config.sample_rate_hz = (uint32_t) strtoul(argv[2], NULL, 10);
+
+        if (!adc_manager_reconfigure(&config)) {
+            printf("Configuration rejected\n\r");
+            return 1;
+        }
+    }
+    else if (strcmp(argv[1], "start") == 0) {
+        if (!adc_manager_reconfigure(&g_adc.config)) {
+            printf("Failed to start\n\r");
+            return 1;
+        }
+    }
+    else if (strcmp(argv[1], "stop") == 0) {
+        adc_manager_stop();
+    }
+    else {
+        printf("Unknown adc command: %s\n\r", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
+
+void register_adc_manager_commands(void) {
+    static const shell_command_t adc_command = {
+        cmd_adc,
+        "adc",
+        "ADC streaming (status|show|input|rate|start|stop)"
+    };
+
+    shell_register_command(&adc_command);
+}
@@ -0,0 +1,988 @@
+/**
+* @file blackbox_manager.c
+* @brief Black-box recorder implementation
+* @date 2025-05-27
+*/
+
+#include "blackbox_manager.h"
+
+#include "log_manager.h"
+#include "scheduler.h"
+#include "spinlock_manager.h"
+#include "ts_codec.h"
+#include "usb_shell.h"
+
+#include "hardware/flash.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "pico/flash.h"
+#include "pico/stdlib.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLACKBOX_RING_MASK          (BLACKBOX_RING_SAMPLES - 1)
+#define BLACKBOX_HEADER_MAGIC       0x32424B42u  // "BKB2"
+#define BLACKBOX_KIND_SHIFT         6            // Stream channel is kind << 6 | channel
+#define BLACKBOX_CHANNELS           (1 << BLACKBOX_KIND_SHIFT)
+#define BLACKBOX_FLASH_TIMEOUT_MS   10
+#define BLACKBOX_PAGES_PER_RUN      4            // Pages programmed per task run
+#define BLACKBOX_DATA_CAPACITY      (BLACKBOX_SLOT_SIZE - FLASH_PAGE_SIZE)
+#define BLACKBOX_BENCH_SAMPLES      1024         // Newest samples compressed by blackbox bench
+#define BLACKBOX_SELFTEST_WRITE_MS  2000         // Allowed for erase and program after the post window
+
+/**
+ * @brief Sample as held in the RAM ring
+ */
+typedef struct {
+    uint32_t time_us;                           // time_us_32() when recorded
+    uint8_t kind;                               // blackbox_sample_kind_t
+    uint8_t channel;                            // Sensor type or servo ID
+    uint16_t reserved;
+    float values[BLACKBOX_SAMPLE_VALUES];       // Raw values
+} blackbox_entry_t;
+
+/**
+ * @brief Capture header, programmed into the first page of a slot last
+ */
+typedef struct {
+    uint32_t magic;                             // BLACKBOX_HEADER_MAGIC
+    uint32_t capture_id;                        // Increasing capture number
+    uint32_t reason;                            // blackbox_trigger_t
+    uint32_t trigger_ms;                        // Milliseconds since boot at the trigger
+    uint32_t trigger_us;                        // time_us_32() at the trigger
+    uint32_t first_us;                          // Time of the first sample
+    uint32_t last_us;                           // Time of the last sample
+    uint32_t sample_count;                      // Samples encoded
+    uint32_t pre_samples;                       // Samples before the trigger
+    uint32_t data_len;                          // ts_codec stream bytes after the header page
+} blackbox_flash_header_t;
+
+/**
+ * @brief Flash writer phase
+ */
+typedef enum {
+    BLACKBOX_WRITE_IDLE = 0,                    // No capture being written
+    BLACKBOX_WRITE_ERASE,                       // Erasing the slot one sector per run
+    BLACKBOX_WRITE_DATA,                        // Encoding and programming samples
+    BLACKBOX_WRITE_HEADER                       // Programming the header page
+} blackbox_write_phase_t;
+
+/**
+ * @brief Flash operation run with the other core locked out
+ */
+typedef struct {
+    uint32_t offset;                            // Flash offset
+    const uint8_t* data;                        // Page to program, NULL to erase a sector
+} blackbox_flash_op_t;
+
+/**
+ * @brief Recorder state
+ */
+typedef struct {
+    blackbox_manager_config_t config;           // Configuration
+    volatile blackbox_state_t state;            // Recorder state
+    uint32_t lock_num;                          // Spinlock for the ring and capture
+    int task_id;                                // Recorder task
+
+    blackbox_entry_t ring[BLACKBOX_RING_SAMPLES]; // Sample ring
+    uint32_t head;                              // Samples recorded since init
+    uint32_t pre_max_samples;                   // Ring share kept for the pre-trigger window
+
+    blackbox_trigger_t reason;                  // Trigger of the capture in progress
+    uint32_t trigger_ms;                        // Milliseconds since boot at the trigger
+    uint32_t trigger_us;                        // time_us_32() at the trigger
+    uint32_t capture_start;                     // First sample of the capture
+    uint32_t capture_trigger;                   // First sample after the trigger
+    uint32_t capture_end;                       // One past the last sample
+
+    blackbox_write_phase_t phase;               // Flash writer phase
+    uint32_t slot;                              // Slot being written
+    uint32_t write_sector;                      // Next sector to erase
+    uint32_t write_offset;                      // Next page to program
+    uint32_t write_index;                       // Next sample to encode
+    uint32_t data_len;                          // Bytes encoded
+    uint32_t last_us;                           // Time of the last sample encoded
+    uint32_t next_capture_id;                   // ID of the next capture
+    ts_codec_encoder_t encoder;                 // Stream encoder
+    uint8_t page[FLASH_PAGE_SIZE];              // Page buffer
+    uint32_t page_fill;                         // Bytes in the page buffer
+
+    uint32_t captures_written;                  // Captures stored since boot
+    uint32_t write_errors;                      // Failed flash operations
+} blackbox_manager_state_t;
+
+static blackbox_manager_state_t g_blackbox = {
+    .state = BLACKBOX_STATE_DISABLED,
+    .lock_num = UINT_MAX,
+    .task_id = -1
+};
+
+static void blackbox_abort_write(const char* what);
+static int blackbox_append(const uint8_t* data, uint32_t len);
+static void blackbox_codec_config(ts_codec_config_t* config, bool lossless);
+static void blackbox_entry_to_sample(const blackbox_entry_t* entry, ts_codec_sample_t* sample);
+static bool blackbox_flash_run(uint32_t offset, const uint8_t* data);
+static void blackbox_gpio_irq(void);
+static bool blackbox_post_window_done(uint32_t now_us);
+static bool blackbox_program_page(void);
+static const blackbox_flash_header_t* blackbox_read_header(uint32_t slot);
+static void blackbox_record(uint8_t kind, uint8_t channel, const float* values, int count);
+static const char* blackbox_state_to_string(blackbox_state_t state);
+static const char* blackbox_trigger_to_string(blackbox_trigger_t reason);
+static void blackbox_write_begin(void);
+static void blackbox_write_data(void);
+static void blackbox_write_header(void);
+
+int blackbox_manager_decode(uint32_t slot, blackbox_sample_callback_t callback, void* user_data) {
+    const blackbox_flash_header_t* header = blackbox_read_header(slot);
+    if (header == NULL) {
+        return -1;
+    }
+
+    // Too large for a task stack
+    static ts_codec_decoder_t decoder;
+
+    if (!ts_codec_decoder_init(&decoder, (const uint8_t*) header + FLASH_PAGE_SIZE, header->data_len)) {
+        return -1;
+    }
+
+    int count = 0;
+    ts_codec_sample_t encoded;
+
+    while ((uint32_t) count < header->sample_count && ts_codec_decode(&decoder, &encoded)) {
+        blackbox_sample_t sample;
+
+        sample.time_us = encoded.time_us;
+        sample.kind = (blackbox_sample_kind_t) (encoded.channel >> BLACKBOX_KIND_SHIFT);
+        sample.channel = encoded.channel & (BLACKBOX_CHANNELS - 1);
+        memcpy(sample.values, encoded.values, sizeof(sample.values));
+
+        count++;
+
+        if (callback != NULL && !callback(&sample, user_data)) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+bool blackbox_manager_get_capture(uint32_t slot, blackbox_capture_info_t* info, const uint8_t** data) {
+    const blackbox_flash_header_t* header = blackbox_read_header(slot);
+    if (header == NULL) {
+        return false;
+    }
+
+    if (info != NULL) {
+        info->capture_id = header->capture_id;
+        info->reason = (blackbox_trigger_t) header->reason;
+        info->trigger_ms = header->trigger_ms;
+        info->sample_count = header->sample_count;
+        info->pre_samples = header->pre_samples;
+        info->duration_us = header->last_us - header->first_us;
+        info->data_len = header->data_len;
+    }
+
+    if (data != NULL) {
+        *data = (const uint8_t*) header + FLASH_PAGE_SIZE;
+    }
+
+    return true;
+}
+
+void blackbox_manager_get_default_config(blackbox_manager_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+
+    config->pre_trigger_ms = 2000;
+    config->post_trigger_ms = 1000;
+    config->trigger_gpio = -1;
+    config->sensor_scale = 1000.0f;
+    config->servo_scale = 100.0f;
+}
+
+blackbox_state_t blackbox_manager_get_state(void) {
+    return g_blackbox.state;
+}
+
+bool blackbox_manager_init(const blackbox_manager_config_t* config) {
+    if (g_blackbox.state != BLACKBOX_STATE_DISABLED) {
+        return true;
+    }
+
+    if (config != NULL) {
+        g_blackbox.config = *config;
+    } else {
+        blackbox_manager_get_default_config(&g_blackbox.config);
+    }
+
+    blackbox_manager_config_t* cfg = &g_blackbox.config;
+    if ((cfg->pre_trigger_ms + cfg->post_trigger_ms) == 0 || !(cfg->sensor_scale >= 0.0f) || !(cfg->servo_scale >= 0.0f)) {
+        log_message(LOG_LEVEL_ERROR, "Blackbox", "Invalid configuration.");
+        return false;
+    }
+
+    g_blackbox.lock_num = hw_spinlock_allocate(SPINLOCK_CAT_DEBUG, "blackbox_manager");
+    if (g_blackbox.lock_num == UINT_MAX) {
+        log_message(LOG_LEVEL_ERROR, "Blackbox", "Failed to claim spinlock.");
+        return false;
+    }
+
+    // Leave room in the ring for the post-trigger window
+    g_blackbox.pre_max_samples = (uint32_t) (((uint64_t) BLACKBOX_RING_SAMPLES * cfg->pre_trigger_ms) /
+        (cfg->pre_trigger_ms + cfg->post_trigger_ms));
+
+    // Continue capture numbering from what is already stored
+    g_blackbox.next_capture_id = 1;
+    for (uint32_t slot = 0; slot < BLACKBOX_SLOTS; slot++) {
+        const blackbox_flash_header_t* header = blackbox_read_header(slot);
+        if (header != NULL && header->capture_id >= g_blackbox.next_capture_id) {
+            g_blackbox.next_capture_id = header->capture_id + 1;
+        }
+    }
+
+    g_blackbox.task_id = scheduler_create_task(
+        blackbox_manager_task,  // Task function
+        NULL,                   // No parameters
+        2048,                   // Stack size
+        TASK_PRIORITY_HIGH,     // Peer of the core 0 tasks, lower levels are never reached
+        "blackbox",             // Task name
+        0,                      // Core 0
+        TASK_TYPE_PERSISTENT    // Always running
+    );
+
+    if (g_blackbox.task_id < 0) {
+        log_message(LOG_LEVEL_ERROR, "Blackbox", "Failed to create recorder task.");
+        return false;
+    }
+
+    // Flash writes are background work, shed while degraded and resumed on restore
+    scheduler_set_criticality(g_blackbox.task_id, TASK_CRITICALITY_LOW);
+
+    if (cfg->trigger_gpio >= 0) {
+        uint pin = (uint) cfg->trigger_gpio;
+        gpio_init(pin);
+        gpio_set_dir(pin, GPIO_IN);
+        gpio_pull_up(pin);
+        gpio_add_raw_irq_handler(pin, blackbox_gpio_irq);
+        gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_FALL, true);
+        irq_set_enabled(IO_IRQ_BANK0, true);
+    }
+
+    g_blackbox.state = BLACKBOX_STATE_ARMED;
+
+    log_message(LOG_LEVEL_INFO, "Blackbox", "Armed with %lu ms pre-trigger and %lu ms post-trigger windows.",
+        cfg->pre_trigger_ms, cfg->post_trigger_ms);
+    return true;
+}
+
+void blackbox_manager_mpu_fault(uint32_t task_id, void* fault_addr, uint32_t fault_type) {
+    (void) task_id;
+    (void) fault_addr;
+    (void) fault_type;
+
+    blackbox_manager_trigger(BLACKBOX_TRIGGER_FAULT);
+}
+
+void blackbox_manager_record_sensor(sensor_type_t type, const sensor_data_t* data) {
+    if (data == NULL) {
+        return;
+    }
+
+    float values[BLACKBOX_SAMPLE_VALUES] = {data->xyz.x, data->xyz.y, data->xyz.z};
+    blackbox_record(BLACKBOX_SAMPLE_SENSOR, (uint8_t) type, values, BLACKBOX_SAMPLE_VALUES);
+}
+
+void blackbox_manager_record_servo(uint32_t id, float position) {
+    blackbox_record(BLACKBOX_SAMPLE_SERVO, (uint8_t) id, &position, 1);
+}
+
+bool blackbox_manager_trigger(blackbox_trigger_t reason) {
+    if (g_blackbox.state != BLACKBOX_STATE_ARMED) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_blackbox.lock_num, scheduler_get_current_task());
+
+    if (g_blackbox.state != BLACKBOX_STATE_ARMED) {
+        hw_spinlock_release(g_blackbox.lock_num, save);
+        return false;
+    }
+
+    uint32_t now_us = time_us_32();
+    uint32_t pre_us = g_blackbox.config.pre_trigger_ms * 1000;
+    uint32_t head = g_blackbox.head;
+
+    uint32_t available = (head < g_blackbox.pre_max_samples) ? head : g_blackbox.pre_max_samples;
+
+    // Samples are time ordered, find the oldest one inside the pre-trigger window
+    uint32_t lo = 0;
+    uint32_t hi = available;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) / 2);
+        const blackbox_entry_t* entry = &g_blackbox.ring[(head - available + mid) & BLACKBOX_RING_MASK];
+
+        if ((now_us - entry->time_us) <= pre_us) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+
+    g_blackbox.reason = reason;
+    g_blackbox.trigger_us = now_us;
+    g_blackbox.trigger_ms = to_ms_since_boot(get_absolute_time());
+    g_blackbox.capture_start = head - available + lo;
+    g_blackbox.capture_trigger = head;
+    g_blackbox.state = BLACKBOX_STATE_TRIGGERED;
+
+    hw_spinlock_release(g_blackbox.lock_num, save);
+    return true;
+}
+
+void blackbox_manager_task(void* params) {
+    (void) params;
+
+    switch (g_blackbox.state) {
+        case BLACKBOX_STATE_TRIGGERED: {
+            // Close the capture even if no samples arrive
+            uint32_t save = hw_spinlock_acquire(g_blackbox.lock_num, scheduler_get_current_task());
+            if (g_blackbox.state == BLACKBOX_STATE_TRIGGERED && blackbox_post_window_done(time_us_32())) {
+                g_blackbox.capture_end = g_blackbox.head;
+                g_blackbox.state = BLACKBOX_STATE_WRITING;
+            }
+            hw_spinlock_release(g_blackbox.lock_num, save);
+            break;
+        }
+
+        case BLACKBOX_STATE_WRITING:
+            switch (g_blackbox.phase) {
+                case BLACKBOX_WRITE_IDLE:   blackbox_write_begin();  break;
+                case BLACKBOX_WRITE_ERASE:
+                case BLACKBOX_WRITE_DATA:   blackbox_write_data();   break;
+                case BLACKBOX_WRITE_HEADER: blackbox_write_header(); break;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Abandon the capture being written and re-arm
+ *
+ * @param what Operation that failed
+ */
+static void blackbox_abort_write(const char* what) {
+    g_blackbox.write_errors++;
+    g_blackbox.phase = BLACKBOX_WRITE_IDLE;
+    g_blackbox.state = BLACKBOX_STATE_ARMED;
+
+    log_message(LOG_LEVEL_ERROR, "Blackbox", "Capture %lu lost, flash %s failed in slot %lu.",
+        g_blackbox.next_capture_id, what, g_blackbox.slot);
+}
+
+/**
+ * @brief Append encoded bytes to the page buffer, programming full pages
+ *
+ * @param data Bytes to append, at most FLASH_PAGE_SIZE
+ * @param len Number of bytes
+ * @return Pages programmed (0 or 1), or -1 if programming failed
+ */
+static int blackbox_append(const uint8_t* data, uint32_t len) {
+    uint32_t first = FLASH_PAGE_SIZE - g_blackbox.page_fill;
+    if (first > len) {
+        first = len;
+    }
+
+    memcpy(&g_blackbox.page[g_blackbox.page_fill], data, first);
+    g_blackbox.page_fill += first;
+    g_blackbox.data_len += len;
+
+    if (g_blackbox.page_fill < FLASH_PAGE_SIZE) {
+        return 0;
+    }
+
+    if (!blackbox_program_page()) {
+        return -1;
+    }
+
+    memcpy(g_blackbox.page, &data[first], len - first);
+    g_blackbox.page_fill = len - first;
+    return 1;
+}
+
+/**
+ * @brief Stream configuration for the recorder
+ *
+ * Sensor and servo channels get their own quantization scale through the
+ * kind bit above the 6 bit channel number.
+ *
+ * @param config Configuration to fill
+ * @param lossless Use lossless coding instead of the configured scales
+ */
+static void blackbox_codec_config(ts_codec_config_t* config, bool lossless) {
+    memset(config, 0, sizeof(ts_codec_config_t));
+    config->channel_bits = BLACKBOX_KIND_SHIFT + 1;
+    config->scale_shift = BLACKBOX_KIND_SHIFT;
+    config->scale_count = 2;
+
+    if (!lossless) {
+        config->scales[BLACKBOX_SAMPLE_SENSOR] = g_blackbox.config.sensor_scale;
+        config->scales[BLACKBOX_SAMPLE_SERVO] = g_blackbox.config.servo_scale;
+    }
+}
+
+/**
+ * @brief Convert a ring entry for the encoder
+ */
+static void blackbox_entry_to_sample(const blackbox_entry_t* entry, ts_codec_sample_t* sample) {
+    sample->time_us = entry->time_us;
+    sample->channel = (uint8_t) ((entry->kind << BLACKBOX_KIND_SHIFT) | entry->channel);
+    sample->count = (entry->kind == BLACKBOX_SAMPLE_SERVO) ? 1 : BLACKBOX_SAMPLE_VALUES;
+    memcpy(sample->values, entry->values, sizeof(entry->values));
+}
+
+/**
+ * @brief Erase or program flash with the other core locked out
+ */
+static void __not_in_flash_func(blackbox_flash_execute)(void* param) {
+    const blackbox_flash_op_t* op = (const blackbox_flash_op_t*) param;
+
+    if (op->data == NULL) {
+        flash_range_erase(op->offset, FLASH_SECTOR_SIZE);
+    } else {
+        flash_range_program(op->offset, op->data, FLASH_PAGE_SIZE);
+    }
+}
+
+/**
+ * @brief Run one flash operation
+ *
+ * @param offset Flash offset
+ * @param data Page to program, NULL to erase the sector at offset
+ * @return true if successful
+ */
+static bool blackbox_flash_run(uint32_t offset, const uint8_t* data) {
+    blackbox_flash_op_t op = {
+        .offset = offset,
+        .data = data
+    };
+
+    return flash_safe_execute(blackbox_flash_execute, &op, BLACKBOX_FLASH_TIMEOUT_MS) == PICO_OK;
+}
+
+/**
+ * @brief Trigger GPIO falling edge handler
+ */
+static void blackbox_gpio_irq(void) {
+    uint pin = (uint) g_blackbox.config.trigger_gpio;
+
+    if (gpio_get_irq_event_mask(pin) & GPIO_IRQ_EDGE_FALL) {
+        gpio_acknowledge_irq(pin, GPIO_IRQ_EDGE_FALL);
+        blackbox_manager_trigger(BLACKBOX_TRIGGER_GPIO);
+    }
+}
+
+/**
+ * @brief Check whether the post-trigger window is over, lock held
+ *
+ * The window also ends early when the ring would overwrite the start of
+ * the capture.
+ */
+static bool blackbox_post_window_done(uint32_t now_us) {
+    return (now_us - g_blackbox.trigger_us) >= (g_blackbox.config.post_trigger_ms * 1000) ||
+        (g_blackbox.head - g_blackbox.capture_start) >= BLACKBOX_RING_SAMPLES;
+}
+
+/**
+ * @brief Program the page buffer at the write offset and advance
+ *
+ * @return true if successful
+ */
+static bool blackbox_program_page(void) {
+    memset(&g_blackbox.page[g_blackbox.page_fill], 0xFF, FLASH_PAGE_SIZE - g_blackbox.page_fill);
+
+    if (!blackbox_flash_run(g_blackbox.write_offset, g_blackbox.page)) {
+        return false;
+    }
+
+    g_blackbox.write_offset += FLASH_PAGE_SIZE;
+    g_blackbox.page_fill = 0;
+    return true;
+}
+
+/**
+ * @brief Get the header of a stored capture
+ *
+ * @param slot Capture slot
+ * @return Header in flash, NULL if the slot holds no valid capture
+ */
+static const blackbox_flash_header_t* blackbox_read_header(uint32_t slot) {
+    if (slot >= BLACKBOX_SLOTS) {
+        return NULL;
+    }
+
+    const blackbox_flash_header_t* header = (const blackbox_flash_header_t*) (XIP_BASE +
+        BLACKBOX_FLASH_OFFSET + (slot * BLACKBOX_SLOT_SIZE));
+
+    if (header->magic != BLACKBOX_HEADER_MAGIC || header->data_len > BLACKBOX_DATA_CAPACITY) {
+        return NULL;
+    }
+
+    return header;
+}
+
+/**
+ * @brief Append a sample to the ring
+ *
+ * @param kind Sample kind
+ * @param channel Sensor type or servo ID
+ * @param values Values to record
+ * @param count Number of values
+ */
+static void blackbox_record(uint8_t kind, uint8_t channel, const float* values, int count) {
+    blackbox_state_t state = g_blackbox.state;
+    if (state != BLACKBOX_STATE_ARMED && state != BLACKBOX_STATE_TRIGGERED) {
+        return;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_blackbox.lock_num, scheduler_get_current_task());
+
+    // Timestamp under the lock so the ring stays time ordered across cores
+    uint32_t now_us = time_us_32();
+
+    if (g_blackbox.state == BLACKBOX_STATE_TRIGGERED && blackbox_post_window_done(now_us)) {
+        g_blackbox.capture_end = g_blackbox.head;
+        g_blackbox.state = BLACKBOX_STATE_WRITING;
+    }
+
+    if (g_blackbox.state == BLACKBOX_STATE_ARMED || g_blackbox.state == BLACKBOX_STATE_TRIGGERED) {
+        blackbox_entry_t* entry = &g_blackbox.ring[g_blackbox.head & BLACKBOX_RING_MASK];
+        entry->time_us = now_us;
+        entry->kind = kind;
+        entry->channel = channel & (BLACKBOX_CHANNELS - 1);
+
+        for (int i = 0; i < BLACKBOX_SAMPLE_VALUES; i++) {
+            entry->values[i] = (i < count) ? values[i] : 0.0f;
+        }
+
+        g_blackbox.head++;
+    }
+
+    hw_spinlock_release(g_blackbox.lock_num, save);
+}
+
+static const char* blackbox_state_to_string(blackbox_state_t state) {
+    switch (state) {
+        case BLACKBOX_STATE_DISABLED:  return "disabled";
+        case BLACKBOX_STATE_ARMED:     return "armed";
+        case BLACKBOX_STATE_TRIGGERED: return "triggered";
+        case BLACKBOX_STATE_WRITING:   return "writing";
+        default:                       return "unknown";
+    }
+}
+
+static const char* blackbox_trigger_to_string(blackbox_trigger_t reason) {
+    switch (reason) {
+        case BLACKBOX_TRIGGER_SHELL:    return "shell";
+        case BLACKBOX_TRIGGER_GPIO:     return "gpio";
+        case BLACKBOX_TRIGGER_STALL:    return "stall";
+        case BLACKBOX_TRIGGER_DEADLINE: return "deadline";
+        case BLACKBOX_TRIGGER_FAULT:    return "fault";
+        case BLACKBOX_TRIGGER_USER:     return "user";
+        default:                        return "unknown";
+    }
+}
+
+/**
+ * @brief Pick a slot for the frozen capture and start erasing it
+ *
+ * An empty slot is used first, otherwise the oldest capture is replaced.
+ */
+static void blackbox_write_begin(void) {
+    uint32_t slot = 0;
+    uint32_t oldest_id = UINT32_MAX;
+
+    for (uint32_t i = 0; i < BLACKBOX_SLOTS; i++) {
+        const blackbox_flash_header_t* header = blackbox_read_header(i);
+        if (header == NULL) {
+            slot = i;
+            break;
+        }
+
+        if (header->capture_id < oldest_id) {
+            oldest_id = header->capture_id;
+            slot = i;
+        }
+    }
+
+    g_blackbox.slot = slot;
+    g_blackbox.write_sector = 0;
+    g_blackbox.phase = BLACKBOX_WRITE_ERASE;
+
+    log_message(LOG_LEVEL_WARN, "Blackbox", "Capture %lu triggered by %s, writing %lu samples to slot %lu.",
+        g_blackbox.next_capture_id, blackbox_trigger_to_string(g_blackbox.reason),
+        g_blackbox.capture_end - g_blackbox.capture_start, slot);
+}
+
+/**
+ * @brief Erase one sector, or encode samples and program a few pages
+ *
+ * The ring is frozen while writing, so samples are read without the lock.
+ * Samples that do not fit in the slot are dropped from the end.
+ */
+static void blackbox_write_data(void) {
+    uint32_t slot_offset = BLACKBOX_FLASH_OFFSET + (g_blackbox.slot * BLACKBOX_SLOT_SIZE);
+
+    if (g_blackbox.phase == BLACKBOX_WRITE_ERASE) {
+        if (!blackbox_flash_run(slot_offset + (g_blackbox.write_sector * FLASH_SECTOR_SIZE), NULL)) {
+            blackbox_abort_write("erase");
+            return;
+        }
+
+        if (++g_blackbox.write_sector < (BLACKBOX_SLOT_SIZE / FLASH_SECTOR_SIZE)) {
+            return;
+        }
+
+        ts_codec_config_t config;
+        blackbox_codec_config(&config, false);
+
+        g_blackbox.write_offset = slot_offset + FLASH_PAGE_SIZE;
+        g_blackbox.write_index = g_blackbox.capture_start;
+        g_blackbox.page_fill = ts_codec_encoder_init(&g_blackbox.encoder, &config, g_blackbox.page);
+        g_blackbox.data_len = g_blackbox.page_fill;
+        g_blackbox.phase = BLACKBOX_WRITE_DATA;
+        return;
+    }
+
+    for (int pages = 0; pages < BLACKBOX_PAGES_PER_RUN; ) {
+        uint8_t encoded[TS_CODEC_MAX_SAMPLE_BYTES];
+        int programmed;
+
+        // Stop at the end of the capture or when a worst case sample might not fit
+        if (g_blackbox.write_index == g_blackbox.capture_end ||
+            (g_blackbox.data_len + TS_CODEC_MAX_SAMPLE_BYTES + 1) > BLACKBOX_DATA_CAPACITY) {
+            g_blackbox.capture_end = g_blackbox.write_index;
+
+            uint32_t len = (uint32_t) ts_codec_finish(&g_blackbox.encoder, encoded);
+            if (blackbox_append(encoded, len) < 0 ||
+                (g_blackbox.page_fill > 0 && !blackbox_program_page())) {
+                blackbox_abort_write("program");
+                return;
+            }
+
+            g_blackbox.phase = BLACKBOX_WRITE_HEADER;
+            return;
+        }
+
+        ts_codec_sample_t sample;
+        blackbox_entry_to_sample(&g_blackbox.ring[g_blackbox.write_index & BLACKBOX_RING_MASK], &sample);
+
+        uint32_t len = (uint32_t) ts_codec_encode(&g_blackbox.encoder, &sample, encoded);
+        g_blackbox.last_us = sample.time_us;
+        g_blackbox.write_index++;
+
+        programmed = blackbox_append(encoded, len);
+        if (programmed < 0) {
+            blackbox_abort_write("program");
+            return;
+        }
+        pages += programmed;
+    }
+}
+
+/**
+ * @brief Program the header, which makes the capture valid, and re-arm
+ */
+static void blackbox_write_header(void) {
+    uint32_t slot_offset = BLACKBOX_FLASH_OFFSET + (g_blackbox.slot * BLACKBOX_SLOT_SIZE);
+    uint32_t count = g_blackbox.capture_end - g_blackbox.capture_start;
+
+    blackbox_flash_header_t header = {
+        .magic = BLACKBOX_HEADER_MAGIC,
+        .capture_id = g_blackbox.next_capture_id,
+        .reason = (uint32_t) g_blackbox.reason,
+        .trigger_ms = g_blackbox.trigger_ms,
+        .trigger_us = g_blackbox.trigger_us,
+        .first_us = g_blackbox.ring[g_blackbox.capture_start & BLACKBOX_RING_MASK].time_us,
+        .last_us = g_blackbox.last_us,
+        .sample_count = count,
+        .pre_samples = g_blackbox.capture_trigger - g_blackbox.capture_start,
+        .data_len = g_blackbox.data_len
+    };
+
+    if (header.pre_samples > count) {
+        header.pre_samples = count;
+    }
+
+    memcpy(g_blackbox.page, &header, sizeof(header));
+    g_blackbox.page_fill = sizeof(header);
+    g_blackbox.write_offset = slot_offset;
+
+    if (!blackbox_program_page()) {
+        blackbox_abort_write("header");
+        return;
+    }
+
+    g_blackbox.captures_written++;
+    g_blackbox.next_capture_id++;
+    g_blackbox.phase = BLACKBOX_WRITE_IDLE;
+    g_blackbox.state = BLACKBOX_STATE_ARMED;
+
+    log_message(LOG_LEVEL_INFO, "Blackbox", "Capture %lu stored in slot %lu, %lu samples in %lu bytes.",
+        header.capture_id, g_blackbox.slot, count, header.data_len);
+}
+
+/**
+ * @brief State for printing decoded samples
+ */
+typedef struct {
+    uint32_t trigger_us;                        // Times are printed relative to this
+    uint32_t remaining;                         // Samples left to print
+} blackbox_show_ctx_t;
+
+/**
+ * @brief Print a decoded sample as a CSV line
+ */
+static bool blackbox_show_sample(const blackbox_sample_t* sample, void* user_data) {
+    blackbox_show_ctx_t* ctx = (blackbox_show_ctx_t*) user_data;
+
+    int32_t t_us = (int32_t) (sample->time_us - ctx->trigger_us);
+
+    if (sample->kind == BLACKBOX_SAMPLE_SERVO) {
+        printf("%ld,servo,%u,%.2f\n\r", t_us, sample->channel, sample->values[0]);
+    } else {
+        printf("%ld,sensor,%u,%.3f,%.3f,%.3f\n\r", t_us, sample->channel,
+            sample->values[0], sample->values[1], sample->values[2]);
+    }
+
+    return --ctx->remaining > 0;
+}
+
+static int handle_blackbox_dump(uint32_t slot) {
+    const blackbox_flash_header_t* header = blackbox_read_header(slot);
+    if (header == NULL) {
+        printf("Slot %lu holds no capture\n\r", slot);
+        return 1;
+    }
+
+    // Header page followed by the ts_codec stream, 32 bytes per line
+    const uint8_t* data = (const uint8_t*) header;
+    uint32_t total = FLASH_PAGE_SIZE + header->data_len;
+
+    printf("# blackbox capture %lu stream=%u count=%lu\n\r", header->capture_id, FLASH_PAGE_SIZE, header->sample_count);
+
+    for (uint32_t offset = 0; offset < total; offset += 32) {
+        printf("%06lx:", offset);
+
+        for (uint32_t i = offset; i < offset + 32 && i < total; i++) {
+            printf("%02x", data[i]);
+        }
+
+        printf("\n\r");
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Compress the newest ring samples and report ratio and cost
+ *
+ * Half the ring is left as slack so recording can continue while the
+ * older samples are read without the lock.
+ */
+static void handle_blackbox_bench(void) {
+    // Too large for a task stack
+    static ts_codec_encoder_t encoder;
+
+    uint32_t head = g_blackbox.head;
+    uint32_t count = (head < BLACKBOX_BENCH_SAMPLES) ? head : BLACKBOX_BENCH_SAMPLES;
+
+    if (count == 0) {
+        printf("No samples recorded\n\r");
+        return;
+    }
+
+    printf("Mode      | Samples | Raw (B) | Packed (B) | Ratio | us/sample\n\r");
+    printf("----------+---------+---------+------------+-------+----------\n\r");
+
+    for (int lossless = 0; lossless < 2; lossless++) {
+        ts_codec_config_t config;
+        uint8_t out[TS_CODEC_MAX_HEADER_BYTES];
+        uint32_t raw = 0;
+
+        blackbox_codec_config(&config, lossless != 0);
+
+        uint32_t start_us = time_us_32();
+        uint32_t packed = (uint32_t) ts_codec_encoder_init(&encoder, &config, out);
+
+        for (uint32_t i = head - count; i != head; i++) {
+            ts_codec_sample_t sample;
+            blackbox_entry_to_sample(&g_blackbox.ring[i & BLACKBOX_RING_MASK], &sample);
+
+            packed += (uint32_t) ts_codec_encode(&encoder, &sample, out);
+            raw += sizeof(uint32_t) + (sample.count * sizeof(float));
+        }
+
+        packed += (uint32_t) ts_codec_finish(&encoder, out);
+        uint32_t elapsed_us = time_us_32() - start_us;
+
+        printf("%-9s | %7lu | %7lu | %10lu | %5.2f | %9.2f\n\r",
+            lossless ? "lossless" : "quantized", count, raw, packed,
+            (float) raw / (float) packed, (float) elapsed_us / (float) count);
+    }
+}
+
+static void handle_blackbox_list(void) {
+    printf("Slot | ID     | Reason   | Trigger (ms) | Samples | Pre   | Span (ms) | Bytes | Ratio\n\r");
+    printf("-----+--------+----------+--------------+---------+-------+-----------+-------+------\n\r");
+
+    for (uint32_t slot = 0; slot < BLACKBOX_SLOTS; slot++) {
+        blackbox_capture_info_t info;
+        if (!blackbox_manager_get_capture(slot, &info, NULL)) {
+            printf("%4lu | empty\n\r", slot);
+            continue;
+        }
+
+        // Against the raw ring entries
+        float ratio = (info.data_len > 0) ?
+            (float) (info.sample_count * sizeof(blackbox_entry_t)) / (float) info.data_len : 0.0f;
+
+        printf("%4lu | %6lu | %-8s | %12lu | %7lu | %5lu | %9lu | %5lu | %5.1f\n\r",
+            slot, info.capture_id, blackbox_trigger_to_string(info.reason), info.trigger_ms,
+            info.sample_count, info.pre_samples, info.duration_us / 1000, info.data_len, ratio);
+    }
+}
+
+/**
+ * @brief Trigger a capture and dispatch the core 0 tasks until it is written
+ *
+ * Writes one capture to flash like "blackbox trigger" does.
+ */
+static int handle_blackbox_selftest(void) {
+    uint32_t written = g_blackbox.captures_written;
+    uint32_t errors = g_blackbox.write_errors;
+
+    if (!blackbox_manager_trigger(BLACKBOX_TRIGGER_SHELL)) {
+        printf("Recorder is %s, not armed\n\r", blackbox_state_to_string(g_blackbox.state));
+        return 1;
+    }
+
+    uint32_t timeout_ms = g_blackbox.config.post_trigger_ms + BLACKBOX_SELFTEST_WRITE_MS;
+    uint32_t waited_ms = 0;
+
+    while (g_blackbox.state != BLACKBOX_STATE_ARMED && waited_ms < timeout_ms) {
+        scheduler_delay(10);
+        waited_ms += 10;
+    }
+
+    bool ok = (g_blackbox.state == BLACKBOX_STATE_ARMED) &&
+        (g_blackbox.captures_written == written + 1) && (g_blackbox.write_errors == errors);
+
+    printf("Recorder %s after %lu ms, %lu captures written, %lu write errors\n\r",
+        blackbox_state_to_string(g_blackbox.state), waited_ms, g_blackbox.captures_written - written,
+        g_blackbox.write_errors - errors);
+    printf("Blackbox self test %s\n\r", ok ? "passed" : "FAILED");
+
+    return ok ? 0 : 1;
+}
+
+static void handle_blackbox_status(void) {
+    uint32_t head = g_blackbox.head;
+    uint32_t held = (head < BLACKBOX_RING_SAMPLES) ? head : BLACKBOX_RING_SAMPLES;
+
+    printf("State: %s\n\r", blackbox_state_to_string(g_blackbox.state));
+    printf("Windows: %lu ms pre, %lu ms post\n\r",
+        g_blackbox.config.pre_trigger_ms, g_blackbox.config.post_trigger_ms);
+    printf("Samples recorded: %lu (%lu/%d held)\n\r", head, held, BLACKBOX_RING_SAMPLES);
+
+    if (g_blackbox.config.trigger_gpio >= 0) {
+        printf("Trigger GPIO: %d\n\r", g_blackbox.config.trigger_gpio);
+    } else {
+        printf("Trigger GPIO: none\n\r");
+    }
+
+    printf("Captures written: %lu\n\r", g_blackbox.captures_written);
+    printf("Write errors: %lu\n\r", g_blackbox.write_errors);
+}
+
+int cmd_blackbox(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: blackbox <status|trigger|selftest|list|bench|show <slot> [max]|dump <slot>>\n\r");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "status") == 0) {
+        handle_blackbox_status();
+    }
+    else if (strcmp(argv[1], "trigger") == 0) {
+        if (!blackbox_manager_trigger(BLACKBOX_TRIGGER_SHELL)) {
+            printf("Recorder is %s, not armed\n\r", blackbox_state_to_string(g_blackbox.state));
+            return 1;
+        }
+
+        printf("Capture triggered, writing after %lu ms\n\r", g_blackbox.config.post_trigger_ms);
+    }
+    else if (strcmp(argv[1], "selftest") == 0) {
+        return handle_blackbox_selftest();
+    }
+    else if (strcmp(argv[1], "list") == 0) {
+        handle_blackbox_list();
+    }
+    else if (strcmp(argv[1], "bench") == 0) {
+        handle_blackbox_bench();
+    }
+    else if (strcmp(argv[1], "show") == 0 || strcmp(argv[1], "dump") == 0) {
+        if (argc < 3) {
+            printf("Usage: blackbox %s <slot>\n\r", argv[1]);
+            return 1;
+        }
+
+        uint32_t slot = (uint32_t) strtoul(argv[2], NULL, 10);
+
+        if (strcmp(argv[1], "dump") == 0) {
+            return handle_blackbox_dump(slot);
+        }
+
+        const blackbox_flash_header_t* header = blackbox_read_header(slot);
+        if (header == NULL) {
+            printf("Slot %lu holds no capture\n\r", slot);
+            return 1;
+        }
+
+        blackbox_show_ctx_t ctx = {
+            .trigger_us = header->trigger_us,
+            .remaining = (argc > 3) ? (uint32_t) strtoul(argv[3], NULL, 10) : UINT32_MAX
+        };
+
+        if (ctx.remaining == 0) {
+            ctx.remaining = UINT32_MAX;
+        }
+
+        printf("t_us,kind,channel,v0,v1,v2\n\r");
+        int count = blackbox_manager_decode(slot, blackbox_show_sample, &ctx);
+        printf("%d of %lu samples\n\r", count, header->sample_count);
+    }
+    else {
+        printf("Unknown blackbox command: %s\n\r", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
+
+void register_blackbox_manager_commands(void) {
+    static const shell_command_t blackbox_command = {
+        cmd_blackbox,
+        "blackbox",
+        "Sensor and servo black-box recorder (status|trigger|selftest|list|bench|show|dump)"
+    };
+
+    shell_register_command(&blackbox_command);
+}
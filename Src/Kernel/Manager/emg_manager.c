@@ -0,0 +1,498 @@
+/**
+* @file emg_manager.c
+* @brief Myoelectric control implementation
+* @date 2025-05-27
+*/
+
+#include "emg_manager.h"
+
+#include "adc_manager.h"
+#include "log_manager.h"
+#include "scheduler.h"
+#include "servo_manager.h"
+#include "spinlock_manager.h"
+#include "usb_shell.h"
+
+#include "pico/stdlib.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief EMG manager state
+ */
+typedef struct {
+    bool initialized;
+    bool enabled;                                           // Grasp level drives the servos
+    uint32_t lock_num;                                      // Spinlock for the pipeline and mapping
+    int task_id;                                            // Scheduler task
+    emg_manager_config_t config;                            // Configuration
+    emg_pipeline_t pipeline;                                // Signal processing
+
+    uint8_t channels;                                       // EMG channels found
+    uint8_t inputs[EMG_PIPELINE_MAX_CHANNELS];              // ADC input of each channel
+    uint32_t cursors[EMG_PIPELINE_MAX_CHANNELS];            // ADC ring read positions
+    float blocks[EMG_PIPELINE_MAX_CHANNELS][EMG_PIPELINE_BLOCK]; // Samples waiting for a full block
+    uint8_t fill[EMG_PIPELINE_MAX_CHANNELS];                // Samples in each block
+
+    float last_sent;                                        // Grasp level of the last servo update
+    uint32_t last_update_ms;                                // Time of the last servo update
+    uint32_t blocks_processed;
+    uint32_t dropped;
+    uint32_t servo_updates;
+    uint32_t last_us_per_block;
+    uint32_t max_us_per_block;
+} emg_manager_state_t;
+
+static emg_manager_state_t g_emg = {
+    .initialized = false,
+    .lock_num = UINT_MAX,
+    .task_id = -1
+};
+
+/**
+ * @brief Find the ADC inputs with the EMG role and restart the pipeline, lock held
+ */
+static bool emg_manager_scan(void) {
+    adc_manager_config_t adc;
+    adc_manager_get_config(&adc);
+
+    g_emg.channels = 0;
+    for (uint8_t i = 0; i < ADC_MANAGER_MAX_INPUTS && g_emg.channels < EMG_PIPELINE_MAX_CHANNELS; i++) {
+        if (adc.inputs[i].role == ADC_ROLE_EMG) {
+            g_emg.inputs[g_emg.channels] = i;
+            g_emg.cursors[g_emg.channels] = 0;
+            g_emg.fill[g_emg.channels] = 0;
+            g_emg.channels++;
+        }
+    }
+
+    if (g_emg.channels == 0 || !adc_manager_is_running()) {
+        g_emg.channels = 0;
+        return false;
+    }
+
+    // All EMG inputs share the ADC rate, the decimation of the first sets the pipeline rate
+    g_emg.config.pipeline.sample_rate_hz = (float) adc.sample_rate_hz / (float) adc.inputs[g_emg.inputs[0]].decimation;
+
+    if (!emg_pipeline_init(&g_emg.pipeline, &g_emg.config.pipeline, g_emg.channels)) {
+        log_message(LOG_LEVEL_WARN, "EMG Manager", "Invalid pipeline configuration for %.0f Hz.",
+            (double) g_emg.config.pipeline.sample_rate_hz);
+        g_emg.channels = 0;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Move the staged samples of every channel forward, lock held
+ *
+ * @return true if every channel has a full block
+ */
+static bool emg_manager_stage(void) {
+    adc_manager_sample_t samples[EMG_PIPELINE_BLOCK];
+    bool full = true;
+
+    for (uint8_t c = 0; c < g_emg.channels; c++) {
+        int need = EMG_PIPELINE_BLOCK - g_emg.fill[c];
+        uint32_t dropped = 0;
+
+        if (need > 0) {
+            int count = adc_manager_read(g_emg.inputs[c], &g_emg.cursors[c], samples, need, &dropped);
+
+            for (int i = 0; i < count; i++) {
+                g_emg.blocks[c][g_emg.fill[c]++] = samples[i].value;
+            }
+
+            g_emg.dropped += dropped;
+        }
+
+        if (g_emg.fill[c] < EMG_PIPELINE_BLOCK) {
+            full = false;
+        }
+    }
+
+    return full;
+}
+
+/**
+ * @brief Build the batched servo update for a grasp level
+ */
+static int emg_manager_build_commands(float grasp, servo_manager_command_t* commands) {
+    for (uint8_t i = 0; i < g_emg.config.servo_count; i++) {
+        const emg_manager_servo_t* servo = &g_emg.config.servos[i];
+
+        commands[i].id = servo->id;
+        commands[i].value = servo->open_percent + (grasp * (servo->closed_percent - servo->open_percent));
+        commands[i].is_percent = true;
+    }
+
+    return g_emg.config.servo_count;
+}
+
+void emg_manager_task(void* params) {
+    (void) params;
+
+    if (!g_emg.initialized || g_emg.channels == 0) {
+        return;
+    }
+
+    servo_manager_command_t commands[EMG_MANAGER_MAX_SERVOS];
+    int command_count = 0;
+
+    uint32_t save = hw_spinlock_acquire(g_emg.lock_num, scheduler_get_current_task());
+
+    while (emg_manager_stage()) {
+        uint32_t start_us = time_us_32();
+
+        for (uint8_t c = 0; c < g_emg.channels; c++) {
+            emg_pipeline_process(&g_emg.pipeline, c, g_emg.blocks[c]);
+            g_emg.fill[c] = 0;
+        }
+
+        emg_pipeline_update_grasp(&g_emg.pipeline);
+
+        g_emg.last_us_per_block = time_us_32() - start_us;
+        if (g_emg.last_us_per_block > g_emg.max_us_per_block) {
+            g_emg.max_us_per_block = g_emg.last_us_per_block;
+        }
+        g_emg.blocks_processed++;
+    }
+
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    float grasp = g_emg.pipeline.grasp;
+
+    if (g_emg.enabled && (now_ms - g_emg.last_update_ms) >= g_emg.config.update_ms &&
+        fabsf(grasp - g_emg.last_sent) >= g_emg.config.deadband) {
+        command_count = emg_manager_build_commands(grasp, commands);
+        g_emg.last_sent = grasp;
+        g_emg.last_update_ms = now_ms;
+    }
+
+    hw_spinlock_release(g_emg.lock_num, save);
+
+    // Outside our lock, the servo manager takes its own
+    if (command_count > 0 && servo_manager_set_batch(servo_manager_get_instance(), commands, command_count) > 0) {
+        g_emg.servo_updates++;
+    }
+}
+
+void emg_manager_get_default_config(emg_manager_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+
+    memset(config, 0, sizeof(emg_manager_config_t));
+    emg_pipeline_get_default_config(&config->pipeline);
+    config->update_ms = 20;     // One servo frame
+    config->deadband = 0.01f;
+    config->servo_count = 0;
+}
+
+bool emg_manager_init(const emg_manager_config_t* config) {
+    if (g_emg.initialized) {
+        return true;
+    }
+
+    if (config != NULL) {
+        g_emg.config = *config;
+    } else {
+        emg_manager_get_default_config(&g_emg.config);
+    }
+
+    g_emg.lock_num = hw_spinlock_allocate(SPINLOCK_CAT_SERVO, "emg_manager");
+    if (g_emg.lock_num == UINT_MAX) {
+        log_message(LOG_LEVEL_ERROR, "EMG Manager", "Failed to claim spinlock.");
+        return false;
+    }
+
+    g_emg.task_id = scheduler_create_task(
+        emg_manager_task,       // Task function
+        NULL,                   // No parameters
+        2048,                   // Stack size
+        TASK_PRIORITY_HIGH,     // Keeps up with the ADC rings
+        "emg",                  // Task name
+        1,                      // Core 1, next to the servo task
+        TASK_TYPE_PERSISTENT    // Always running
+    );
+
+    if (g_emg.task_id < 0) {
+        log_message(LOG_LEVEL_ERROR, "EMG Manager", "Failed to create EMG task.");
+        return false;
+    }
+
+    g_emg.enabled = false;
+    g_emg.initialized = true;
+
+    uint32_t save = hw_spinlock_acquire(g_emg.lock_num, scheduler_get_current_task());
+    bool found = emg_manager_scan();
+    hw_spinlock_release(g_emg.lock_num, save);
+
+    log_message(LOG_LEVEL_INFO, "EMG Manager", "Initialized with %u EMG channels, control disabled.",
+        found ? g_emg.channels : 0);
+
+    return true;
+}
+
+bool emg_manager_enable(void) {
+    if (!g_emg.initialized) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_emg.lock_num, scheduler_get_current_task());
+
+    bool ok = emg_manager_scan() && g_emg.config.servo_count > 0;
+    g_emg.enabled = ok;
+
+    // Force an update on the next block
+    g_emg.last_sent = -1.0f;
+
+    hw_spinlock_release(g_emg.lock_num, save);
+
+    if (ok) {
+        log_message(LOG_LEVEL_INFO, "EMG Manager", "Control enabled, %u channels driving %u servos.",
+            g_emg.channels, g_emg.config.servo_count);
+    }
+
+    return ok;
+}
+
+void emg_manager_disable(void) {
+    g_emg.enabled = false;
+}
+
+bool emg_manager_calibrate(bool max) {
+    if (!g_emg.initialized || g_emg.channels == 0) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_emg.lock_num, scheduler_get_current_task());
+
+    for (uint8_t c = 0; c < g_emg.channels; c++) {
+        emg_pipeline_calibration_t* cal = &g_emg.config.pipeline.calibration[c];
+
+        if (max) {
+            cal->max = g_emg.pipeline.channel[c].envelope;
+        } else {
+            cal->rest = g_emg.pipeline.channel[c].envelope;
+        }
+
+        emg_pipeline_set_calibration(&g_emg.pipeline, c, cal);
+    }
+
+    hw_spinlock_release(g_emg.lock_num, save);
+
+    return true;
+}
+
+bool emg_manager_map_servo(const emg_manager_servo_t* servo) {
+    if (!g_emg.initialized || servo == NULL || servo->id == 0) {
+        return false;
+    }
+
+    bool ok = false;
+    uint32_t save = hw_spinlock_acquire(g_emg.lock_num, scheduler_get_current_task());
+
+    for (uint8_t i = 0; i <= g_emg.config.servo_count && i < EMG_MANAGER_MAX_SERVOS; i++) {
+        if (i == g_emg.config.servo_count || g_emg.config.servos[i].id == servo->id) {
+            g_emg.config.servos[i] = *servo;
+            if (i == g_emg.config.servo_count) {
+                g_emg.config.servo_count++;
+            }
+            ok = true;
+            break;
+        }
+    }
+
+    hw_spinlock_release(g_emg.lock_num, save);
+
+    return ok;
+}
+
+void emg_manager_get_status(emg_manager_status_t* status) {
+    if (status == NULL) {
+        return;
+    }
+
+    memset(status, 0, sizeof(emg_manager_status_t));
+    if (!g_emg.initialized) {
+        return;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_emg.lock_num, scheduler_get_current_task());
+
+    status->enabled = g_emg.enabled;
+    status->channels = g_emg.channels;
+    for (uint8_t c = 0; c < g_emg.channels; c++) {
+        status->inputs[c] = g_emg.inputs[c];
+        status->envelope[c] = g_emg.pipeline.channel[c].envelope;
+        status->activation[c] = g_emg.pipeline.channel[c].activation;
+    }
+    status->grasp = g_emg.pipeline.grasp;
+    status->blocks = g_emg.blocks_processed;
+    status->dropped = g_emg.dropped;
+    status->servo_updates = g_emg.servo_updates;
+    status->last_us_per_block = g_emg.last_us_per_block;
+    status->max_us_per_block = g_emg.max_us_per_block;
+
+    hw_spinlock_release(g_emg.lock_num, save);
+}
+
+static void handle_emg_status(void) {
+    emg_manager_status_t status;
+    emg_manager_get_status(&status);
+
+    const emg_pipeline_config_t* p = &g_emg.config.pipeline;
+    float block_us = (p->sample_rate_hz > 0.0f) ? (1e6f * (float) EMG_PIPELINE_BLOCK / p->sample_rate_hz) : 0.0f;
+
+    printf("EMG control: %s, %u channels at %.0f Hz, grasp %.3f\n\r",
+        status.enabled ? "enabled" : "disabled", status.channels, (double) p->sample_rate_hz, (double) status.grasp);
+    printf("Band %.0f-%.0f Hz, notch %.0f Hz, %s window %u blocks, thresholds on %.2f off %.2f\n\r",
+        (double) p->highpass_hz, (double) p->lowpass_hz, (double) p->notch_hz,
+        (p->envelope == EMG_ENVELOPE_MAV) ? "MAV" : "RMS", p->window_blocks,
+        (double) p->on_threshold, (double) p->off_threshold);
+    printf("Blocks: %lu, dropped samples: %lu, servo updates: %lu\n\r",
+        status.blocks, status.dropped, status.servo_updates);
+    printf("Processing: last %lu us, max %lu us per %.0f us block (%.2f%% load)\n\r",
+        status.last_us_per_block, status.max_us_per_block, (double) block_us,
+        (block_us > 0.0f) ? (100.0 * (double) status.max_us_per_block / (double) block_us) : 0.0);
+
+    for (uint8_t c = 0; c < status.channels; c++) {
+        printf("  ch%u (%s, ADC %u): envelope %.4f, rest %.4f, max %.4f, activation %.3f\n\r",
+            c, (c == 0) ? "close" : ((c == 1) ? "open" : "unused"), status.inputs[c],
+            (double) status.envelope[c], (double) p->calibration[c].rest, (double) p->calibration[c].max,
+            (double) status.activation[c]);
+    }
+
+    for (uint8_t i = 0; i < g_emg.config.servo_count; i++) {
+        printf("  servo %lu: open %.1f%%, closed %.1f%%\n\r", g_emg.config.servos[i].id,
+            (double) g_emg.config.servos[i].open_percent, (double) g_emg.config.servos[i].closed_percent);
+    }
+}
+
+/**
+ * @brief Apply a pipeline change from the shell, keeping the old one if rejected
+ */
+static int emg_manager_apply(const emg_pipeline_config_t* pipeline) {
+    uint32_t save = hw_spinlock_acquire(g_emg.lock_num, scheduler_get_current_task());
+
+    emg_pipeline_config_t previous = g_emg.config.pipeline;
+    g_emg.config.pipeline = *pipeline;
+
+    if (!emg_manager_scan()) {
+        g_emg.config.pipeline = previous;
+        emg_manager_scan();
+        hw_spinlock_release(g_emg.lock_num, save);
+        printf("Configuration rejected or no EMG inputs\n\r");
+        return 1;
+    }
+
+    hw_spinlock_release(g_emg.lock_num, save);
+    return 0;
+}
+
+int cmd_emg(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: emg <status|scan|calibrate|servo|threshold|filter|enable|disable>\n\r");
+        printf("  emg calibrate <rest|max>\n\r");
+        printf("  emg servo <id> <open%%> <closed%%>\n\r");
+        printf("  emg threshold <on> <off>\n\r");
+        printf("  emg filter <highpass_hz> <lowpass_hz> <notch_hz> [rms|mav]\n\r");
+        return 1;
+    }
+
+    if (!g_emg.initialized) {
+        printf("EMG manager not initialized\n\r");
+        return 1;
+    }
+
+    emg_pipeline_config_t pipeline = g_emg.config.pipeline;
+
+    if (strcmp(argv[1], "status") == 0) {
+        handle_emg_status();
+    }
+    else if (strcmp(argv[1], "scan") == 0) {
+        return emg_manager_apply(&pipeline);
+    }
+    else if (strcmp(argv[1], "calibrate") == 0) {
+        if (argc < 3 || (strcmp(argv[2], "rest") != 0 && strcmp(argv[2], "max") != 0)) {
+            printf("Usage: emg calibrate <rest|max>\n\r");
+            return 1;
+        }
+
+        if (!emg_manager_calibrate(strcmp(argv[2], "max") == 0)) {
+            printf("No EMG channels\n\r");
+            return 1;
+        }
+    }
+    else if (strcmp(argv[1], "servo") == 0) {
+        if (argc < 5) {
+            printf("Usage: emg servo <id> <open%%> <closed%%>\n\r");
+            return 1;
+        }
+
+        emg_manager_servo_t servo = {
+            .id = (uint32_t) strtoul(argv[2], NULL, 10),
+            .open_percent = strtof(argv[3], NULL),
+            .closed_percent = strtof(argv[4], NULL)
+        };
+
+        if (!emg_manager_map_servo(&servo)) {
+            printf("Invalid servo or no free mapping slots\n\r");
+            return 1;
+        }
+    }
+    else if (strcmp(argv[1], "threshold") == 0) {
+        if (argc < 4) {
+            printf("Usage: emg threshold <on> <off>\n\r");
+            return 1;
+        }
+
+        pipeline.on_threshold = strtof(argv[2], NULL);
+        pipeline.off_threshold = strtof(argv[3], NULL);
+        return emg_manager_apply(&pipeline);
+    }
+    else if (strcmp(argv[1], "filter") == 0) {
+        if (argc < 5) {
+            printf("Usage: emg filter <highpass_hz> <lowpass_hz> <notch_hz> [rms|mav]\n\r");
+            return 1;
+        }
+
+        pipeline.highpass_hz = strtof(argv[2], NULL);
+        pipeline.lowpass_hz = strtof(argv[3], NULL);
+        pipeline.notch_hz = strtof(argv[4], NULL);
+        if (argc > 5) {
+            pipeline.envelope = (strcmp(argv[5], "mav") == 0) ? EMG_ENVELOPE_MAV : EMG_ENVELOPE_RMS;
+        }
+        return emg_manager_apply(&pipeline);
+    }
+    else if (strcmp(argv[1], "enable") == 0) {
+        if (!emg_manager_enable()) {
+            printf("Needs an ADC input with the emg role and a mapped servo\n\r");
+            return 1;
+        }
+    }
+    else if (strcmp(argv[1], "disable") == 0) {
+        emg_manager_disable();
+    }
+    else {
+        printf("Unknown emg command: %s\n\r", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
+
+void register_emg_manager_commands(void) {
+    static const shell_command_t emg_command = {
+        cmd_emg,
+        "emg",
+        "Myoelectric grasp control (status|scan|calibrate|servo|threshold|filter|enable|disable)"
+    };
+
+    shell_register_command(&emg_command);
+}
@@ -0,0 +1,167 @@
+/**
+* @file emg_pipeline.c
+* @brief Myoelectric signal processing implementation
+* @date 2025-05-27
+*/
+
+#include "emg_pipeline.h"
+
+#include "filter_design.h"
+
+#include <math.h>
+#include <string.h>
+
+#define EMG_PIPELINE_BAND_Q 0.7071f  // Butterworth band edges
+
+static inline float emg_clamp01(float value) {
+    return (value < 0.0f) ? 0.0f : ((value > 1.0f) ? 1.0f : value);
+}
+
+void emg_pipeline_get_default_config(emg_pipeline_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+
+    memset(config, 0, sizeof(emg_pipeline_config_t));
+    config->sample_rate_hz = 1000.0f;
+    config->highpass_hz = 20.0f;
+    config->lowpass_hz = 450.0f;
+    config->notch_hz = 50.0f;
+    config->notch_q = 30.0f;
+    config->envelope = EMG_ENVELOPE_RMS;
+    config->window_blocks = 4;
+    config->on_threshold = 0.15f;
+    config->off_threshold = 0.08f;
+    config->grasp_rate = 4.0f;
+
+    // Placeholder until calibrated, volts at the ADC pin
+    for (int i = 0; i < EMG_PIPELINE_MAX_CHANNELS; i++) {
+        config->calibration[i].rest = 0.01f;
+        config->calibration[i].max = 0.5f;
+    }
+}
+
+bool emg_pipeline_init(emg_pipeline_t* pipeline, const emg_pipeline_config_t* config, uint8_t channels) {
+    if (pipeline == NULL || config == NULL || channels == 0 || channels > EMG_PIPELINE_MAX_CHANNELS) {
+        return false;
+    }
+
+    float nyquist = config->sample_rate_hz * 0.5f;
+
+    if (!(config->highpass_hz > 0.0f) || !(config->lowpass_hz > config->highpass_hz) || !(config->lowpass_hz < nyquist) ||
+        config->notch_hz < 0.0f || config->notch_hz >= nyquist || (config->notch_hz > 0.0f && !(config->notch_q > 0.0f)) ||
+        config->window_blocks == 0 || config->window_blocks > EMG_PIPELINE_MAX_WINDOW ||
+        config->off_threshold > config->on_threshold || config->on_threshold >= 1.0f) {
+        return false;
+    }
+
+    memset(pipeline, 0, sizeof(emg_pipeline_t));
+    pipeline->config = *config;
+    pipeline->channels = channels;
+
+    filter_design_biquad(FILTER_DESIGN_HIGHPASS, config->highpass_hz, EMG_PIPELINE_BAND_Q, config->sample_rate_hz, &pipeline->coeffs[0]);
+    filter_design_biquad(FILTER_DESIGN_LOWPASS, config->lowpass_hz, EMG_PIPELINE_BAND_Q, config->sample_rate_hz, &pipeline->coeffs[5]);
+    pipeline->stages = 2;
+
+    if (config->notch_hz > 0.0f) {
+        filter_design_biquad(FILTER_DESIGN_NOTCH, config->notch_hz, config->notch_q, config->sample_rate_hz, &pipeline->coeffs[10]);
+        pipeline->stages = 3;
+    }
+
+    for (uint8_t c = 0; c < channels; c++) {
+        arm_biquad_cascade_df2T_init_f32(&pipeline->channel[c].cascade, pipeline->stages,
+            pipeline->coeffs, pipeline->channel[c].state);
+    }
+
+    return true;
+}
+
+void emg_pipeline_set_calibration(emg_pipeline_t* pipeline, uint8_t channel, const emg_pipeline_calibration_t* calibration) {
+    if (pipeline == NULL || calibration == NULL || channel >= EMG_PIPELINE_MAX_CHANNELS) {
+        return;
+    }
+
+    pipeline->config.calibration[channel] = *calibration;
+}
+
+void emg_pipeline_process(emg_pipeline_t* pipeline, uint8_t channel, float* block) {
+    if (pipeline == NULL || block == NULL || channel >= pipeline->channels) {
+        return;
+    }
+
+    const emg_pipeline_config_t* config = &pipeline->config;
+    emg_pipeline_channel_t* ch = &pipeline->channel[channel];
+    float block_sum;
+
+    arm_biquad_cascade_df2T_f32(&ch->cascade, block, block, EMG_PIPELINE_BLOCK);
+
+    if (config->envelope == EMG_ENVELOPE_MAV) {
+        float mean;
+
+        arm_abs_f32(block, block, EMG_PIPELINE_BLOCK);
+        arm_mean_f32(block, EMG_PIPELINE_BLOCK, &mean);
+        block_sum = mean * (float) EMG_PIPELINE_BLOCK;
+    }
+    else {
+        arm_power_f32(block, EMG_PIPELINE_BLOCK, &block_sum);
+    }
+
+    ch->window[ch->window_pos] = block_sum;
+    ch->window_pos = (uint8_t) ((ch->window_pos + 1u) % config->window_blocks);
+    if (ch->window_fill < config->window_blocks) {
+        ch->window_fill++;
+    }
+
+    // Summed fresh each block, a running total would drift
+    float total = 0.0f;
+    for (uint8_t i = 0; i < ch->window_fill; i++) {
+        total += ch->window[i];
+    }
+
+    float mean = total / (float) (ch->window_fill * EMG_PIPELINE_BLOCK);
+    ch->envelope = (config->envelope == EMG_ENVELOPE_MAV) ? mean : sqrtf(mean);
+
+    const emg_pipeline_calibration_t* cal = &config->calibration[channel];
+    float range = cal->max - cal->rest;
+    float level = (range > 0.0f) ? emg_clamp01((ch->envelope - cal->rest) / range) : 0.0f;
+
+    if (!ch->active && level >= config->on_threshold) {
+        ch->active = true;
+    }
+    else if (ch->active && level < config->off_threshold) {
+        ch->active = false;
+    }
+
+    // Proportional above the release point, so activation starts near zero
+    ch->activation = ch->active ?
+        emg_clamp01((level - config->off_threshold) / (1.0f - config->off_threshold)) : 0.0f;
+}
+
+float emg_pipeline_update_grasp(emg_pipeline_t* pipeline) {
+    if (pipeline == NULL || pipeline->channels == 0) {
+        return 0.0f;
+    }
+
+    float target = pipeline->channel[0].activation;
+    if (pipeline->channels > 1) {
+        target = emg_clamp01(target - pipeline->channel[1].activation);
+    }
+
+    float rate = pipeline->config.grasp_rate;
+    if (rate > 0.0f) {
+        float step = rate * ((float) EMG_PIPELINE_BLOCK / pipeline->config.sample_rate_hz);
+        float delta = target - pipeline->grasp;
+
+        if (delta > step) {
+            delta = step;
+        }
+        else if (delta < -step) {
+            delta = -step;
+        }
+
+        target = pipeline->grasp + delta;
+    }
+
+    pipeline->grasp = target;
+    return target;
+}
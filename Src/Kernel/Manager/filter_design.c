@@ -0,0 +1,66 @@
+/**
+* @file filter_design.c
+* @brief Coefficient design for CMSIS-DSP filters
+* @date 2025-05-27
+*/
+
+#include "filter_design.h"
+
+#include <math.h>
+
+#define FILTER_DESIGN_PI 3.14159265358979f
+
+void filter_design_biquad(filter_design_type_t type, float cutoff_hz, float q, float sample_rate_hz, float* coeffs) {
+    float w0 = 2.0f * FILTER_DESIGN_PI * cutoff_hz / sample_rate_hz;
+    float cos_w0 = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * q);
+    float b0, b1, b2;
+
+    switch (type) {
+        case FILTER_DESIGN_HIGHPASS:
+            b0 = (1.0f + cos_w0) * 0.5f;
+            b1 = -(1.0f + cos_w0);
+            b2 = b0;
+            break;
+
+        case FILTER_DESIGN_NOTCH:
+            b0 = 1.0f;
+            b1 = -2.0f * cos_w0;
+            b2 = 1.0f;
+            break;
+
+        case FILTER_DESIGN_LOWPASS:
+        default:
+            b0 = (1.0f - cos_w0) * 0.5f;
+            b1 = 1.0f - cos_w0;
+            b2 = b0;
+            break;
+    }
+
+    float a0 = 1.0f + alpha;
+
+    coeffs[0] = b0 / a0;
+    coeffs[1] = b1 / a0;
+    coeffs[2] = b2 / a0;
+    coeffs[3] = (2.0f * cos_w0) / a0;
+    coeffs[4] = -(1.0f - alpha) / a0;
+}
+
+void filter_design_fir_lowpass(uint32_t taps, float cutoff, float* coeffs) {
+    float center = (float) (taps - 1u) * 0.5f;
+    float sum = 0.0f;
+
+    for (uint32_t i = 0; i < taps; i++) {
+        float x = 2.0f * cutoff * ((float) i - center);
+        float sinc = (fabsf(x) < 1e-6f) ? 1.0f : (sinf(FILTER_DESIGN_PI * x) / (FILTER_DESIGN_PI * x));
+        float window = (taps > 1u) ?
+            (0.54f - (0.46f * cosf((2.0f * FILTER_DESIGN_PI * (float) i) / (float) (taps - 1u)))) : 1.0f;
+
+        coeffs[i] = 2.0f * cutoff * sinc * window;
+        sum += coeffs[i];
+    }
+
+    for (uint32_t i = 0; i < taps; i++) {
+        coeffs[i] /= sum;
+    }
+}
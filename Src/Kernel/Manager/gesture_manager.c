@@ -0,0 +1,526 @@
+/**
+* @file gesture_manager.c
+* @brief Gesture classification implementation
+* @date 2025-05-27
+*/
+
+#include "gesture_manager.h"
+
+#include "adc_manager.h"
+#include "emg_manager.h"
+#include "log_manager.h"
+#include "nn_engine.h"
+#include "scheduler.h"
+#include "sensor_manager.h"
+#include "spinlock_manager.h"
+#include "usb_shell.h"
+
+#include "pico/stdlib.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GESTURE_MANAGER_MAX_LATE_ROWS 4     // Rows caught up before resynchronizing
+
+/**
+ * @brief Gesture manager state
+ *
+ * The shell and the task both run on core 0, so a classification is never
+ * interrupted by a reload. The lock covers what other cores read.
+ */
+typedef struct {
+    bool initialized;
+    bool loaded;                                            // Engine holds a valid model
+    bool enabled;                                           // Classification runs
+    uint32_t lock_num;                                      // Spinlock for status and configuration
+    int task_id;                                            // Scheduler task
+    gesture_manager_config_t config;                        // Configuration
+    nn_engine_t engine;                                     // Loaded model
+
+    // Each row is written twice, length rows apart, so the newest window is always contiguous
+    float window[2 * GESTURE_MANAGER_MAX_WINDOW * GESTURE_MANAGER_MAX_FEATURES];
+    uint16_t row;                                           // Next row position
+    uint16_t filled;                                        // Rows in the window
+    uint16_t since;                                         // Rows since the last classification
+    uint32_t next_row_us;                                   // Time of the next row
+
+    int gesture;
+    float confidence;
+    uint32_t inferences;
+    uint32_t budget_overruns;
+    uint32_t late_rows;
+    uint32_t last_us;
+    uint32_t max_us;
+} gesture_manager_state_t;
+
+static gesture_manager_state_t g_gesture = {
+    .initialized = false,
+    .lock_num = UINT_MAX,
+    .task_id = -1,
+    .gesture = -1
+};
+
+static uint8_t __attribute__((aligned(4))) g_gesture_arena[GESTURE_MANAGER_ARENA_SIZE];
+
+static uint32_t gesture_clock_us(void) {
+    return time_us_32();
+}
+
+/**
+ * @brief Sample one row of features
+ */
+static void gesture_sample_row(float* row, uint16_t channels) {
+    emg_manager_status_t emg;
+    bool emg_read = false;
+    sensor_manager_t sensors = sensor_manager_get_instance();
+
+    for (uint16_t i = 0; i < channels; i++) {
+        const gesture_manager_feature_t* feature = &g_gesture.config.features[i];
+        adc_manager_sample_t sample;
+        sensor_data_t data;
+
+        row[i] = 0.0f;
+
+        switch (feature->kind) {
+            case GESTURE_FEATURE_ADC:
+                if (adc_manager_get_latest(feature->index, &sample)) {
+                    row[i] = sample.value;
+                }
+                break;
+
+            case GESTURE_FEATURE_EMG:
+                if (!emg_read) {
+                    emg_manager_get_status(&emg);
+                    emg_read = true;
+                }
+                if (feature->index < emg.channels) {
+                    row[i] = emg.envelope[feature->index];
+                }
+                break;
+
+            case GESTURE_FEATURE_SENSOR:
+                if (sensor_manager_get_latest(sensors, feature->sensor_type, &data)) {
+                    row[i] = (feature->index == 0) ? data.xyz.x : ((feature->index == 1) ? data.xyz.y : data.xyz.z);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Classify the newest window
+ */
+static void gesture_classify(void) {
+    uint16_t channels = g_gesture.engine.header->input_channels;
+
+    nn_engine_quantize_input(&g_gesture.engine, &g_gesture.window[(uint32_t) g_gesture.row * channels]);
+
+    uint32_t start_us = time_us_32();
+    bool done = nn_engine_run(&g_gesture.engine, gesture_clock_us, g_gesture.config.budget_us);
+    uint32_t elapsed_us = time_us_32() - start_us;
+
+    int8_t best = 0;
+    int gesture = done ? nn_engine_argmax(&g_gesture.engine, &best) : -1;
+    float confidence = ((float) best + 128.0f) / 256.0f;
+    int previous;
+
+    uint32_t save = hw_spinlock_acquire(g_gesture.lock_num, scheduler_get_current_task());
+
+    previous = g_gesture.gesture;
+    g_gesture.last_us = elapsed_us;
+    if (elapsed_us > g_gesture.max_us) {
+        g_gesture.max_us = elapsed_us;
+    }
+
+    if (!done) {
+        g_gesture.budget_overruns++;
+    } else {
+        g_gesture.inferences++;
+        g_gesture.gesture = (confidence >= g_gesture.config.min_confidence) ? gesture : -1;
+        g_gesture.confidence = confidence;
+    }
+
+    hw_spinlock_release(g_gesture.lock_num, save);
+
+    if (done && g_gesture.gesture != previous && g_gesture.gesture >= 0) {
+        LOG_KV(LOG_LEVEL_INFO, "Gesture", "class", K_U32("class", gesture), K_F32("confidence", confidence),
+            K_U32("us", elapsed_us));
+    }
+}
+
+void gesture_manager_task(void* params) {
+    (void) params;
+
+    if (!g_gesture.initialized || !g_gesture.loaded || !g_gesture.enabled) {
+        return;
+    }
+
+    uint16_t length = g_gesture.engine.header->input_length;
+    uint16_t channels = g_gesture.engine.header->input_channels;
+    uint32_t period_us = 1000000u / g_gesture.config.sample_hz;
+    uint32_t now_us = time_us_32();
+
+    if ((int32_t) (now_us - g_gesture.next_row_us) > (int32_t) (GESTURE_MANAGER_MAX_LATE_ROWS * period_us)) {
+        g_gesture.late_rows += (now_us - g_gesture.next_row_us) / period_us;
+        g_gesture.next_row_us = now_us;
+    }
+
+    while ((int32_t) (now_us - g_gesture.next_row_us) >= 0) {
+        float row[GESTURE_MANAGER_MAX_FEATURES];
+
+        gesture_sample_row(row, channels);
+        memcpy(&g_gesture.window[(uint32_t) g_gesture.row * channels], row, channels * sizeof(float));
+        memcpy(&g_gesture.window[(uint32_t) (g_gesture.row + length) * channels], row, channels * sizeof(float));
+
+        // The window is rows row+1 to row+length after the increment
+        g_gesture.row = (uint16_t) ((g_gesture.row + 1u) % length);
+        if (g_gesture.filled < length) {
+            g_gesture.filled++;
+        }
+        g_gesture.since++;
+        g_gesture.next_row_us += period_us;
+    }
+
+    if (g_gesture.filled == length && g_gesture.since >= g_gesture.config.hop) {
+        g_gesture.since = 0;
+        gesture_classify();
+    }
+}
+
+bool gesture_manager_load(void) {
+    if (!g_gesture.initialized) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_gesture.lock_num, scheduler_get_current_task());
+    g_gesture.loaded = false;
+    hw_spinlock_release(g_gesture.lock_num, save);
+
+    const uint8_t* blob = (const uint8_t*) (XIP_BASE + GESTURE_MANAGER_FLASH_OFFSET);
+
+    if (!nn_engine_load(&g_gesture.engine, blob, GESTURE_MANAGER_FLASH_SIZE, g_gesture_arena, sizeof(g_gesture_arena))) {
+        log_message(LOG_LEVEL_WARN, "Gesture", "No valid model at flash offset 0x%x.", GESTURE_MANAGER_FLASH_OFFSET);
+        return false;
+    }
+
+    const nn_engine_header_t* header = g_gesture.engine.header;
+    if (header->input_length > GESTURE_MANAGER_MAX_WINDOW || header->input_channels > GESTURE_MANAGER_MAX_FEATURES) {
+        log_message(LOG_LEVEL_WARN, "Gesture", "Model input %ux%u exceeds the %ux%u window.",
+            header->input_length, header->input_channels, GESTURE_MANAGER_MAX_WINDOW, GESTURE_MANAGER_MAX_FEATURES);
+        return false;
+    }
+
+    save = hw_spinlock_acquire(g_gesture.lock_num, scheduler_get_current_task());
+    g_gesture.row = 0;
+    g_gesture.filled = 0;
+    g_gesture.since = 0;
+    g_gesture.gesture = -1;
+    g_gesture.next_row_us = time_us_32();
+    g_gesture.loaded = true;
+    hw_spinlock_release(g_gesture.lock_num, save);
+
+    uint32_t classes;
+    nn_engine_output(&g_gesture.engine, &classes);
+
+    log_message(LOG_LEVEL_INFO, "Gesture", "Model loaded: %u layers, %ux%u input, %lu classes, %lu MACs, %u arena bytes.",
+        header->layer_count, header->input_length, header->input_channels, classes, g_gesture.engine.macs,
+        (unsigned) g_gesture.engine.arena_used);
+
+    return true;
+}
+
+void gesture_manager_get_default_config(gesture_manager_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+
+    memset(config, 0, sizeof(gesture_manager_config_t));
+    config->sample_hz = 50;
+    config->hop = 10;
+    config->budget_us = 5000;
+    config->min_confidence = 0.6f;
+
+    config->features[0] = (gesture_manager_feature_t) {GESTURE_FEATURE_EMG, 0, SENSOR_TYPE_UNKNOWN};
+    config->features[1] = (gesture_manager_feature_t) {GESTURE_FEATURE_EMG, 1, SENSOR_TYPE_UNKNOWN};
+
+    for (uint8_t axis = 0; axis < 3; axis++) {
+        config->features[2 + axis] = (gesture_manager_feature_t) {GESTURE_FEATURE_SENSOR, axis, SENSOR_TYPE_ACCELEROMETER};
+        config->features[5 + axis] = (gesture_manager_feature_t) {GESTURE_FEATURE_SENSOR, axis, SENSOR_TYPE_GYROSCOPE};
+    }
+}
+
+void gesture_manager_get_status(gesture_manager_status_t* status) {
+    if (status == NULL) {
+        return;
+    }
+
+    memset(status, 0, sizeof(gesture_manager_status_t));
+    status->gesture = -1;
+    if (!g_gesture.initialized) {
+        return;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_gesture.lock_num, scheduler_get_current_task());
+
+    status->loaded = g_gesture.loaded;
+    status->enabled = g_gesture.enabled;
+    if (g_gesture.loaded) {
+        uint32_t classes;
+
+        nn_engine_output(&g_gesture.engine, &classes);
+        status->length = g_gesture.engine.header->input_length;
+        status->channels = g_gesture.engine.header->input_channels;
+        status->classes = (uint16_t) classes;
+        status->layers = (uint8_t) g_gesture.engine.header->layer_count;
+        status->macs = g_gesture.engine.macs;
+        status->arena_used = (uint32_t) g_gesture.engine.arena_used;
+    }
+    status->gesture = g_gesture.gesture;
+    status->confidence = g_gesture.confidence;
+    status->inferences = g_gesture.inferences;
+    status->budget_overruns = g_gesture.budget_overruns;
+    status->late_rows = g_gesture.late_rows;
+    status->last_us = g_gesture.last_us;
+    status->max_us = g_gesture.max_us;
+
+    hw_spinlock_release(g_gesture.lock_num, save);
+}
+
+bool gesture_manager_init(const gesture_manager_config_t* config) {
+    if (g_gesture.initialized) {
+        return true;
+    }
+
+    if (config != NULL) {
+        g_gesture.config = *config;
+    } else {
+        gesture_manager_get_default_config(&g_gesture.config);
+    }
+
+    if (g_gesture.config.sample_hz == 0 || g_gesture.config.hop == 0) {
+        log_message(LOG_LEVEL_ERROR, "Gesture", "Invalid configuration.");
+        return false;
+    }
+
+    g_gesture.lock_num = hw_spinlock_allocate(SPINLOCK_CAT_SENSOR, "gesture_manager");
+    if (g_gesture.lock_num == UINT_MAX) {
+        log_message(LOG_LEVEL_ERROR, "Gesture", "Failed to claim spinlock.");
+        return false;
+    }
+
+    g_gesture.task_id = scheduler_create_task(
+        gesture_manager_task,   // Task function
+        NULL,                   // No parameters
+        2048,                   // Stack size
+        TASK_PRIORITY_HIGH,     // Peer of the core 0 tasks, lower levels are never reached
+        "gesture",              // Task name
+        0,                      // Core 0, with the shell that reloads the model
+        TASK_TYPE_PERSISTENT    // Always running
+    );
+
+    if (g_gesture.task_id < 0) {
+        log_message(LOG_LEVEL_ERROR, "Gesture", "Failed to create gesture task.");
+        return false;
+    }
+
+    // Rate limited while degraded, late rows are counted and skipped
+    scheduler_set_criticality(g_gesture.task_id, TASK_CRITICALITY_MEDIUM);
+
+    g_gesture.initialized = true;
+    g_gesture.enabled = true;
+
+    // Classification starts once a model is written and loaded
+    gesture_manager_load();
+
+    return true;
+}
+
+static void handle_gesture_status(void) {
+    gesture_manager_status_t status;
+    gesture_manager_get_status(&status);
+
+    if (!status.loaded) {
+        printf("No model loaded, write one at flash offset 0x%x and run 'gesture load'\n\r", GESTURE_MANAGER_FLASH_OFFSET);
+        return;
+    }
+
+    float window_us = 1e6f * (float) g_gesture.config.hop / (float) g_gesture.config.sample_hz;
+
+    printf("Model: %u layers, %ux%u input, %u classes, %lu MACs, %lu of %u arena bytes\n\r",
+        status.layers, status.length, status.channels, status.classes, status.macs, status.arena_used,
+        GESTURE_MANAGER_ARENA_SIZE);
+    printf("Classification: %s, %lu Hz rows, every %u rows, budget %lu us\n\r",
+        status.enabled ? "enabled" : "disabled", g_gesture.config.sample_hz, g_gesture.config.hop,
+        g_gesture.config.budget_us);
+    printf("Latest: class %d, confidence %.2f\n\r", status.gesture, (double) status.confidence);
+    printf("Inferences: %lu, over budget: %lu, late rows: %lu\n\r",
+        status.inferences, status.budget_overruns, status.late_rows);
+    printf("Time: last %lu us, max %lu us, %.2f%% of the hop, %.1f MAC/us\n\r",
+        status.last_us, status.max_us, 100.0 * (double) status.max_us / (double) window_us,
+        (status.last_us > 0) ? ((double) status.macs / (double) status.last_us) : 0.0);
+
+    for (uint16_t i = 0; i < status.channels; i++) {
+        const gesture_manager_feature_t* feature = &g_gesture.config.features[i];
+
+        switch (feature->kind) {
+            case GESTURE_FEATURE_ADC:
+                printf("  feature %u: adc %u\n\r", i, feature->index);
+                break;
+            case GESTURE_FEATURE_EMG:
+                printf("  feature %u: emg %u\n\r", i, feature->index);
+                break;
+            case GESTURE_FEATURE_SENSOR:
+                printf("  feature %u: %s %c\n\r", i, sensor_manager_type_to_string(feature->sensor_type),
+                    (char) ('x' + feature->index));
+                break;
+            default:
+                printf("  feature %u: none\n\r", i);
+                break;
+        }
+    }
+}
+
+static int handle_gesture_selftest(void) {
+    uint32_t mismatches = 0;
+    uint32_t start_us = time_us_32();
+    int result = nn_engine_self_test(&g_gesture.engine, &mismatches);
+    uint32_t elapsed_us = time_us_32() - start_us;
+
+    if (result < 0) {
+        printf("Model has no test vector\n\r");
+        return 1;
+    }
+
+    printf("Self test %s: %lu mismatched outputs, %lu us\n\r", (result == 1) ? "passed" : "FAILED", mismatches, elapsed_us);
+    return (result == 1) ? 0 : 1;
+}
+
+static void handle_gesture_bench(int runs) {
+    uint32_t total_us = 0;
+    uint32_t max_us = 0;
+
+    for (int i = 0; i < runs; i++) {
+        uint32_t start_us = time_us_32();
+        nn_engine_run(&g_gesture.engine, NULL, 0);
+        uint32_t elapsed_us = time_us_32() - start_us;
+
+        total_us += elapsed_us;
+        if (elapsed_us > max_us) {
+            max_us = elapsed_us;
+        }
+    }
+
+    float avg_us = (float) total_us / (float) runs;
+    printf("%d runs: average %.1f us, max %lu us, %.1f MAC/us\n\r", runs, (double) avg_us, max_us,
+        (avg_us > 0.0f) ? ((double) g_gesture.engine.macs / (double) avg_us) : 0.0);
+}
+
+int cmd_gesture(int argc, char *argv[]) {
+    if (!g_gesture.initialized) {
+        printf("Gesture manager not initialized\n\r");
+        return 1;
+    }
+
+    if (argc < 2 || strcmp(argv[1], "status") == 0) {
+        handle_gesture_status();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "load") == 0) {
+        return gesture_manager_load() ? 0 : 1;
+    }
+
+    if (strcmp(argv[1], "enable") == 0 || strcmp(argv[1], "disable") == 0) {
+        g_gesture.enabled = (strcmp(argv[1], "enable") == 0);
+        g_gesture.next_row_us = time_us_32();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "rate") == 0) {
+        if (argc < 4 || atoi(argv[2]) <= 0 || atoi(argv[3]) <= 0) {
+            printf("Usage: gesture rate <rows_per_second> <hop_rows>\n\r");
+            return 1;
+        }
+
+        g_gesture.config.sample_hz = (uint32_t) atoi(argv[2]);
+        g_gesture.config.hop = (uint16_t) atoi(argv[3]);
+        g_gesture.next_row_us = time_us_32();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "budget") == 0) {
+        if (argc < 3) {
+            printf("Usage: gesture budget <us>\n\r");
+            return 1;
+        }
+
+        g_gesture.config.budget_us = (uint32_t) strtoul(argv[2], NULL, 10);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "feature") == 0) {
+        if (argc < 4) {
+            printf("Usage: gesture feature <n> <none|adc <input>|emg <channel>|sensor <type> <x|y|z>>\n\r");
+            return 1;
+        }
+
+        int n = atoi(argv[2]);
+        if (n < 0 || n >= GESTURE_MANAGER_MAX_FEATURES) {
+            printf("Feature must be 0 to %d\n\r", GESTURE_MANAGER_MAX_FEATURES - 1);
+            return 1;
+        }
+
+        gesture_manager_feature_t feature = {GESTURE_FEATURE_NONE, 0, SENSOR_TYPE_UNKNOWN};
+
+        if (strcmp(argv[3], "adc") == 0 && argc > 4) {
+            feature.kind = GESTURE_FEATURE_ADC;
+            feature.index = (uint8_t) atoi(argv[4]);
+        } else if (strcmp(argv[3], "emg") == 0 && argc > 4) {
+            feature.kind = GESTURE_FEATURE_EMG;
+            feature.index = (uint8_t) atoi(argv[4]);
+        } else if (strcmp(argv[3], "sensor") == 0 && argc > 5 && argv[5][0] >= 'x' && argv[5][0] <= 'z') {
+            feature.kind = GESTURE_FEATURE_SENSOR;
+            feature.sensor_type = sensor_manager_type_from_string(argv[4]);
+            feature.index = (uint8_t) (argv[5][0] - 'x');
+        } else if (strcmp(argv[3], "none") != 0) {
+            printf("Unknown feature source: %s\n\r", argv[3]);
+            return 1;
+        }
+
+        g_gesture.config.features[n] = feature;
+        return 0;
+    }
+
+    if (!g_gesture.loaded) {
+        printf("No model loaded\n\r");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "selftest") == 0) {
+        return handle_gesture_selftest();
+    }
+
+    if (strcmp(argv[1], "bench") == 0) {
+        int runs = (argc > 2) ? atoi(argv[2]) : 100;
+        handle_gesture_bench((runs > 0) ? runs : 100);
+        return 0;
+    }
+
+    printf("Usage: gesture <status|load|selftest|bench|enable|disable|rate|budget|feature>\n\r");
+    return 1;
+}
+
+void register_gesture_manager_commands(void) {
+    static const shell_command_t gesture_command = {
+        cmd_gesture,
+        "gesture",
+        "Gesture classification (status|load|selftest|bench|enable|disable|rate|budget|feature)"
+    };
+
+    shell_register_command(&gesture_command);
+}
@@ -6,6 +6,7 @@
 */
 
 #include "interrupt_manager.h"
+#include "kernel_placement.h"
 #include "log_manager.h"
 #include "scheduler.h"
 #include "stats.h"
@@ -53,9 +54,9 @@ static uint32_t g_coalesced_active = 0;
 
 // Forward declarations
 static void interrupt_manager_task(void *param);
-static void interrupt_handler_wrapper(uint irq_num);
+KERNEL_ISR_FUNC static void interrupt_handler_wrapper(uint irq_num);
 static bool setup_interrupt_task(void);
-static void process_interrupt(interrupt_config_t *config);
+KERNEL_ISR_FUNC static void process_interrupt(interrupt_config_t *config);
 
 /**
  * @brief Initialize the interrupt manager
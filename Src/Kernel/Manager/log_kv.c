@@ -0,0 +1,264 @@
+/**
+* @file log_kv.c
+* @brief Encoding and rendering of structured key/value log records
+* @date 2025-05-27
+*/
+
+#include "log_kv.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Tag byte fields
+#define LOG_KV_TYPE_SHIFT 5
+#define LOG_KV_KEY_MASK 0x1F
+
+/**
+ * @brief Append a length-prefixed string
+ */
+static bool kv_put_str(uint8_t* out, size_t out_size, size_t* pos, const char* str) {
+    size_t len = str ? strlen(str) : 0;
+
+    if (len > LOG_KV_MAX_STR_LEN) {
+        len = LOG_KV_MAX_STR_LEN;
+    }
+
+    if (*pos + 1 + len > out_size) {
+        return false;
+    }
+
+    out[(*pos)++] = (uint8_t) len;
+    memcpy(&out[*pos], str, len);
+    *pos += len;
+
+    return true;
+}
+
+/**
+ * @brief Append an unsigned LEB128 varint
+ */
+static bool kv_put_varint(uint8_t* out, size_t out_size, size_t* pos, uint32_t value) {
+    do {
+        if (*pos >= out_size) {
+            return false;
+        }
+
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out[(*pos)++] = byte | (value ? 0x80 : 0);
+    } while (value);
+
+    return true;
+}
+
+/**
+ * @brief Read an unsigned LEB128 varint
+ */
+static bool kv_get_varint(const uint8_t* data, size_t len, size_t* pos, uint32_t* value) {
+    *value = 0;
+
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*pos >= len) {
+            return false;
+        }
+
+        uint8_t byte = data[(*pos)++];
+        *value |= (uint32_t) (byte & 0x7F) << shift;
+
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Read a length-prefixed string in place
+ */
+static bool kv_get_str(const uint8_t* data, size_t len, size_t* pos, const char** str, size_t* str_len) {
+    if (*pos >= len) {
+        return false;
+    }
+
+    *str_len = data[(*pos)++];
+
+    if (*pos + *str_len > len) {
+        return false;
+    }
+
+    *str = (const char*) &data[*pos];
+    *pos += *str_len;
+
+    return true;
+}
+
+size_t log_kv_encode(uint8_t* out, size_t out_size, const char* module, const char* event,
+                     const log_kv_t* fields, size_t count) {
+    size_t pos = 0;
+
+    if (out == NULL || count > UINT8_MAX || (count > 0 && fields == NULL)) {
+        return 0;
+    }
+
+    if (!kv_put_str(out, out_size, &pos, module) || !kv_put_str(out, out_size, &pos, event) ||
+        pos >= out_size) {
+        return 0;
+    }
+
+    out[pos++] = (uint8_t) count;
+
+    for (size_t i = 0; i < count; i++) {
+        const log_kv_t* field = &fields[i];
+        size_t key_len = field->key ? strlen(field->key) : 0;
+
+        if (key_len > LOG_KV_MAX_KEY_LEN) {
+            key_len = LOG_KV_MAX_KEY_LEN;
+        }
+
+        if (pos + 1 + key_len > out_size) {
+            return 0;
+        }
+
+        out[pos++] = (uint8_t) ((field->type << LOG_KV_TYPE_SHIFT) | key_len);
+        memcpy(&out[pos], field->key, key_len);
+        pos += key_len;
+
+        bool ok;
+        switch (field->type) {
+            case LOG_KV_U32:
+                ok = kv_put_varint(out, out_size, &pos, field->value.u32);
+                break;
+
+            case LOG_KV_I32:
+                ok = kv_put_varint(out, out_size, &pos,
+                    ((uint32_t) field->value.i32 << 1) ^ (uint32_t) (field->value.i32 >> 31));
+                break;
+
+            case LOG_KV_F32:
+                ok = (pos + sizeof(float) <= out_size);
+                if (ok) {
+                    memcpy(&out[pos], &field->value.f32, sizeof(float));
+                    pos += sizeof(float);
+                }
+                break;
+
+            case LOG_KV_STR:
+                ok = kv_put_str(out, out_size, &pos, field->value.str);
+                break;
+
+            case LOG_KV_BOOL:
+                ok = (pos < out_size);
+                if (ok) {
+                    out[pos++] = field->value.b ? 1 : 0;
+                }
+                break;
+
+            default:
+                ok = false;
+                break;
+        }
+
+        if (!ok) {
+            return 0;
+        }
+    }
+
+    return pos;
+}
+
+int log_kv_render(const uint8_t* data, size_t len, char* out, size_t out_size) {
+    size_t pos = 0;
+    size_t used = 0;
+    const char* str;
+    size_t str_len;
+
+    if (data == NULL || out == NULL || out_size == 0) {
+        return -1;
+    }
+
+    out[0] = '\0';
+
+// Append to out, stopping at the end of the buffer
+#define KV_APPEND(...) do { \
+        int n = snprintf(out + used, out_size - used, __VA_ARGS__); \
+        if (n > 0) { used += ((size_t) n < out_size - used) ? (size_t) n : out_size - used - 1; } \
+    } while (0)
+
+    if (!kv_get_str(data, len, &pos, &str, &str_len)) {
+        return -1;
+    }
+    KV_APPEND("[%.*s] ", (int) str_len, str);
+
+    if (!kv_get_str(data, len, &pos, &str, &str_len) || pos >= len) {
+        return -1;
+    }
+    KV_APPEND("%.*s", (int) str_len, str);
+
+    uint8_t count = data[pos++];
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (pos >= len) {
+            return -1;
+        }
+
+        uint8_t tag = data[pos++];
+        size_t key_len = tag & LOG_KV_KEY_MASK;
+
+        if (pos + key_len > len) {
+            return -1;
+        }
+
+        KV_APPEND(" %.*s=", (int) key_len, (const char*) &data[pos]);
+        pos += key_len;
+
+        uint32_t raw;
+        float f32;
+
+        switch ((log_kv_type_t) (tag >> LOG_KV_TYPE_SHIFT)) {
+            case LOG_KV_U32:
+                if (!kv_get_varint(data, len, &pos, &raw)) {
+                    return -1;
+                }
+                KV_APPEND("%lu", (unsigned long) raw);
+                break;
+
+            case LOG_KV_I32:
+                if (!kv_get_varint(data, len, &pos, &raw)) {
+                    return -1;
+                }
+                KV_APPEND("%ld", (long) ((int32_t) (raw >> 1) ^ -(int32_t) (raw & 1)));
+                break;
+
+            case LOG_KV_F32:
+                if (pos + sizeof(float) > len) {
+                    return -1;
+                }
+                memcpy(&f32, &data[pos], sizeof(float));
+                pos += sizeof(float);
+                KV_APPEND("%g", (double) f32);
+                break;
+
+            case LOG_KV_STR:
+                if (!kv_get_str(data, len, &pos, &str, &str_len)) {
+                    return -1;
+                }
+                KV_APPEND("\"%.*s\"", (int) str_len, str);
+                break;
+
+            case LOG_KV_BOOL:
+                if (pos >= len) {
+                    return -1;
+                }
+                KV_APPEND("%s", data[pos++] ? "true" : "false");
+                break;
+
+            default:
+                return -1;
+        }
+    }
+
+#undef KV_APPEND
+
+    return (int) used;
+}
@@ -5,9 +5,11 @@
 * @date 2025-05-14
 */
 
+#include "kernel_placement.h"
 #include "log_manager.h"
 #include "scheduler.h"
 #include "spinlock_manager.h"
+#include "usb_shell.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
@@ -15,6 +17,7 @@
 #include <limits.h>
 #include "pico/stdlib.h"
 #include "hardware/flash.h"
+#include "pico/flash.h"
 #include "pico/multicore.h"
 #include "hardware/watchdog.h"
 
@@ -40,12 +43,81 @@
 #define DEFAULT_SDCARD_FILENAME "logs.txt"
 #define DEFAULT_FLASH_OFFSET (1024 * 1024)  // 1MB offset
 #define DEFAULT_FLASH_SIZE (256 * 1024)     // 256KB size
+#define DEFAULT_DRAIN_BUDGET_US 500
+
+// Output block sizes, one write is issued per full block
+#define LOG_SDCARD_BLOCK_SIZE 512
+#define LOG_FLASH_TIMEOUT_MS 10
+
+// Window over which the drain rate is measured
+#define LOG_RATE_WINDOW_US 1000000
+
+// Flash index, one entry per sector with a seek point every stride bytes
+#define LOG_FLASH_RECORD_MAGIC 0xA5
+#define LOG_INDEX_POINT_STRIDE 1024
+#define LOG_INDEX_POINTS (FLASH_SECTOR_SIZE / LOG_INDEX_POINT_STRIDE)
+#define LOG_INDEX_NO_POINT 0xFFFF
+
+// Header queued ahead of each message in the main buffer
+typedef struct {
+    uint16_t length;        // Message bytes following the header
+    uint16_t module_hash;   // log_module_hash() of the module name
+    uint8_t level;          // log_level_t of the message
+    uint8_t format;         // log_format_t of the message bytes
+    uint8_t core_id;        // Core that logged the message
+    uint8_t reserved;
+    uint32_t seq;           // Sequence number
+    uint32_t timestamp_ms;  // Milliseconds since boot when logged
+    uint32_t enqueue_us;    // time_us_32() when queued, for backlog age
+} log_record_header_t;
+
+// Header written ahead of each message in flash, records never span a sector
+typedef struct {
+    uint8_t magic;          // LOG_FLASH_RECORD_MAGIC, erased flash reads 0xFF
+    uint8_t level;
+    uint16_t length;
+    uint16_t module_hash;
+    uint8_t format;
+    uint8_t reserved;
+    uint32_t seq;
+    uint32_t timestamp_ms;
+} log_flash_record_t;
+
+// Seek point, the first record starting in a stride of a sector
+typedef struct {
+    uint32_t timestamp_ms;
+    uint16_t offset;        // Offset within the sector, LOG_INDEX_NO_POINT if none
+    uint16_t reserved;
+} log_index_point_t;
+
+// Index entry for one flash sector
+typedef struct {
+    uint32_t first_seq;
+    uint32_t last_seq;
+    uint32_t first_ms;
+    uint32_t last_ms;
+    uint32_t module_mask;   // Bit per module hash bucket
+    uint16_t record_count;
+    uint8_t level_mask;     // Bit per log_level_t
+    uint8_t reserved;
+    log_index_point_t points[LOG_INDEX_POINTS];
+} log_index_sector_t;
+
+// Flash operation run with the other core locked out
+typedef struct {
+    uint32_t offset;
+    const uint8_t* data;
+    bool erase;
+} log_flash_op_t;
 
 // Internal configuration and state
 typedef struct {
     uint32_t buffer_head;
     uint32_t buffer_tail;
     uint32_t buffer_count;
+    uint32_t record_count;
+    uint32_t records_dropped;
+    uint32_t records_suppressed;
     uint32_t sequence_counter;
     uint32_t log_lock_num;
 
@@ -56,6 +128,18 @@ typedef struct {
     uint32_t console_lock_num;
 
     uint32_t flash_write_offset;
+    uint32_t flash_page_fill;
+    bool flash_page_programmed;     // Partial page already written at flash_write_offset
+    uint32_t sdcard_block_fill;
+
+    log_index_sector_t* index;      // One entry per sector of the flash region
+    uint32_t index_sectors;
+    uint32_t index_current;         // Sector being written, UINT32_MAX if none
+    uint32_t boot_seq;              // First sequence number of this boot
+
+    uint32_t rate_window_start_us;
+    uint32_t rate_window_records;
+    log_stats_t stats;
 
     log_level_t current_levels[3];  // Console, SD card, Flash
 
@@ -71,9 +155,11 @@ typedef struct {
     
     uint8_t* buffer;
     uint8_t* console_buffer;
+    uint8_t* drain_record;
     char* temp_buffer;
     
-    
+    uint8_t flash_page[FLASH_PAGE_SIZE];
+    uint8_t sdcard_block[LOG_SDCARD_BLOCK_SIZE];
 } log_state_t;
 
 // Global logging state
@@ -81,8 +167,15 @@ static log_state_t log_state;
 
 // Forward declarations for internal functions
 static void log_write_console(const log_message_t* message, const char* formatted_message);
-static void log_write_sdcard(const char* formatted_message);
-static void log_write_flash(const char* formatted_message);
+static void log_write_sdcard(const uint8_t* data, uint32_t len);
+static void log_write_flash(const uint8_t* data, uint32_t len);
+static void log_flash_append_record(const log_record_header_t* header, const uint8_t* text);
+static void log_index_rebuild(void);
+static uint16_t log_module_hash(const char* module);
+static size_t log_format_prefix(char* out, size_t size, uint32_t ms, log_level_t level,
+                                uint8_t core_id, const char* module);
+static void log_flush_sdcard(void);
+static void log_flush_flash(void);
 static const char* log_level_to_string(log_level_t level);
 static const char* log_level_to_color(log_level_t level);
 
@@ -91,8 +184,6 @@ static inline void log_release_lock(uint32_t save);
 static inline uint32_t console_acquire_lock(void);
 static inline void console_release_lock(uint32_t save);
 
-void log_scheduler_task(void* params);
-
 // Scheduler task ID
 static int g_log_task_id = -1;
 
@@ -128,66 +219,67 @@ bool log_init_as_task(void) {
         return false;
     }
     
+    // Log flushing is rate limited when the scheduler is degraded
+    scheduler_set_criticality(g_log_task_id, TASK_CRITICALITY_MEDIUM);
+    
     printf("INFO: Logging task created with ID: %d\n", g_log_task_id);
     return true;
 }
 
 /**
- * @brief Check if log processing should be performed
- * 
- * Determines whether the logging system is ready to process messages
- * based on initialization status and buffer content.
+ * @brief Copy bytes into the main buffer at the head
  * 
- * @return true if processing should proceed, false otherwise
+ * @note Caller must hold the log lock and have checked for space
  */
-static bool should_process_logs(void) {
-    return (log_state.initialized && log_state.buffer_count > 4);
+static void log_ring_put(const void* src, uint32_t len) {
+    const uint8_t* bytes = (const uint8_t*) src;
+    uint32_t first = log_state.config.buffer_size - log_state.buffer_head;
+
+    if (first > len) {
+        first = len;
+    }
+
+    memcpy(&log_state.buffer[log_state.buffer_head], bytes, first);
+    memcpy(log_state.buffer, bytes + first, len - first);
+
+    log_state.buffer_head = (log_state.buffer_head + len) % log_state.config.buffer_size;
+    log_state.buffer_count += len;
 }
 
 /**
- * @brief Extract message length from the log buffer
+ * @brief Copy bytes from the tail of the main buffer without consuming them
  * 
- * Reads a 4-byte message length from the front of the circular buffer.
- * The length is stored in big-endian format.
- * 
- * @param[out] msg_len Pointer to store the extracted message length
- * @return true if length extracted successfully, false on insufficient data
- * 
- * @note This function modifies buffer_tail and buffer_count
- * @note Caller must hold the log lock before calling this function
+ * @note Caller must hold the log lock and have checked buffer_count
  */
-static bool extract_message_length(uint32_t *msg_len) {
-    if (!msg_len || log_state.buffer_count < 4) {
-        return false;
-    }
-    
-    *msg_len = 0;
-    for (int i = 0; i < 4; i++) {
-        *msg_len = (*msg_len << 8) | log_state.buffer[log_state.buffer_tail];
-        log_state.buffer_tail = (log_state.buffer_tail + 1) % log_state.config.buffer_size;
-        log_state.buffer_count--;
+static void log_ring_peek(void* dst, uint32_t len) {
+    uint8_t* bytes = (uint8_t*) dst;
+    uint32_t first = log_state.config.buffer_size - log_state.buffer_tail;
+
+    if (first > len) {
+        first = len;
     }
-    
-    return true;
+
+    memcpy(bytes, &log_state.buffer[log_state.buffer_tail], first);
+    memcpy(bytes + first, log_state.buffer, len - first);
 }
 
 /**
- * @brief Validate extracted message length
- * 
- * Checks if the message length is within acceptable bounds.
+ * @brief Copy bytes from the tail of the main buffer and consume them
  * 
- * @param[in] msg_len Message length to validate
- * @return true if length is valid, false otherwise
+ * @note Caller must hold the log lock and have checked buffer_count
  */
-static bool is_valid_message_length(uint32_t msg_len) {
-    return (msg_len > 0 && msg_len <= log_state.config.max_message_size);
+static void log_ring_take(void* dst, uint32_t len) {
+    log_ring_peek(dst, len);
+
+    log_state.buffer_tail = (log_state.buffer_tail + len) % log_state.config.buffer_size;
+    log_state.buffer_count -= len;
 }
 
 /**
  * @brief Reset log buffer to empty state
  * 
  * Clears the circular buffer by resetting head, tail, and count to zero.
- * This is typically called when an invalid message is detected.
+ * This is typically called when an invalid record is detected.
  * 
  * @note Caller must hold the log lock before calling this function
  */
@@ -195,131 +287,45 @@ static void reset_log_buffer(void) {
     log_state.buffer_head = 0;
     log_state.buffer_tail = 0;
     log_state.buffer_count = 0;
+    log_state.record_count = 0;
 }
 
 /**
- * @brief Extract message content from the log buffer
- * 
- * Reads message content from the circular buffer into a local buffer.
- * The message is null-terminated and truncated if it exceeds buffer size.
- * 
- * @param[in] msg_len Length of message to extract
- * @param[out] msg_buffer Buffer to store the extracted message
- * @param[in] buffer_size Size of the destination buffer
- * @return Number of bytes actually extracted
- * 
- * @note This function modifies buffer_tail and buffer_count
- * @note Caller must hold the log lock before calling this function
- */
-static size_t extract_message_content(uint32_t msg_len, char *msg_buffer, size_t buffer_size) {
-    if (!msg_buffer || buffer_size == 0) {
-        return 0;
-    }
-    
-    size_t max_extract = (buffer_size > 1) ? (buffer_size - 1) : 0;
-    size_t bytes_to_extract = (msg_len < max_extract) ? msg_len : max_extract;
-    
-    for (size_t i = 0; i < bytes_to_extract && log_state.buffer_count > 0; i++) {
-        msg_buffer[i] = log_state.buffer[log_state.buffer_tail];
-        log_state.buffer_tail = (log_state.buffer_tail + 1) % log_state.config.buffer_size;
-        log_state.buffer_count--;
-    }
-    
-    // Null-terminate the message
-    size_t null_pos = (bytes_to_extract < max_extract) ? bytes_to_extract : max_extract;
-    msg_buffer[null_pos] = '\0';
-    
-    return bytes_to_extract;
-}
-
-/**
- * @brief Output message to all active log destinations
+ * @brief Output one drained record to the SD card and flash
  * 
- * Writes the message to each enabled logging destination (SD card, flash, etc.).
- * This function operates without holding locks to avoid blocking.
+ * Each destination applies its own level, so a record queued for the SD
+ * card does not also reach flash unless it passes the flash level. The SD
+ * card gets text lines, flash gets framed records for the index.
  * 
- * @param[in] message Null-terminated message string to output
+ * @param[in] header Header of the record
+ * @param[in] text Message bytes, not null-terminated
  * 
  * @note This function should be called without holding the log lock
  */
-static void output_message_to_destinations(const char *message) {
-    if (!message) {
-        return;
-    }
-    
-    if (log_state.active_destinations & LOG_DEST_SDCARD) {
-        log_write_sdcard(message);
-    }
-    
-    if (log_state.active_destinations & LOG_DEST_FLASH) {
-        log_write_flash(message);
-    }
-}
-
-/**
- * @brief Process a single log message from the buffer
- * 
- * Extracts one complete message from the log buffer, validates it,
- * and outputs it to all active destinations.
- * 
- * @return true if message processed successfully, false on error or invalid message
- * 
- * @note Returns false on invalid message length, causing buffer reset
- */
-static bool process_single_message(void) {
-    // Check if we have enough data for at least length + some content
-    if (log_state.buffer_count <= 4) {
-        return false;
-    }
-    
-    uint32_t save = log_acquire_lock();
-    
-    // Extract message length
-    uint32_t msg_len;
-    if (!extract_message_length(&msg_len)) {
-        log_release_lock(save);
-        return false;
-    }
-    
-    // Validate message length
-    if (!is_valid_message_length(msg_len)) {
-        // Invalid length - reset buffer and exit
-        reset_log_buffer();
-        log_release_lock(save);
-        return false;
-    }
-    
-    // Extract message content
-    char msg_buffer[DEFAULT_MAX_MESSAGE_SIZE];
-    size_t extracted = extract_message_content(msg_len, msg_buffer, sizeof(msg_buffer));
-    
-    log_release_lock(save);
-    
-    // Output message to destinations (without holding lock)
-    if (extracted > 0) {
-        output_message_to_destinations(msg_buffer);
-        return true;
+static void output_record_to_destinations(const log_record_header_t* header, const uint8_t* text) {
+    static const uint8_t newline = '\n';
+
+    if ((log_state.active_destinations & LOG_DEST_SDCARD) &&
+        header->level >= log_state.current_levels[1]) {
+        if (header->format == LOG_FORMAT_KV) {
+            char line[DEFAULT_MAX_MESSAGE_SIZE];
+            size_t offset = log_format_prefix(line, sizeof(line), header->timestamp_ms,
+                                              (log_level_t) header->level, header->core_id, NULL);
+            int rendered = log_kv_render(text, header->length, line + offset, sizeof(line) - offset);
+
+            if (rendered >= 0) {
+                log_write_sdcard((const uint8_t*) line, offset + rendered);
+                log_write_sdcard(&newline, 1);
+            }
+        } else {
+            log_write_sdcard(text, header->length);
+            log_write_sdcard(&newline, 1);
+        }
     }
     
-    return false;
-}
-
-/**
- * @brief Process multiple log messages with rate limiting
- * 
- * Processes up to a maximum number of messages per call to maintain
- * system responsiveness. This implements rate limiting for log processing.
- * 
- * @param[in] max_messages Maximum number of messages to process in this call
- */
-static void process_pending_messages(int max_messages) {
-    int processed = 0;
-    
-    while (processed < max_messages && should_process_logs()) {
-        if (!process_single_message()) {
-            break;  // Stop on error or invalid message
-        }
-        processed++;
+    if ((log_state.active_destinations & LOG_DEST_FLASH) &&
+        header->level >= log_state.current_levels[2]) {
+        log_flash_append_record(header, text);
     }
 }
 
@@ -389,30 +395,29 @@ static void process_console_messages(int max_messages) {
     }
 }
 
-
-
-
 /**
  * @brief Scheduler task for processing log messages
  * 
- * This task is called regularly by the scheduler to process pending log messages
- * from the circular buffer. It implements rate limiting to maintain system
- * responsiveness by processing at most 2 messages per execution.
+ * Drains queued records for up to drain_budget_us per run, then replays
+ * console messages that were buffered while USB was disconnected.
  * 
- * The task performs the following operations:
- * 1. Checks if log processing should be performed
- * 2. Processes up to 2 messages per execution
- * 3. For each message: extracts length, validates it, extracts content, and outputs
- * 4. Resets buffer on invalid messages to prevent corruption
- * 
- * @param[in] params Task parameters (unused, marked as void to avoid warnings)
- * 
- * @note This function is designed to be non-blocking and responsive
- * @note Invalid messages cause the entire buffer to be reset for safety
- * @note Lock is released before writing to destinations to prevent blocking
+ * @param[in] params Task parameters (unused)
+ */
+void log_scheduler_task(void* params) {
+    (void) params;
+
+    log_process();
+
+    if (log_state.console_count > 0 && stdio_usb_connected()) {
+        process_console_messages(8);
+    }
+}
+
+/**
+ * @brief Flush all pending log messages
  * 
- * @see process_single_message() for individual message processing
- * @see output_message_to_destinations() for destination handling
+ * Drains the whole buffer, then writes out the partially filled SD card
+ * block and flash page so nothing is left only in RAM.
  */
 void log_flush(void) {
     if (!log_state.initialized) {
@@ -424,13 +429,16 @@ void log_flush(void) {
         log_process();
     }
 
+    log_flush_sdcard();
+    log_flush_flash();
+
     // Flush console buffer if USB is connected
     if (stdio_usb_connected()) {
-        uint32_t save = console_acquire_lock();
         while (log_state.console_count > 0) {
-            process_single_console_message();
+            if (!process_single_console_message()) {
+                break;
+            }
         }
-        console_release_lock(save);
     }
 }
 
@@ -481,12 +489,21 @@ bool log_init_core(const log_config_t* config) {
         free(log_state.buffer);
         return false;
     }
+
+    // Allocate buffer for the record being drained
+    log_state.drain_record = malloc(log_state.config.max_message_size);
+    if (log_state.drain_record == NULL) {
+        free(log_state.buffer);
+        free(log_state.temp_buffer);
+        return false;
+    }
     
     // Initialize buffer pointers
     log_state.buffer_head = 0;
     log_state.buffer_tail = 0;
     log_state.buffer_count = 0;
-    log_state.sequence_counter = 0;
+    log_state.record_count = 0;
+    log_state.records_dropped = 0;
 
     // Allocate console buffer
     log_state.console_buffer_size = DEFAULT_BUFFER_SIZE;
@@ -494,6 +511,7 @@ bool log_init_core(const log_config_t* config) {
     if (log_state.console_buffer == NULL) {
         free(log_state.buffer);
         free(log_state.temp_buffer);
+        free(log_state.drain_record);
         return false;
     }
 
@@ -509,8 +527,26 @@ bool log_init_core(const log_config_t* config) {
     // Set active destinations
     log_state.active_destinations = LOG_DEST_CONSOLE;  // Start with console only
     
-    // Initialize flash offset
+    // Initialize flash offset, pages are only programmed whole
+    log_state.config.flash_offset &= ~(FLASH_SECTOR_SIZE - 1);
+    log_state.config.flash_size &= ~(FLASH_SECTOR_SIZE - 1);
     log_state.flash_write_offset = log_state.config.flash_offset;
+    log_state.flash_page_fill = 0;
+    log_state.flash_page_programmed = false;
+    log_state.sdcard_block_fill = 0;
+
+    // Index the records already in flash and continue after the newest
+    log_state.index_sectors = log_state.config.flash_size / FLASH_SECTOR_SIZE;
+    log_state.index = calloc(log_state.index_sectors, sizeof(log_index_sector_t));
+    log_state.index_current = UINT32_MAX;
+    if (log_state.index != NULL) {
+        log_index_rebuild();
+    }
+    log_state.boot_seq = log_state.sequence_counter;
+
+    memset(&log_state.stats, 0, sizeof(log_stats_t));
+    log_state.rate_window_records = 0;
+    log_state.rate_window_start_us = time_us_32();
     
     // We start without spinlocks - will be set up later
     log_state.using_spinlocks = false;
@@ -579,6 +615,153 @@ bool log_init(const log_config_t* config) {
 // Now replace all mutex_enter_blocking/mutex_exit calls with log_acquire_lock/log_release_lock
 // And all direct printf calls in log_write_console with protected console output
 
+/**
+ * @brief Format the "[time] [LEVEL] [Cn] [Module] " prefix of a log line
+ * 
+ * @param module Module name, or NULL to leave it out
+ * @return Length of the prefix
+ */
+static size_t log_format_prefix(char* out, size_t size, uint32_t ms, log_level_t level,
+                                uint8_t core_id, const char* module) {
+    size_t offset = 0;
+
+    out[0] = '\0';
+
+    // Add timestamp
+    if (log_state.config.include_timestamp) {
+        offset += snprintf(out + offset, size - offset, "[%5lu.%03lu] ", ms / 1000, ms % 1000);
+    }
+    
+    // Add level
+    if (log_state.config.include_level && offset < size) {
+        offset += snprintf(out + offset, size - offset, "[%s] ", log_level_to_string(level));
+    }
+    
+    // Add core ID
+    if (log_state.config.include_core_id && offset < size) {
+        offset += snprintf(out + offset, size - offset, "[C%d] ", core_id);
+    }
+    
+    // Add module
+    if (module && offset < size) {
+        offset += snprintf(out + offset, size - offset, "[%s] ", module);
+    }
+
+    return (offset < size) ? offset : size - 1;
+}
+
+/**
+ * @brief Check whether a level is queued for the SD card or flash
+ */
+static bool log_wants_queue(log_level_t level) {
+    return ((log_state.active_destinations & LOG_DEST_SDCARD) && 
+            level >= log_state.current_levels[1]) ||
+           ((log_state.active_destinations & LOG_DEST_FLASH) && 
+            level >= log_state.current_levels[2]);
+}
+
+/**
+ * @brief Print a formatted line, or buffer it while USB is disconnected
+ */
+static void log_output_console(log_level_t level, const char* formatted_message) {
+    uint32_t console_save = console_acquire_lock();
+
+    if (stdio_usb_connected()) {
+        // Print directly if USB is connected
+        if (log_state.config.color_output) {
+            printf("%s%s%s\n", log_level_to_color(level), formatted_message, ANSI_COLOR_RESET);
+        } else {
+            printf("%s\n", formatted_message);
+        }
+        fflush(stdout);
+    } else {
+        // Buffer the message with newline
+        size_t msg_len = strlen(formatted_message);
+        size_t total_len = msg_len + 1; // +1 for '\n'
+        uint32_t required_space = 4 + total_len;
+
+        if (log_state.console_count + required_space <= log_state.console_buffer_size) {
+            // Write 4-byte length (big-endian)
+            uint32_t len = total_len;
+            for (int i = 0; i < 4; i++) {
+                log_state.console_buffer[log_state.console_head] = (len >> (24 - i * 8)) & 0xFF;
+                log_state.console_head = (log_state.console_head + 1) % log_state.console_buffer_size;
+                log_state.console_count++;
+            }
+
+            // Write message content
+            for (size_t i = 0; i < msg_len; i++) {
+                log_state.console_buffer[log_state.console_head] = formatted_message[i];
+                log_state.console_head = (log_state.console_head + 1) % log_state.console_buffer_size;
+                log_state.console_count++;
+            }
+
+            // Add newline
+            log_state.console_buffer[log_state.console_head] = '\n';
+            log_state.console_head = (log_state.console_head + 1) % log_state.console_buffer_size;
+            log_state.console_count++;
+        } else {
+            // Handle overflow
+            static uint32_t overflow_count = 0;
+            if (++overflow_count % 100 == 1) {
+                // Attempt to log overflow (may fail if buffer full)
+                char overflow_msg[64];
+                snprintf(overflow_msg, sizeof(overflow_msg), 
+                        "WARNING: Console buffer overflow (%lu messages dropped)", overflow_count);
+                // Add to main log buffer if possible
+                log_message(LOG_LEVEL_WARN, "LogMgr", overflow_msg);
+            }
+        }
+    }
+
+    console_release_lock(console_save);
+}
+
+/**
+ * @brief Queue a record for the SD card and flash
+ * 
+ * @param format LOG_FORMAT_TEXT for a formatted line, LOG_FORMAT_KV for a log_kv payload
+ */
+static void log_enqueue(log_level_t level, const char* module, log_format_t format,
+                        const void* payload, size_t len, uint32_t timestamp_ms, uint8_t core_id) {
+    // Acquire lock to add to buffer
+    uint32_t save = log_acquire_lock();
+    
+    if (len >= log_state.config.max_message_size) {
+        len = log_state.config.max_message_size - 1;
+    }
+    
+    // Check if we have space
+    if (log_state.buffer_count + sizeof(log_record_header_t) + len <= log_state.config.buffer_size) {
+        log_record_header_t header = {
+            .length = (uint16_t) len,
+            .module_hash = log_module_hash(module),
+            .level = (uint8_t) level,
+            .format = (uint8_t) format,
+            .core_id = core_id,
+            .seq = log_state.sequence_counter++,
+            .timestamp_ms = timestamp_ms,
+            .enqueue_us = time_us_32()
+        };
+
+        log_ring_put(&header, sizeof(header));
+        log_ring_put(payload, len);
+        log_state.record_count++;
+    } else {
+        // Buffer full - note the overflow but don't overwrite
+        if (++log_state.records_dropped % 100 == 1) {
+            printf("WARNING: Log buffer overflow (%lu messages dropped)\n", log_state.records_dropped);
+        }
+    }
+    
+    log_release_lock(save);
+    
+    // Now that we've queued the message, make sure the task runs soon
+    if (g_log_task_id >= 0) {
+        scheduler_resume_task(g_log_task_id);  // Hint to scheduler to run log task
+    }
+}
+
 /**
  * @brief Add a log message to the buffer
  */
@@ -612,38 +795,9 @@ void log_message(log_level_t level, const char* module, const char* format, ...)
     
     // Construct the formatted message
     char formatted_message[DEFAULT_MAX_MESSAGE_SIZE];
-    size_t offset = 0;
-    
-    // Add timestamp
-    if (log_state.config.include_timestamp) {
-        uint32_t ms = to_ms_since_boot(message.timestamp);
-        offset += snprintf(formatted_message + offset, 
-                         sizeof(formatted_message) - offset,
-                         "[%5lu.%03lu] ", 
-                         ms / 1000, ms % 1000);
-    }
-    
-    // Add level
-    if (log_state.config.include_level) {
-        offset += snprintf(formatted_message + offset,
-                         sizeof(formatted_message) - offset,
-                         "[%s] ", 
-                         log_level_to_string(message.level));
-    }
-    
-    // Add core ID
-    if (log_state.config.include_core_id) {
-        offset += snprintf(formatted_message + offset,
-                         sizeof(formatted_message) - offset,
-                         "[C%d] ", 
-                         message.core_id);
-    }
-    
-    // Add module
-    offset += snprintf(formatted_message + offset,
-                     sizeof(formatted_message) - offset,
-                     "[%s] ", 
-                     message.module);
+    uint32_t ms = to_ms_since_boot(message.timestamp);
+    size_t offset = log_format_prefix(formatted_message, sizeof(formatted_message), ms,
+                                      message.level, message.core_id, message.module);
     
     // Add message
     snprintf(formatted_message + offset,
@@ -652,139 +806,108 @@ void log_message(log_level_t level, const char* module, const char* format, ...)
            message.message);
     
     if ((log_state.active_destinations & LOG_DEST_CONSOLE) && level >= log_state.current_levels[0]) {
-        uint32_t console_save = console_acquire_lock();
-
-        if (stdio_usb_connected()) {
-            // Print directly if USB is connected
-            if (log_state.config.color_output) {
-                printf("%s%s%s\n", log_level_to_color(message.level), formatted_message, ANSI_COLOR_RESET);
-            } else {
-                printf("%s\n", formatted_message);
-            }
-            fflush(stdout);
-        } else {
-            // Buffer the message with newline
-            size_t msg_len = strlen(formatted_message);
-            size_t total_len = msg_len + 1; // +1 for '\n'
-            uint32_t required_space = 4 + total_len;
-
-            if (log_state.console_count + required_space <= log_state.console_buffer_size) {
-                // Write 4-byte length (big-endian)
-                uint32_t len = total_len;
-                for (int i = 0; i < 4; i++) {
-                    log_state.console_buffer[log_state.console_head] = (len >> (24 - i * 8)) & 0xFF;
-                    log_state.console_head = (log_state.console_head + 1) % log_state.console_buffer_size;
-                    log_state.console_count++;
-                }
-
-                // Write message content
-                for (size_t i = 0; i < msg_len; i++) {
-                    log_state.console_buffer[log_state.console_head] = formatted_message[i];
-                    log_state.console_head = (log_state.console_head + 1) % log_state.console_buffer_size;
-                    log_state.console_count++;
-                }
-
-                // Add newline
-                log_state.console_buffer[log_state.console_head] = '\n';
-                log_state.console_head = (log_state.console_head + 1) % log_state.console_buffer_size;
-                log_state.console_count++;
-            } else {
-                // Handle overflow
-                static uint32_t overflow_count = 0;
-                if (++overflow_count % 100 == 1) {
-                    // Attempt to log overflow (may fail if buffer full)
-                    char overflow_msg[64];
-                    snprintf(overflow_msg, sizeof(overflow_msg), 
-                            "WARNING: Console buffer overflow (%lu messages dropped)", overflow_count);
-                    // Add to main log buffer if possible
-                    log_message(LOG_LEVEL_WARN, "LogMgr", overflow_msg);
-                }
-            }
-        }
-
-        console_release_lock(console_save);
+        log_output_console(level, formatted_message);
     }
     
     // Queue for other destinations (processed by task)
-    if (((log_state.active_destinations & LOG_DEST_SDCARD) && 
-         level >= log_state.current_levels[1]) ||
-        ((log_state.active_destinations & LOG_DEST_FLASH) && 
-         level >= log_state.current_levels[2])) {
-        
-        // Acquire lock to add to buffer
-        uint32_t save = log_acquire_lock();
-        
-        // Store in circular buffer
-        size_t msg_len = strlen(formatted_message);
-        
-        // Check if we have space
-        if (log_state.buffer_count + msg_len + 4 <= log_state.config.buffer_size) {
-            // Store length
-            uint8_t len_bytes[4];
-            len_bytes[0] = (msg_len >> 24) & 0xFF;
-            len_bytes[1] = (msg_len >> 16) & 0xFF;
-            len_bytes[2] = (msg_len >> 8) & 0xFF;
-            len_bytes[3] = msg_len & 0xFF;
-            
-            for (int i = 0; i < 4; i++) {
-                log_state.buffer[log_state.buffer_head] = len_bytes[i];
-                log_state.buffer_head = (log_state.buffer_head + 1) % log_state.config.buffer_size;
-                log_state.buffer_count++;
-            }
-            
-            // Store message
-            for (size_t i = 0; i < msg_len; i++) {
-                log_state.buffer[log_state.buffer_head] = formatted_message[i];
-                log_state.buffer_head = (log_state.buffer_head + 1) % log_state.config.buffer_size;
-                log_state.buffer_count++;
-            }
-        } else {
-            // Buffer full - note the overflow but don't overwrite
-            static uint32_t overflow_count = 0;
-            if (++overflow_count % 100 == 1) {
-                printf("WARNING: Log buffer overflow (%lu messages dropped)\n", overflow_count);
-            }
-        }
-        
-        log_release_lock(save);
-        
-        // Now that we've queued the message, make sure the task runs soon
-        if (g_log_task_id >= 0) {
-            scheduler_resume_task(g_log_task_id);  // Hint to scheduler to run log task
-        }
+    if (log_wants_queue(level)) {
+        log_enqueue(level, module, LOG_FORMAT_TEXT, formatted_message, strlen(formatted_message),
+                    ms, message.core_id);
     }
 }
 
 /**
- * @brief Get default logging configuration
+ * @brief Add a structured log record to the buffer
+ * 
+ * The fields are encoded once. Text is only rendered when the record goes
+ * to the console, and for the SD card when it is drained.
  */
 
-void log_get_default_config(log_config_t* config) {
-    if (config == NULL) {
+void log_kv_message(log_level_t level, const char* module, const char* event,
+                    const log_kv_t* fields, size_t count) {
+    bool to_console = (log_state.active_destinations & LOG_DEST_CONSOLE) &&
+                      level >= log_state.current_levels[0];
+
+    if (log_state.initialized && !to_console && !log_wants_queue(level)) {
         return;
     }
-    
-    memset(config, 0, sizeof(log_config_t));
-    
-    config->console_level = LOG_LEVEL_DEBUG;
-    config->sdcard_level = LOG_LEVEL_DEBUG;
-    config->flash_level = LOG_LEVEL_ERROR;
-    config->buffer_size = DEFAULT_BUFFER_SIZE;
-    config->max_message_size = DEFAULT_MAX_MESSAGE_SIZE;
-    config->sdcard_filename = DEFAULT_SDCARD_FILENAME;
-    config->flash_offset = DEFAULT_FLASH_OFFSET;
-    config->flash_size = DEFAULT_FLASH_SIZE;
-    config->include_timestamp = true;
-    config->include_level = true;
-    config->include_core_id = true;
-    config->color_output = true;
-}
 
-/**
- * @brief Set the global logging level
- */
+    uint8_t payload[DEFAULT_MAX_MESSAGE_SIZE];
+    size_t len = log_kv_encode(payload, sizeof(payload), module, event, fields, count);
 
-void log_set_level(log_level_t level, log_destination_t destination) {
+    if (len == 0) {
+        log_message(LOG_LEVEL_WARN, "LogMgr", "Structured record %s too large", event);
+        return;
+    }
+
+    uint32_t ms = to_ms_since_boot(get_absolute_time());
+    uint8_t core_id = (uint8_t) (get_core_num() & 0xFF);
+
+    if (!log_state.initialized || to_console) {
+        char formatted_message[DEFAULT_MAX_MESSAGE_SIZE];
+        size_t offset = log_format_prefix(formatted_message, sizeof(formatted_message), ms,
+                                          level, core_id, NULL);
+
+        log_kv_render(payload, len, formatted_message + offset, sizeof(formatted_message) - offset);
+
+        if (!log_state.initialized) {
+            printf("%s\n", formatted_message);
+            return;
+        }
+
+        log_output_console(level, formatted_message);
+    }
+
+    if (log_wants_queue(level)) {
+        log_enqueue(level, module, LOG_FORMAT_KV, payload, len, ms, core_id);
+    }
+}
+
+/**
+ * @brief Log how many messages a call site suppressed
+ */
+
+void log_suppressed_summary(log_level_t level, const char* module, uint32_t count) {
+    if (log_state.initialized) {
+        uint32_t save = log_acquire_lock();
+        log_state.records_suppressed += count;
+        log_release_lock(save);
+    }
+
+    log_message(level, module, "...repeated %lu times", count);
+}
+
+/**
+ * @brief Get default logging configuration
+ */
+
+void log_get_default_config(log_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+    
+    memset(config, 0, sizeof(log_config_t));
+    
+    config->console_level = LOG_LEVEL_DEBUG;
+    config->sdcard_level = LOG_LEVEL_DEBUG;
+    config->flash_level = LOG_LEVEL_ERROR;
+    config->buffer_size = DEFAULT_BUFFER_SIZE;
+    config->max_message_size = DEFAULT_MAX_MESSAGE_SIZE;
+    config->sdcard_filename = DEFAULT_SDCARD_FILENAME;
+    config->flash_offset = DEFAULT_FLASH_OFFSET;
+    config->flash_size = DEFAULT_FLASH_SIZE;
+    config->drain_budget_us = DEFAULT_DRAIN_BUDGET_US;
+    config->include_timestamp = true;
+    config->include_level = true;
+    config->include_core_id = true;
+    config->color_output = true;
+}
+
+/**
+ * @brief Set the global logging level
+ */
+
+void log_set_level(log_level_t level, log_destination_t destination) {
     uint32_t save = hw_spinlock_acquire(log_state.log_lock_num, scheduler_get_current_task());
     
     
@@ -823,91 +946,127 @@ void log_set_destinations(uint8_t destinations) {
 
 /**
  * @brief Process and output pending log messages
+ * 
+ * Drains whole records until the buffer is empty or drain_budget_us has
+ * elapsed, so a burst is cleared in a few task runs instead of one run per
+ * record. Output is gathered into SD card blocks and flash pages, which are
+ * written only once full.
  */
 
 void log_process(void) {
+    KERNEL_PROFILE_FUNC();
     if (!log_state.initialized) {
         return;
     }
     
-    uint32_t save = log_acquire_lock();
-    
-    // Safety check - don't process if buffer is empty or corrupted
-    if (log_state.buffer_count < 4) {
+    uint32_t start_us = time_us_32();
+    uint32_t batch = 0;
+    uint32_t bytes = 0;
+
+    do {
+        log_record_header_t header;
+        uint32_t save = log_acquire_lock();
+
+        if (log_state.buffer_count < sizeof(header)) {
+            log_release_lock(save);
+            break;
+        }
+
+        log_ring_take(&header, sizeof(header));
+
+        // Validate length
+        if (header.length == 0 || header.length > log_state.config.max_message_size ||
+            header.length > log_state.buffer_count) {
+            // Invalid length - something went wrong
+            printf("ERROR: Invalid log record length: %u\n", header.length);
+            reset_log_buffer();
+            log_release_lock(save);
+            break;
+        }
+
+        log_ring_take(log_state.drain_record, header.length);
+        log_state.record_count--;
+
+        // Release lock before writing to outputs to avoid deadlocks
         log_release_lock(save);
-        return;
+
+        uint32_t age_us = time_us_32() - header.enqueue_us;
+        if (age_us > log_state.stats.max_backlog_age_us) {
+            log_state.stats.max_backlog_age_us = age_us;
+        }
+
+        output_record_to_destinations(&header, log_state.drain_record);
+
+        batch++;
+        bytes += header.length;
+    } while (time_us_32() - start_us < log_state.config.drain_budget_us);
+
+    if (batch > 0) {
+        log_state.stats.batches++;
+        log_state.stats.records_drained += batch;
+        log_state.stats.bytes_drained += bytes;
+
+        if (batch > log_state.stats.max_batch) {
+            log_state.stats.max_batch = batch;
+        }
     }
-    
-    // Process only one message at a time to avoid blocking too long
-    uint32_t msg_len = 0;
-    
-    // Extract message length with proper bounds checking
-    for (int j = 0; j < 4 && log_state.buffer_count > j; j++) {
-        msg_len = (msg_len << 8) | log_state.buffer[log_state.buffer_tail];
-        log_state.buffer_tail = (log_state.buffer_tail + 1) % log_state.config.buffer_size;
-        log_state.buffer_count--;
+
+    // Drain rate over the last complete window
+    uint32_t now_us = time_us_32();
+    uint32_t window_us = now_us - log_state.rate_window_start_us;
+
+    log_state.rate_window_records += batch;
+
+    if (window_us >= LOG_RATE_WINDOW_US) {
+        log_state.stats.drain_rate = (uint32_t) (((uint64_t) log_state.rate_window_records * 1000000u) / window_us);
+        log_state.rate_window_records = 0;
+        log_state.rate_window_start_us = now_us;
     }
-    
-    // Validate length
-    if (msg_len == 0 || msg_len > log_state.config.max_message_size) {
-        // Invalid length - something went wrong
-        // Log an error and reset buffer
-        printf("ERROR: Invalid log message length: %lu\n", msg_len);
-        log_state.buffer_head = 0;
-        log_state.buffer_tail = 0;
-        log_state.buffer_count = 0;
-        log_release_lock(save);
-        return;
+}
+
+/**
+ * @brief Get logging throughput and backlog statistics
+ */
+
+bool log_get_stats(log_stats_t* stats) {
+    if (stats == NULL || !log_state.initialized) {
+        return false;
     }
-    
-    // Extract message with bounds checking
-    char msg_buffer[log_state.config.max_message_size];
-    size_t actual_len = 0;
-    for (size_t j = 0; j < msg_len && j < log_state.config.max_message_size - 1 && j < log_state.buffer_count; j++) {
-        msg_buffer[j] = log_state.buffer[log_state.buffer_tail];
-        log_state.buffer_tail = (log_state.buffer_tail + 1) % log_state.config.buffer_size;
-        log_state.buffer_count--;
-        actual_len = j + 1; // Track actual bytes written
+
+    uint32_t save = log_acquire_lock();
+
+    memcpy(stats, &log_state.stats, sizeof(log_stats_t));
+    stats->backlog_records = log_state.record_count;
+    stats->backlog_bytes = log_state.buffer_count;
+    stats->records_dropped = log_state.records_dropped;
+    stats->records_suppressed = log_state.records_suppressed;
+    stats->backlog_age_us = 0;
+
+    if (log_state.buffer_count >= sizeof(log_record_header_t)) {
+        log_record_header_t header;
+        log_ring_peek(&header, sizeof(header));
+        stats->backlog_age_us = time_us_32() - header.enqueue_us;
     }
-    
-    // Place null terminator at the end of actual content
-    msg_buffer[actual_len] = '\0';
-    
-    // Release lock before writing to outputs to avoid deadlocks
+
     log_release_lock(save);
-    
-    // Write to SD card and flash (without holding the lock)
-    if (log_state.active_destinations & LOG_DEST_SDCARD) {
-        log_write_sdcard(msg_buffer);
-    }
-    
-    if (log_state.active_destinations & LOG_DEST_FLASH) {
-        log_write_flash(msg_buffer);
-    }
+
+    return true;
 }
 
 /**
- * @brief Flush all pending log messages
+ * @brief Reset logging statistics
  */
 
-void log_flush(void) {
-    if (!log_state.initialized) {
-        return;
-    }
+void log_reset_stats(void) {
+    uint32_t save = log_acquire_lock();
 
-    // Flush main buffer
-    while (log_state.buffer_count > 0) {
-        log_process();
-    }
+    memset(&log_state.stats, 0, sizeof(log_stats_t));
+    log_state.records_dropped = 0;
+    log_state.records_suppressed = 0;
+    log_state.rate_window_records = 0;
+    log_state.rate_window_start_us = time_us_32();
 
-    // Flush console buffer if USB is connected
-    if (stdio_usb_connected()) {
-        uint32_t save = console_acquire_lock();
-        while (log_state.console_count > 0) {
-            process_single_console_message();
-        }
-        console_release_lock(save);
-    }
+    log_release_lock(save);
 }
 
 /**
@@ -936,78 +1095,364 @@ static void log_write_console(const log_message_t* message, const char* formatte
     console_release_lock(save);
 }
 
+#ifdef USE_FATFS
+static FIL sd_file;
+static bool sd_file_opened = false;
+
 /**
- * @brief Write message to SD card
+ * @brief Append the filled part of the SD card block to the log file
  */
-static void log_write_sdcard(const char* formatted_message) {
-    (void) formatted_message;
-#ifdef USE_FATFS
-    // SD card write implementation would go here
-    // For now, just a placeholder
-    static bool sd_file_opened = false;
-    static FIL file;
-    
+static void log_sdcard_write_block(void) {
     if (!sd_file_opened) {
-        if (f_open(&file, log_state.config.sdcard_filename, FA_WRITE | FA_OPEN_APPEND | FA_OPEN_ALWAYS) != FR_OK) {
+        if (f_open(&sd_file, log_state.config.sdcard_filename, FA_WRITE | FA_OPEN_APPEND | FA_OPEN_ALWAYS) != FR_OK) {
+            log_state.sdcard_block_fill = 0;
             return;
         }
         sd_file_opened = true;
     }
-    
-    // Write message
+
     UINT bw;
-    f_write(&file, formatted_message, strlen(formatted_message), &bw);
-    f_write(&file, "\n", 1, &bw);
-    
+    if (f_write(&sd_file, log_state.sdcard_block, log_state.sdcard_block_fill, &bw) == FR_OK &&
+        bw == log_state.sdcard_block_fill) {
+        log_state.stats.sdcard_blocks_written++;
+    } else {
+        log_state.stats.write_errors++;
+    }
+
+    log_state.sdcard_block_fill = 0;
+
     // Sync to SD card periodically
     static uint32_t sync_counter = 0;
     if (++sync_counter % 10 == 0) {
-        f_sync(&file);
+        f_sync(&sd_file);
     }
+}
+#endif
+
+/**
+ * @brief Append bytes to the SD card block, writing it out when full
+ */
+static void log_write_sdcard(const uint8_t* data, uint32_t len) {
+#ifdef USE_FATFS
+    while (len > 0) {
+        uint32_t chunk = LOG_SDCARD_BLOCK_SIZE - log_state.sdcard_block_fill;
+        if (chunk > len) {
+            chunk = len;
+        }
+
+        memcpy(&log_state.sdcard_block[log_state.sdcard_block_fill], data, chunk);
+        log_state.sdcard_block_fill += chunk;
+        data += chunk;
+        len -= chunk;
+
+        if (log_state.sdcard_block_fill == LOG_SDCARD_BLOCK_SIZE) {
+            log_sdcard_write_block();
+        }
+    }
+#else
+    (void) data;
+    (void) len;
 #endif
 }
 
 /**
- * @brief Write message to flash
+ * @brief Write out a partially filled SD card block
  */
+static void log_flush_sdcard(void) {
+#ifdef USE_FATFS
+    if (log_state.sdcard_block_fill > 0) {
+        log_sdcard_write_block();
+    }
 
-static void log_write_flash(const char* formatted_message) {
-    // Check if we have enough space in flash
-    size_t msg_len = strlen(formatted_message) + 1;  // Include null terminator
-    
-    // Round up to nearest 4 bytes (flash program size)
-    msg_len = (msg_len + 3) & ~3;
-    
-    // Check if we have enough space
-    if (log_state.flash_write_offset + msg_len > log_state.config.flash_offset + log_state.config.flash_size) {
-        // Not enough space - wrap around to beginning
+    if (sd_file_opened) {
+        f_sync(&sd_file);
+    }
+#endif
+}
+
+/**
+ * @brief Erase and program flash with the other core locked out
+ */
+static void __not_in_flash_func(log_flash_execute)(void* param) {
+    const log_flash_op_t* op = (const log_flash_op_t*) param;
+
+    if (op->erase) {
+        flash_range_erase(op->offset, FLASH_SECTOR_SIZE);
+    }
+
+    flash_range_program(op->offset, op->data, FLASH_PAGE_SIZE);
+}
+
+/**
+ * @brief Program the flash page buffer at the current write offset
+ * 
+ * Unused bytes are padded with 0xFF. Because programming can only clear
+ * bits, a partial page can be programmed and later reprogrammed in full at
+ * the same offset, which is how log_flush() persists a partial page.
+ * 
+ * @param complete true if the page is full and the offset should advance
+ */
+static void log_flash_program_page(bool complete) {
+    uint32_t region_end = log_state.config.flash_offset + log_state.config.flash_size;
+
+    memset(&log_state.flash_page[log_state.flash_page_fill], 0xFF,
+           FLASH_PAGE_SIZE - log_state.flash_page_fill);
+
+    // Erase each sector once, when its first page is written
+    log_flash_op_t op = {
+        .offset = log_state.flash_write_offset,
+        .data = log_state.flash_page,
+        .erase = !log_state.flash_page_programmed &&
+                 (log_state.flash_write_offset % FLASH_SECTOR_SIZE) == 0
+    };
+
+    bool programmed = (flash_safe_execute(log_flash_execute, &op, LOG_FLASH_TIMEOUT_MS) == PICO_OK);
+
+    if (!programmed) {
+        log_state.stats.write_errors++;
+    }
+
+    if (!complete) {
+        log_state.flash_page_programmed |= programmed;
+        return;
+    }
+
+    if (programmed) {
+        log_state.stats.flash_pages_written++;
+    } else if (!log_state.flash_page_programmed) {
+        // Nothing written at this offset yet, reuse it for the next page
+        log_state.flash_page_fill = 0;
+        return;
+    }
+
+    log_state.flash_page_fill = 0;
+    log_state.flash_page_programmed = false;
+    log_state.flash_write_offset += FLASH_PAGE_SIZE;
+
+    // Wrap around to the beginning of the region
+    if (log_state.flash_write_offset + FLASH_PAGE_SIZE > region_end) {
         log_state.flash_write_offset = log_state.config.flash_offset;
-        
-        // Erase the flash sector
-        uint32_t sector_offset = log_state.flash_write_offset & ~(FLASH_SECTOR_SIZE - 1);
-        flash_range_erase(sector_offset, FLASH_SECTOR_SIZE);
     }
-    
-    // Check if we need to erase a sector
-    uint32_t current_sector = log_state.flash_write_offset & ~(FLASH_SECTOR_SIZE - 1);
-    uint32_t end_sector = (log_state.flash_write_offset + msg_len) & ~(FLASH_SECTOR_SIZE - 1);
-    
-    if (current_sector != end_sector) {
-        // Message crosses sector boundary - erase the next sector
-        flash_range_erase(end_sector, FLASH_SECTOR_SIZE);
+}
+
+/**
+ * @brief Append bytes to the flash page, programming it when full
+ */
+static void log_write_flash(const uint8_t* data, uint32_t len) {
+    while (len > 0) {
+        uint32_t chunk = FLASH_PAGE_SIZE - log_state.flash_page_fill;
+        if (chunk > len) {
+            chunk = len;
+        }
+
+        memcpy(&log_state.flash_page[log_state.flash_page_fill], data, chunk);
+        log_state.flash_page_fill += chunk;
+        data += chunk;
+        len -= chunk;
+
+        if (log_state.flash_page_fill == FLASH_PAGE_SIZE) {
+            log_flash_program_page(true);
+        }
+    }
+}
+
+/**
+ * @brief Program a partially filled flash page without advancing
+ */
+static void log_flush_flash(void) {
+    if (log_state.flash_page_fill > 0) {
+        log_flash_program_page(false);
+    }
+}
+
+/**
+ * @brief Hash a module name for the flash index
+ */
+static uint16_t log_module_hash(const char* module) {
+    uint32_t hash = 2166136261u;
+
+    while (module && *module) {
+        hash ^= (uint8_t) *module++;
+        hash *= 16777619u;
+    }
+
+    return (uint16_t) (hash ^ (hash >> 16));
+}
+
+/**
+ * @brief Add a record about to be written at a flash offset to the index
+ * 
+ * Records are written in order, so the first record landing in a sector
+ * means that sector is about to be erased and its old entry is dropped.
+ */
+static void log_index_add(uint32_t flash_offset, const log_record_header_t* header) {
+    uint32_t region_offset = flash_offset - log_state.config.flash_offset;
+    uint32_t sector = region_offset / FLASH_SECTOR_SIZE;
+    uint32_t in_sector = region_offset % FLASH_SECTOR_SIZE;
+
+    if (log_state.index == NULL || sector >= log_state.index_sectors) {
+        return;
+    }
+
+    log_index_sector_t* entry = &log_state.index[sector];
+
+    if (sector != log_state.index_current) {
+        memset(entry, 0, sizeof(log_index_sector_t));
+        for (int i = 0; i < LOG_INDEX_POINTS; i++) {
+            entry->points[i].offset = LOG_INDEX_NO_POINT;
+        }
+        log_state.index_current = sector;
+    }
+
+    if (entry->record_count == 0) {
+        entry->first_seq = header->seq;
+        entry->first_ms = header->timestamp_ms;
+    }
+
+    entry->last_seq = header->seq;
+    entry->last_ms = header->timestamp_ms;
+    entry->record_count++;
+    entry->level_mask |= (uint8_t) (1u << header->level);
+    entry->module_mask |= 1u << (header->module_hash % 32);
+
+    log_index_point_t* point = &entry->points[in_sector / LOG_INDEX_POINT_STRIDE];
+    if (point->offset == LOG_INDEX_NO_POINT) {
+        point->offset = (uint16_t) in_sector;
+        point->timestamp_ms = header->timestamp_ms;
+    }
+}
+
+/**
+ * @brief Move the flash write position to the start of the next sector
+ */
+static void log_flash_next_sector(void) {
+    if (log_state.flash_page_fill > 0) {
+        log_flash_program_page(true);
+    }
+
+    if (log_state.flash_write_offset % FLASH_SECTOR_SIZE != 0) {
+        log_state.flash_write_offset = (log_state.flash_write_offset & ~(FLASH_SECTOR_SIZE - 1)) + FLASH_SECTOR_SIZE;
+        log_state.flash_page_programmed = false;
+
+        if (log_state.flash_write_offset >= log_state.config.flash_offset + log_state.config.flash_size) {
+            log_state.flash_write_offset = log_state.config.flash_offset;
+        }
+    }
+}
+
+/**
+ * @brief Append a framed record to flash and index it
+ * 
+ * Records never span a sector, so each sector can be erased, indexed and
+ * parsed on its own.
+ */
+static void log_flash_append_record(const log_record_header_t* header, const uint8_t* text) {
+    uint32_t size = sizeof(log_flash_record_t) + header->length;
+    uint32_t position = log_state.flash_write_offset + log_state.flash_page_fill;
+    uint32_t sector_end = (position & ~(FLASH_SECTOR_SIZE - 1)) + FLASH_SECTOR_SIZE;
+
+    if (position + size > sector_end) {
+        log_flash_next_sector();
+        position = log_state.flash_write_offset + log_state.flash_page_fill;
+    }
+
+    log_flash_record_t record = {
+        .magic = LOG_FLASH_RECORD_MAGIC,
+        .level = header->level,
+        .length = header->length,
+        .module_hash = header->module_hash,
+        .format = header->format,
+        .reserved = 0xFF,
+        .seq = header->seq,
+        .timestamp_ms = header->timestamp_ms
+    };
+
+    log_index_add(position, header);
+    log_write_flash((const uint8_t*) &record, sizeof(record));
+    log_write_flash(text, header->length);
+}
+
+/**
+ * @brief Read and validate the flash record at an offset within a sector
+ * 
+ * @return Pointer to the record header in XIP, or NULL at the end of the sector's data
+ */
+static const log_flash_record_t* log_flash_record_at(uint32_t sector_offset, uint32_t in_sector) {
+    if (in_sector + sizeof(log_flash_record_t) > FLASH_SECTOR_SIZE) {
+        return NULL;
+    }
+
+    const log_flash_record_t* record =
+        (const log_flash_record_t*) (XIP_BASE + sector_offset + in_sector);
+
+    if (record->magic != LOG_FLASH_RECORD_MAGIC || record->level > LOG_LEVEL_FATAL ||
+        record->length == 0 || record->length > log_state.config.max_message_size ||
+        in_sector + sizeof(log_flash_record_t) + record->length > FLASH_SECTOR_SIZE) {
+        return NULL;
+    }
+
+    return record;
+}
+
+/**
+ * @brief Rebuild the flash index and resume after the newest record
+ * 
+ * Sequence numbers continue from the newest record found, so records from
+ * earlier boots stay ordered and queryable.
+ */
+static void log_index_rebuild(void) {
+    bool found = false;
+    uint32_t newest_seq = 0;
+    uint32_t newest_end = log_state.config.flash_offset;
+
+    for (uint32_t sector = 0; sector < log_state.index_sectors; sector++) {
+        uint32_t sector_offset = log_state.config.flash_offset + sector * FLASH_SECTOR_SIZE;
+        uint32_t in_sector = 0;
+        const log_flash_record_t* record;
+
+        log_state.index_current = UINT32_MAX;
+
+        while ((record = log_flash_record_at(sector_offset, in_sector)) != NULL) {
+            log_record_header_t header = {
+                .length = record->length,
+                .module_hash = record->module_hash,
+                .level = record->level,
+                .format = record->format,
+                .seq = record->seq,
+                .timestamp_ms = record->timestamp_ms
+            };
+
+            log_index_add(sector_offset + in_sector, &header);
+
+            in_sector += sizeof(log_flash_record_t) + record->length;
+
+            if (!found || (int32_t) (record->seq - newest_seq) > 0) {
+                found = true;
+                newest_seq = record->seq;
+                newest_end = sector_offset + in_sector;
+            }
+        }
+    }
+
+    log_state.index_current = UINT32_MAX;
+
+    if (!found) {
+        return;
+    }
+
+    log_state.sequence_counter = newest_seq + 1;
+    log_state.index_current = (newest_end - log_state.config.flash_offset - 1) / FLASH_SECTOR_SIZE;
+
+    // Continue in the partially written page
+    log_state.flash_write_offset = newest_end & ~(FLASH_PAGE_SIZE - 1);
+    log_state.flash_page_fill = newest_end % FLASH_PAGE_SIZE;
+    log_state.flash_page_programmed = (log_state.flash_page_fill > 0);
+    memcpy(log_state.flash_page, (const void*) (XIP_BASE + log_state.flash_write_offset),
+           log_state.flash_page_fill);
+
+    if (log_state.flash_write_offset >= log_state.config.flash_offset + log_state.config.flash_size) {
+        log_state.flash_write_offset = log_state.config.flash_offset;
     }
-    
-    // Prepare message buffer (must be aligned to 4 bytes for flash program)
-    uint8_t flash_buffer[256];  // Max message size
-    memset(flash_buffer, 0, sizeof(flash_buffer));
-    memcpy(flash_buffer, formatted_message, strlen(formatted_message) + 1);
-    
-    // Program flash
-    uint32_t offset = log_state.flash_write_offset - XIP_BASE;
-    flash_range_program(offset, flash_buffer, msg_len);
-    
-    // Update offset
-    log_state.flash_write_offset += msg_len;
 }
 
 /**
@@ -1082,4 +1527,291 @@ static inline void console_release_lock(uint32_t save) {
         // Fallback for early boot
         mutex_exit(&log_state.fallback_mutex);
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Check whether an index entry can hold records matching a query
+ */
+static bool log_index_may_match(const log_index_sector_t* entry, const log_query_t* query,
+                                uint16_t module_hash) {
+    if (entry->record_count == 0) {
+        return false;
+    }
+
+    if ((entry->level_mask >> query->min_level) == 0) {
+        return false;
+    }
+
+    if (query->module && !(entry->module_mask & (1u << (module_hash % 32)))) {
+        return false;
+    }
+
+    if (query->use_since &&
+        ((int32_t) (entry->last_seq - log_state.boot_seq) < 0 || entry->last_ms < query->since_ms)) {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Find flash log records matching a filter
+ */
+
+uint32_t log_query(const log_query_t* query, log_query_callback_t callback, void* user_data) {
+    if (query == NULL || callback == NULL || !log_state.initialized || log_state.index == NULL) {
+        return 0;
+    }
+
+    // Everything logged so far should be visible
+    log_flush();
+
+    uint16_t module_hash = query->module ? log_module_hash(query->module) : 0;
+    uint32_t matched = 0;
+
+    // Oldest sector first, ending with the one being written
+    uint32_t newest = (log_state.index_current < log_state.index_sectors) ? log_state.index_current : 0;
+
+    for (uint32_t i = 1; i <= log_state.index_sectors; i++) {
+        uint32_t sector = (newest + i) % log_state.index_sectors;
+        const log_index_sector_t* entry = &log_state.index[sector];
+
+        if (!log_index_may_match(entry, query, module_hash)) {
+            continue;
+        }
+
+        // Seek to the last index point at or before the start time
+        uint32_t in_sector = 0;
+        if (query->use_since && (int32_t) (entry->first_seq - log_state.boot_seq) >= 0) {
+            for (int p = 0; p < LOG_INDEX_POINTS; p++) {
+                if (entry->points[p].offset != LOG_INDEX_NO_POINT &&
+                    entry->points[p].timestamp_ms <= query->since_ms) {
+                    in_sector = entry->points[p].offset;
+                }
+            }
+        }
+
+        uint32_t sector_offset = log_state.config.flash_offset + sector * FLASH_SECTOR_SIZE;
+        const log_flash_record_t* record;
+
+        while ((record = log_flash_record_at(sector_offset, in_sector)) != NULL) {
+            uint32_t record_offset = sector_offset + in_sector;
+            in_sector += sizeof(log_flash_record_t) + record->length;
+
+            if (record->level < query->min_level) {
+                continue;
+            }
+
+            if (query->module && record->module_hash != module_hash) {
+                continue;
+            }
+
+            if (query->use_since &&
+                ((int32_t) (record->seq - log_state.boot_seq) < 0 || record->timestamp_ms < query->since_ms)) {
+                continue;
+            }
+
+            log_query_record_t result = {
+                .seq = record->seq,
+                .timestamp_ms = record->timestamp_ms,
+                .level = (log_level_t) record->level,
+                .format = (log_format_t) record->format,
+                .flash_offset = record_offset,
+                .text = (const char*) (record + 1),
+                .length = record->length
+            };
+
+            matched++;
+
+            if (!callback(&result, user_data) ||
+                (query->max_records > 0 && matched >= query->max_records)) {
+                return matched;
+            }
+        }
+    }
+
+    return matched;
+}
+
+/**
+ * @brief Print logging statistics, or reset them
+ */
+
+static int handle_log_stats(int argc, char *argv[]) {
+    if (argc > 2 && strcmp(argv[2], "reset") == 0) {
+        log_reset_stats();
+        printf("Logging statistics reset\n\r");
+        return 0;
+    }
+
+    log_stats_t stats;
+    if (!log_get_stats(&stats)) {
+        printf("Logging not initialized\n\r");
+        return 1;
+    }
+
+    printf("Records drained:  %lu (%lu bytes)\n\r", stats.records_drained, stats.bytes_drained);
+    printf("Batches:          %lu (avg %lu, max %lu records)\n\r", stats.batches,
+        stats.batches ? stats.records_drained / stats.batches : 0, stats.max_batch);
+    printf("Drain rate:       %lu records/s\n\r", stats.drain_rate);
+    printf("Drain budget:     %lu us\n\r", log_state.config.drain_budget_us);
+    printf("Backlog:          %lu records, %lu/%lu bytes\n\r", stats.backlog_records,
+        stats.backlog_bytes, log_state.config.buffer_size);
+    printf("Backlog age:      %lu us (max %lu us)\n\r", stats.backlog_age_us, stats.max_backlog_age_us);
+    printf("Flash pages:      %lu (offset 0x%08lx)\n\r", stats.flash_pages_written, log_state.flash_write_offset);
+    printf("SD card blocks:   %lu\n\r", stats.sdcard_blocks_written);
+    printf("Write errors:     %lu\n\r", stats.write_errors);
+    printf("Dropped records:  %lu\n\r", stats.records_dropped);
+    printf("Rate limited:     %lu\n\r", stats.records_suppressed);
+
+    return 0;
+}
+
+/**
+ * @brief Print the per-sector flash index
+ */
+
+static int handle_log_index(void) {
+    if (log_state.index == NULL) {
+        printf("Flash log index not available\n\r");
+        return 1;
+    }
+
+    log_flush();
+
+    printf("Sector  Records  First seq  Last seq   First ms    Last ms     Levels  Modules\n\r");
+
+    for (uint32_t sector = 0; sector < log_state.index_sectors; sector++) {
+        const log_index_sector_t* entry = &log_state.index[sector];
+
+        if (entry->record_count == 0) {
+            continue;
+        }
+
+        printf("%-6lu  %-7u  %-9lu  %-9lu  %-10lu  %-10lu  0x%02x    0x%08lx%s\n\r",
+            sector, entry->record_count, entry->first_seq, entry->last_seq,
+            entry->first_ms, entry->last_ms, entry->level_mask, entry->module_mask,
+            (sector == log_state.index_current) ? " *" : "");
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Print one record found by log query
+ */
+static bool print_query_record(const log_query_record_t* record, void* user_data) {
+    (void) user_data;
+
+    if (record->format == LOG_FORMAT_KV) {
+        char line[DEFAULT_MAX_MESSAGE_SIZE];
+        size_t offset = log_format_prefix(line, sizeof(line), record->timestamp_ms, record->level, 0, NULL);
+
+        if (log_kv_render((const uint8_t*) record->text, record->length,
+                          line + offset, sizeof(line) - offset) < 0) {
+            printf("#%-6lu <malformed structured record>\n\r", record->seq);
+            return true;
+        }
+
+        printf("#%-6lu %s\n\r", record->seq, line);
+        return true;
+    }
+
+    printf("#%-6lu %.*s\n\r", record->seq, (int) record->length, record->text);
+
+    return true;
+}
+
+/**
+ * @brief Query the flash log
+ */
+
+static int handle_log_query(int argc, char *argv[]) {
+    static const char* level_names[] = { "trace", "debug", "info", "warn", "error", "fatal" };
+
+    log_query_t query = {
+        .use_since = false,
+        .since_ms = 0,
+        .min_level = LOG_LEVEL_TRACE,
+        .module = NULL,
+        .max_records = 100
+    };
+
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 >= argc) {
+            printf("Missing value for %s\n\r", argv[i]);
+            return 1;
+        }
+
+        if (strcmp(argv[i], "--since") == 0) {
+            query.use_since = true;
+            query.since_ms = strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--level") == 0) {
+            const char* name = argv[++i];
+            int level = -1;
+
+            for (int l = 0; l < (int) (sizeof(level_names) / sizeof(level_names[0])); l++) {
+                if (strcmp(name, level_names[l]) == 0) {
+                    level = l;
+                }
+            }
+
+            if (level < 0) {
+                printf("Unknown level: %s (trace|debug|info|warn|error|fatal)\n\r", name);
+                return 1;
+            }
+
+            query.min_level = (log_level_t) level;
+        } else if (strcmp(argv[i], "--module") == 0) {
+            query.module = argv[++i];
+        } else if (strcmp(argv[i], "--limit") == 0) {
+            query.max_records = strtoul(argv[++i], NULL, 0);
+        } else {
+            printf("Unknown option: %s\n\r", argv[i]);
+            return 1;
+        }
+    }
+
+    uint32_t matched = log_query(&query, print_query_record, NULL);
+    printf("%lu record(s)\n\r", matched);
+
+    return 0;
+}
+
+/**
+ * @brief Shell command handler for logging
+ */
+
+static int cmd_log(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: log <command>\n\r");
+        printf("  stats [reset]                   - Drain and backlog statistics\n\r");
+        printf("  index                           - Per-sector flash log index\n\r");
+        printf("  query [--since <ms>] [--level <name>] [--module <name>] [--limit <n>]\n\r");
+        printf("                                  - Print matching flash log records\n\r");
+        return 0;
+    }
+
+    if (strcmp(argv[1], "stats") == 0) {
+        return handle_log_stats(argc, argv);
+    }
+    else if (strcmp(argv[1], "index") == 0) {
+        return handle_log_index();
+    }
+    else if (strcmp(argv[1], "query") == 0) {
+        return handle_log_query(argc, argv);
+    }
+
+    printf("Unknown log command: %s\n\r", argv[1]);
+    return 1;
+}
+
+void register_log_commands(void) {
+    static const shell_command_t log_command = {
+        cmd_log,
+        "log",
+        "Logging statistics and flash log queries (stats|index|query)"
+    };
+
+    shell_register_command(&log_command);
+}
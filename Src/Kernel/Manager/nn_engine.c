@@ -0,0 +1,380 @@
+/**
+* @file nn_engine.c
+* @brief Quantized int8 neural network runtime implementation
+* @date 2025-05-27
+*/
+
+#include "nn_engine.h"
+
+#ifndef NN_ENGINE_REFERENCE
+#include "arm_math.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#define NN_ENGINE_ALIGN(x) (((x) + 3u) & ~3u)
+#define NN_ENGINE_MAX_DOT  (1u << 17)    // Products of -128 * -128 overflow int32 beyond this
+
+/**
+ * @brief Exact int32 dot product of two int8 vectors
+ */
+static inline int32_t nn_dot_q7(const int8_t* a, const int8_t* b, uint32_t n) {
+#ifdef NN_ENGINE_REFERENCE
+    int32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        sum += (int32_t) a[i] * (int32_t) b[i];
+    }
+    return sum;
+#else
+    // Accumulates in 18.14, the plain integer sum below NN_ENGINE_MAX_DOT terms
+    q31_t sum;
+    arm_dot_prod_q7((const q7_t*) a, (const q7_t*) b, n, &sum);
+    return (int32_t) sum;
+#endif
+}
+
+static inline void nn_clip_q7(const int8_t* src, int8_t* dst, int8_t low, uint32_t n) {
+#ifdef NN_ENGINE_REFERENCE
+    for (uint32_t i = 0; i < n; i++) {
+        dst[i] = (src[i] < low) ? low : src[i];
+    }
+#else
+    arm_clip_q7((const q7_t*) src, (q7_t*) dst, (q7_t) low, (q7_t) 127, n);
+#endif
+}
+
+/**
+ * @brief Scale an accumulator by a Q31 multiplier and a power of two, rounding half up
+ */
+static inline int32_t nn_requantize(int32_t acc, int32_t multiplier, int32_t shift) {
+    int32_t right = 31 - shift;
+    int64_t product = (int64_t) acc * (int64_t) multiplier;
+
+    return (int32_t) ((product + ((int64_t) 1 << (right - 1))) >> right);
+}
+
+static inline int8_t nn_saturate(int32_t value, int32_t low) {
+    if (value < low) {
+        return (int8_t) low;
+    }
+    return (int8_t) ((value > 127) ? 127 : value);
+}
+
+uint32_t nn_engine_crc32(const uint8_t* data, size_t len) {
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+
+    return ~crc;
+}
+
+static bool nn_range_valid(const nn_engine_header_t* header, uint32_t offset, uint64_t len) {
+    return offset >= sizeof(nn_engine_header_t) && offset <= header->size && len <= (header->size - offset);
+}
+
+/**
+ * @brief Output shape of a layer, false if the layer does not fit its input
+ */
+static bool nn_layer_shape(const nn_engine_header_t* header, const nn_engine_layer_t* layer,
+                           nn_engine_shape_t in, nn_engine_shape_t* out, uint32_t* macs) {
+    uint32_t in_size = (uint32_t) in.length * in.channels;
+
+    switch (layer->type) {
+        case NN_LAYER_DENSE:
+            out->length = 1;
+            out->channels = layer->out_channels;
+            *macs = in_size * layer->out_channels;
+
+            return layer->out_channels > 0 && in_size < NN_ENGINE_MAX_DOT && layer->shift <= 30 && layer->shift > -32 &&
+                nn_range_valid(header, layer->weights_offset, (uint64_t) in_size * layer->out_channels) &&
+                (layer->bias_offset & 3u) == 0 && nn_range_valid(header, layer->bias_offset, 4u * layer->out_channels);
+
+        case NN_LAYER_CONV1D: {
+            uint32_t window = (uint32_t) layer->kernel * in.channels;
+
+            if (layer->kernel == 0 || layer->stride == 0 || layer->kernel > in.length || layer->out_channels == 0) {
+                return false;
+            }
+
+            out->length = (uint16_t) (((uint32_t) (in.length - layer->kernel) / layer->stride) + 1u);
+            out->channels = layer->out_channels;
+            *macs = (uint32_t) out->length * layer->out_channels * window;
+
+            return window < NN_ENGINE_MAX_DOT && layer->shift <= 30 && layer->shift > -32 &&
+                nn_range_valid(header, layer->weights_offset, (uint64_t) window * layer->out_channels) &&
+                (layer->bias_offset & 3u) == 0 && nn_range_valid(header, layer->bias_offset, 4u * layer->out_channels);
+        }
+
+        case NN_LAYER_RELU:
+            *out = in;
+            *macs = 0;
+            return true;
+
+        case NN_LAYER_SOFTMAX:
+            out->length = 1;
+            out->channels = in.channels;
+            *macs = 0;
+
+            return (layer->weights_offset & 1u) == 0 &&
+                nn_range_valid(header, layer->weights_offset, 2u * NN_ENGINE_SOFTMAX_TABLE);
+
+        default:
+            return false;
+    }
+}
+
+bool nn_engine_load(nn_engine_t* engine, const uint8_t* blob, size_t size, uint8_t* arena, size_t arena_size) {
+    if (engine == NULL || blob == NULL || arena == NULL || size < sizeof(nn_engine_header_t)) {
+        return false;
+    }
+
+    const nn_engine_header_t* header = (const nn_engine_header_t*) blob;
+
+    if (header->magic != NN_ENGINE_MAGIC || header->version != NN_ENGINE_VERSION ||
+        header->size > size || header->size < sizeof(nn_engine_header_t) ||
+        header->layer_count == 0 || header->layer_count > NN_ENGINE_MAX_LAYERS ||
+        header->input_length == 0 || header->input_channels == 0 || !(header->input_scale > 0.0f) ||
+        header->input_zero_point < -128 || header->input_zero_point > 127 ||
+        !nn_range_valid(header, sizeof(nn_engine_header_t), (uint64_t) header->layer_count * sizeof(nn_engine_layer_t))) {
+        return false;
+    }
+
+    if (nn_engine_crc32(blob + sizeof(nn_engine_header_t), header->size - sizeof(nn_engine_header_t)) != header->crc32) {
+        return false;
+    }
+
+    memset(engine, 0, sizeof(nn_engine_t));
+    engine->blob = blob;
+    engine->header = header;
+    engine->layers = (const nn_engine_layer_t*) (blob + sizeof(nn_engine_header_t));
+    engine->arena = arena;
+    engine->input_inverse_scale = 1.0f / header->input_scale;
+
+    engine->shapes[0].length = header->input_length;
+    engine->shapes[0].channels = header->input_channels;
+    engine->zero_points[0] = header->input_zero_point;
+
+    size_t needed = 0;
+
+    for (uint16_t i = 0; i < header->layer_count; i++) {
+        const nn_engine_layer_t* layer = &engine->layers[i];
+        uint32_t macs = 0;
+
+        if (!nn_layer_shape(header, layer, engine->shapes[i], &engine->shapes[i + 1], &macs)) {
+            return false;
+        }
+
+        engine->macs += macs;
+
+        if (layer->type == NN_LAYER_RELU) {
+            engine->zero_points[i + 1] = engine->zero_points[i];
+        } else if (layer->type == NN_LAYER_SOFTMAX) {
+            engine->zero_points[i + 1] = -128;
+        } else if (layer->output_zero_point < -128 || layer->output_zero_point > 127) {
+            return false;
+        } else {
+            engine->zero_points[i + 1] = layer->output_zero_point;
+        }
+
+        size_t pair = NN_ENGINE_ALIGN((size_t) engine->shapes[i].length * engine->shapes[i].channels) +
+                      NN_ENGINE_ALIGN((size_t) engine->shapes[i + 1].length * engine->shapes[i + 1].channels);
+        if (pair > needed) {
+            needed = pair;
+        }
+    }
+
+    if (needed > arena_size) {
+        return false;
+    }
+
+    // Even tensors at the bottom, odd ones at the top, so a layer never overwrites its input
+    for (uint16_t i = 0; i <= header->layer_count; i++) {
+        size_t bytes = NN_ENGINE_ALIGN((size_t) engine->shapes[i].length * engine->shapes[i].channels);
+        engine->offsets[i] = (uint32_t) (((i & 1u) == 0) ? 0 : (needed - bytes));
+    }
+    engine->arena_used = needed;
+
+    if (header->test_offset != 0) {
+        uint32_t in_size = (uint32_t) header->input_length * header->input_channels;
+        uint32_t out_size = (uint32_t) engine->shapes[header->layer_count].length * engine->shapes[header->layer_count].channels;
+
+        if (!nn_range_valid(header, header->test_offset, in_size + out_size)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void nn_run_dense(const nn_engine_t* engine, const nn_engine_layer_t* layer, const int8_t* in, int8_t* out,
+                         nn_engine_shape_t in_shape) {
+    uint32_t in_size = (uint32_t) in_shape.length * in_shape.channels;
+    const int8_t* weights = (const int8_t*) (engine->blob + layer->weights_offset);
+    const int32_t* bias = (const int32_t*) (engine->blob + layer->bias_offset);
+    int32_t low = layer->relu ? layer->output_zero_point : -128;
+
+    for (uint32_t o = 0; o < layer->out_channels; o++) {
+        int32_t acc = bias[o] + nn_dot_q7(in, &weights[o * in_size], in_size);
+        out[o] = nn_saturate(layer->output_zero_point + nn_requantize(acc, layer->multiplier, layer->shift), low);
+    }
+}
+
+static void nn_run_conv1d(const nn_engine_t* engine, const nn_engine_layer_t* layer, const int8_t* in, int8_t* out,
+                          nn_engine_shape_t in_shape, nn_engine_shape_t out_shape) {
+    uint32_t window = (uint32_t) layer->kernel * in_shape.channels;
+    const int8_t* weights = (const int8_t*) (engine->blob + layer->weights_offset);
+    const int32_t* bias = (const int32_t*) (engine->blob + layer->bias_offset);
+    int32_t low = layer->relu ? layer->output_zero_point : -128;
+
+    for (uint32_t t = 0; t < out_shape.length; t++) {
+        // [time][channel] makes the receptive field one contiguous run
+        const int8_t* field = &in[t * layer->stride * in_shape.channels];
+        int8_t* row = &out[t * out_shape.channels];
+
+        for (uint32_t o = 0; o < layer->out_channels; o++) {
+            int32_t acc = bias[o] + nn_dot_q7(field, &weights[o * window], window);
+            row[o] = nn_saturate(layer->output_zero_point + nn_requantize(acc, layer->multiplier, layer->shift), low);
+        }
+    }
+}
+
+static void nn_run_softmax(const nn_engine_t* engine, const nn_engine_layer_t* layer, const int8_t* in, int8_t* out,
+                           nn_engine_shape_t in_shape) {
+    const uint16_t* table = (const uint16_t*) (engine->blob + layer->weights_offset);
+    const int8_t* last = &in[(uint32_t) (in_shape.length - 1u) * in_shape.channels];
+    int32_t max = -128;
+    uint32_t sum = 0;
+
+    for (uint32_t c = 0; c < in_shape.channels; c++) {
+        if (last[c] > max) {
+            max = last[c];
+        }
+    }
+
+    for (uint32_t c = 0; c < in_shape.channels; c++) {
+        sum += table[max - last[c]];
+    }
+
+    for (uint32_t c = 0; c < in_shape.channels; c++) {
+        uint32_t p = (((uint32_t) table[max - last[c]] << 8) + (sum / 2u)) / sum;
+        out[c] = nn_saturate((int32_t) p - 128, -128);
+    }
+}
+
+bool nn_engine_run(nn_engine_t* engine, nn_engine_clock_t clock, uint32_t budget_us) {
+    if (engine == NULL || engine->header == NULL) {
+        return false;
+    }
+
+    uint32_t start_us = (clock != NULL) ? clock() : 0;
+
+    for (uint16_t i = 0; i < engine->header->layer_count; i++) {
+        const nn_engine_layer_t* layer = &engine->layers[i];
+        const int8_t* in = (const int8_t*) &engine->arena[engine->offsets[i]];
+        int8_t* out = (int8_t*) &engine->arena[engine->offsets[i + 1]];
+
+        switch (layer->type) {
+            case NN_LAYER_DENSE:
+                nn_run_dense(engine, layer, in, out, engine->shapes[i]);
+                break;
+
+            case NN_LAYER_CONV1D:
+                nn_run_conv1d(engine, layer, in, out, engine->shapes[i], engine->shapes[i + 1]);
+                break;
+
+            case NN_LAYER_RELU:
+                nn_clip_q7(in, out, (int8_t) engine->zero_points[i],
+                    (uint32_t) engine->shapes[i].length * engine->shapes[i].channels);
+                break;
+
+            case NN_LAYER_SOFTMAX:
+                nn_run_softmax(engine, layer, in, out, engine->shapes[i]);
+                break;
+
+            default:
+                return false;
+        }
+
+        if (clock != NULL && (clock() - start_us) > budget_us && (i + 1u) < engine->header->layer_count) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int8_t* nn_engine_input(nn_engine_t* engine) {
+    return (int8_t*) &engine->arena[engine->offsets[0]];
+}
+
+const int8_t* nn_engine_output(const nn_engine_t* engine, uint32_t* count) {
+    uint16_t last = engine->header->layer_count;
+
+    if (count != NULL) {
+        *count = (uint32_t) engine->shapes[last].length * engine->shapes[last].channels;
+    }
+
+    return (const int8_t*) &engine->arena[engine->offsets[last]];
+}
+
+int nn_engine_argmax(const nn_engine_t* engine, int8_t* value) {
+    uint32_t count;
+    const int8_t* out = nn_engine_output(engine, &count);
+    int best = 0;
+
+    for (uint32_t i = 1; i < count; i++) {
+        if (out[i] > out[best]) {
+            best = (int) i;
+        }
+    }
+
+    if (value != NULL) {
+        *value = out[best];
+    }
+
+    return best;
+}
+
+void nn_engine_quantize_input(nn_engine_t* engine, const float* values) {
+    int8_t* input = nn_engine_input(engine);
+    uint32_t count = (uint32_t) engine->header->input_length * engine->header->input_channels;
+    int32_t zero_point = engine->header->input_zero_point;
+
+    for (uint32_t i = 0; i < count; i++) {
+        int32_t q = (int32_t) floorf((values[i] * engine->input_inverse_scale) + 0.5f) + zero_point;
+        input[i] = nn_saturate(q, -128);
+    }
+}
+
+int nn_engine_self_test(nn_engine_t* engine, uint32_t* mismatches) {
+    if (engine == NULL || engine->header == NULL || engine->header->test_offset == 0) {
+        return -1;
+    }
+
+    uint32_t in_size = (uint32_t) engine->header->input_length * engine->header->input_channels;
+    const int8_t* vector = (const int8_t*) (engine->blob + engine->header->test_offset);
+    uint32_t count;
+    uint32_t differ = 0;
+
+    memcpy(nn_engine_input(engine), vector, in_size);
+    nn_engine_run(engine, NULL, 0);
+
+    const int8_t* out = nn_engine_output(engine, &count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (out[i] != vector[in_size + i]) {
+            differ++;
+        }
+    }
+
+    if (mismatches != NULL) {
+        *mismatches = differ;
+    }
+
+    return (differ == 0) ? 1 : 0;
+}
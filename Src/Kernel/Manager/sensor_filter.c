@@ -0,0 +1,598 @@
+/**
+* @file sensor_filter.c
+* @brief Per-sensor DSP filter chain implementation
+* @date 2025-05-27
+*/
+
+#include "sensor_filter.h"
+
+#include "filter_design.h"
+#include "log_manager.h"
+#include "scheduler.h"
+#include "sensor_manager.h"
+#include "spinlock_manager.h"
+#include "usb_shell.h"
+
+#include "arm_math.h"
+
+#include "hardware/structs/m33.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SENSOR_FILTER_DEFAULT_RATE_HZ   100.0f
+#define SENSOR_FILTER_DEFAULT_BLOCK     8
+#define SENSOR_FILTER_DEFAULT_Q         0.7071f
+#define SENSOR_FILTER_FIR_STATE         (SENSOR_FILTER_MAX_TAPS + SENSOR_FILTER_MAX_BLOCK - 1)
+
+/**
+ * @brief Filter state of one axis
+ */
+typedef struct {
+    float block[SENSOR_FILTER_MAX_BLOCK];                   // Samples waiting for a full block
+    float median_hist[SENSOR_FILTER_MAX_MEDIAN - 1];        // Last inputs of the previous block
+    float biquad_state[2 * SENSOR_FILTER_MAX_BIQUADS];      // Biquad delay line
+    float fir_state[SENSOR_FILTER_FIR_STATE];               // FIR decimator delay line
+    arm_biquad_cascade_df2T_instance_f32 biquad;            // Biquad cascade instance
+    arm_fir_decimate_instance_f32 fir;                      // FIR decimator instance
+} sensor_filter_axis_t;
+
+/**
+ * @brief Filter chain of one sensor type
+ */
+typedef struct {
+    sensor_filter_config_t config;                          // Configuration
+    sensor_filter_stats_t stats;                            // Statistics
+    float biquad_coeffs[5 * SENSOR_FILTER_MAX_BIQUADS];     // {b0, b1, b2, -a1, -a2} per section
+    float fir_coeffs[SENSOR_FILTER_MAX_TAPS];               // FIR decimator taps
+    uint8_t fir_taps;                                       // FIR taps in use
+    uint8_t pending;                                        // Samples in the block buffers
+    bool primed;                                            // Median history holds real samples
+    sensor_filter_axis_t axes[SENSOR_FILTER_AXES];          // Per-axis state
+} sensor_filter_chain_t;
+
+/**
+ * @brief Sensor filter state
+ */
+typedef struct {
+    bool initialized;
+    uint32_t lock_num;                                      // Spinlock for the chains
+    sensor_filter_chain_t* chains[SENSOR_FILTER_MAX_TYPES]; // Chains, allocated on first configure
+} sensor_filter_state_t;
+
+static sensor_filter_state_t g_filter = {
+    .initialized = false,
+    .lock_num = UINT_MAX
+};
+
+static void sensor_filter_cycles_enable(void) {
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+}
+
+static bool sensor_filter_type_valid(sensor_type_t type) {
+    return type > SENSOR_TYPE_UNKNOWN && type < SENSOR_FILTER_MAX_TYPES;
+}
+
+/**
+ * @brief Default FIR length for a decimation factor
+ */
+static uint8_t sensor_filter_default_taps(uint8_t decimation) {
+    uint32_t taps = (4u * decimation) + 1u;
+    return (uint8_t) ((taps > SENSOR_FILTER_MAX_TAPS) ? SENSOR_FILTER_MAX_TAPS : taps);
+}
+
+static bool sensor_filter_validate(const sensor_filter_config_t* config) {
+    if (!(config->sample_rate_hz > 0.0f)) {
+        log_message(LOG_LEVEL_WARN, "Sensor Filter", "Sample rate must be positive.");
+        return false;
+    }
+
+    if (config->block_size == 0 || config->block_size > SENSOR_FILTER_MAX_BLOCK) {
+        log_message(LOG_LEVEL_WARN, "Sensor Filter", "Block size must be 1 to %d.", SENSOR_FILTER_MAX_BLOCK);
+        return false;
+    }
+
+    if (config->median_window != 0 && config->median_window != 3 && config->median_window != 5) {
+        log_message(LOG_LEVEL_WARN, "Sensor Filter", "Median window must be 0, 3 or 5.");
+        return false;
+    }
+
+    if (config->biquad_count > SENSOR_FILTER_MAX_BIQUADS) {
+        log_message(LOG_LEVEL_WARN, "Sensor Filter", "At most %d biquads.", SENSOR_FILTER_MAX_BIQUADS);
+        return false;
+    }
+
+    for (int i = 0; i < config->biquad_count; i++) {
+        const sensor_filter_biquad_t* bq = &config->biquads[i];
+
+        if (!(bq->cutoff_hz > 0.0f) || bq->cutoff_hz >= (config->sample_rate_hz * 0.5f) || !(bq->q > 0.0f)) {
+            log_message(LOG_LEVEL_WARN, "Sensor Filter", "Biquad %d needs 0 < cutoff < %.1f Hz and q > 0.",
+                i, (double) (config->sample_rate_hz * 0.5f));
+            return false;
+        }
+    }
+
+    if (config->decimation == 0 || (config->block_size % config->decimation) != 0) {
+        log_message(LOG_LEVEL_WARN, "Sensor Filter", "Block size must be a multiple of the decimation.");
+        return false;
+    }
+
+    if (config->fir_taps > SENSOR_FILTER_MAX_TAPS) {
+        log_message(LOG_LEVEL_WARN, "Sensor Filter", "At most %d FIR taps.", SENSOR_FILTER_MAX_TAPS);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Clear the delay lines and statistics, lock held or chain unpublished
+ */
+static void sensor_filter_clear(sensor_filter_chain_t* chain) {
+    chain->pending = 0;
+    chain->primed = false;
+    memset(&chain->stats, 0, sizeof(chain->stats));
+
+    for (int a = 0; a < SENSOR_FILTER_AXES; a++) {
+        sensor_filter_axis_t* axis = &chain->axes[a];
+
+        memset(axis->median_hist, 0, sizeof(axis->median_hist));
+        memset(axis->biquad_state, 0, sizeof(axis->biquad_state));
+        memset(axis->fir_state, 0, sizeof(axis->fir_state));
+    }
+}
+
+/**
+ * @brief Build the CMSIS-DSP instances from the configuration
+ */
+static void sensor_filter_build(sensor_filter_chain_t* chain, const sensor_filter_config_t* config) {
+    chain->config = *config;
+
+    for (int i = 0; i < config->biquad_count; i++) {
+        const sensor_filter_biquad_t* bq = &config->biquads[i];
+        filter_design_type_t type = (bq->type == SENSOR_FILTER_HIGHPASS) ? FILTER_DESIGN_HIGHPASS :
+            (bq->type == SENSOR_FILTER_NOTCH) ? FILTER_DESIGN_NOTCH : FILTER_DESIGN_LOWPASS;
+
+        filter_design_biquad(type, bq->cutoff_hz, bq->q, config->sample_rate_hz, &chain->biquad_coeffs[5 * i]);
+    }
+
+    // Anti-alias cutoff at 80% of the output Nyquist frequency
+    chain->fir_taps = 0;
+    if (config->decimation > 1) {
+        chain->fir_taps = (config->fir_taps != 0) ? config->fir_taps : sensor_filter_default_taps(config->decimation);
+        filter_design_fir_lowpass(chain->fir_taps, 0.4f / (float) config->decimation, chain->fir_coeffs);
+    }
+
+    sensor_filter_clear(chain);
+
+    for (int a = 0; a < SENSOR_FILTER_AXES; a++) {
+        sensor_filter_axis_t* axis = &chain->axes[a];
+
+        if (config->biquad_count > 0) {
+            arm_biquad_cascade_df2T_init_f32(&axis->biquad, config->biquad_count,
+                chain->biquad_coeffs, axis->biquad_state);
+        }
+
+        if (chain->fir_taps > 0) {
+            arm_fir_decimate_init_f32(&axis->fir, chain->fir_taps, config->decimation,
+                chain->fir_coeffs, axis->fir_state, config->block_size);
+        }
+    }
+}
+
+/**
+ * @brief Median of a short window by insertion sort
+ */
+static inline float sensor_filter_median(const float* window, int n) {
+    float sorted[SENSOR_FILTER_MAX_MEDIAN];
+
+    for (int i = 0; i < n; i++) {
+        float v = window[i];
+        int j = i;
+
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+
+    return sorted[n / 2];
+}
+
+/**
+ * @brief Run a full block of one axis through the chain, in place
+ *
+ * @return Number of output samples left in axis->block
+ */
+static int sensor_filter_run_axis(sensor_filter_chain_t* chain, sensor_filter_axis_t* axis) {
+    const sensor_filter_config_t* config = &chain->config;
+    uint32_t n = config->block_size;
+
+    if (config->median_window > 1) {
+        uint32_t hist = config->median_window - 1u;
+        float ext[SENSOR_FILTER_MAX_MEDIAN - 1 + SENSOR_FILTER_MAX_BLOCK];
+
+        memcpy(ext, axis->median_hist, hist * sizeof(float));
+        memcpy(&ext[hist], axis->block, n * sizeof(float));
+
+        for (uint32_t i = 0; i < n; i++) {
+            axis->block[i] = sensor_filter_median(&ext[i], config->median_window);
+        }
+
+        memcpy(axis->median_hist, &ext[n], hist * sizeof(float));
+    }
+
+    if (config->biquad_count > 0) {
+        arm_biquad_cascade_df2T_f32(&axis->biquad, axis->block, axis->block, n);
+    }
+
+    if (chain->fir_taps > 0) {
+        float out[SENSOR_FILTER_MAX_BLOCK];
+
+        arm_fir_decimate_f32(&axis->fir, axis->block, out, n);
+        n /= config->decimation;
+        memcpy(axis->block, out, n * sizeof(float));
+    }
+
+    return (int) n;
+}
+
+bool sensor_filter_init(void) {
+    if (g_filter.initialized) {
+        return true;
+    }
+
+    g_filter.lock_num = hw_spinlock_allocate(SPINLOCK_CAT_SENSOR, "sensor_filter");
+    if (g_filter.lock_num == UINT_MAX) {
+        log_message(LOG_LEVEL_ERROR, "Sensor Filter", "Failed to allocate spinlock.");
+        return false;
+    }
+
+    sensor_filter_cycles_enable();
+
+    g_filter.initialized = true;
+    return true;
+}
+
+void sensor_filter_get_default_config(sensor_filter_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+
+    memset(config, 0, sizeof(sensor_filter_config_t));
+    config->enabled = false;
+    config->sample_rate_hz = SENSOR_FILTER_DEFAULT_RATE_HZ;
+    config->block_size = SENSOR_FILTER_DEFAULT_BLOCK;
+    config->decimation = 1;
+}
+
+bool sensor_filter_configure(sensor_type_t type, const sensor_filter_config_t* config) {
+    if (!g_filter.initialized || !sensor_filter_type_valid(type) || config == NULL) {
+        return false;
+    }
+
+    if (!sensor_filter_validate(config)) {
+        return false;
+    }
+
+    // Allocate outside the lock, the chain is only published once built
+    sensor_filter_chain_t* chain = g_filter.chains[type];
+    if (chain == NULL) {
+        chain = (sensor_filter_chain_t*) malloc(sizeof(sensor_filter_chain_t));
+        if (chain == NULL) {
+            log_message(LOG_LEVEL_ERROR, "Sensor Filter", "Out of memory for %s chain.",
+                sensor_manager_type_to_string(type));
+            return false;
+        }
+
+        memset(chain, 0, sizeof(sensor_filter_chain_t));
+        sensor_filter_build(chain, config);
+
+        uint32_t save = hw_spinlock_acquire(g_filter.lock_num, scheduler_get_current_task());
+        g_filter.chains[type] = chain;
+        hw_spinlock_release(g_filter.lock_num, save);
+    }
+    else {
+        uint32_t save = hw_spinlock_acquire(g_filter.lock_num, scheduler_get_current_task());
+        sensor_filter_build(chain, config);
+        hw_spinlock_release(g_filter.lock_num, save);
+    }
+
+    log_message(LOG_LEVEL_INFO, "Sensor Filter", "%s chain %s: %u biquads, median %u, decimate %u, block %u.",
+        sensor_manager_type_to_string(type), config->enabled ? "enabled" : "disabled",
+        config->biquad_count, config->median_window, config->decimation, config->block_size);
+
+    return true;
+}
+
+bool sensor_filter_get_config(sensor_type_t type, sensor_filter_config_t* config) {
+    if (config == NULL) {
+        return false;
+    }
+
+    if (!sensor_filter_type_valid(type) || g_filter.chains[type] == NULL) {
+        sensor_filter_get_default_config(config);
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_filter.lock_num, scheduler_get_current_task());
+    *config = g_filter.chains[type]->config;
+    hw_spinlock_release(g_filter.lock_num, save);
+
+    return true;
+}
+
+bool sensor_filter_get_stats(sensor_type_t type, sensor_filter_stats_t* stats) {
+    if (stats == NULL || !sensor_filter_type_valid(type) || g_filter.chains[type] == NULL) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_filter.lock_num, scheduler_get_current_task());
+    *stats = g_filter.chains[type]->stats;
+    hw_spinlock_release(g_filter.lock_num, save);
+
+    return true;
+}
+
+bool sensor_filter_reset(sensor_type_t type) {
+    if (!sensor_filter_type_valid(type) || g_filter.chains[type] == NULL) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_filter.lock_num, scheduler_get_current_task());
+    sensor_filter_clear(g_filter.chains[type]);
+    hw_spinlock_release(g_filter.lock_num, save);
+
+    return true;
+}
+
+int sensor_filter_push(sensor_type_t type, const sensor_data_t* in, sensor_data_t* out, int max_out) {
+    if (!sensor_filter_type_valid(type) || in == NULL || out == NULL) {
+        return -1;
+    }
+
+    sensor_filter_chain_t* chain = g_filter.chains[type];
+    if (chain == NULL || !chain->config.enabled) {
+        return -1;
+    }
+
+    const float values[SENSOR_FILTER_AXES] = {in->xyz.x, in->xyz.y, in->xyz.z};
+    int count = 0;
+
+    uint32_t save = hw_spinlock_acquire(g_filter.lock_num, scheduler_get_current_task());
+
+    // Start the median history from the first sample instead of zeros
+    if (!chain->primed) {
+        for (int a = 0; a < SENSOR_FILTER_AXES; a++) {
+            for (int i = 0; i < (SENSOR_FILTER_MAX_MEDIAN - 1); i++) {
+                chain->axes[a].median_hist[i] = values[a];
+            }
+        }
+        chain->primed = true;
+    }
+
+    for (int a = 0; a < SENSOR_FILTER_AXES; a++) {
+        chain->axes[a].block[chain->pending] = values[a];
+    }
+
+    chain->pending++;
+    chain->stats.samples_in++;
+
+    if (chain->pending >= chain->config.block_size) {
+        uint32_t start = m33_hw->dwt_cyccnt;
+
+        for (int a = 0; a < SENSOR_FILTER_AXES; a++) {
+            count = sensor_filter_run_axis(chain, &chain->axes[a]);
+        }
+
+        uint32_t cycles = m33_hw->dwt_cyccnt - start;
+        uint32_t per_sample = cycles / chain->config.block_size;
+
+        if (count > max_out) {
+            count = max_out;
+        }
+
+        for (int i = 0; i < count; i++) {
+            out[i].xyz.x = chain->axes[0].block[i];
+            out[i].xyz.y = chain->axes[1].block[i];
+            out[i].xyz.z = chain->axes[2].block[i];
+        }
+
+        chain->pending = 0;
+        chain->stats.blocks++;
+        chain->stats.samples_out += (uint32_t) count;
+        chain->stats.total_cycles += cycles;
+        chain->stats.last_cycles_per_sample = per_sample;
+        if (per_sample > chain->stats.max_cycles_per_sample) {
+            chain->stats.max_cycles_per_sample = per_sample;
+        }
+    }
+
+    hw_spinlock_release(g_filter.lock_num, save);
+
+    return count;
+}
+
+static const char* sensor_filter_biquad_to_string(sensor_filter_biquad_type_t type) {
+    switch (type) {
+        case SENSOR_FILTER_LOWPASS:  return "lp";
+        case SENSOR_FILTER_HIGHPASS: return "hp";
+        case SENSOR_FILTER_NOTCH:    return "notch";
+        default:                     return "?";
+    }
+}
+
+static void handle_filter_list(void) {
+    bool any = false;
+
+    for (int t = SENSOR_TYPE_UNKNOWN + 1; t < SENSOR_FILTER_MAX_TYPES; t++) {
+        sensor_filter_config_t config;
+        sensor_filter_stats_t stats;
+
+        if (!sensor_filter_get_config((sensor_type_t) t, &config) ||
+            !sensor_filter_get_stats((sensor_type_t) t, &stats)) {
+            continue;
+        }
+
+        any = true;
+        printf("%s: %s, %.1f Hz, block %u, median %u, decimate %u",
+            sensor_manager_type_to_string((sensor_type_t) t), config.enabled ? "enabled" : "disabled",
+            (double) config.sample_rate_hz, config.block_size, config.median_window, config.decimation);
+        if (config.decimation > 1) {
+            printf(" (%u taps)", (config.fir_taps != 0) ? config.fir_taps : sensor_filter_default_taps(config.decimation));
+        }
+        printf("\n\r");
+
+        for (int i = 0; i < config.biquad_count; i++) {
+            printf("  biquad %d: %s %.2f Hz q %.3f\n\r", i, sensor_filter_biquad_to_string(config.biquads[i].type),
+                (double) config.biquads[i].cutoff_hz, (double) config.biquads[i].q);
+        }
+
+        uint32_t avg = (stats.samples_in > 0) ? (uint32_t) (stats.total_cycles / stats.samples_in) : 0;
+        printf("  in %lu, out %lu, blocks %lu, cycles/sample last %lu avg %lu max %lu\n\r",
+            stats.samples_in, stats.samples_out, stats.blocks,
+            stats.last_cycles_per_sample, avg, stats.max_cycles_per_sample);
+    }
+
+    if (!any) {
+        printf("No filter chains configured\n\r");
+    }
+}
+
+static int handle_filter_set(sensor_type_t type, sensor_filter_config_t* config, int argc, char* argv[]) {
+    if (argc < 5) {
+        printf("Usage: filter set <type> <rate|block|median|decimate> <value> [taps]\n\r");
+        return 1;
+    }
+
+    const char* field = argv[3];
+    long value = strtol(argv[4], NULL, 10);
+
+    if (strcmp(field, "rate") == 0) {
+        config->sample_rate_hz = strtof(argv[4], NULL);
+    }
+    else if (strcmp(field, "block") == 0) {
+        config->block_size = (uint8_t) value;
+    }
+    else if (strcmp(field, "median") == 0) {
+        config->median_window = (uint8_t) value;
+    }
+    else if (strcmp(field, "decimate") == 0) {
+        config->decimation = (uint8_t) value;
+        config->fir_taps = (argc > 5) ? (uint8_t) strtol(argv[5], NULL, 10) : 0;
+    }
+    else {
+        printf("Unknown filter setting: %s\n\r", field);
+        return 1;
+    }
+
+    return sensor_filter_configure(type, config) ? 0 : 1;
+}
+
+static int handle_filter_add(sensor_type_t type, sensor_filter_config_t* config, int argc, char* argv[]) {
+    if (argc < 5) {
+        printf("Usage: filter add <type> <lp|hp|notch> <hz> [q]\n\r");
+        return 1;
+    }
+
+    if (config->biquad_count >= SENSOR_FILTER_MAX_BIQUADS) {
+        printf("Chain already has %d biquads\n\r", SENSOR_FILTER_MAX_BIQUADS);
+        return 1;
+    }
+
+    sensor_filter_biquad_t* bq = &config->biquads[config->biquad_count];
+
+    if (strcmp(argv[3], "lp") == 0) {
+        bq->type = SENSOR_FILTER_LOWPASS;
+    }
+    else if (strcmp(argv[3], "hp") == 0) {
+        bq->type = SENSOR_FILTER_HIGHPASS;
+    }
+    else if (strcmp(argv[3], "notch") == 0) {
+        bq->type = SENSOR_FILTER_NOTCH;
+    }
+    else {
+        printf("Unknown biquad type: %s\n\r", argv[3]);
+        return 1;
+    }
+
+    bq->cutoff_hz = strtof(argv[4], NULL);
+    bq->q = (argc > 5) ? strtof(argv[5], NULL) : SENSOR_FILTER_DEFAULT_Q;
+    config->biquad_count++;
+    config->enabled = true;
+
+    return sensor_filter_configure(type, config) ? 0 : 1;
+}
+
+int cmd_filter(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: filter <list|set|add|clear|reset|enable|disable> [<type> ...]\n\r");
+        printf("  filter set <type> rate <hz>|block <n>|median <0|3|5>|decimate <n> [taps]\n\r");
+        printf("  filter add <type> <lp|hp|notch> <hz> [q]\n\r");
+        printf("where <type> is: mag, accel, gyro, temp, press, hum\n\r");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "list") == 0) {
+        handle_filter_list();
+        return 0;
+    }
+
+    if (argc < 3) {
+        printf("Usage: filter %s <type>\n\r", argv[1]);
+        return 1;
+    }
+
+    sensor_type_t type = sensor_manager_type_from_string(argv[2]);
+    if (type == SENSOR_TYPE_UNKNOWN) {
+        printf("Unknown sensor type: %s\n\r", argv[2]);
+        return 1;
+    }
+
+    sensor_filter_config_t config;
+    sensor_filter_get_config(type, &config);
+
+    if (strcmp(argv[1], "set") == 0) {
+        return handle_filter_set(type, &config, argc, argv);
+    }
+    else if (strcmp(argv[1], "add") == 0) {
+        return handle_filter_add(type, &config, argc, argv);
+    }
+    else if (strcmp(argv[1], "clear") == 0) {
+        float rate = config.sample_rate_hz;
+
+        sensor_filter_get_default_config(&config);
+        config.sample_rate_hz = rate;
+        return sensor_filter_configure(type, &config) ? 0 : 1;
+    }
+    else if (strcmp(argv[1], "reset") == 0) {
+        if (!sensor_filter_reset(type)) {
+            printf("No filter chain for %s\n\r", argv[2]);
+            return 1;
+        }
+    }
+    else if (strcmp(argv[1], "enable") == 0 || strcmp(argv[1], "disable") == 0) {
+        config.enabled = (strcmp(argv[1], "enable") == 0);
+        return sensor_filter_configure(type, &config) ? 0 : 1;
+    }
+    else {
+        printf("Unknown filter command: %s\n\r", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
+
+void register_sensor_filter_commands(void) {
+    static const shell_command_t filter_command = {
+        cmd_filter,
+        "filter",
+        "Sensor DSP filter chains (list|set|add|clear|reset|enable|disable)"
+    };
+
+    shell_register_command(&filter_command);
+}
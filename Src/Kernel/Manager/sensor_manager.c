@@ -11,11 +11,16 @@
 #include "i2c_driver.h"
 #include "i2c_sensor_adapter.h"
 
+#include "blackbox_manager.h"
+#include "kernel_placement.h"
 #include "log_manager.h"
+#include "sensor_filter.h"
 #include "sensor_manager.h"
+#include "spectrum_manager.h"
 #include "spinlock_manager.h"
 
 #include "usb_shell.h"
+#include "watchdog_manager.h"
 
 #include "hardware/sync.h"
 #include "pico/stdlib.h"
@@ -42,6 +47,14 @@ typedef struct {
     bool is_active;                   // Whether the sensor is active
 } sensor_entry_t;
 
+/**
+ * @brief Newest delivered sample of a sensor type
+ */
+typedef struct {
+    volatile uint32_t sequence;                      // Odd while the sample is written
+    sensor_data_t data;                               // Sample
+} sensor_latest_t;
+
 /**
  * @brief Sensor manager structure
  */
@@ -49,12 +62,14 @@ struct sensor_manager_s {
     i2c_driver_ctx_t* i2c_ctx;                            // I2C driver context
     sensor_entry_t sensors[SENSOR_MANAGER_MAX_SENSORS];   // Array of sensor entries
     uint32_t task_period_ms;                             // Task period in milliseconds
+    uint32_t base_period_ms;                             // Configured period, restored after degradation
     uint32_t last_execution_time;                       // Time of last task execution
     uint32_t access_lock_num;                              // Lock for thread-safe access
     uint32_t lock_owner;                               // ID of task that acquired the lock (0 = none)
     uint32_t lock_save;                                // Saved state for unlocking
     sensor_manager_callback_t callback;                 // Data callback function
     void* callback_data;                                // User data for callback
+    sensor_latest_t latest[SENSOR_TYPE_ENV + 1];        // Newest sample per type
     bool is_running;                                   // Whether the manager is running
 };
 
@@ -67,9 +82,14 @@ static i2c_driver_ctx_t* g_i2c_driver = NULL;
 // Sensor manager task ID from scheduler
 static int g_sensor_task_id = -1;
 
+// Watchdog heartbeat handle
+static int g_sensor_heartbeat = -1;
+
 // Spinlock for init/deinit operations
 static uint32_t g_sensor_lock_num;
 
+static void sensor_manager_mode_handler(scheduler_mode_t mode);
+static bool sensor_manager_restart_sensors(void* user_data);
 static void sensor_manager_scheduler_task(void *param);
 static bool setup_default_sensors(sensor_manager_t manager);
 static i2c_sensor_adapter_t setup_bmm350_sensor(sensor_manager_t manager);
@@ -97,6 +117,7 @@ sensor_manager_t sensor_manager_create(const sensor_manager_config_t* config) {
     memset(manager, 0, sizeof(struct sensor_manager_s));
     manager->i2c_ctx = config->i2c_ctx;
     manager->task_period_ms = config->task_period_ms;
+    manager->base_period_ms = config->task_period_ms;
     manager->is_running = false;
     
     manager->access_lock_num = hw_spinlock_allocate(SPINLOCK_CAT_SENSOR, "sensor_manager");
@@ -364,7 +385,7 @@ static sensor_type_t get_sensor_type(const sensor_manager_t manager, int index)
 static bool try_get_sensor_data(const sensor_manager_t manager, int index, sensor_data_t* data) {
     bool result = i2c_sensor_adapter_get_data(manager->sensors[index].adapter, data);
     if (!result) {
-        log_message(LOG_LEVEL_ERROR, "Sensor Manager", "Failed to get data from sensor adapter");
+        LOG_RATELIMITED(1000, 3, LOG_LEVEL_ERROR, "Sensor Manager", "Failed to get data from sensor adapter");
     }
     return result;
 }
@@ -409,6 +430,28 @@ bool sensor_manager_get_data(sensor_manager_t manager, sensor_type_t type, senso
     return false;
 }
 
+bool sensor_manager_get_latest(sensor_manager_t manager, sensor_type_t type, sensor_data_t* data) {
+    if (manager == NULL || type == SENSOR_TYPE_UNKNOWN || type > SENSOR_TYPE_ENV || data == NULL) {
+        return false;
+    }
+
+    const sensor_latest_t* latest = &manager->latest[type];
+
+    // Retry while the sensor task rewrites the sample
+    for (int attempt = 0; attempt < 4; attempt++) {
+        uint32_t sequence = latest->sequence;
+        __dmb();
+        *data = latest->data;
+        __dmb();
+
+        if ((sequence & 1u) == 0 && sequence == latest->sequence) {
+            return sequence != 0;
+        }
+    }
+
+    return false;
+}
+
 void sensor_manager_task(void* param) {
     sensor_manager_t manager = (sensor_manager_t)param;
     
@@ -517,9 +560,37 @@ static void sensor_manager_internal_callback(sensor_type_t type, const sensor_da
         return;
     }
     
-    // Forward the data to the registered callback if any
-    if (manager->callback != NULL) {
+    // Record the raw sample, the filter can hide what went wrong
+    blackbox_manager_record_sensor(type, data);
+
+    // Vibration analysis needs the full bandwidth
+    spectrum_manager_record_sensor(type, data);
+
+    sensor_data_t filtered[SENSOR_FILTER_MAX_BLOCK];
+    int count = sensor_filter_push(type, data, filtered, SENSOR_FILTER_MAX_BLOCK);
+
+    if (type <= SENSOR_TYPE_ENV && count != 0) {
+        sensor_latest_t* latest = &manager->latest[type];
+
+        latest->sequence++;
+        __dmb();
+        latest->data = (count < 0) ? *data : filtered[count - 1];
+        __dmb();
+        latest->sequence++;
+    }
+
+    if (manager->callback == NULL) {
+        return;
+    }
+
+    // Unfiltered types pass straight through
+    if (count < 0) {
         manager->callback(type, data, manager->callback_data);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        manager->callback(type, &filtered[i], manager->callback_data);
     }
 }
 
@@ -637,7 +708,57 @@ i2c_driver_ctx_t* sensor_manager_get_i2c_context(sensor_manager_t manager) {
  * @param param Parameters (unused)
  */
 
+/**
+ * @brief Scheduler mode handler, lowers the sampling rate under overload
+ * 
+ * @param mode Newly entered scheduler mode
+ */
+static void sensor_manager_mode_handler(scheduler_mode_t mode) {
+    sensor_manager_t manager = sensor_manager_get_instance();
+    if (manager == NULL) {
+        return;
+    }
+
+    if (mode == SCHEDULER_MODE_DEGRADED) {
+        manager->task_period_ms = manager->base_period_ms * SENSOR_MANAGER_DEGRADED_PERIOD_FACTOR;
+    } else {
+        manager->task_period_ms = manager->base_period_ms;
+    }
+
+    log_message(LOG_LEVEL_INFO, "Sensor Manager", "Sampling period set to %lu ms.", manager->task_period_ms);
+}
+
+/**
+ * @brief Watchdog recovery, restarts every active sensor
+ * 
+ * @param user_data Sensor manager handle
+ * @return true if all sensors restarted
+ */
+static bool sensor_manager_restart_sensors(void* user_data) {
+    sensor_manager_t manager = (sensor_manager_t)user_data;
+    if (manager == NULL) {
+        return false;
+    }
+
+    // A sensor that hung mid-transfer may still be holding the bus
+    if (manager->i2c_ctx != NULL) {
+        i2c_driver_recover_bus(manager->i2c_ctx);
+    }
+
+    bool success = true;
+    for (int i = 0; i < SENSOR_MANAGER_MAX_SENSORS; i++) {
+        if (manager->sensors[i].adapter != NULL && manager->sensors[i].is_active) {
+            i2c_sensor_adapter_stop(manager->sensors[i].adapter);
+            success &= i2c_sensor_adapter_start(manager->sensors[i].adapter);
+        }
+    }
+
+    log_message(LOG_LEVEL_WARN, "Sensor Manager", "Sensors restarted by watchdog (%s).", success ? "ok" : "failed");
+    return success;
+}
+
 static void sensor_manager_scheduler_task(void *param) {
+    KERNEL_PROFILE_FUNC();
     (void)param; // Unused parameter
     
     // Call the sensor manager task function
@@ -649,6 +770,9 @@ static void sensor_manager_scheduler_task(void *param) {
         // Release the lock
         sensor_manager_unlock(manager);
     }
+
+    // Returning from a pass counts as a heartbeat, a hung read never does
+    watchdog_manager_checkin(g_sensor_heartbeat);
 }
 
 bool sensor_manager_init(void) {
@@ -678,6 +802,7 @@ bool sensor_manager_init(void) {
     i2c_config.scl_pin = 17;
     i2c_config.clock_freq = 400000;  // 400 kHz
     i2c_config.use_dma = false;       // Enable DMA for better performance
+    i2c_config.auto_clock_fallback = true;  // Drop to 100 kHz if the bus turns noisy
     
     g_i2c_driver = i2c_driver_init(&i2c_config);
     if (g_i2c_driver == NULL) {
@@ -730,6 +855,15 @@ bool sensor_manager_init(void) {
         hw_spinlock_release(g_sensor_lock_num, save);
         return false;
     }
+
+    // Drop the sampling rate when the scheduler sheds load
+    if (!scheduler_register_mode_handler(sensor_manager_mode_handler)) {
+        log_message(LOG_LEVEL_WARN, "Sensor Manager Init", "Failed to register scheduler mode handler.");
+    }
+
+    // Supervise the sensor task, a hung read restarts the sensors
+    g_sensor_heartbeat = watchdog_manager_register("sensor_mgr", g_sensor_task_id, SENSOR_MANAGER_HEARTBEAT_MS,
+        false, WATCHDOG_ACTION_RESTART_TASK, sensor_manager_restart_sensors, g_global_sensor_manager);
     
     // Release lock
     hw_spinlock_release(g_sensor_lock_num, save);
@@ -880,13 +1014,15 @@ static void print_sensor_usage(void) {
     printf("  i2c_read <dev_addr> <reg_addr> [len=1] - Read register(s)\n");
     printf("  i2c_write <dev_addr> <reg_addr> <value1> [value2...] - Write register(s)\n");
     printf("  dump <dev_addr> <start_reg> <end_reg> - Dump register range\n");
+    printf("  i2c_stats [reset] - Show bus error, retry and clock statistics\n");
+    printf("  i2c_recover - Clock a stuck device off the bus\n");
+    printf("  i2c_clock <hz> - Set the bus clock and fallback ceiling\n");
     printf("where <type> is: mag, accel, gyro, temp, press, hum\n");
     printf("and <mode> is: off, low, normal, high\n");
     printf("and <rate> is: off, low, normal, high, vhigh\n");
 }
 
-// Helper function to parse sensor type from command line
-static sensor_type_t parse_sensor_type(const char* type_str) {
+sensor_type_t sensor_manager_type_from_string(const char* type_str) {
     if (strcmp(type_str, "mag") == 0) {
         return SENSOR_TYPE_MAGNETOMETER;
     } else if (strcmp(type_str, "accel") == 0) {
@@ -904,8 +1040,7 @@ static sensor_type_t parse_sensor_type(const char* type_str) {
     return SENSOR_TYPE_UNKNOWN;
 }
 
-// Helper function to convert sensor type to string
-static const char* sensor_type_to_string(sensor_type_t type) {
+const char* sensor_manager_type_to_string(sensor_type_t type) {
     switch (type) {
         case SENSOR_TYPE_ACCELEROMETER: return "Accelerometer";
         case SENSOR_TYPE_GYROSCOPE:     return "Gyroscope";
@@ -948,7 +1083,7 @@ static int handle_sensor_info(sensor_manager_t manager) {
     } else {
         for (int i = 0; i < count; i++) {
             printf("  - %s: %s\n", 
-                sensor_type_to_string(types[i]), 
+                sensor_manager_type_to_string(types[i]), 
                 statuses[i] ? "Running" : "Stopped");
         }
     }
@@ -968,6 +1103,91 @@ static int handle_sensor_scan(sensor_manager_t manager) {
     return sensor_i2c_scan(i2c_ctx);
 }
 
+// Command handler for 'i2c_stats' command
+static int handle_sensor_i2c_stats(sensor_manager_t manager, int argc, char* argv[]) {
+    i2c_driver_ctx_t* i2c_ctx = sensor_manager_get_i2c_context(manager);
+    
+    if (i2c_ctx == NULL) {
+        printf("Could not access I2C driver context\n");
+        return 1;
+    }
+    
+    if (argc >= 3 && strcmp(argv[2], "reset") == 0) {
+        i2c_driver_reset_stats(i2c_ctx);
+        printf("I2C statistics reset\n");
+        return 0;
+    }
+    
+    i2c_driver_stats_t stats;
+    if (!i2c_driver_get_stats(i2c_ctx, &stats)) {
+        printf("Failed to read I2C statistics\n");
+        return 1;
+    }
+    
+    printf("=== I2C Bus Statistics ===\n");
+    printf("Clock: %lu Hz (max %lu Hz, %s)\n", stats.clock_freq, stats.max_clock_freq,
+        i2c_ctx->auto_clock_fallback ? "auto fallback" : "fixed");
+    printf("Transfers: %lu, errors: %lu, retries: %lu, failures: %lu\n",
+        stats.transfers, stats.errors, stats.retries, stats.failures);
+    printf("Recoveries: %lu (failed %lu), fallbacks: %lu, restores: %lu\n",
+        stats.recoveries, stats.recovery_failures, stats.clock_fallbacks, stats.clock_restores);
+    
+    if (stats.device_count > 0) {
+        printf("Addr  Transfers  Errors  Retries  Failures\n");
+        for (int i = 0; i < stats.device_count; i++) {
+            const i2c_driver_device_stats_t* dev = &stats.devices[i];
+            printf("0x%02X  %9lu  %6lu  %7lu  %8lu\n",
+                dev->addr, dev->transfers, dev->errors, dev->retries, dev->failures);
+        }
+    }
+    
+    return 0;
+}
+
+// Command handler for 'i2c_recover' command
+static int handle_sensor_i2c_recover(sensor_manager_t manager) {
+    i2c_driver_ctx_t* i2c_ctx = sensor_manager_get_i2c_context(manager);
+    
+    if (i2c_ctx == NULL) {
+        printf("Could not access I2C driver context\n");
+        return 1;
+    }
+    
+    bool freed = i2c_driver_recover_bus(i2c_ctx);
+    printf("Bus recovery %s\n", freed ? "succeeded" : "failed, a line is still held low");
+    
+    return freed ? 0 : 1;
+}
+
+// Command handler for 'i2c_clock' command
+static int handle_sensor_i2c_clock(sensor_manager_t manager, int argc, char* argv[]) {
+    if (argc < 3) {
+        printf("Usage: sensor i2c_clock <hz>\n");
+        return 1;
+    }
+    
+    i2c_driver_ctx_t* i2c_ctx = sensor_manager_get_i2c_context(manager);
+    
+    if (i2c_ctx == NULL) {
+        printf("Could not access I2C driver context\n");
+        return 1;
+    }
+    
+    uint32_t clock_freq = (uint32_t)strtoul(argv[2], NULL, 0);
+    if (clock_freq < 10000 || clock_freq > 1000000) {
+        printf("Clock must be between 10000 and 1000000 Hz\n");
+        return 1;
+    }
+    
+    if (!i2c_driver_set_clock(i2c_ctx, clock_freq)) {
+        printf("Failed to set clock, bus busy\n");
+        return 1;
+    }
+    
+    printf("I2C clock set to %lu Hz\n", clock_freq);
+    return 0;
+}
+
 // Command handler for 'i2c_read' command
 static int handle_sensor_i2c_read(sensor_manager_t manager, int argc, char* argv[]) {
     if (argc < 4) {
@@ -1064,7 +1284,7 @@ static int handle_sensor_dump(sensor_manager_t manager, int argc, char* argv[])
 static int handle_sensor_start(sensor_manager_t manager, int argc, char* argv[]) {
     if (argc > 2) {
         // Start specific sensor
-        sensor_type_t type = parse_sensor_type(argv[2]);
+        sensor_type_t type = sensor_manager_type_from_string(argv[2]);
         if (type == SENSOR_TYPE_UNKNOWN) {
             printf("Unknown sensor type: %s\n", argv[2]);
             return 1;
@@ -1093,7 +1313,7 @@ static int handle_sensor_start(sensor_manager_t manager, int argc, char* argv[])
 static int handle_sensor_stop(sensor_manager_t manager, int argc, char* argv[]) {
     if (argc > 2) {
         // Stop specific sensor
-        sensor_type_t type = parse_sensor_type(argv[2]);
+        sensor_type_t type = sensor_manager_type_from_string(argv[2]);
         if (type == SENSOR_TYPE_UNKNOWN) {
             printf("Unknown sensor type: %s\n", argv[2]);
             return 1;
@@ -1125,7 +1345,7 @@ static int handle_sensor_read(sensor_manager_t manager, int argc, char* argv[])
         return 1;
     }
     
-    sensor_type_t type = parse_sensor_type(argv[2]);
+    sensor_type_t type = sensor_manager_type_from_string(argv[2]);
     if (type == SENSOR_TYPE_UNKNOWN) {
         printf("Unknown sensor type: %s\n", argv[2]);
         return 1;
@@ -1195,7 +1415,7 @@ static int handle_sensor_mode(sensor_manager_t manager, int argc, char* argv[])
         return 1;
     }
     
-    sensor_type_t type = parse_sensor_type(argv[2]);
+    sensor_type_t type = sensor_manager_type_from_string(argv[2]);
     if (type == SENSOR_TYPE_UNKNOWN) {
         printf("Unknown sensor type: %s\n", argv[2]);
         return 1;
@@ -1241,7 +1461,7 @@ static int handle_sensor_rate(sensor_manager_t manager, int argc, char* argv[])
         return 1;
     }
     
-    sensor_type_t type = parse_sensor_type(argv[2]);
+    sensor_type_t type = sensor_manager_type_from_string(argv[2]);
     if (type == SENSOR_TYPE_UNKNOWN) {
         printf("Unknown sensor type: %s\n", argv[2]);
         return 1;
@@ -1276,7 +1496,7 @@ static int handle_sensor_status(sensor_manager_t manager) {
         printf("Sensor Status:\n");
         for (int i = 0; i < count; i++) {
             printf("  %s: %s\n", 
-                sensor_type_to_string(types[i]), 
+                sensor_manager_type_to_string(types[i]), 
                 statuses[i] ? "RUNNING" : "STOPPED");
         }
     }
@@ -1309,6 +1529,12 @@ int cmd_sensor(int argc, char *argv[]) {
         return handle_sensor_i2c_write(manager, argc, argv);
     } else if (strcmp(argv[1], "dump") == 0) {
         return handle_sensor_dump(manager, argc, argv);
+    } else if (strcmp(argv[1], "i2c_stats") == 0) {
+        return handle_sensor_i2c_stats(manager, argc, argv);
+    } else if (strcmp(argv[1], "i2c_recover") == 0) {
+        return handle_sensor_i2c_recover(manager);
+    } else if (strcmp(argv[1], "i2c_clock") == 0) {
+        return handle_sensor_i2c_clock(manager, argc, argv);
     } else if (strcmp(argv[1], "start") == 0) {
         return handle_sensor_start(manager, argc, argv);
     } else if (strcmp(argv[1], "stop") == 0) {
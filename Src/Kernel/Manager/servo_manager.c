@@ -4,12 +4,15 @@
 * @date 2025-05-14
 */
 
+#include "blackbox_manager.h"
+#include "kernel_placement.h"
 #include "log_manager.h"
 #include "scheduler.h"
 #include "servo_manager.h"
 #include "servo_controller.h"
 #include "spinlock_manager.h"
 #include "usb_shell.h"
+#include "watchdog_manager.h"
 
 #include <limits.h>
 #include <stdlib.h>
@@ -50,9 +53,12 @@ static int g_servo_task_id = -1;
 // Spinlock for init/deinit operations
 static uint32_t g_servo_lock_num;
 
+// Watchdog heartbeat handle
+static int g_servo_heartbeat = -1;
+
 
 // Private function declarations
-static void servo_manager_scheduler_task(void *param);
+KERNEL_RAM_FUNC(servo) static void servo_manager_scheduler_task(void *param);
 
 servo_manager_t servo_manager_create(const servo_manager_config_t* config) {
     if (config == NULL) {
@@ -277,6 +283,49 @@ bool servo_manager_disable_servo(servo_manager_t manager, uint id) {
     return found;
 }
 
+int servo_manager_set_batch(servo_manager_t manager, const servo_manager_command_t* commands, int count) {
+    if (manager == NULL || commands == NULL || count <= 0) {
+        return 0;
+    }
+    
+    // One lock for the whole batch
+    servo_manager_lock(manager);
+    
+    int applied = 0;
+    
+    for (int c = 0; c < count; c++) {
+        const servo_manager_command_t* command = &commands[c];
+        
+        for (int i = 0; i < SERVO_MANAGER_MAX_SERVOS; i++) {
+            if (manager->servos[i].controller == NULL || manager->servos[i].id != command->id || command->id == 0) {
+                continue;
+            }
+            
+            servo_controller_t controller = manager->servos[i].controller;
+            bool ok = command->is_percent ?
+                servo_controller_set_position_percent(controller, command->value) :
+                servo_controller_set_position(controller, command->value);
+            
+            if (ok) {
+                float position = servo_controller_get_position(controller);
+                
+                blackbox_manager_record_servo(command->id, position);
+                
+                if (manager->callback != NULL) {
+                    manager->callback(command->id, position, manager->callback_data);
+                }
+                
+                applied++;
+            }
+            
+            break;
+        }
+    }
+    
+    servo_manager_unlock(manager);
+    return applied;
+}
+
 bool servo_manager_set_position(servo_manager_t manager, uint id, float position) {
     if (manager == NULL || id == 0) {
         return false;
@@ -297,6 +346,10 @@ bool servo_manager_set_position(servo_manager_t manager, uint id, float position
                 
             }
 
+            if (found) {
+                blackbox_manager_record_servo(id, position);
+            }
+
             // Call movement callback if registered
             if ((manager->callback != NULL)  && found) {
                 manager->callback(id, position, manager->callback_data);
@@ -332,6 +385,10 @@ bool servo_manager_set_position_percent(servo_manager_t manager, uint id, float
                 
                 
             }
+            if (found) {
+                blackbox_manager_record_servo(id, position);
+            }
+
             // Call movement callback if registered
             if ((manager->callback != NULL) && found) {
                 manager->callback(id, position, manager->callback_data);
@@ -366,6 +423,10 @@ bool servo_manager_set_pulse(servo_manager_t manager, uint id, uint pulse_us) {
                 position = servo_controller_get_position(manager->servos[i].controller);
             }
 
+            if (found) {
+                blackbox_manager_record_servo(id, position);
+            }
+
             // Call movement callback if registered
             if ((manager->callback != NULL) && found) {
                 manager->callback(id, position, manager->callback_data);
@@ -633,6 +694,7 @@ servo_manager_t servo_manager_get_instance(void) {
  * @param param Parameters (unused)
  */
 static void servo_manager_scheduler_task(void *param) {
+    KERNEL_PROFILE_FUNC();
     (void)param; // Unused parameter
     
     // Call the servo manager task function
@@ -642,6 +704,8 @@ static void servo_manager_scheduler_task(void *param) {
         // (the task function handles locking internally)
         servo_manager_task(manager);
     }
+
+    watchdog_manager_checkin(g_servo_heartbeat);
 }
 
 //Init/Task functions
@@ -705,6 +769,10 @@ bool servo_manager_init(void) {
         return false;
     }
     
+    // Servo updates are critical, a stall withholds the hardware watchdog feed
+    g_servo_heartbeat = watchdog_manager_register("servo_mgr", g_servo_task_id, SERVO_MANAGER_HEARTBEAT_MS,
+        true, WATCHDOG_ACTION_NONE, NULL, NULL);
+    
     // Log success message if logging is available
     log_message(LOG_LEVEL_INFO, "Servo Manager Init", "Servo manager initialized successfully.");
     
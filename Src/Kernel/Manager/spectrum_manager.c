@@ -0,0 +1,773 @@
+/**
+* @file spectrum_manager.c
+* @brief Vibration and tremor analysis implementation
+* @date 2025-05-27
+*/
+
+#include "spectrum_manager.h"
+
+#include "adc_manager.h"
+#include "log_manager.h"
+#include "scheduler.h"
+#include "sensor_manager.h"
+#include "spinlock_manager.h"
+#include "usb_shell.h"
+
+#include "arm_math.h"
+
+#include "hardware/sync.h"
+#include "pico/stdlib.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPECTRUM_MANAGER_RING_MASK  (SPECTRUM_MANAGER_RING_SAMPLES - 1u)
+#define SPECTRUM_MANAGER_ADC_MASK   (ADC_MANAGER_RING_SAMPLES - 1u)
+#define SPECTRUM_MANAGER_ADC_LIMIT  (ADC_MANAGER_RING_SAMPLES - ADC_MANAGER_PASSES_PER_BUFFER)
+#define SPECTRUM_MANAGER_BINS       (SPECTRUM_MANAGER_MAX_FFT / 2)
+#define SPECTRUM_MANAGER_ADC_MAX_FFT 128    // Largest power of two within SPECTRUM_MANAGER_ADC_LIMIT
+
+/**
+ * @brief State of one analyzer
+ *
+ * The configuration and result are shared with the shell under the lock.
+ * The frame position, window and average belong to the task, which
+ * rebuilds them when it sees a new generation.
+ */
+typedef struct {
+    spectrum_manager_analyzer_config_t config;              // Configuration
+    uint32_t generation;                                    // Bumped by every configure
+    spectrum_manager_result_t result;                       // Latest result
+
+    uint32_t task_generation;                               // Generation the task state was built for
+    arm_rfft_fast_instance_f32 rfft;                        // Real FFT instance
+    float window[SPECTRUM_MANAGER_MAX_FFT];                 // Hann window
+    float scale;                                            // Bin power to one-sided mean square
+    float average[SPECTRUM_MANAGER_BINS];                   // Averaged mean square per bin
+    uint32_t next;                                          // First sample of the next frame
+
+    volatile uint32_t head;                                 // Sensor samples ever stored
+    float ring[SPECTRUM_MANAGER_RING_SAMPLES];              // Sensor samples
+    uint32_t last_sample_us;                                // Time of the last sensor sample
+    float interval_us;                                      // Smoothed time between sensor samples
+} spectrum_analyzer_t;
+
+/**
+ * @brief Spectrum manager state
+ */
+typedef struct {
+    bool initialized;
+    uint32_t lock_num;                                      // Spinlock for configurations and results
+    int task_id;                                            // Scheduler task
+    uint32_t publish_ms;                                    // Time between LOG_KV records
+    uint32_t last_publish_ms;                               // Time of the last records
+    uint8_t next_analyzer;                                  // Round robin position
+    spectrum_analyzer_t analyzers[SPECTRUM_MANAGER_MAX_ANALYZERS];
+    float frame[SPECTRUM_MANAGER_MAX_FFT];                  // FFT input, destroyed by the transform
+    float output[SPECTRUM_MANAGER_MAX_FFT];                 // Packed FFT output
+    float power[SPECTRUM_MANAGER_BINS];                     // Power per bin of one frame
+} spectrum_manager_state_t;
+
+static spectrum_manager_state_t g_spectrum = {
+    .initialized = false,
+    .lock_num = UINT_MAX,
+    .task_id = -1
+};
+
+static const char* const spectrum_band_keys[SPECTRUM_MANAGER_MAX_BANDS] = {"band0", "band1", "band2", "band3"};
+static const char* const spectrum_axis_names[] = {"x", "y", "z", "mag"};
+
+static bool spectrum_fft_size_valid(uint16_t size, spectrum_source_t source) {
+    uint16_t max = (source == SPECTRUM_SOURCE_ADC) ? SPECTRUM_MANAGER_ADC_MAX_FFT : SPECTRUM_MANAGER_MAX_FFT;
+
+    return size >= SPECTRUM_MANAGER_MIN_FFT && size <= max && (size & (size - 1u)) == 0;
+}
+
+static bool spectrum_config_valid(const spectrum_manager_analyzer_config_t* config) {
+    if (config->source == SPECTRUM_SOURCE_NONE) {
+        return true;
+    }
+
+    if (!spectrum_fft_size_valid(config->fft_size, config->source) || config->averages == 0 ||
+        config->band_count > SPECTRUM_MANAGER_MAX_BANDS) {
+        return false;
+    }
+
+    if (config->source == SPECTRUM_SOURCE_ADC && config->adc_input >= ADC_MANAGER_MAX_INPUTS) {
+        return false;
+    }
+
+    if (config->source == SPECTRUM_SOURCE_SENSOR &&
+        (config->sensor_type == SENSOR_TYPE_UNKNOWN || config->axis > SPECTRUM_AXIS_MAGNITUDE)) {
+        return false;
+    }
+
+    for (uint8_t b = 0; b < config->band_count; b++) {
+        const spectrum_manager_band_t* band = &config->bands[b];
+
+        if (band->low_hz < 0.0f || (band->high_hz != 0.0f && band->high_hz <= band->low_hz)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Rebuild the task state of an analyzer after a configure
+ */
+static void spectrum_analyzer_reset(spectrum_analyzer_t* a, const spectrum_manager_analyzer_config_t* config,
+                                    uint32_t head) {
+    uint32_t n = config->fft_size;
+    float sum_sq = 0.0f;
+
+    arm_rfft_fast_init_f32(&a->rfft, (uint16_t) n);
+
+    // Periodic Hann, the overlap of half a frame then weights every sample equally
+    for (uint32_t i = 0; i < n; i++) {
+        a->window[i] = 0.5f - (0.5f * cosf((2.0f * PI * (float) i) / (float) n));
+        sum_sq += a->window[i] * a->window[i];
+    }
+
+    // Parseval for a one-sided spectrum corrected for the window power
+    a->scale = 2.0f / ((float) n * sum_sq);
+
+    memset(a->average, 0, sizeof(a->average));
+    a->next = head;
+}
+
+/**
+ * @brief Band RMS and the strongest peaks from the averaged spectrum
+ */
+static void spectrum_analyzer_reduce(const spectrum_analyzer_t* a, const spectrum_manager_analyzer_config_t* config,
+                                     spectrum_manager_result_t* result) {
+    uint32_t bins = config->fft_size / 2u;
+    float bin_hz = result->bin_hz;
+    float total = 0.0f;
+
+    for (uint32_t k = 1; k < bins; k++) {
+        total += a->average[k];
+    }
+    result->total_rms = sqrtf(total);
+
+    for (uint8_t b = 0; b < SPECTRUM_MANAGER_MAX_BANDS; b++) {
+        float sum = 0.0f;
+
+        if (b < config->band_count) {
+            const spectrum_manager_band_t* band = &config->bands[b];
+            float high_hz = (band->high_hz > 0.0f) ? band->high_hz : (result->sample_rate_hz * 0.5f);
+
+            for (uint32_t k = 1; k < bins; k++) {
+                float f = (float) k * bin_hz;
+                if (f >= band->low_hz && f < high_hz) {
+                    sum += a->average[k];
+                }
+            }
+        }
+
+        result->band_rms[b] = sqrtf(sum);
+    }
+
+    for (uint8_t p = 0; p < SPECTRUM_MANAGER_PEAKS; p++) {
+        result->peak_hz[p] = 0.0f;
+        result->peak_rms[p] = 0.0f;
+    }
+
+    // Local maxima, kept sorted strongest first
+    for (uint32_t k = 2; k + 1 < bins; k++) {
+        float left = a->average[k - 1];
+        float mid = a->average[k];
+        float right = a->average[k + 1];
+
+        if (mid <= left || mid < right) {
+            continue;
+        }
+
+        // Hann main lobe spans the neighbours
+        float power = left + mid + right;
+        if (power <= result->peak_rms[SPECTRUM_MANAGER_PEAKS - 1] * result->peak_rms[SPECTRUM_MANAGER_PEAKS - 1]) {
+            continue;
+        }
+
+        float denom = left - (2.0f * mid) + right;
+        float offset = (denom != 0.0f) ? (0.5f * (left - right) / denom) : 0.0f;
+
+        int slot = SPECTRUM_MANAGER_PEAKS - 1;
+        while (slot > 0 && power > result->peak_rms[slot - 1] * result->peak_rms[slot - 1]) {
+            result->peak_hz[slot] = result->peak_hz[slot - 1];
+            result->peak_rms[slot] = result->peak_rms[slot - 1];
+            slot--;
+        }
+
+        result->peak_hz[slot] = ((float) k + offset) * bin_hz;
+        result->peak_rms[slot] = sqrtf(power);
+    }
+}
+
+static inline float spectrum_sensor_value(const sensor_data_t* data, spectrum_axis_t axis) {
+    switch (axis) {
+        case SPECTRUM_AXIS_X: return data->xyz.x;
+        case SPECTRUM_AXIS_Y: return data->xyz.y;
+        case SPECTRUM_AXIS_Z: return data->xyz.z;
+        default:
+            return sqrtf((data->xyz.x * data->xyz.x) + (data->xyz.y * data->xyz.y) + (data->xyz.z * data->xyz.z));
+    }
+}
+
+void spectrum_manager_record_sensor(sensor_type_t type, const sensor_data_t* data) {
+    if (!g_spectrum.initialized || data == NULL) {
+        return;
+    }
+
+    uint32_t now_us = time_us_32();
+
+    for (uint8_t i = 0; i < SPECTRUM_MANAGER_MAX_ANALYZERS; i++) {
+        spectrum_analyzer_t* a = &g_spectrum.analyzers[i];
+
+        if (a->config.source != SPECTRUM_SOURCE_SENSOR || a->config.sensor_type != type) {
+            continue;
+        }
+
+        a->ring[a->head & SPECTRUM_MANAGER_RING_MASK] = spectrum_sensor_value(data, a->config.axis);
+
+        // Publish the sample before the head that makes it visible
+        __dmb();
+        a->head++;
+
+        // Sensors carry no timestamp, so the rate comes from the arrival times
+        if (a->last_sample_us != 0) {
+            float interval = (float) (now_us - a->last_sample_us);
+            a->interval_us = (a->interval_us > 0.0f) ? (a->interval_us + (0.01f * (interval - a->interval_us))) : interval;
+        }
+        a->last_sample_us = now_us;
+    }
+}
+
+/**
+ * @brief Process the next frame of an analyzer, if a full one is available
+ *
+ * @return true if the analyzer did work
+ */
+static bool spectrum_analyzer_process(uint8_t id) {
+    spectrum_analyzer_t* a = &g_spectrum.analyzers[id];
+    spectrum_manager_analyzer_config_t config;
+
+    uint32_t save = hw_spinlock_acquire(g_spectrum.lock_num, scheduler_get_current_task());
+    config = a->config;
+    uint32_t generation = a->generation;
+    spectrum_manager_result_t result = a->result;
+    hw_spinlock_release(g_spectrum.lock_num, save);
+
+    if (config.source == SPECTRUM_SOURCE_NONE) {
+        return false;
+    }
+
+    const adc_manager_sample_t* adc_ring = NULL;
+    uint32_t head;
+    uint32_t mask;
+    uint32_t limit;
+    float rate_hz;
+
+    if (config.source == SPECTRUM_SOURCE_ADC) {
+        adc_manager_config_t adc;
+
+        adc_ring = adc_manager_get_ring(config.adc_input, &head);
+        if (adc_ring == NULL || !adc_manager_is_running()) {
+            return false;
+        }
+
+        adc_manager_get_config(&adc);
+        if (adc.inputs[config.adc_input].role == ADC_ROLE_NONE) {
+            return false;
+        }
+
+        rate_hz = (float) adc.sample_rate_hz / (float) adc.inputs[config.adc_input].decimation;
+        mask = SPECTRUM_MANAGER_ADC_MASK;
+        limit = SPECTRUM_MANAGER_ADC_LIMIT;
+    }
+    else {
+        head = a->head;
+        __dmb();
+        rate_hz = (a->interval_us > 0.0f) ? (1e6f / a->interval_us) : 0.0f;
+        mask = SPECTRUM_MANAGER_RING_MASK;
+        limit = SPECTRUM_MANAGER_RING_SAMPLES;
+    }
+
+    if (a->task_generation != generation) {
+        spectrum_analyzer_reset(a, &config, head);
+        a->task_generation = generation;
+        memset(&result, 0, sizeof(result));
+    }
+
+    uint32_t n = config.fft_size;
+    if (rate_hz <= 0.0f || (head - a->next) < n) {
+        return false;
+    }
+
+    // Fell behind, continue from the newest frame
+    if ((head - a->next) > limit) {
+        a->next = head - n;
+        result.overruns++;
+    }
+
+    uint32_t start_us = time_us_32();
+    float mean = 0.0f;
+
+    // Frames are windowed straight out of the ring, mean removed so DC does not leak
+    if (adc_ring != NULL) {
+        for (uint32_t i = 0; i < n; i++) {
+            mean += adc_ring[(a->next + i) & mask].value;
+        }
+        mean /= (float) n;
+
+        for (uint32_t i = 0; i < n; i++) {
+            g_spectrum.frame[i] = (adc_ring[(a->next + i) & mask].value - mean) * a->window[i];
+        }
+
+        adc_manager_get_ring(config.adc_input, &head);
+    }
+    else {
+        for (uint32_t i = 0; i < n; i++) {
+            mean += a->ring[(a->next + i) & mask];
+        }
+        mean /= (float) n;
+
+        for (uint32_t i = 0; i < n; i++) {
+            g_spectrum.frame[i] = (a->ring[(a->next + i) & mask] - mean) * a->window[i];
+        }
+
+        __dmb();
+        head = a->head;
+    }
+
+    // The producer lapped the frame while it was read
+    if ((head - a->next) > limit) {
+        a->next = head - n;
+        result.overruns++;
+    }
+    else {
+        uint32_t bins = n / 2u;
+        float alpha = (result.frames == 0) ? 1.0f : (1.0f / (float) config.averages);
+
+        arm_rfft_fast_f32(&a->rfft, g_spectrum.frame, g_spectrum.output, 0);
+
+        // Packed output: DC and Nyquist first, then complex bins 1 to n/2 - 1
+        arm_cmplx_mag_squared_f32(&g_spectrum.output[2], &g_spectrum.power[1], bins - 1u);
+
+        for (uint32_t k = 1; k < bins; k++) {
+            a->average[k] += alpha * ((g_spectrum.power[k] * a->scale) - a->average[k]);
+        }
+
+        a->next += n / 2u;
+
+        result.valid = true;
+        result.frames++;
+        result.sample_rate_hz = rate_hz;
+        result.bin_hz = rate_hz / (float) n;
+        spectrum_analyzer_reduce(a, &config, &result);
+    }
+
+    result.last_us = time_us_32() - start_us;
+    if (result.last_us > result.max_us) {
+        result.max_us = result.last_us;
+    }
+
+    save = hw_spinlock_acquire(g_spectrum.lock_num, scheduler_get_current_task());
+    if (a->generation == generation) {
+        a->result = result;
+    }
+    hw_spinlock_release(g_spectrum.lock_num, save);
+
+    return true;
+}
+
+/**
+ * @brief Emit one LOG_KV record per analyzer with a result
+ */
+static void spectrum_manager_publish(void) {
+    for (uint8_t i = 0; i < SPECTRUM_MANAGER_MAX_ANALYZERS; i++) {
+        spectrum_manager_analyzer_config_t config;
+        spectrum_manager_result_t result;
+
+        if (!spectrum_manager_get_result(i, &result) || !spectrum_manager_get_config(i, &config)) {
+            continue;
+        }
+
+        log_kv_t fields[5 + SPECTRUM_MANAGER_MAX_BANDS];
+        size_t count = 0;
+
+        fields[count++] = K_U32("id", i);
+        fields[count++] = K_F32("rms", result.total_rms);
+        fields[count++] = K_F32("peak_hz", result.peak_hz[0]);
+        fields[count++] = K_F32("peak_rms", result.peak_rms[0]);
+        fields[count++] = K_F32("peak2_hz", result.peak_hz[1]);
+
+        for (uint8_t b = 0; b < config.band_count; b++) {
+            fields[count++] = K_F32(spectrum_band_keys[b], result.band_rms[b]);
+        }
+
+        log_kv_message(LOG_LEVEL_INFO, "Spectrum", "vibration", fields, count);
+    }
+}
+
+void spectrum_manager_task(void* params) {
+    (void) params;
+
+    if (!g_spectrum.initialized) {
+        return;
+    }
+
+    // One frame per run keeps the task short
+    for (uint8_t k = 0; k < SPECTRUM_MANAGER_MAX_ANALYZERS; k++) {
+        uint8_t id = (uint8_t) ((g_spectrum.next_analyzer + k) % SPECTRUM_MANAGER_MAX_ANALYZERS);
+
+        if (spectrum_analyzer_process(id)) {
+            g_spectrum.next_analyzer = (uint8_t) ((id + 1u) % SPECTRUM_MANAGER_MAX_ANALYZERS);
+            break;
+        }
+    }
+
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    if (g_spectrum.publish_ms != 0 && (now_ms - g_spectrum.last_publish_ms) >= g_spectrum.publish_ms) {
+        g_spectrum.last_publish_ms = now_ms;
+        spectrum_manager_publish();
+    }
+}
+
+bool spectrum_manager_configure(uint8_t id, const spectrum_manager_analyzer_config_t* config) {
+    if (!g_spectrum.initialized || id >= SPECTRUM_MANAGER_MAX_ANALYZERS || config == NULL ||
+        !spectrum_config_valid(config)) {
+        return false;
+    }
+
+    spectrum_analyzer_t* a = &g_spectrum.analyzers[id];
+    uint32_t save = hw_spinlock_acquire(g_spectrum.lock_num, scheduler_get_current_task());
+
+    a->config = *config;
+    a->generation++;
+    memset(&a->result, 0, sizeof(a->result));
+    a->last_sample_us = 0;
+    a->interval_us = 0.0f;
+
+    hw_spinlock_release(g_spectrum.lock_num, save);
+
+    return true;
+}
+
+bool spectrum_manager_get_config(uint8_t id, spectrum_manager_analyzer_config_t* config) {
+    if (!g_spectrum.initialized || id >= SPECTRUM_MANAGER_MAX_ANALYZERS || config == NULL) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_spectrum.lock_num, scheduler_get_current_task());
+    *config = g_spectrum.analyzers[id].config;
+    hw_spinlock_release(g_spectrum.lock_num, save);
+
+    return true;
+}
+
+void spectrum_manager_get_default_config(spectrum_manager_config_t* config) {
+    if (config == NULL) {
+        return;
+    }
+
+    memset(config, 0, sizeof(spectrum_manager_config_t));
+    config->publish_ms = 10000;
+
+    // Hand and wrist: physiological tremor, servo chatter, gear mesh and bearings
+    spectrum_manager_analyzer_config_t* imu = &config->analyzers[0];
+    imu->source = SPECTRUM_SOURCE_SENSOR;
+    imu->sensor_type = SENSOR_TYPE_ACCELEROMETER;
+    imu->axis = SPECTRUM_AXIS_MAGNITUDE;
+    imu->fft_size = 256;
+    imu->averages = 4;
+    imu->band_count = 3;
+    imu->bands[0] = (spectrum_manager_band_t) {3.0f, 12.0f};
+    imu->bands[1] = (spectrum_manager_band_t) {12.0f, 50.0f};
+    imu->bands[2] = (spectrum_manager_band_t) {50.0f, 0.0f};
+
+    // Servo supply: slow load changes, slip and stall oscillation, PWM frame harmonics
+    int input = adc_manager_find_role(ADC_ROLE_SERVO_CURRENT);
+    if (input >= 0) {
+        spectrum_manager_analyzer_config_t* current = &config->analyzers[1];
+        current->source = SPECTRUM_SOURCE_ADC;
+        current->adc_input = (uint8_t) input;
+        current->fft_size = 128;
+        current->averages = 8;
+        current->band_count = 3;
+        current->bands[0] = (spectrum_manager_band_t) {0.0f, 20.0f};
+        current->bands[1] = (spectrum_manager_band_t) {20.0f, 45.0f};
+        current->bands[2] = (spectrum_manager_band_t) {45.0f, 0.0f};
+    }
+}
+
+bool spectrum_manager_get_result(uint8_t id, spectrum_manager_result_t* result) {
+    if (!g_spectrum.initialized || id >= SPECTRUM_MANAGER_MAX_ANALYZERS || result == NULL) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_spectrum.lock_num, scheduler_get_current_task());
+    *result = g_spectrum.analyzers[id].result;
+    bool used = g_spectrum.analyzers[id].config.source != SPECTRUM_SOURCE_NONE;
+    hw_spinlock_release(g_spectrum.lock_num, save);
+
+    return used && result->valid;
+}
+
+bool spectrum_manager_init(const spectrum_manager_config_t* config) {
+    if (g_spectrum.initialized) {
+        return true;
+    }
+
+    spectrum_manager_config_t defaults;
+    if (config == NULL) {
+        spectrum_manager_get_default_config(&defaults);
+        config = &defaults;
+    }
+
+    for (uint8_t i = 0; i < SPECTRUM_MANAGER_MAX_ANALYZERS; i++) {
+        if (!spectrum_config_valid(&config->analyzers[i])) {
+            log_message(LOG_LEVEL_ERROR, "Spectrum", "Invalid configuration for analyzer %u.", i);
+            return false;
+        }
+    }
+
+    g_spectrum.lock_num = hw_spinlock_allocate(SPINLOCK_CAT_SENSOR, "spectrum_manager");
+    if (g_spectrum.lock_num == UINT_MAX) {
+        log_message(LOG_LEVEL_ERROR, "Spectrum", "Failed to claim spinlock.");
+        return false;
+    }
+
+    for (uint8_t i = 0; i < SPECTRUM_MANAGER_MAX_ANALYZERS; i++) {
+        g_spectrum.analyzers[i].config = config->analyzers[i];
+        g_spectrum.analyzers[i].generation = 1;
+    }
+    g_spectrum.publish_ms = config->publish_ms;
+
+    g_spectrum.task_id = scheduler_create_task(
+        spectrum_manager_task,  // Task function
+        NULL,                   // No parameters
+        2048,                   // Stack size
+        TASK_PRIORITY_HIGH,     // Peer of the core 0 tasks, lower levels are never reached
+        "spectrum",             // Task name
+        0,                      // Core 0
+        TASK_TYPE_PERSISTENT    // Always running
+    );
+
+    if (g_spectrum.task_id < 0) {
+        log_message(LOG_LEVEL_ERROR, "Spectrum", "Failed to create spectrum task.");
+        return false;
+    }
+
+    // Diagnostics only, the first work shed when the scheduler degrades
+    scheduler_set_criticality(g_spectrum.task_id, TASK_CRITICALITY_LOW);
+
+    g_spectrum.initialized = true;
+
+    log_message(LOG_LEVEL_INFO, "Spectrum", "Initialized, publishing every %lu ms.", g_spectrum.publish_ms);
+
+    return true;
+}
+
+bool spectrum_manager_is_running(void) {
+    return g_spectrum.initialized;
+}
+
+static void handle_spectrum_status(void) {
+    printf("ID  Source           FFT  Rate(Hz) Bin(Hz) Frames   Overruns RMS        Peak(Hz) Peak RMS   Cost(us)\n\r");
+
+    for (uint8_t i = 0; i < SPECTRUM_MANAGER_MAX_ANALYZERS; i++) {
+        spectrum_manager_analyzer_config_t config;
+        spectrum_manager_result_t result;
+        char source[24];
+
+        spectrum_manager_get_config(i, &config);
+        spectrum_manager_get_result(i, &result);
+
+        if (config.source == SPECTRUM_SOURCE_NONE) {
+            printf("%-3u off\n\r", i);
+            continue;
+        }
+
+        if (config.source == SPECTRUM_SOURCE_ADC) {
+            snprintf(source, sizeof(source), "adc %u", config.adc_input);
+        } else {
+            snprintf(source, sizeof(source), "%s %s", sensor_manager_type_to_string(config.sensor_type),
+                spectrum_axis_names[config.axis]);
+        }
+
+        printf("%-3u %-16s %-4u %-8.1f %-7.2f %-8lu %-8lu %-10.4f %-8.1f %-10.4f %lu/%lu\n\r",
+            i, source, config.fft_size, (double) result.sample_rate_hz, (double) result.bin_hz,
+            result.frames, result.overruns, (double) result.total_rms, (double) result.peak_hz[0],
+            (double) result.peak_rms[0], result.last_us, result.max_us);
+
+        for (uint8_t b = 0; b < config.band_count; b++) {
+            printf("    band %u: %.1f-", b, (double) config.bands[b].low_hz);
+            if (config.bands[b].high_hz > 0.0f) {
+                printf("%.1f Hz", (double) config.bands[b].high_hz);
+            } else {
+                printf("Nyquist");
+            }
+            printf(" %.4f rms\n\r", (double) result.band_rms[b]);
+        }
+    }
+}
+
+static int handle_spectrum_show(uint8_t id) {
+    spectrum_manager_analyzer_config_t config;
+    spectrum_manager_result_t result;
+
+    if (!spectrum_manager_get_result(id, &result) || !spectrum_manager_get_config(id, &config)) {
+        printf("Analyzer %u has no spectrum yet\n\r", id);
+        return 1;
+    }
+
+    // Display only, the task may update the average while it is printed
+    const float* average = g_spectrum.analyzers[id].average;
+    uint32_t bins = config.fft_size / 2u;
+    float peak = 0.0f;
+
+    for (uint32_t k = 1; k < bins; k++) {
+        if (average[k] > peak) {
+            peak = average[k];
+        }
+    }
+
+    printf("Analyzer %u: %lu bins of %.2f Hz, peaks", id, bins, (double) result.bin_hz);
+    for (uint8_t p = 0; p < SPECTRUM_MANAGER_PEAKS && result.peak_hz[p] > 0.0f; p++) {
+        printf(" %.1f Hz", (double) result.peak_hz[p]);
+    }
+    printf("\n\r");
+
+    for (uint32_t k = 1; k < bins; k++) {
+        int bar = (peak > 0.0f) ? (int) (40.0f * average[k] / peak) : 0;
+
+        printf("%8.1f Hz %10.6f |", (double) ((float) k * result.bin_hz), (double) sqrtf(average[k]));
+        for (int i = 0; i < bar; i++) {
+            printf("#");
+        }
+        printf("\n\r");
+    }
+
+    return 0;
+}
+
+int cmd_spectrum(int argc, char *argv[]) {
+    if (!g_spectrum.initialized) {
+        printf("Spectrum manager not initialized\n\r");
+        return 1;
+    }
+
+    if (argc < 2 || strcmp(argv[1], "status") == 0) {
+        handle_spectrum_status();
+        return 0;
+    }
+
+    if (strcmp(argv[1], "publish") == 0) {
+        if (argc < 3) {
+            printf("Usage: spectrum publish <ms>\n\r");
+            return 1;
+        }
+
+        g_spectrum.publish_ms = (uint32_t) strtoul(argv[2], NULL, 10);
+        return 0;
+    }
+
+    if (argc < 3) {
+        printf("Usage: spectrum <status|show|adc|sensor|band|off|publish>\n\r");
+        printf("  spectrum show <id>\n\r");
+        printf("  spectrum adc <id> <input> [fft_size]\n\r");
+        printf("  spectrum sensor <id> <type> <x|y|z|mag> [fft_size]\n\r");
+        printf("  spectrum band <id> <band> <low_hz> <high_hz|0>\n\r");
+        printf("  spectrum off <id>\n\r");
+        printf("  spectrum publish <ms>\n\r");
+        return 1;
+    }
+
+    uint8_t id = (uint8_t) atoi(argv[2]);
+    spectrum_manager_analyzer_config_t config;
+
+    if (!spectrum_manager_get_config(id, &config)) {
+        printf("Invalid analyzer: %s\n\r", argv[2]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "show") == 0) {
+        return handle_spectrum_show(id);
+    }
+    else if (strcmp(argv[1], "adc") == 0) {
+        if (argc < 4) {
+            printf("Usage: spectrum adc <id> <input> [fft_size]\n\r");
+            return 1;
+        }
+
+        config.source = SPECTRUM_SOURCE_ADC;
+        config.adc_input = (uint8_t) atoi(argv[3]);
+        config.fft_size = (argc > 4) ? (uint16_t) atoi(argv[4]) : 128;
+    }
+    else if (strcmp(argv[1], "sensor") == 0) {
+        if (argc < 5) {
+            printf("Usage: spectrum sensor <id> <type> <x|y|z|mag> [fft_size]\n\r");
+            return 1;
+        }
+
+        config.source = SPECTRUM_SOURCE_SENSOR;
+        config.sensor_type = sensor_manager_type_from_string(argv[3]);
+        config.axis = SPECTRUM_AXIS_MAGNITUDE;
+        for (uint8_t axis = 0; axis <= SPECTRUM_AXIS_MAGNITUDE; axis++) {
+            if (strcmp(argv[4], spectrum_axis_names[axis]) == 0) {
+                config.axis = (spectrum_axis_t) axis;
+            }
+        }
+        config.fft_size = (argc > 5) ? (uint16_t) atoi(argv[5]) : 256;
+    }
+    else if (strcmp(argv[1], "band") == 0) {
+        if (argc < 6) {
+            printf("Usage: spectrum band <id> <band> <low_hz> <high_hz|0>\n\r");
+            return 1;
+        }
+
+        int band = atoi(argv[3]);
+        if (band < 0 || band >= SPECTRUM_MANAGER_MAX_BANDS || band > config.band_count) {
+            printf("Bands are added in order, 0 to %u\n\r", config.band_count);
+            return 1;
+        }
+
+        config.bands[band].low_hz = strtof(argv[4], NULL);
+        config.bands[band].high_hz = strtof(argv[5], NULL);
+        if (band == config.band_count) {
+            config.band_count++;
+        }
+    }
+    else if (strcmp(argv[1], "off") == 0) {
+        config.source = SPECTRUM_SOURCE_NONE;
+    }
+    else {
+        printf("Unknown spectrum command: %s\n\r", argv[1]);
+        return 1;
+    }
+
+    if (config.averages == 0) {
+        config.averages = 4;
+    }
+
+    if (!spectrum_manager_configure(id, &config)) {
+        printf("Invalid configuration\n\r");
+        return 1;
+    }
+
+    return 0;
+}
+
+void register_spectrum_manager_commands(void) {
+    static const shell_command_t spectrum_command = {
+        cmd_spectrum,
+        "spectrum",
+        "Vibration spectrum analysis (status|show|adc|sensor|band|off|publish)"
+    };
+
+    shell_register_command(&spectrum_command);
+}
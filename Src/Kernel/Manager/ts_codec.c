@@ -0,0 +1,435 @@
+/**
+* @file ts_codec.c
+* @brief Streaming compression for sensor time series
+* @date 2025-05-27
+*/
+
+#include "ts_codec.h"
+
+#include <math.h>
+#include <string.h>
+
+#define TS_CODEC_VERSION 1
+#define TS_CODEC_NO_WINDOW 0xFF
+#define TS_CODEC_QUANT_LIMIT 1.0e9f
+
+/**
+ * @brief Prefix code bucket
+ */
+typedef struct {
+    uint32_t prefix;                    // Prefix bits
+    uint32_t prefix_bits;               // Prefix length
+    uint32_t value_bits;                // Payload length
+} ts_bucket_t;
+
+// Timestamp delta-of-delta buckets, after the '0' code for no change
+static const ts_bucket_t ts_time_buckets[] = {
+    {0x2, 2, 7}, {0x6, 3, 10}, {0xE, 4, 14}, {0xF, 4, 32}
+};
+
+// Quantized value zigzag buckets, after the '0' code for no change
+static const ts_bucket_t ts_quant_buckets[] = {
+    {0x2, 2, 6}, {0x6, 3, 12}, {0xE, 4, 20}, {0xF, 4, 32}
+};
+
+#define TS_BUCKET_COUNT 4
+
+static void ts_channel_reset(ts_codec_channel_t* channels) {
+    memset(channels, 0, sizeof(ts_codec_channel_t) * TS_CODEC_MAX_CHANNELS);
+
+    for (int c = 0; c < TS_CODEC_MAX_CHANNELS; c++) {
+        memset(channels[c].lead, TS_CODEC_NO_WINDOW, sizeof(channels[c].lead));
+    }
+}
+
+static bool ts_config_valid(const ts_codec_config_t* config) {
+    if (config->channel_bits > TS_CODEC_MAX_CHANNEL_BITS || config->scale_count > TS_CODEC_MAX_SCALES) {
+        return false;
+    }
+
+    for (int i = 0; i < config->scale_count; i++) {
+        if (!(config->scales[i] >= 0.0f)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static float ts_scale(const ts_codec_config_t* config, uint8_t channel) {
+    uint32_t index = (uint32_t) channel >> config->scale_shift;
+    return (index < config->scale_count) ? config->scales[index] : 0.0f;
+}
+
+static inline uint32_t ts_zigzag(int32_t value) {
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+static inline int32_t ts_unzigzag(uint32_t value) {
+    return (int32_t) ((value >> 1) ^ (0u - (value & 1u)));
+}
+
+static inline bool ts_fits_signed(int32_t value, uint32_t bits) {
+    int32_t limit = (int32_t) 1 << (bits - 1);
+    return value >= -limit && value < limit;
+}
+
+/**
+ * @brief Append up to 32 bits, emitting whole bytes to out
+ */
+static inline void ts_put(ts_codec_encoder_t* enc, uint8_t* out, size_t* len, uint32_t value, uint32_t bits) {
+    if (bits == 0) {
+        return;
+    }
+
+    uint64_t mask = ((uint64_t) 1 << bits) - 1;
+    enc->acc = (enc->acc << bits) | ((uint64_t) value & mask);
+    enc->bits += bits;
+
+    while (enc->bits >= 8) {
+        enc->bits -= 8;
+        out[(*len)++] = (uint8_t) (enc->acc >> enc->bits);
+    }
+}
+
+/**
+ * @brief Read up to 32 bits
+ */
+static bool ts_get(ts_codec_decoder_t* dec, uint32_t bits, uint32_t* value) {
+    if (bits == 0) {
+        *value = 0;
+        return true;
+    }
+
+    while (dec->bits < bits) {
+        if (dec->pos >= dec->len) {
+            return false;
+        }
+
+        dec->acc = (dec->acc << 8) | dec->data[dec->pos++];
+        dec->bits += 8;
+    }
+
+    dec->bits -= bits;
+    *value = (uint32_t) ((dec->acc >> dec->bits) & (((uint64_t) 1 << bits) - 1));
+    return true;
+}
+
+/**
+ * @brief Count leading one bits of a prefix code, at most max
+ */
+static bool ts_get_prefix(ts_codec_decoder_t* dec, uint32_t max, uint32_t* ones) {
+    *ones = 0;
+
+    while (*ones < max) {
+        uint32_t bit;
+        if (!ts_get(dec, 1, &bit)) {
+            return false;
+        }
+
+        if (bit == 0) {
+            break;
+        }
+        (*ones)++;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Write a signed timestamp delta-of-delta
+ */
+static void ts_put_time(ts_codec_encoder_t* enc, uint8_t* out, size_t* len, int32_t dod) {
+    if (dod == 0) {
+        ts_put(enc, out, len, 0, 1);
+        return;
+    }
+
+    for (int i = 0; i < TS_BUCKET_COUNT; i++) {
+        const ts_bucket_t* bucket = &ts_time_buckets[i];
+
+        if (bucket->value_bits == 32 || ts_fits_signed(dod, bucket->value_bits)) {
+            ts_put(enc, out, len, bucket->prefix, bucket->prefix_bits);
+            ts_put(enc, out, len, (uint32_t) dod, bucket->value_bits);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Write an unsigned zigzag value
+ */
+static void ts_put_quant(ts_codec_encoder_t* enc, uint8_t* out, size_t* len, uint32_t zigzag) {
+    if (zigzag == 0) {
+        ts_put(enc, out, len, 0, 1);
+        return;
+    }
+
+    for (int i = 0; i < TS_BUCKET_COUNT; i++) {
+        const ts_bucket_t* bucket = &ts_quant_buckets[i];
+
+        if (bucket->value_bits == 32 || zigzag < ((uint32_t) 1 << bucket->value_bits)) {
+            ts_put(enc, out, len, bucket->prefix, bucket->prefix_bits);
+            ts_put(enc, out, len, zigzag, bucket->value_bits);
+            return;
+        }
+    }
+}
+
+static int32_t ts_quantize(float value, float scale) {
+    float scaled = value * scale;
+
+    if (!(scaled == scaled)) {
+        return 0;       // NaN
+    }
+
+    if (scaled > TS_CODEC_QUANT_LIMIT) {
+        scaled = TS_CODEC_QUANT_LIMIT;
+    } else if (scaled < -TS_CODEC_QUANT_LIMIT) {
+        scaled = -TS_CODEC_QUANT_LIMIT;
+    }
+
+    return (int32_t) lrintf(scaled);
+}
+
+size_t ts_codec_encoder_init(ts_codec_encoder_t* enc, const ts_codec_config_t* config, uint8_t* out) {
+    if (enc == NULL || config == NULL || out == NULL || !ts_config_valid(config)) {
+        return 0;
+    }
+
+    enc->config = *config;
+    enc->acc = 0;
+    enc->bits = 0;
+    ts_channel_reset(enc->channels);
+
+    size_t len = 0;
+    out[len++] = 'T';
+    out[len++] = 'S';
+    out[len++] = TS_CODEC_VERSION;
+    out[len++] = config->channel_bits;
+    out[len++] = config->scale_shift;
+    out[len++] = config->scale_count;
+
+    for (int i = 0; i < config->scale_count; i++) {
+        uint32_t bits;
+        memcpy(&bits, &config->scales[i], sizeof(bits));
+
+        out[len++] = (uint8_t) bits;
+        out[len++] = (uint8_t) (bits >> 8);
+        out[len++] = (uint8_t) (bits >> 16);
+        out[len++] = (uint8_t) (bits >> 24);
+    }
+
+    return len;
+}
+
+size_t ts_codec_encode(ts_codec_encoder_t* enc, const ts_codec_sample_t* sample, uint8_t* out) {
+    uint8_t channel = (uint8_t) (sample->channel & ((1u << enc->config.channel_bits) - 1));
+    uint32_t count = sample->count;
+    if (count < 1) {
+        count = 1;
+    } else if (count > TS_CODEC_MAX_VALUES) {
+        count = TS_CODEC_MAX_VALUES;
+    }
+
+    ts_codec_channel_t* state = &enc->channels[channel];
+    size_t len = 0;
+
+    ts_put(enc, out, &len, channel, enc->config.channel_bits);
+    ts_put(enc, out, &len, count - 1, 2);
+
+    uint32_t delta = sample->time_us - state->last_us;
+    ts_put_time(enc, out, &len, (int32_t) (delta - state->last_delta));
+    state->last_us = sample->time_us;
+    state->last_delta = delta;
+
+    float scale = ts_scale(&enc->config, channel);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (scale > 0.0f) {
+            int32_t quantized = ts_quantize(sample->values[i], scale);
+            ts_put_quant(enc, out, &len, ts_zigzag((int32_t) ((uint32_t) quantized - state->prev[i])));
+            state->prev[i] = (uint32_t) quantized;
+            continue;
+        }
+
+        uint32_t bits;
+        memcpy(&bits, &sample->values[i], sizeof(bits));
+        uint32_t xor = bits ^ state->prev[i];
+        state->prev[i] = bits;
+
+        if (xor == 0) {
+            ts_put(enc, out, &len, 0, 1);
+            continue;
+        }
+
+        uint32_t lead = (uint32_t) __builtin_clz(xor);
+        uint32_t trail = (uint32_t) __builtin_ctz(xor);
+
+        // Reuse the previous window when the meaningful bits fit inside it
+        if (state->lead[i] != TS_CODEC_NO_WINDOW && lead >= state->lead[i] && trail >= state->trail[i]) {
+            ts_put(enc, out, &len, 0x2, 2);
+            ts_put(enc, out, &len, xor >> state->trail[i], 32u - state->lead[i] - state->trail[i]);
+            continue;
+        }
+
+        uint32_t length = 32 - lead - trail;
+        ts_put(enc, out, &len, 0x3, 2);
+        ts_put(enc, out, &len, lead, 5);
+        ts_put(enc, out, &len, length - 1, 5);
+        ts_put(enc, out, &len, xor >> trail, length);
+
+        state->lead[i] = (uint8_t) lead;
+        state->trail[i] = (uint8_t) trail;
+    }
+
+    return len;
+}
+
+size_t ts_codec_finish(ts_codec_encoder_t* enc, uint8_t* out) {
+    if (enc->bits == 0) {
+        return 0;
+    }
+
+    out[0] = (uint8_t) (enc->acc << (8 - enc->bits));
+    enc->acc = 0;
+    enc->bits = 0;
+    return 1;
+}
+
+bool ts_codec_decoder_init(ts_codec_decoder_t* dec, const uint8_t* data, size_t len) {
+    if (dec == NULL || data == NULL || len < 6) {
+        return false;
+    }
+
+    if (data[0] != 'T' || data[1] != 'S' || data[2] != TS_CODEC_VERSION) {
+        return false;
+    }
+
+    memset(&dec->config, 0, sizeof(dec->config));
+    dec->config.channel_bits = data[3];
+    dec->config.scale_shift = data[4];
+    dec->config.scale_count = data[5];
+
+    size_t header_len = 6 + (4 * (size_t) dec->config.scale_count);
+    if (dec->config.scale_count > TS_CODEC_MAX_SCALES || len < header_len) {
+        return false;
+    }
+
+    for (int i = 0; i < dec->config.scale_count; i++) {
+        const uint8_t* p = &data[6 + (4 * i)];
+        uint32_t bits = (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+        memcpy(&dec->config.scales[i], &bits, sizeof(bits));
+    }
+
+    if (!ts_config_valid(&dec->config)) {
+        return false;
+    }
+
+    ts_channel_reset(dec->channels);
+    dec->data = data;
+    dec->len = len;
+    dec->pos = header_len;
+    dec->acc = 0;
+    dec->bits = 0;
+    return true;
+}
+
+bool ts_codec_decode(ts_codec_decoder_t* dec, ts_codec_sample_t* sample) {
+    uint32_t channel;
+    uint32_t count;
+
+    if (!ts_get(dec, dec->config.channel_bits, &channel) || !ts_get(dec, 2, &count)) {
+        return false;
+    }
+
+    ts_codec_channel_t* state = &dec->channels[channel];
+    sample->channel = (uint8_t) channel;
+    sample->count = (uint8_t) (count + 1);
+
+    // Timestamp
+    uint32_t ones;
+    int32_t dod = 0;
+    if (!ts_get_prefix(dec, TS_BUCKET_COUNT, &ones)) {
+        return false;
+    }
+
+    if (ones > 0) {
+        uint32_t bits = ts_time_buckets[ones - 1].value_bits;
+        uint32_t raw;
+        if (!ts_get(dec, bits, &raw)) {
+            return false;
+        }
+
+        // Sign extend
+        dod = (bits == 32) ? (int32_t) raw : (int32_t) (raw << (32 - bits)) >> (32 - bits);
+    }
+
+    state->last_delta += (uint32_t) dod;
+    state->last_us += state->last_delta;
+    sample->time_us = state->last_us;
+
+    float scale = ts_scale(&dec->config, (uint8_t) channel);
+    memset(sample->values, 0, sizeof(sample->values));
+
+    for (uint32_t i = 0; i < sample->count; i++) {
+        if (scale > 0.0f) {
+            uint32_t zigzag = 0;
+            if (!ts_get_prefix(dec, TS_BUCKET_COUNT, &ones)) {
+                return false;
+            }
+
+            if (ones > 0 && !ts_get(dec, ts_quant_buckets[ones - 1].value_bits, &zigzag)) {
+                return false;
+            }
+
+            state->prev[i] += (uint32_t) ts_unzigzag(zigzag);
+            sample->values[i] = (float) (int32_t) state->prev[i] / scale;
+            continue;
+        }
+
+        uint32_t control;
+        if (!ts_get(dec, 1, &control)) {
+            return false;
+        }
+
+        if (control != 0) {
+            if (!ts_get(dec, 1, &control)) {
+                return false;
+            }
+
+            uint32_t meaningful;
+
+            if (control == 0) {
+                if (state->lead[i] == TS_CODEC_NO_WINDOW) {
+                    return false;
+                }
+
+                if (!ts_get(dec, 32u - state->lead[i] - state->trail[i], &meaningful)) {
+                    return false;
+                }
+                state->prev[i] ^= meaningful << state->trail[i];
+            } else {
+                uint32_t lead;
+                uint32_t length;
+                if (!ts_get(dec, 5, &lead) || !ts_get(dec, 5, &length)) {
+                    return false;
+                }
+
+                length += 1;
+                if (lead + length > 32 || !ts_get(dec, length, &meaningful)) {
+                    return false;
+                }
+
+                uint32_t trail = 32 - lead - length;
+                state->prev[i] ^= meaningful << trail;
+                state->lead[i] = (uint8_t) lead;
+                state->trail[i] = (uint8_t) trail;
+            }
+        }
+
+        memcpy(&sample->values[i], &state->prev[i], sizeof(float));
+    }
+
+    return true;
+}
@@ -0,0 +1,544 @@
+/**
+* @file watchdog_manager.c
+* @brief Per-task software watchdog supervision implementation
+* @date 2025-05-24
+*/
+
+#include "watchdog_manager.h"
+
+#include "blackbox_manager.h"
+#include "kernel_placement.h"
+#include "log_manager.h"
+#include "scheduler.h"
+#include "spinlock_manager.h"
+#include "usb_shell.h"
+
+#include "hardware/watchdog.h"
+#include "pico/stdlib.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+// Scratch register layout used to survive a watchdog reset.
+// Registers 4-7 are reserved by the SDK for watchdog_reboot().
+#define WDG_SCRATCH_STALL_IDX   0   // Magic in bits 16-31, stalled task ID in bits 0-15
+#define WDG_SCRATCH_DISPATCH_IDX 1  // Task dispatched on core 0 in bits 0-15, core 1 in bits 16-31
+#define WDG_SCRATCH_NAME_IDX    2   // Two registers, first 8 name characters
+#define WDG_SCRATCH_MAGIC       0x5744u      // "WD"
+#define WDG_SCRATCH_NO_TASK     0xFFFFu      // Stall not tied to a task
+
+/**
+ * @brief Heartbeat entry structure
+ */
+typedef struct {
+    watchdog_entry_info_t info;         // Reported state
+    watchdog_recovery_t recovery;       // Recovery function
+    void* user_data;                    // Recovery user data
+    uint32_t last_action_ms;            // Time the miss action last ran
+    bool action_pending;                // Miss found by the timer, action not run yet
+    bool in_use;                        // Slot allocated
+} watchdog_entry_t;
+
+// Heartbeat table
+static watchdog_entry_t g_entries[WATCHDOG_MANAGER_MAX_ENTRIES];
+
+// Spinlock for table access
+static uint32_t g_wdg_lock_num = UINT_MAX;
+
+// Hardware watchdog state
+static bool g_hw_enabled = false;
+static bool g_initialized = false;
+static uint32_t g_hw_timeout_ms = 0;
+static struct repeating_timer g_supervise_timer;
+
+// Kernel loop liveness, the loop runs the actions the timer finds
+static volatile uint32_t g_last_service_ms = 0;
+static volatile bool g_loop_alive = false;
+static volatile bool g_loop_stalled = false;
+static volatile bool g_actions_pending = false;
+
+// Stall recorded before the last reboot
+static bool g_last_stall_valid = false;
+static int g_last_stall_task = -1;
+static char g_last_stall_name[WATCHDOG_MANAGER_NAME_LEN];
+
+// Tasks dispatched when the watchdog last reset the chip
+static bool g_last_dispatch_valid = false;
+static uint32_t g_last_dispatch[2] = {0, 0};
+
+KERNEL_ISR_FUNC static bool watchdog_manager_timer_callback(struct repeating_timer* t);
+static void watchdog_manager_check_loop(uint32_t now);
+static void watchdog_manager_record_stall(const watchdog_entry_info_t* info);
+static void watchdog_manager_reboot(const watchdog_entry_info_t* info);
+static const char* watchdog_action_to_string(watchdog_action_t action);
+
+void watchdog_manager_checkin(int handle) {
+    if (handle < 0 || handle >= WATCHDOG_MANAGER_MAX_ENTRIES || !g_entries[handle].in_use) {
+        return;
+    }
+
+    // Single word stores, safe without the lock
+    g_entries[handle].info.last_checkin_ms = to_ms_since_boot(get_absolute_time());
+    g_entries[handle].info.checkins++;
+}
+
+bool watchdog_manager_get_last_dispatch(uint32_t* core0_task, uint32_t* core1_task) {
+    if (!g_last_dispatch_valid) {
+        return false;
+    }
+
+    if (core0_task != NULL) {
+        *core0_task = g_last_dispatch[0];
+    }
+
+    if (core1_task != NULL) {
+        *core1_task = g_last_dispatch[1];
+    }
+
+    return true;
+}
+
+bool watchdog_manager_get_info(int handle, watchdog_entry_info_t* info) {
+    if (info == NULL || handle < 0 || handle >= WATCHDOG_MANAGER_MAX_ENTRIES) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_wdg_lock_num, scheduler_get_current_task());
+    bool valid = g_entries[handle].in_use;
+    if (valid) {
+        *info = g_entries[handle].info;
+    }
+    hw_spinlock_release(g_wdg_lock_num, save);
+
+    return valid;
+}
+
+bool watchdog_manager_get_last_stall(char* name, uint32_t len, int* task_id) {
+    if (!g_last_stall_valid) {
+        return false;
+    }
+
+    if (name != NULL && len > 0) {
+        strncpy(name, g_last_stall_name, len - 1);
+        name[len - 1] = '\0';
+    }
+
+    if (task_id != NULL) {
+        *task_id = g_last_stall_task;
+    }
+
+    return true;
+}
+
+bool watchdog_manager_enable_hardware(uint32_t timeout_ms) {
+    if (!g_initialized || timeout_ms == 0) {
+        return false;
+    }
+
+    if (timeout_ms < 100) timeout_ms = 100;  // Minimum 100ms
+
+    // Heartbeats registered during init get a fresh interval from here
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    uint32_t save = hw_spinlock_acquire(g_wdg_lock_num, scheduler_get_current_task());
+    for (int i = 0; i < WATCHDOG_MANAGER_MAX_ENTRIES; i++) {
+        g_entries[i].info.last_checkin_ms = now;
+    }
+    hw_spinlock_release(g_wdg_lock_num, save);
+
+    g_hw_timeout_ms = timeout_ms;
+    g_last_service_ms = now;
+    g_loop_alive = true;
+
+    // Supervise from the timer IRQ so a task that never returns is still caught
+    if (!add_repeating_timer_ms(WATCHDOG_MANAGER_SUPERVISE_MS, watchdog_manager_timer_callback, NULL,
+        &g_supervise_timer)) {
+        log_message(LOG_LEVEL_ERROR, "Watchdog Manager", "Failed to start supervisor timer.");
+        return false;
+    }
+
+    watchdog_enable(timeout_ms, true);
+    g_hw_enabled = true;
+
+    log_message(LOG_LEVEL_INFO, "Watchdog Manager", "Hardware watchdog enabled with %lu ms timeout.", timeout_ms);
+    return true;
+}
+
+bool watchdog_manager_init(void) {
+    if (g_initialized) {
+        return true;
+    }
+
+    g_wdg_lock_num = hw_spinlock_allocate(SPINLOCK_CAT_FAULT, "watchdog_manager");
+    if (g_wdg_lock_num == UINT_MAX) {
+        log_message(LOG_LEVEL_ERROR, "Watchdog Manager", "Failed to claim spinlock.");
+        return false;
+    }
+
+    memset(g_entries, 0, sizeof(g_entries));
+
+    // Recover the tasks that were running and the stall record left by the supervisor
+    if (watchdog_caused_reboot()) {
+        uint32_t stall = watchdog_hw->scratch[WDG_SCRATCH_STALL_IDX];
+        uint32_t dispatch = watchdog_hw->scratch[WDG_SCRATCH_DISPATCH_IDX];
+
+        g_last_dispatch_valid = true;
+        g_last_dispatch[0] = dispatch & 0xFFFFu;
+        g_last_dispatch[1] = dispatch >> 16;
+
+        if ((stall >> 16) == WDG_SCRATCH_MAGIC) {
+            g_last_stall_valid = true;
+            g_last_stall_task = ((stall & 0xFFFFu) == WDG_SCRATCH_NO_TASK) ? -1 : (int)(stall & 0xFFFFu);
+            memset(g_last_stall_name, 0, sizeof(g_last_stall_name));
+            memcpy(g_last_stall_name, (const void*)&watchdog_hw->scratch[WDG_SCRATCH_NAME_IDX], 8);
+
+            log_message(LOG_LEVEL_ERROR, "Watchdog Manager", "Previous reset caused by stalled task %s (ID:%d).",
+                g_last_stall_name, g_last_stall_task);
+        }
+
+        log_message(LOG_LEVEL_ERROR, "Watchdog Manager", "Watchdog reset with task %lu on core 0, %lu on core 1.",
+            g_last_dispatch[0], g_last_dispatch[1]);
+    }
+    watchdog_hw->scratch[WDG_SCRATCH_STALL_IDX] = 0;
+    watchdog_hw->scratch[WDG_SCRATCH_DISPATCH_IDX] = 0;
+
+    g_initialized = true;
+    return true;
+}
+
+void watchdog_manager_note_dispatch(uint8_t core, uint32_t task_id) {
+    uint32_t shift = (core != 0) ? 16u : 0u;
+
+    // Each core only writes its own half, through the atomic XOR alias
+    hw_write_masked(&watchdog_hw->scratch[WDG_SCRATCH_DISPATCH_IDX], (task_id & 0xFFFFu) << shift, 0xFFFFu << shift);
+}
+
+int watchdog_manager_register(const char* name, int task_id, uint32_t interval_ms,
+    bool critical, watchdog_action_t action, watchdog_recovery_t recovery, void* user_data) {
+    if (!g_initialized || name == NULL || interval_ms == 0) {
+        return -1;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_wdg_lock_num, scheduler_get_current_task());
+
+    int handle = -1;
+    for (int i = 0; i < WATCHDOG_MANAGER_MAX_ENTRIES; i++) {
+        if (!g_entries[i].in_use) {
+            handle = i;
+            break;
+        }
+    }
+
+    if (handle < 0) {
+        hw_spinlock_release(g_wdg_lock_num, save);
+        log_message(LOG_LEVEL_ERROR, "Watchdog Manager", "No free heartbeat slot for %s.", name);
+        return -1;
+    }
+
+    watchdog_entry_t* entry = &g_entries[handle];
+    memset(entry, 0, sizeof(watchdog_entry_t));
+    strncpy(entry->info.name, name, WATCHDOG_MANAGER_NAME_LEN - 1);
+    entry->info.task_id = task_id;
+    entry->info.interval_ms = interval_ms;
+    entry->info.critical = critical;
+    entry->info.action = action;
+    entry->info.last_checkin_ms = to_ms_since_boot(get_absolute_time());
+    entry->recovery = recovery;
+    entry->user_data = user_data;
+    entry->in_use = true;
+
+    hw_spinlock_release(g_wdg_lock_num, save);
+
+    log_message(LOG_LEVEL_INFO, "Watchdog Manager", "Supervising %s every %lu ms (%s, %s).",
+        name, interval_ms, critical ? "critical" : "non-critical", watchdog_action_to_string(action));
+    return handle;
+}
+
+void watchdog_manager_supervise(void) {
+    KERNEL_PROFILE_FUNC();
+    if (!g_initialized) {
+        return;
+    }
+
+    g_last_service_ms = to_ms_since_boot(get_absolute_time());
+    g_loop_alive = true;
+
+    if (g_loop_stalled) {
+        g_loop_stalled = false;
+        watchdog_hw->scratch[WDG_SCRATCH_STALL_IDX] = 0;
+        log_message(LOG_LEVEL_WARN, "Watchdog Manager", "Kernel loop resumed.");
+    }
+
+    if (!g_actions_pending) {
+        return;
+    }
+    g_actions_pending = false;
+
+    for (int i = 0; i < WATCHDOG_MANAGER_MAX_ENTRIES; i++) {
+        watchdog_entry_t* entry = &g_entries[i];
+
+        uint32_t save = hw_spinlock_acquire(g_wdg_lock_num, scheduler_get_current_task());
+
+        if (!entry->in_use || !entry->action_pending) {
+            hw_spinlock_release(g_wdg_lock_num, save);
+            continue;
+        }
+
+        entry->action_pending = false;
+        watchdog_entry_info_t info = entry->info;
+        watchdog_recovery_t recovery = entry->recovery;
+        void* user_data = entry->user_data;
+
+        hw_spinlock_release(g_wdg_lock_num, save);
+
+        log_message(LOG_LEVEL_ERROR, "Watchdog Manager", "Task %s missed its %lu ms heartbeat, action: %s.",
+            info.name, info.interval_ms, watchdog_action_to_string(info.action));
+
+        switch (info.action) {
+            case WATCHDOG_ACTION_RESTART_TASK:
+            case WATCHDOG_ACTION_RESET_BUS: {
+                bool recovered = (recovery != NULL) && recovery(user_data);
+
+                save = hw_spinlock_acquire(g_wdg_lock_num, scheduler_get_current_task());
+                entry->info.recoveries = recovered ? entry->info.recoveries + 1 : WATCHDOG_MANAGER_MAX_RECOVERIES;
+                uint32_t recoveries = entry->info.recoveries;
+                hw_spinlock_release(g_wdg_lock_num, save);
+
+                // Recovery is not making progress, escalate
+                if (recoveries >= WATCHDOG_MANAGER_MAX_RECOVERIES) {
+                    watchdog_manager_reboot(&info);
+                }
+                break;
+            }
+
+            case WATCHDOG_ACTION_REBOOT:
+                watchdog_manager_reboot(&info);
+                break;
+
+            case WATCHDOG_ACTION_NONE:
+            default:
+                break;
+        }
+    }
+}
+
+bool watchdog_manager_unregister(int handle) {
+    if (handle < 0 || handle >= WATCHDOG_MANAGER_MAX_ENTRIES) {
+        return false;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_wdg_lock_num, scheduler_get_current_task());
+    bool valid = g_entries[handle].in_use;
+    g_entries[handle].in_use = false;
+    hw_spinlock_release(g_wdg_lock_num, save);
+
+    return valid;
+}
+
+/**
+ * @brief Supervisor pass, run from the timer IRQ
+ *
+ * Marks overdue heartbeats, records the stall before anything can reset
+ * the chip and leaves the recovery action to watchdog_manager_supervise().
+ * The hardware watchdog is fed only while every critical heartbeat is
+ * healthy and the kernel loop has come round since the last feed.
+ *
+ * @param t Repeating timer
+ * @return true to keep the timer running
+ */
+static bool watchdog_manager_timer_callback(struct repeating_timer* t) {
+    (void)t;
+
+    uint32_t now = to_ms_since_boot(get_absolute_time());
+    bool healthy = true;
+
+    for (int i = 0; i < WATCHDOG_MANAGER_MAX_ENTRIES; i++) {
+        watchdog_entry_t* entry = &g_entries[i];
+        if (!entry->in_use) {
+            continue;
+        }
+
+        uint32_t save = hw_spinlock_acquire(g_wdg_lock_num, scheduler_get_current_task());
+
+        bool overdue = (now - entry->info.last_checkin_ms) > entry->info.interval_ms;
+
+        // A check-in since the last miss clears the stall
+        if (!overdue) {
+            entry->info.stalled = false;
+            entry->info.recoveries = 0;
+            hw_spinlock_release(g_wdg_lock_num, save);
+            continue;
+        }
+
+        if (entry->info.critical) {
+            healthy = false;
+        }
+
+        // Act once per missed interval
+        if (entry->info.stalled && (now - entry->last_action_ms) < entry->info.interval_ms) {
+            hw_spinlock_release(g_wdg_lock_num, save);
+            continue;
+        }
+
+        entry->info.stalled = true;
+        entry->info.misses++;
+        entry->last_action_ms = now;
+        entry->action_pending = true;
+        watchdog_entry_info_t info = entry->info;
+
+        hw_spinlock_release(g_wdg_lock_num, save);
+
+        watchdog_manager_record_stall(&info);
+        blackbox_manager_trigger(BLACKBOX_TRIGGER_STALL);
+        g_actions_pending = true;
+    }
+
+    watchdog_manager_check_loop(now);
+
+    // Only feed the hardware watchdog when all critical tasks and the kernel loop are alive
+    if (g_hw_enabled && healthy && g_loop_alive) {
+        g_loop_alive = false;
+        watchdog_update();
+    }
+
+    return true;
+}
+
+/**
+ * @brief Record the task holding core 0 when the kernel loop stops
+ *
+ * Recorded at half the hardware timeout, so the record is in place
+ * before the reset.
+ *
+ * @param now Current time (ms)
+ */
+static void watchdog_manager_check_loop(uint32_t now) {
+    if (g_loop_stalled || (now - g_last_service_ms) < (g_hw_timeout_ms / 2)) {
+        return;
+    }
+
+    g_loop_stalled = true;
+
+    watchdog_entry_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.task_id = (int)(watchdog_hw->scratch[WDG_SCRATCH_DISPATCH_IDX] & 0xFFFFu);
+
+    task_control_block_t tcb;
+    if (scheduler_get_task_info(info.task_id, &tcb)) {
+        strncpy(info.name, tcb.name, WATCHDOG_MANAGER_NAME_LEN - 1);
+    } else {
+        strncpy(info.name, "kernel", WATCHDOG_MANAGER_NAME_LEN - 1);
+    }
+
+    watchdog_manager_record_stall(&info);
+    blackbox_manager_trigger(BLACKBOX_TRIGGER_STALL);
+}
+
+/**
+ * @brief Store the stalled task in the watchdog scratch registers
+ *
+ * @param info Heartbeat that stalled
+ */
+static void watchdog_manager_record_stall(const watchdog_entry_info_t* info) {
+    uint32_t name_words[2] = {0, 0};
+    memcpy(name_words, info->name, sizeof(name_words));
+
+    uint32_t task = (info->task_id < 0) ? WDG_SCRATCH_NO_TASK : ((uint32_t)info->task_id & 0xFFFFu);
+
+    watchdog_hw->scratch[WDG_SCRATCH_NAME_IDX] = name_words[0];
+    watchdog_hw->scratch[WDG_SCRATCH_NAME_IDX + 1] = name_words[1];
+    watchdog_hw->scratch[WDG_SCRATCH_STALL_IDX] = (WDG_SCRATCH_MAGIC << 16) | task;
+}
+
+/**
+ * @brief Reboot after recording the stalled task
+ *
+ * @param info Heartbeat that stalled
+ */
+static void watchdog_manager_reboot(const watchdog_entry_info_t* info) {
+    log_message(LOG_LEVEL_FATAL, "Watchdog Manager", "Rebooting, task %s stalled.", info->name);
+    watchdog_manager_record_stall(info);
+
+    // Give the console a moment to drain
+    sleep_ms(10);
+    watchdog_reboot(0, 0, 0);
+
+    while (1) {
+        tight_loop_contents();
+    }
+}
+
+static const char* watchdog_action_to_string(watchdog_action_t action) {
+    switch (action) {
+        case WATCHDOG_ACTION_NONE:         return "none";
+        case WATCHDOG_ACTION_RESTART_TASK: return "restart";
+        case WATCHDOG_ACTION_RESET_BUS:    return "bus reset";
+        case WATCHDOG_ACTION_REBOOT:       return "reboot";
+        default:                           return "unknown";
+    }
+}
+
+int cmd_wdt(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("Usage: wdt <status|last>\n\r");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "status") == 0) {
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+
+        printf("Hardware watchdog: %s\n\r", g_hw_enabled ? "enabled" : "disabled");
+        printf("Name           | Task | Interval | Age (ms) | Crit | Misses | Action\n\r");
+        printf("---------------+------+----------+----------+------+--------+----------\n\r");
+
+        for (int i = 0; i < WATCHDOG_MANAGER_MAX_ENTRIES; i++) {
+            watchdog_entry_info_t info;
+            if (!watchdog_manager_get_info(i, &info)) {
+                continue;
+            }
+
+            printf("%-14s | %4d | %8lu | %8lu | %-4s | %6lu | %s%s\n\r",
+                info.name, info.task_id, info.interval_ms, now - info.last_checkin_ms,
+                info.critical ? "yes" : "no", info.misses,
+                watchdog_action_to_string(info.action), info.stalled ? " (stalled)" : "");
+        }
+    }
+    else if (strcmp(argv[1], "last") == 0) {
+        char name[WATCHDOG_MANAGER_NAME_LEN];
+        int task_id;
+
+        uint32_t dispatched[2];
+
+        if (watchdog_manager_get_last_stall(name, sizeof(name), &task_id)) {
+            printf("Last reset caused by stalled task %s (ID:%d)\n\r", name, task_id);
+        } else {
+            printf("No supervised stall recorded before the last reset\n\r");
+        }
+
+        // Task IDs follow creation order, so they name the same tasks after the reset
+        if (watchdog_manager_get_last_dispatch(&dispatched[0], &dispatched[1])) {
+            for (uint8_t core = 0; core < 2; core++) {
+                task_control_block_t tcb;
+                bool known = (dispatched[core] != 0) && scheduler_get_task_info((int)dispatched[core], &tcb);
+
+                printf("Core %u was running %s (ID:%lu)\n\r", core, known ? tcb.name : "no task", dispatched[core]);
+            }
+        }
+    }
+    else {
+        printf("Unknown wdt command: %s\n\r", argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
+
+void register_watchdog_manager_commands(void) {
+    static const shell_command_t wdt_command = {
+        cmd_wdt,
+        "wdt",
+        "Task heartbeat supervision (status|last)"
+    };
+
+    shell_register_command(&wdt_command);
+}
@@ -6,11 +6,19 @@
 */
 
 #include "kernel_init.h"
+#include "kernel_placement.h"
 
+#include "adc_manager.h"
+#include "blackbox_manager.h"
+#include "emg_manager.h"
+#include "gesture_manager.h"
 #include "log_manager.h"
 #include "spinlock_manager.h"
+#include "sensor_filter.h"
 #include "sensor_manager.h"
 #include "servo_manager.h"
+#include "spectrum_manager.h"
+#include "watchdog_manager.h"
 
 #include "scheduler.h"
 #include "scheduler_mpu.h"
@@ -46,6 +54,11 @@ static void print_banner(void);
 static void shell_task_wrapper(void *params);
 static kernel_result_t init_shell_task(void);
 static kernel_result_t init_servos(void);
+static kernel_result_t init_blackbox(void);
+static kernel_result_t init_adc(void);
+static kernel_result_t init_emg(void);
+static kernel_result_t init_spectrum(void);
+static kernel_result_t init_gesture(void);
 static kernel_result_t init_core_subsystems(void);
 
 // Add a global variable to track the shell task ID
@@ -167,6 +180,10 @@ static kernel_result_t init_sensors(void) {
     }
     
     log_message(LOG_LEVEL_INFO, "Kernel Init", "Sensor manager initialized.");
+
+    if (!sensor_filter_init()) {
+        log_message(LOG_LEVEL_WARN, "Kernel Init", "Failed to initialize sensor filters.");
+    }
     
     return SYS_INIT_OK;
 }
@@ -183,6 +200,7 @@ static void register_shell_commands(void) {
     register_scheduler_commands();
     register_stats_commands();
     register_spinlock_commands();
+    register_log_commands();
     
     if (system_config.flags & SYS_INIT_FLAG_TZ) {
         register_tz_commands();
@@ -199,11 +217,36 @@ static void register_shell_commands(void) {
     // Register sensor commands if sensors enabled
     if (system_config.flags & SYS_INIT_FLAG_SENSORS) {
         register_sensor_manager_commands();
+        register_sensor_filter_commands();
     }
 
     if (system_config.flags & SYS_INIT_FLAG_SERVOS) {
         register_servo_manager_commands();
     }
+
+    if (system_config.flags & SYS_INIT_FLAG_WATCHDOG) {
+        register_watchdog_manager_commands();
+    }
+
+    if (system_config.flags & SYS_INIT_FLAG_BLACKBOX) {
+        register_blackbox_manager_commands();
+    }
+
+    if (system_config.flags & SYS_INIT_FLAG_ADC) {
+        register_adc_manager_commands();
+    }
+
+    if (system_config.flags & SYS_INIT_FLAG_EMG) {
+        register_emg_manager_commands();
+    }
+
+    if (system_config.flags & SYS_INIT_FLAG_SPECTRUM) {
+        register_spectrum_manager_commands();
+    }
+
+    if (system_config.flags & SYS_INIT_FLAG_GESTURE) {
+        register_gesture_manager_commands();
+    }
     
     // Register application-specific commands
     kernel_register_commands();
@@ -246,6 +289,17 @@ kernel_result_t kernel_init(const kernel_config_t* config) {
         log_message(LOG_LEVEL_ERROR, "Kernel Init", "Failed to register hardware spinlock manager with scheduler");
         return SYS_INIT_ERROR_GENERAL;
     }
+
+    // Profiling is optional, placement itself is done by the linker
+    if (!kernel_placement_init()) {
+        log_message(LOG_LEVEL_WARN, "Kernel Init", "XIP profiler unavailable.");
+    }
+    
+    // Heartbeat supervision must be up before subsystems register with it
+    if ((system_config.flags & SYS_INIT_FLAG_WATCHDOG) && !watchdog_manager_init()) {
+        log_message(LOG_LEVEL_ERROR, "Kernel Init", "Failed to initialize watchdog manager.");
+        return SYS_INIT_ERROR_GENERAL;
+    }
     
     // Initialize MPU and TrustZone (if requested)
     result = init_mpu_tz();
@@ -259,6 +313,11 @@ kernel_result_t kernel_init(const kernel_config_t* config) {
         return result;
     }
     
+    result = init_adc();
+    if (result != SYS_INIT_OK) {
+        return result;
+    }
+    
     // Initialize sensors (if requested)
     result = init_sensors();
     if (result != SYS_INIT_OK) {
@@ -269,6 +328,29 @@ kernel_result_t kernel_init(const kernel_config_t* config) {
     if (result != SYS_INIT_OK) {
         return result;
     }
+
+    // EMG control reads the ADC rings and drives the servos
+    result = init_emg();
+    if (result != SYS_INIT_OK) {
+        return result;
+    }
+
+    // Picks its default streams from the ADC roles
+    result = init_spectrum();
+    if (result != SYS_INIT_OK) {
+        return result;
+    }
+
+    result = init_gesture();
+    if (result != SYS_INIT_OK) {
+        return result;
+    }
+
+    // Recorder hooks sensors, servos and faults, so it comes up after them
+    result = init_blackbox();
+    if (result != SYS_INIT_OK) {
+        return result;
+    }
     
     // Start scheduler - MOVED BEFORE shell task creation
     log_message(LOG_LEVEL_INFO, "Kernel Init", "Starting scheduler.");
@@ -286,14 +368,10 @@ kernel_result_t kernel_init(const kernel_config_t* config) {
         }
     }
     
-    // Setup watchdog if requested
+    // Setup watchdog if requested, fed by the heartbeat supervisor
     if (system_config.flags & SYS_INIT_FLAG_WATCHDOG) {
-        uint32_t timeout_ms = system_config.watchdog_timeout_ms;
-        if (timeout_ms < 100) timeout_ms = 100;  // Minimum 100ms
-        
-        log_message(LOG_LEVEL_INFO, "Kernel Init", "Enabling watchdog with %lu ms timeout", timeout_ms);
-        watchdog_enable(timeout_ms, true);
-        watchdog_enabled = true;
+        log_message(LOG_LEVEL_INFO, "Kernel Init", "Enabling watchdog with %lu ms timeout", system_config.watchdog_timeout_ms);
+        watchdog_enabled = watchdog_manager_enable_hardware(system_config.watchdog_timeout_ms);
     }
     
     // Mark system as initialized
@@ -338,16 +416,15 @@ void kernel_run(void) {
     printf("> ");
     
     // Main processing loop
-    uint32_t loop_counter = 0;
     uint32_t last_stat_time = to_ms_since_boot(get_absolute_time());
     
     while (1) {
         // Run scheduler tasks
         scheduler_run_pending_tasks();
         
-        // Feed watchdog if enabled
-        if (watchdog_enabled && (loop_counter % 100 == 0)) {
-            watchdog_update();
+        // Run recovery actions, the supervisor timer feeds the watchdog while this loop comes round
+        if (watchdog_enabled) {
+            watchdog_manager_supervise();
         }
         
         // Print statistics every 60 seconds
@@ -360,8 +437,6 @@ void kernel_run(void) {
         
         // Brief delay to prevent CPU hogging
         sleep_ms(1); // Reduce to 1ms for better responsiveness
-        
-        loop_counter++;
     }
 }
 
@@ -504,6 +579,113 @@ static kernel_result_t init_servos(void) {
     return SYS_INIT_OK;
 }
 
+/**
+ * @brief Initialize black-box recorder
+ */
+static kernel_result_t init_blackbox(void) {
+    if (!(system_config.flags & SYS_INIT_FLAG_BLACKBOX)) {
+        log_message(LOG_LEVEL_INFO, "Kernel Init", "Black-box recorder disabled.");
+        return SYS_INIT_OK; // Recorder not requested
+    }
+
+    if (!blackbox_manager_init(NULL)) {
+        log_message(LOG_LEVEL_ERROR, "Kernel Init", "Failed to initialize black-box recorder.");
+        return SYS_INIT_ERROR_GENERAL;
+    }
+
+    // MPU faults freeze a capture
+    if (system_config.flags & SYS_INIT_FLAG_MPU) {
+        scheduler_mpu_register_fault_handler(blackbox_manager_mpu_fault);
+    }
+
+    log_message(LOG_LEVEL_INFO, "Kernel Init", "Black-box recorder initialized.");
+
+    return SYS_INIT_OK;
+}
+
+/**
+ * @brief Initialize ADC streaming
+ */
+static kernel_result_t init_adc(void) {
+    if (!(system_config.flags & SYS_INIT_FLAG_ADC)) {
+        log_message(LOG_LEVEL_INFO, "Kernel Init", "ADC streaming disabled.");
+        return SYS_INIT_OK; // ADC streaming not requested
+    }
+
+    // Not fatal, stats fall back to blocking reads
+    if (!adc_manager_init(NULL)) {
+        log_message(LOG_LEVEL_WARN, "Kernel Init", "Failed to initialize ADC manager.");
+        return SYS_INIT_OK;
+    }
+
+    log_message(LOG_LEVEL_INFO, "Kernel Init", "ADC manager initialized.");
+
+    return SYS_INIT_OK;
+}
+
+/**
+ * @brief Initialize EMG grasp control
+ */
+static kernel_result_t init_emg(void) {
+    if (!(system_config.flags & SYS_INIT_FLAG_EMG)) {
+        log_message(LOG_LEVEL_INFO, "Kernel Init", "EMG control disabled.");
+        return SYS_INIT_OK; // EMG control not requested
+    }
+
+    if (!(system_config.flags & SYS_INIT_FLAG_ADC) || !(system_config.flags & SYS_INIT_FLAG_SERVOS)) {
+        log_message(LOG_LEVEL_WARN, "Kernel Init", "EMG control needs ADC streaming and servos.");
+        return SYS_INIT_OK;
+    }
+
+    if (!emg_manager_init(NULL)) {
+        log_message(LOG_LEVEL_ERROR, "Kernel Init", "Failed to initialize EMG manager.");
+        return SYS_INIT_ERROR_GENERAL;
+    }
+
+    log_message(LOG_LEVEL_INFO, "Kernel Init", "EMG manager initialized.");
+
+    return SYS_INIT_OK;
+}
+
+/**
+ * @brief Initialize vibration analysis
+ */
+static kernel_result_t init_spectrum(void) {
+    if (!(system_config.flags & SYS_INIT_FLAG_SPECTRUM)) {
+        log_message(LOG_LEVEL_INFO, "Kernel Init", "Vibration analysis disabled.");
+        return SYS_INIT_OK; // Analysis not requested
+    }
+
+    // Not fatal, diagnostics only
+    if (!spectrum_manager_init(NULL)) {
+        log_message(LOG_LEVEL_WARN, "Kernel Init", "Failed to initialize spectrum manager.");
+        return SYS_INIT_OK;
+    }
+
+    log_message(LOG_LEVEL_INFO, "Kernel Init", "Spectrum manager initialized.");
+
+    return SYS_INIT_OK;
+}
+
+/**
+ * @brief Initialize gesture inference
+ */
+static kernel_result_t init_gesture(void) {
+    if (!(system_config.flags & SYS_INIT_FLAG_GESTURE)) {
+        log_message(LOG_LEVEL_INFO, "Kernel Init", "Gesture inference disabled.");
+        return SYS_INIT_OK; // Inference not requested
+    }
+
+    if (!gesture_manager_init(NULL)) {
+        log_message(LOG_LEVEL_ERROR, "Kernel Init", "Failed to initialize gesture manager.");
+        return SYS_INIT_ERROR_GENERAL;
+    }
+
+    log_message(LOG_LEVEL_INFO, "Kernel Init", "Gesture manager initialized.");
+
+    return SYS_INIT_OK;
+}
+
 /**
  * @brief Initialize Memory Protection Unit
  * 
@@ -0,0 +1,171 @@
+/**
+* @file kernel_placement.c
+* @brief XIP cache miss profiler implementation
+* @date 2025-05-25
+*/
+
+#include "kernel_placement.h"
+
+#include "scheduler.h"
+#include "spinlock_manager.h"
+
+#include "hardware/structs/xip_ctrl.h"
+#include "hardware/sync.h"
+#include "pico/platform.h"
+
+#include <limits.h>
+#include <string.h>
+
+/**
+ * @brief Per-core probe counters
+ */
+typedef struct {
+    uint32_t calls;
+    uint32_t accesses;
+    uint32_t misses;
+} placement_probe_stats_t;
+
+// Probe names, shared between cores
+static const char* g_probe_names[KERNEL_PLACEMENT_MAX_PROBES];
+static volatile int g_probe_count = 0;
+
+// Counters are only updated by the owning core, so no lock is needed
+static placement_probe_stats_t g_probe_stats_core0[KERNEL_PLACEMENT_MAX_PROBES] KERNEL_CORE0_DATA;
+static placement_probe_stats_t g_probe_stats_core1[KERNEL_PLACEMENT_MAX_PROBES] KERNEL_CORE1_DATA;
+
+// Spinlock for probe registration
+static uint32_t g_placement_lock_num = UINT_MAX;
+
+static int kernel_placement_register(const char* name);
+
+void kernel_placement_get_xip_counters(uint32_t* hits, uint32_t* accesses) {
+    // Read accesses first so hits never exceed accesses
+    uint32_t acc = xip_ctrl_hw->ctr_acc;
+    uint32_t hit = xip_ctrl_hw->ctr_hit;
+
+    if (hits != NULL) {
+        *hits = hit;
+    }
+
+    if (accesses != NULL) {
+        *accesses = acc;
+    }
+}
+
+int kernel_placement_get_profile(kernel_placement_probe_info_t* probes, int max_probes) {
+    if (probes == NULL || max_probes <= 0) {
+        return 0;
+    }
+
+    int count = 0;
+    for (int i = 0; i < g_probe_count && count < max_probes; i++) {
+        kernel_placement_probe_info_t info;
+        info.name = g_probe_names[i];
+        info.calls = g_probe_stats_core0[i].calls + g_probe_stats_core1[i].calls;
+        info.accesses = g_probe_stats_core0[i].accesses + g_probe_stats_core1[i].accesses;
+        info.misses = g_probe_stats_core0[i].misses + g_probe_stats_core1[i].misses;
+
+        // Insertion sort by misses, the table is small
+        int pos = count;
+        while (pos > 0 && probes[pos - 1].misses < info.misses) {
+            probes[pos] = probes[pos - 1];
+            pos--;
+        }
+        probes[pos] = info;
+        count++;
+    }
+
+    return count;
+}
+
+bool kernel_placement_init(void) {
+    g_placement_lock_num = hw_spinlock_allocate(SPINLOCK_CAT_DEBUG, "placement");
+    if (g_placement_lock_num == UINT_MAX) {
+        return false;
+    }
+
+    kernel_placement_reset();
+    return true;
+}
+
+kernel_placement_sample_t kernel_placement_profile_begin(const char* name, int* probe_id) {
+    kernel_placement_sample_t sample = { .probe = -1, .hits = 0, .accesses = 0 };
+
+    if (*probe_id < 0) {
+        *probe_id = kernel_placement_register(name);
+    }
+
+    sample.probe = *probe_id;
+    kernel_placement_get_xip_counters(&sample.hits, &sample.accesses);
+    return sample;
+}
+
+void kernel_placement_profile_end(const kernel_placement_sample_t* sample) {
+    uint32_t hits;
+    uint32_t accesses;
+    kernel_placement_get_xip_counters(&hits, &accesses);
+
+    // Drop samples that straddle a counter reset
+    if (sample->probe < 0 || accesses < sample->accesses || hits < sample->hits) {
+        return;
+    }
+
+    placement_probe_stats_t* stats = (get_core_num() == 0) ?
+        &g_probe_stats_core0[sample->probe] : &g_probe_stats_core1[sample->probe];
+
+    uint32_t delta_acc = accesses - sample->accesses;
+    uint32_t delta_hit = hits - sample->hits;
+
+    stats->calls++;
+    stats->accesses += delta_acc;
+    stats->misses += (delta_acc > delta_hit) ? (delta_acc - delta_hit) : 0;
+}
+
+bool kernel_placement_profiling_enabled(void) {
+#if defined(ROBOHAND_XIP_PROFILE)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void kernel_placement_reset(void) {
+    memset(g_probe_stats_core0, 0, sizeof(g_probe_stats_core0));
+    memset(g_probe_stats_core1, 0, sizeof(g_probe_stats_core1));
+
+    // Any write clears the saturating counters
+    xip_ctrl_hw->ctr_hit = 0;
+    xip_ctrl_hw->ctr_acc = 0;
+}
+
+/**
+ * @brief Find or allocate the probe slot for a function
+ *
+ * @param name Function name.
+ * @return Probe index, or -1 if the table is full or the profiler is not initialized.
+ */
+static int kernel_placement_register(const char* name) {
+    if (g_placement_lock_num == UINT_MAX) {
+        return -1;
+    }
+
+    uint32_t save = hw_spinlock_acquire(g_placement_lock_num, scheduler_get_current_task());
+
+    // The other core may have registered the same function first
+    int probe = -1;
+    for (int i = 0; i < g_probe_count; i++) {
+        if (g_probe_names[i] == name) {
+            probe = i;
+            break;
+        }
+    }
+
+    if (probe < 0 && g_probe_count < KERNEL_PLACEMENT_MAX_PROBES) {
+        probe = g_probe_count;
+        g_probe_names[probe] = name;
+        g_probe_count = probe + 1;
+    }
+
+    hw_spinlock_release(g_placement_lock_num, save);
+    return probe;
+}
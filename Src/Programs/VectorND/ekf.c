@@ -0,0 +1,347 @@
+#include "ekf.h"
+#include <math.h>
+
+VectorError ekf_init(Ekf* ekf, uint8_t n, const float* x0, const float* p0, const float* q,
+                     EkfTransition transition, void* context) {
+    if (ekf == NULL || p0 == NULL || q == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    if (n == 0 || n > EKF_MAX_STATE) {
+        return VECTOR_INVALID_DIMENSION;
+    }
+
+    memset(ekf, 0, sizeof(*ekf));
+    ekf->n = n;
+    ekf->transition = transition;
+    ekf->context = context;
+
+    for (uint8_t i = 0; i < n; i++) {
+        ekf->x[i] = (x0 != NULL) ? x0[i] : 0.0f;
+        ekf->P[EKF_SYM_INDEX(i, i)] = p0[i];
+        ekf->Q[EKF_SYM_INDEX(i, i)] = q[i];
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+float ekf_get_covariance(const Ekf* ekf, uint8_t i, uint8_t j) {
+    return (i >= j) ? ekf->P[EKF_SYM_INDEX(i, j)] : ekf->P[EKF_SYM_INDEX(j, i)];
+}
+
+// Helper function for a symmetric element of a packed matrix
+static inline float ekf_sym(const float* packed, uint8_t i, uint8_t j) {
+    return (i >= j) ? packed[EKF_SYM_INDEX(i, j)] : packed[EKF_SYM_INDEX(j, i)];
+}
+
+VectorError ekf_predict(Ekf* ekf, float dt) {
+    if (ekf == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    uint8_t n = ekf->n;
+    float* F = ekf->jacobian;
+
+    if (ekf->transition == NULL) {
+        // Constant state, only the process noise grows the covariance
+        for (uint8_t i = 0; i < n; i++) {
+            for (uint8_t j = 0; j <= i; j++) {
+                ekf->P[EKF_SYM_INDEX(i, j)] += ekf->Q[EKF_SYM_INDEX(i, j)] * dt;
+            }
+        }
+        return VECTOR_SUCCESS;
+    }
+
+    float x_next[EKF_MAX_STATE];
+    memset(F, 0, (size_t) n * n * sizeof(float));
+    ekf->transition(ekf->context, ekf->x, dt, x_next, F);
+    memcpy(ekf->x, x_next, n * sizeof(float));
+
+    // P' = F P F' + Q dt, one row of F P at a time, lower triangle only
+    float next[EKF_SYM_SIZE(EKF_MAX_STATE)];
+    float row[EKF_MAX_STATE];
+
+    for (uint8_t i = 0; i < n; i++) {
+        const float* fi = &F[i * n];
+
+        for (uint8_t k = 0; k < n; k++) {
+            float sum = 0.0f;
+            for (uint8_t l = 0; l < n; l++) {
+                if (fi[l] != 0.0f) {
+                    sum += fi[l] * ekf_sym(ekf->P, l, k);
+                }
+            }
+            row[k] = sum;
+        }
+
+        for (uint8_t j = 0; j <= i; j++) {
+            const float* fj = &F[j * n];
+            float sum = 0.0f;
+            for (uint8_t k = 0; k < n; k++) {
+                sum += row[k] * fj[k];
+            }
+            next[EKF_SYM_INDEX(i, j)] = sum + ekf->Q[EKF_SYM_INDEX(i, j)] * dt;
+        }
+    }
+
+    memcpy(ekf->P, next, EKF_SYM_SIZE(n) * sizeof(float));
+    return VECTOR_SUCCESS;
+}
+
+VectorError ekf_update_scalar(Ekf* ekf, float innovation, const float* h, float r) {
+    if (ekf == NULL || h == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    uint8_t n = ekf->n;
+    float u[EKF_MAX_STATE];
+    float k[EKF_MAX_STATE];
+
+    // u = P h, s = h' P h + r
+    float s = r;
+    for (uint8_t i = 0; i < n; i++) {
+        float sum = 0.0f;
+        for (uint8_t j = 0; j < n; j++) {
+            if (h[j] != 0.0f) {
+                sum += ekf_sym(ekf->P, i, j) * h[j];
+            }
+        }
+        u[i] = sum;
+        s += h[i] * sum;
+    }
+
+    if (!(s > 0.0f)) {
+        return VECTOR_INCOMPATIBLE_OPERATION;
+    }
+
+    float inverse = 1.0f / s;
+    for (uint8_t i = 0; i < n; i++) {
+        k[i] = u[i] * inverse;
+        ekf->x[i] += k[i] * innovation;
+    }
+
+    // Joseph form (I - k h') P (I - k h')' + k r k' expands exactly to
+    // P - k u' - u k' + s k k', which costs O(n^2) for a scalar
+    for (uint8_t i = 0; i < n; i++) {
+        for (uint8_t j = 0; j <= i; j++) {
+            ekf->P[EKF_SYM_INDEX(i, j)] += (s * k[i] * k[j]) - (k[i] * u[j]) - (u[i] * k[j]);
+        }
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+// Helper function to factor a packed symmetric matrix as L L' in place
+static VectorError ekf_cholesky(float* packed, uint8_t m) {
+    for (uint8_t j = 0; j < m; j++) {
+        float diagonal = packed[EKF_SYM_INDEX(j, j)];
+        for (uint8_t k = 0; k < j; k++) {
+            diagonal -= packed[EKF_SYM_INDEX(j, k)] * packed[EKF_SYM_INDEX(j, k)];
+        }
+
+        if (!(diagonal > 0.0f)) {
+            return VECTOR_INCOMPATIBLE_OPERATION;
+        }
+
+        float ljj = sqrtf(diagonal);
+        packed[EKF_SYM_INDEX(j, j)] = ljj;
+
+        for (uint8_t i = j + 1; i < m; i++) {
+            float sum = packed[EKF_SYM_INDEX(i, j)];
+            for (uint8_t k = 0; k < j; k++) {
+                sum -= packed[EKF_SYM_INDEX(i, k)] * packed[EKF_SYM_INDEX(j, k)];
+            }
+            packed[EKF_SYM_INDEX(i, j)] = sum / ljj;
+        }
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError ekf_update(Ekf* ekf, uint8_t m, const float* innovation, const float* H, const float* R) {
+    if (ekf == NULL || innovation == NULL || H == NULL || R == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    if (m == 0 || m > EKF_MAX_MEASUREMENT) {
+        return VECTOR_INVALID_DIMENSION;
+    }
+
+    uint8_t n = ekf->n;
+    float L[EKF_SYM_SIZE(EKF_MAX_MEASUREMENT)];
+    float y[EKF_MAX_MEASUREMENT];
+    float w[EKF_MAX_MEASUREMENT * EKF_MAX_STATE];
+    float x0[EKF_MAX_STATE];
+
+    memcpy(L, R, EKF_SYM_SIZE(m) * sizeof(float));
+    VectorError err = ekf_cholesky(L, m);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    // Whiten: solve L y = innovation and L W = H by forward substitution
+    for (uint8_t i = 0; i < m; i++) {
+        float inverse = 1.0f / L[EKF_SYM_INDEX(i, i)];
+        float* wi = &w[i * n];
+
+        y[i] = innovation[i];
+        memcpy(wi, &H[i * n], n * sizeof(float));
+
+        for (uint8_t k = 0; k < i; k++) {
+            float lik = L[EKF_SYM_INDEX(i, k)];
+            const float* wk = &w[k * n];
+
+            y[i] -= lik * y[k];
+            for (uint8_t j = 0; j < n; j++) {
+                wi[j] -= lik * wk[j];
+            }
+        }
+
+        y[i] *= inverse;
+        for (uint8_t j = 0; j < n; j++) {
+            wi[j] *= inverse;
+        }
+    }
+
+    // Each whitened measurement has unit noise. Its innovation is corrected
+    // for the state change made by the ones before it.
+    memcpy(x0, ekf->x, n * sizeof(float));
+
+    for (uint8_t i = 0; i < m; i++) {
+        const float* wi = &w[i * n];
+        float correction = 0.0f;
+
+        for (uint8_t j = 0; j < n; j++) {
+            correction += wi[j] * (ekf->x[j] - x0[j]);
+        }
+
+        err = ekf_update_scalar(ekf, y[i] - correction, wi, 1.0f);
+        if (err != VECTOR_SUCCESS) {
+            return err;
+        }
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+/* Benchmark model: state pairs of position and velocity */
+static void ekf_benchmark_transition(void* context, const float* x, float dt, float* x_next, float* jacobian) {
+    uint8_t n = *(const uint8_t*) context;
+
+    for (uint8_t i = 0; i < n; i++) {
+        x_next[i] = x[i];
+        jacobian[(i * n) + i] = 1.0f;
+    }
+
+    for (uint8_t i = 0; i + 1 < n; i += 2) {
+        x_next[i] += dt * x[i + 1];
+        jacobian[(i * n) + i + 1] = dt;
+    }
+}
+
+VectorError ekf_benchmark(uint8_t n, uint8_t m, uint32_t iterations, EkfClock clock, EkfBench* bench) {
+    if (clock == NULL || bench == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    if (n < 2 || n > EKF_MAX_STATE || m == 0 || m > EKF_MAX_MEASUREMENT || iterations == 0) {
+        return VECTOR_INVALID_DIMENSION;
+    }
+
+    static Ekf ekf;
+    static Ekf saved;
+    float p0[EKF_MAX_STATE];
+    float q[EKF_MAX_STATE];
+    float H[EKF_MAX_MEASUREMENT * EKF_MAX_STATE] = {0};
+    float R[EKF_SYM_SIZE(EKF_MAX_MEASUREMENT)] = {0};
+    float innovation[EKF_MAX_MEASUREMENT];
+    const float dt = 0.01f;
+
+    for (uint8_t i = 0; i < n; i++) {
+        p0[i] = 1.0f;
+        q[i] = (i & 1) ? 0.1f : 0.001f;
+    }
+
+    VectorError err = ekf_init(&ekf, n, NULL, p0, q, ekf_benchmark_transition, &n);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    // Sensor j sees the position of axis j, neighbouring sensors share some noise
+    uint8_t axes = n / 2;
+    for (uint8_t j = 0; j < m; j++) {
+        H[(j * n) + 2 * (j % axes)] = 1.0f;
+        R[EKF_SYM_INDEX(j, j)] = 0.02f;
+        if (j > 0) {
+            R[EKF_SYM_INDEX(j, j - 1)] = 0.005f;
+        }
+    }
+
+    // Run full cycles first so the covariance reaches its working values
+    for (uint32_t k = 0; k < iterations; k++) {
+        ekf_predict(&ekf, dt);
+
+        for (uint8_t j = 0; j < m; j++) {
+            float truth = sinf((float) k * dt + (float) j);
+            innovation[j] = truth - ekf.x[2 * (j % axes)];
+        }
+
+        err = ekf_update(&ekf, m, innovation, H, R);
+        if (err != VECTOR_SUCCESS) {
+            return err;
+        }
+    }
+
+    // A microsecond clock is too coarse per call, so each operation is timed
+    // in batches, restoring the filter between batches outside the timed part
+    uint32_t predict_us = 0;
+    uint32_t update_us = 0;
+    uint32_t done = 0;
+    saved = ekf;
+
+    while (done < iterations) {
+        uint32_t batch = iterations - done;
+        if (batch > EKF_BENCH_BATCH) {
+            batch = EKF_BENCH_BATCH;
+        }
+
+        ekf = saved;
+        uint32_t start = clock();
+        for (uint32_t k = 0; k < batch; k++) {
+            ekf_predict(&ekf, dt);
+        }
+        predict_us += clock() - start;
+
+        ekf = saved;
+        start = clock();
+        for (uint32_t k = 0; k < batch; k++) {
+            err = ekf_update(&ekf, m, innovation, H, R);
+            if (err != VECTOR_SUCCESS) {
+                return err;
+            }
+        }
+        update_us += clock() - start;
+
+        done += batch;
+    }
+
+    bench->n = n;
+    bench->m = m;
+    bench->iterations = iterations;
+    bench->predict_ns = (uint32_t) (((uint64_t) predict_us * 1000u) / iterations);
+    bench->update_ns = (uint32_t) (((uint64_t) update_us * 1000u) / iterations);
+    bench->healthy = true;
+
+    for (uint8_t i = 0; i < n; i++) {
+        for (uint8_t j = 0; j <= i; j++) {
+            if (!isfinite(ekf.P[EKF_SYM_INDEX(i, j)])) {
+                bench->healthy = false;
+            }
+        }
+        if (!(ekf.P[EKF_SYM_INDEX(i, i)] > 0.0f)) {
+            bench->healthy = false;
+        }
+    }
+
+    return VECTOR_SUCCESS;
+}
@@ -0,0 +1,625 @@
+#include "matrix_solve.h"
+#include <math.h>
+
+/* Relative size below which an R diagonal entry counts as rank deficient */
+#define MATRIX_SOLVE_RANK_TOLERANCE 1e-6f
+
+/* Largest relative error matrix_solve_self_test() accepts */
+#define MATRIX_SOLVE_TEST_TOLERANCE 1e-4f
+
+// Helper function to validate a square matrix with uniform units
+static VectorError solve_validate_square(const Matrix* matrix) {
+    if (matrix == NULL || matrix->data == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    if (matrix->rows != matrix->cols) {
+        return VECTOR_DIMENSION_MISMATCH;
+    }
+
+    return matrix->uniform_units ? VECTOR_SUCCESS : VECTOR_UNIT_MISMATCH;
+}
+
+// Helper function to validate a right-hand side against a matrix
+static VectorError solve_validate_rhs(const Matrix* matrix, const Vector* b, uint16_t dim) {
+    if (b == NULL || b->data == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    if (b->dim != dim) {
+        return VECTOR_DIMENSION_MISMATCH;
+    }
+
+    return (matrix->uniform_units && b->uniform_units) ? VECTOR_SUCCESS : VECTOR_UNIT_MISMATCH;
+}
+
+// Helper function to give a solution the unit of b divided by the unit of A
+static VectorError solve_set_unit(Vector* x, const Unit* b_unit, const Matrix* matrix) {
+    Unit quotient;
+    VectorError err = unit_divide(&quotient, b_unit, matrix->units);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    err = vector_set_uniform_unit(x, &quotient);
+    unit_free(&quotient);
+    return err;
+}
+
+/* LU factorization, right-looking over panels of block columns */
+static VectorError solve_lu(Matrix* matrix, uint16_t* pivots, int8_t* sign, uint16_t block) {
+    VectorError err = solve_validate_square(matrix);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    if (pivots == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    uint16_t n = matrix->rows;
+    float* a = matrix->data;
+    int8_t parity = 1;
+
+    for (uint16_t k0 = 0; k0 < n; k0 += block) {
+        uint16_t k1 = (uint16_t) ((n - k0 > block) ? (k0 + block) : n);
+
+        // Factor the panel, columns k0 to k1, with partial pivoting
+        for (uint16_t k = k0; k < k1; k++) {
+            uint16_t pivot = k;
+            float largest = fabsf(a[(k * n) + k]);
+
+            for (uint16_t i = k + 1; i < n; i++) {
+                if (fabsf(a[(i * n) + k]) > largest) {
+                    largest = fabsf(a[(i * n) + k]);
+                    pivot = i;
+                }
+            }
+
+            pivots[k] = pivot;
+            if (largest == 0.0f) {
+                return VECTOR_INCOMPATIBLE_OPERATION;
+            }
+
+            if (pivot != k) {
+                for (uint16_t j = 0; j < n; j++) {
+                    float t = a[(k * n) + j];
+                    a[(k * n) + j] = a[(pivot * n) + j];
+                    a[(pivot * n) + j] = t;
+                }
+                parity = (int8_t) -parity;
+            }
+
+            float inverse = 1.0f / a[(k * n) + k];
+            for (uint16_t i = k + 1; i < n; i++) {
+                float lik = a[(i * n) + k] * inverse;
+                a[(i * n) + k] = lik;
+
+                for (uint16_t j = k + 1; j < k1; j++) {
+                    a[(i * n) + j] -= lik * a[(k * n) + j];
+                }
+            }
+        }
+
+        // U12 = L11^-1 A12
+        for (uint16_t k = k0; k < k1; k++) {
+            for (uint16_t i = k + 1; i < k1; i++) {
+                float lik = a[(i * n) + k];
+                for (uint16_t j = k1; j < n; j++) {
+                    a[(i * n) + j] -= lik * a[(k * n) + j];
+                }
+            }
+        }
+
+        // A22 -= L21 U12
+        for (uint16_t i = k1; i < n; i++) {
+            for (uint16_t k = k0; k < k1; k++) {
+                float lik = a[(i * n) + k];
+                for (uint16_t j = k1; j < n; j++) {
+                    a[(i * n) + j] -= lik * a[(k * n) + j];
+                }
+            }
+        }
+    }
+
+    if (sign != NULL) {
+        *sign = parity;
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError matrix_lu_decompose(Matrix* matrix, uint16_t* pivots, int8_t* sign) {
+    // One panel spanning the matrix is the unblocked algorithm
+    return solve_lu(matrix, pivots, sign, (matrix != NULL && matrix->rows > 0) ? matrix->rows : 1);
+}
+
+VectorError matrix_lu_decompose_blocked(Matrix* matrix, uint16_t* pivots, int8_t* sign, uint16_t block) {
+    return solve_lu(matrix, pivots, sign, (block > 0) ? block : MATRIX_SOLVE_BLOCK);
+}
+
+VectorError matrix_lu_solve(const Matrix* lu, const uint16_t* pivots, Vector* b) {
+    VectorError err = solve_validate_square(lu);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    if (pivots == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    err = solve_validate_rhs(lu, b, lu->rows);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    uint16_t n = lu->rows;
+    const float* a = lu->data;
+    float* x = b->data;
+
+    // Apply the row swaps, then L y = P b and U x = y
+    for (uint16_t k = 0; k < n; k++) {
+        float t = x[k];
+        x[k] = x[pivots[k]];
+        x[pivots[k]] = t;
+    }
+
+    for (uint16_t i = 1; i < n; i++) {
+        float sum = x[i];
+        for (uint16_t j = 0; j < i; j++) {
+            sum -= a[(i * n) + j] * x[j];
+        }
+        x[i] = sum;
+    }
+
+    for (int32_t i = n - 1; i >= 0; i--) {
+        float sum = x[i];
+        for (uint16_t j = (uint16_t) (i + 1); j < n; j++) {
+            sum -= a[(i * n) + j] * x[j];
+        }
+        x[i] = sum / a[(i * n) + i];
+    }
+
+    return solve_set_unit(b, b->units, lu);
+}
+
+/* Cholesky factorization, right-looking over panels of block columns */
+static VectorError solve_cholesky(Matrix* matrix, uint16_t block) {
+    VectorError err = solve_validate_square(matrix);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    uint16_t n = matrix->rows;
+    float* a = matrix->data;
+
+    for (uint16_t k0 = 0; k0 < n; k0 += block) {
+        uint16_t k1 = (uint16_t) ((n - k0 > block) ? (k0 + block) : n);
+
+        // Factor the diagonal block, earlier panels are already subtracted
+        for (uint16_t j = k0; j < k1; j++) {
+            float diagonal = a[(j * n) + j];
+            for (uint16_t k = k0; k < j; k++) {
+                diagonal -= a[(j * n) + k] * a[(j * n) + k];
+            }
+
+            if (!(diagonal > 0.0f)) {
+                return VECTOR_INCOMPATIBLE_OPERATION;
+            }
+
+            float ljj = sqrtf(diagonal);
+            float inverse = 1.0f / ljj;
+            a[(j * n) + j] = ljj;
+
+            // Column j of L21 and of the rest of the diagonal block
+            for (uint16_t i = j + 1; i < n; i++) {
+                float sum = a[(i * n) + j];
+                for (uint16_t k = k0; k < j; k++) {
+                    sum -= a[(i * n) + k] * a[(j * n) + k];
+                }
+                a[(i * n) + j] = sum * inverse;
+            }
+        }
+
+        // A22 -= L21 L21', lower triangle only
+        for (uint16_t i = k1; i < n; i++) {
+            for (uint16_t j = k1; j <= i; j++) {
+                float sum = 0.0f;
+                for (uint16_t k = k0; k < k1; k++) {
+                    sum += a[(i * n) + k] * a[(j * n) + k];
+                }
+                a[(i * n) + j] -= sum;
+            }
+        }
+    }
+
+    for (uint16_t i = 0; i < n; i++) {
+        for (uint16_t j = i + 1; j < n; j++) {
+            a[(i * n) + j] = 0.0f;
+        }
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError matrix_cholesky_decompose(Matrix* matrix) {
+    return solve_cholesky(matrix, (matrix != NULL && matrix->rows > 0) ? matrix->rows : 1);
+}
+
+VectorError matrix_cholesky_decompose_blocked(Matrix* matrix, uint16_t block) {
+    return solve_cholesky(matrix, (block > 0) ? block : MATRIX_SOLVE_BLOCK);
+}
+
+VectorError matrix_cholesky_solve(const Matrix* l, Vector* b) {
+    VectorError err = solve_validate_square(l);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    err = solve_validate_rhs(l, b, l->rows);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    uint16_t n = l->rows;
+    const float* a = l->data;
+    float* x = b->data;
+
+    // L y = b, then L' x = y
+    for (uint16_t i = 0; i < n; i++) {
+        float sum = x[i];
+        for (uint16_t j = 0; j < i; j++) {
+            sum -= a[(i * n) + j] * x[j];
+        }
+        x[i] = sum / a[(i * n) + i];
+    }
+
+    for (int32_t i = n - 1; i >= 0; i--) {
+        float sum = x[i];
+        for (uint16_t j = (uint16_t) (i + 1); j < n; j++) {
+            sum -= a[(j * n) + i] * x[j];
+        }
+        x[i] = sum / a[(i * n) + i];
+    }
+
+    return solve_set_unit(b, b->units, l);
+}
+
+VectorError matrix_qr_decompose(Matrix* matrix, float* tau) {
+    if (matrix == NULL || matrix->data == NULL || tau == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    if (matrix->rows < matrix->cols) {
+        return VECTOR_DIMENSION_MISMATCH;
+    }
+
+    if (!matrix->uniform_units) {
+        return VECTOR_UNIT_MISMATCH;
+    }
+
+    uint16_t m = matrix->rows;
+    uint16_t n = matrix->cols;
+    float* a = matrix->data;
+
+    for (uint16_t k = 0; k < n; k++) {
+        float norm = 0.0f;
+        for (uint16_t i = k; i < m; i++) {
+            norm += a[(i * n) + k] * a[(i * n) + k];
+        }
+        norm = sqrtf(norm);
+
+        if (norm == 0.0f) {
+            tau[k] = 0.0f;
+            continue;
+        }
+
+        // Reflect onto -sign(alpha) |x| e1 to avoid cancellation
+        float alpha = a[(k * n) + k];
+        float beta = (alpha >= 0.0f) ? -norm : norm;
+        float inverse = 1.0f / (alpha - beta);
+
+        for (uint16_t i = k + 1; i < m; i++) {
+            a[(i * n) + k] *= inverse;
+        }
+        tau[k] = (beta - alpha) / beta;
+        a[(k * n) + k] = beta;
+
+        // Apply H(k) = I - tau v v' to the remaining columns
+        for (uint16_t j = k + 1; j < n; j++) {
+            float w = a[(k * n) + j];
+            for (uint16_t i = k + 1; i < m; i++) {
+                w += a[(i * n) + k] * a[(i * n) + j];
+            }
+            w *= tau[k];
+
+            a[(k * n) + j] -= w;
+            for (uint16_t i = k + 1; i < m; i++) {
+                a[(i * n) + j] -= a[(i * n) + k] * w;
+            }
+        }
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError matrix_qr_solve(Vector* x, const Matrix* qr, const float* tau, Vector* b, float* residual) {
+    if (x == NULL || x->data == NULL || qr == NULL || qr->data == NULL || tau == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    if (qr->rows < qr->cols || x->dim != qr->cols) {
+        return VECTOR_DIMENSION_MISMATCH;
+    }
+
+    VectorError err = solve_validate_rhs(qr, b, qr->rows);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    if (!x->uniform_units) {
+        return VECTOR_UNIT_MISMATCH;
+    }
+
+    uint16_t m = qr->rows;
+    uint16_t n = qr->cols;
+    const float* a = qr->data;
+    float* y = b->data;
+
+    // Rank check against the largest R diagonal entry
+    float largest = 0.0f;
+    for (uint16_t k = 0; k < n; k++) {
+        largest = fmaxf(largest, fabsf(a[(k * n) + k]));
+    }
+
+    for (uint16_t k = 0; k < n; k++) {
+        if (!(fabsf(a[(k * n) + k]) > largest * MATRIX_SOLVE_RANK_TOLERANCE)) {
+            return VECTOR_INCOMPATIBLE_OPERATION;
+        }
+    }
+
+    // y = Q' b
+    for (uint16_t k = 0; k < n; k++) {
+        float w = y[k];
+        for (uint16_t i = k + 1; i < m; i++) {
+            w += a[(i * n) + k] * y[i];
+        }
+        w *= tau[k];
+
+        y[k] -= w;
+        for (uint16_t i = k + 1; i < m; i++) {
+            y[i] -= a[(i * n) + k] * w;
+        }
+    }
+
+    // R x = y, the rest of y is the residual
+    for (int32_t i = n - 1; i >= 0; i--) {
+        float sum = y[i];
+        for (uint16_t j = (uint16_t) (i + 1); j < n; j++) {
+            sum -= a[(i * n) + j] * x->data[j];
+        }
+        x->data[i] = sum / a[(i * n) + i];
+    }
+
+    if (residual != NULL) {
+        float squared = 0.0f;
+        for (uint16_t i = n; i < m; i++) {
+            squared += y[i] * y[i];
+        }
+        *residual = sqrtf(squared);
+    }
+
+    return solve_set_unit(x, b->units, qr);
+}
+
+/* Self test */
+
+// Helper function to fill a test matrix, with a unit of meters
+static VectorError solve_test_matrix(Matrix* matrix, uint16_t rows, uint16_t cols, const Unit* unit) {
+    VectorError err = matrix_init(matrix, rows, cols, true);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    for (uint8_t i = 0; i < unit->count && err == VECTOR_SUCCESS; i++) {
+        err = unit_add_component(matrix->units, unit->components[i].type, unit->components[i].exponent);
+    }
+
+    if (err != VECTOR_SUCCESS) {
+        matrix_free(matrix);
+    }
+    return err;
+}
+
+// Helper function to set b = A x and return |x|
+static float solve_test_rhs(Vector* b, const float* a, const float* x, uint16_t rows, uint16_t cols) {
+    float norm = 0.0f;
+
+    for (uint16_t i = 0; i < rows; i++) {
+        float sum = 0.0f;
+        for (uint16_t j = 0; j < cols; j++) {
+            sum += a[(i * cols) + j] * x[j];
+        }
+        b->data[i] = sum;
+    }
+
+    for (uint16_t j = 0; j < cols; j++) {
+        norm += x[j] * x[j];
+    }
+    return sqrtf(norm);
+}
+
+// Helper function for the relative error of a solution, and its unit
+static float solve_test_error(const float* expected, const float* actual, uint16_t dim, float scale,
+                              const Unit* unit, const Unit* expected_unit) {
+    float error = 0.0f;
+
+    for (uint16_t i = 0; i < dim; i++) {
+        error = fmaxf(error, fabsf(expected[i] - actual[i]));
+    }
+
+    if (!unit_are_compatible(unit, expected_unit)) {
+        return INFINITY;
+    }
+
+    return error / scale;
+}
+
+VectorError matrix_solve_self_test(float* max_error) {
+    enum { N = 7, M = 9, P = 3 };
+    static const float x_true[N] = {1.0f, -2.0f, 3.0f, -4.0f, 5.0f, -6.0f, 7.0f};
+    float worst = 0.0f;
+    uint16_t pivots[N];
+    float tau[P];
+
+    Unit meter;
+    Unit second;
+    Unit per_meter;
+    unit_init(&meter, 1);
+    unit_add_component(&meter, UNIT_METER, 1);
+    unit_init(&second, 1);
+    unit_add_component(&second, UNIT_SECOND, 1);
+    unit_divide(&per_meter, &second, &meter);
+
+    Matrix a;
+    Vector b;
+    Vector x;
+    VectorError err = VECTOR_SUCCESS;
+
+    // General system, A in meters and b in seconds, unblocked then blocked
+    for (uint16_t block = 0; block <= 3 && err == VECTOR_SUCCESS; block += 3) {
+        err = solve_test_matrix(&a, N, N, &meter);
+        if (err != VECTOR_SUCCESS) {
+            break;
+        }
+
+        for (uint16_t i = 0; i < N; i++) {
+            for (uint16_t j = 0; j < N; j++) {
+                a.data[(i * N) + j] = (i == j) ? 0.5f : 1.0f / (float) (1 + ((i * 3 + j * 5) % 7));
+            }
+        }
+
+        err = vector_init(&b, N, true);
+        if (err == VECTOR_SUCCESS) {
+            vector_set_uniform_unit(&b, &second);
+            float scale = solve_test_rhs(&b, a.data, x_true, N, N);
+
+            err = (block == 0) ? matrix_lu_decompose(&a, pivots, NULL)
+                               : matrix_lu_decompose_blocked(&a, pivots, NULL, block);
+            if (err == VECTOR_SUCCESS) {
+                err = matrix_lu_solve(&a, pivots, &b);
+            }
+            if (err == VECTOR_SUCCESS) {
+                worst = fmaxf(worst, solve_test_error(x_true, b.data, N, scale, b.units, &per_meter));
+            }
+            vector_free(&b);
+        }
+        matrix_free(&a);
+    }
+
+    // Symmetric positive definite system, A = B B' + N I
+    for (uint16_t block = 0; block <= 3 && err == VECTOR_SUCCESS; block += 3) {
+        err = solve_test_matrix(&a, N, N, &meter);
+        if (err != VECTOR_SUCCESS) {
+            break;
+        }
+
+        for (uint16_t i = 0; i < N; i++) {
+            for (uint16_t j = 0; j < N; j++) {
+                float sum = (i == j) ? (float) N : 0.0f;
+                for (uint16_t k = 0; k < N; k++) {
+                    sum += sinf((float) (i + 2 * k + 1)) * sinf((float) (j + 2 * k + 1));
+                }
+                a.data[(i * N) + j] = sum;
+            }
+        }
+
+        err = vector_init(&b, N, true);
+        if (err == VECTOR_SUCCESS) {
+            vector_set_uniform_unit(&b, &second);
+            float scale = solve_test_rhs(&b, a.data, x_true, N, N);
+
+            err = (block == 0) ? matrix_cholesky_decompose(&a) : matrix_cholesky_decompose_blocked(&a, block);
+            if (err == VECTOR_SUCCESS) {
+                err = matrix_cholesky_solve(&a, &b);
+            }
+            if (err == VECTOR_SUCCESS) {
+                worst = fmaxf(worst, solve_test_error(x_true, b.data, N, scale, b.units, &per_meter));
+            }
+            vector_free(&b);
+        }
+        matrix_free(&a);
+    }
+
+    // Least squares fit of a quadratic sampled without noise
+    if (err == VECTOR_SUCCESS) {
+        err = solve_test_matrix(&a, M, P, &meter);
+    }
+    if (err == VECTOR_SUCCESS) {
+        for (uint16_t i = 0; i < M; i++) {
+            float t = -1.0f + 0.25f * (float) i;
+            a.data[(i * P) + 0] = 1.0f;
+            a.data[(i * P) + 1] = t;
+            a.data[(i * P) + 2] = t * t;
+        }
+
+        err = vector_init(&b, M, true);
+        if (err == VECTOR_SUCCESS) {
+            err = vector_init(&x, P, true);
+            if (err == VECTOR_SUCCESS) {
+                float residual = 0.0f;
+                vector_set_uniform_unit(&b, &second);
+                float scale = solve_test_rhs(&b, a.data, x_true, M, P);
+
+                err = matrix_qr_decompose(&a, tau);
+                if (err == VECTOR_SUCCESS) {
+                    err = matrix_qr_solve(&x, &a, tau, &b, &residual);
+                }
+                if (err == VECTOR_SUCCESS) {
+                    worst = fmaxf(worst, solve_test_error(x_true, x.data, P, scale, x.units, &per_meter));
+                    worst = fmaxf(worst, residual / scale);
+                }
+                vector_free(&x);
+            }
+            vector_free(&b);
+        }
+        matrix_free(&a);
+    }
+
+    // Determinant 3 m^3
+    if (err == VECTOR_SUCCESS) {
+        err = solve_test_matrix(&a, 3, 3, &meter);
+    }
+    if (err == VECTOR_SUCCESS) {
+        static const float values[9] = {4.0f, 3.0f, 2.0f, 2.0f, 1.0f, 3.0f, 3.0f, 2.0f, 1.0f};
+        float determinant = 0.0f;
+        Unit unit;
+        Unit cube;
+
+        memcpy(a.data, values, sizeof(values));
+        err = matrix_determinant(&a, &determinant, &unit);
+        if (err == VECTOR_SUCCESS) {
+            unit_init(&cube, 1);
+            unit_add_component(&cube, UNIT_METER, 3);
+            float expected = 3.0f;
+            worst = fmaxf(worst, solve_test_error(&expected, &determinant, 1, 3.0f, &unit, &cube));
+            unit_free(&cube);
+            unit_free(&unit);
+        }
+        matrix_free(&a);
+    }
+
+    unit_free(&per_meter);
+    unit_free(&second);
+    unit_free(&meter);
+
+    if (max_error != NULL) {
+        *max_error = worst;
+    }
+
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    return (worst <= MATRIX_SOLVE_TEST_TOLERANCE) ? VECTOR_SUCCESS : VECTOR_INCOMPATIBLE_OPERATION;
+}
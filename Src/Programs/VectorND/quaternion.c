@@ -0,0 +1,238 @@
+#include "quaternion.h"
+#include <math.h>
+
+/* Below this quaternion dot product slerp interpolates, above it nlerp is as good */
+#define QUAT_SLERP_THRESHOLD 0.9995f
+
+float quat_fast_inv_sqrt(float value) {
+    uint32_t bits;
+    float half = 0.5f * value;
+    float y;
+
+    memcpy(&bits, &value, sizeof(bits));
+    bits = 0x5F375A86u - (bits >> 1);
+    memcpy(&y, &bits, sizeof(y));
+
+    // Each Newton step roughly squares the relative error
+    y = y * (1.5f - half * y * y);
+    y = y * (1.5f - half * y * y);
+
+    return y;
+}
+
+Quat quat_identity(void) {
+    return (Quat) {1.0f, 0.0f, 0.0f, 0.0f};
+}
+
+Quat quat_multiply(Quat a, Quat b) {
+    return (Quat) {
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w
+    };
+}
+
+Quat quat_conjugate(Quat q) {
+    return (Quat) {q.w, -q.x, -q.y, -q.z};
+}
+
+Quat quat_inverse(Quat q) {
+    float squared = quat_dot(q, q);
+    if (squared <= 0.0f) {
+        return quat_identity();
+    }
+
+    float inverse = 1.0f / squared;
+    return (Quat) {q.w * inverse, -q.x * inverse, -q.y * inverse, -q.z * inverse};
+}
+
+float quat_dot(Quat a, Quat b) {
+    return a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+float quat_norm(Quat q) {
+    return sqrtf(quat_dot(q, q));
+}
+
+Quat quat_normalize(Quat q) {
+    float squared = quat_dot(q, q);
+    if (squared <= 0.0f) {
+        return quat_identity();
+    }
+
+    float inverse = quat_fast_inv_sqrt(squared);
+    return (Quat) {q.w * inverse, q.x * inverse, q.y * inverse, q.z * inverse};
+}
+
+Vec3 quat_rotate(Quat q, Vec3 v) {
+    // v' = v + w t + q x t with t = 2 (q x v), as in vec3_batch_rotate()
+    float tx = 2.0f * (q.y * v.z - q.z * v.y);
+    float ty = 2.0f * (q.z * v.x - q.x * v.z);
+    float tz = 2.0f * (q.x * v.y - q.y * v.x);
+
+    return (Vec3) {
+        v.x + q.w * tx + (q.y * tz - q.z * ty),
+        v.y + q.w * ty + (q.z * tx - q.x * tz),
+        v.z + q.w * tz + (q.x * ty - q.y * tx)
+    };
+}
+
+Mat3 quat_to_mat3(Quat q) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    return (Mat3) {{
+        1.0f - 2.0f * (yy + zz), 2.0f * (xy - wz),        2.0f * (xz + wy),
+        2.0f * (xy + wz),        1.0f - 2.0f * (xx + zz), 2.0f * (yz - wx),
+        2.0f * (xz - wy),        2.0f * (yz + wx),        1.0f - 2.0f * (xx + yy)
+    }};
+}
+
+Quat quat_from_mat3(const Mat3* m) {
+    const float* r = m->m;
+    float trace = r[0] + r[4] + r[8];
+    Quat q;
+
+    // Take the square root of the largest of 4w², 4x², 4y², 4z² to avoid cancellation
+    if (trace > 0.0f) {
+        float s = 2.0f * sqrtf(1.0f + trace);
+        q = (Quat) {0.25f * s, (r[7] - r[5]) / s, (r[2] - r[6]) / s, (r[3] - r[1]) / s};
+    } else if (r[0] > r[4] && r[0] > r[8]) {
+        float s = 2.0f * sqrtf(1.0f + r[0] - r[4] - r[8]);
+        q = (Quat) {(r[7] - r[5]) / s, 0.25f * s, (r[1] + r[3]) / s, (r[2] + r[6]) / s};
+    } else if (r[4] > r[8]) {
+        float s = 2.0f * sqrtf(1.0f + r[4] - r[0] - r[8]);
+        q = (Quat) {(r[2] - r[6]) / s, (r[1] + r[3]) / s, 0.25f * s, (r[5] + r[7]) / s};
+    } else {
+        float s = 2.0f * sqrtf(1.0f + r[8] - r[0] - r[4]);
+        q = (Quat) {(r[3] - r[1]) / s, (r[2] + r[6]) / s, (r[5] + r[7]) / s, 0.25f * s};
+    }
+
+    if (q.w < 0.0f) {
+        q = (Quat) {-q.w, -q.x, -q.y, -q.z};
+    }
+
+    return quat_normalize(q);
+}
+
+Quat quat_from_axis_angle(Vec3 axis, float angle) {
+    float squared = axis.x * axis.x + axis.y * axis.y + axis.z * axis.z;
+    if (squared <= 0.0f) {
+        return quat_identity();
+    }
+
+    float s = sinf(0.5f * angle) / sqrtf(squared);
+    return (Quat) {cosf(0.5f * angle), axis.x * s, axis.y * s, axis.z * s};
+}
+
+void quat_to_axis_angle(Quat q, Vec3* axis, float* angle) {
+    if (q.w < 0.0f) {
+        q = (Quat) {-q.w, -q.x, -q.y, -q.z};
+    }
+
+    float length = sqrtf(q.x * q.x + q.y * q.y + q.z * q.z);
+    *angle = 2.0f * atan2f(length, q.w);
+
+    if (length > 0.0f) {
+        *axis = (Vec3) {q.x / length, q.y / length, q.z / length};
+    } else {
+        *axis = (Vec3) {1.0f, 0.0f, 0.0f};
+    }
+}
+
+Quat quat_nlerp(Quat a, Quat b, float t) {
+    // q and -q are the same rotation, take the one nearer a
+    float sign = (quat_dot(a, b) < 0.0f) ? -1.0f : 1.0f;
+    float wa = 1.0f - t;
+    float wb = sign * t;
+
+    return quat_normalize((Quat) {
+        wa * a.w + wb * b.w,
+        wa * a.x + wb * b.x,
+        wa * a.y + wb * b.y,
+        wa * a.z + wb * b.z
+    });
+}
+
+Quat quat_slerp(Quat a, Quat b, float t) {
+    float d = quat_dot(a, b);
+    float sign = 1.0f;
+
+    if (d < 0.0f) {
+        d = -d;
+        sign = -1.0f;
+    }
+
+    if (d > QUAT_SLERP_THRESHOLD) {
+        return quat_nlerp(a, b, t);
+    }
+
+    float theta = acosf(d);
+    float inverse = 1.0f / sinf(theta);
+    float wa = sinf((1.0f - t) * theta) * inverse;
+    float wb = sign * sinf(t * theta) * inverse;
+
+    return (Quat) {
+        wa * a.w + wb * b.w,
+        wa * a.x + wb * b.x,
+        wa * a.y + wb * b.y,
+        wa * a.z + wb * b.z
+    };
+}
+
+Vec3 mat3_multiply_vec3(const Mat3* m, Vec3 v) {
+    const float* r = m->m;
+
+    return (Vec3) {
+        r[0] * v.x + r[1] * v.y + r[2] * v.z,
+        r[3] * v.x + r[4] * v.y + r[5] * v.z,
+        r[6] * v.x + r[7] * v.y + r[8] * v.z
+    };
+}
+
+VectorError quat_batch_multiply(Quat* result, const Quat* a, const Quat* b, uint32_t count) {
+    if (result == NULL || a == NULL || b == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        result[i] = quat_multiply(a[i], b[i]);
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError quat_batch_normalize(Quat* qs, uint32_t count) {
+    if (qs == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        qs[i] = quat_normalize(qs[i]);
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError quat_batch_slerp(Quat* result, const Quat* a, const Quat* b, uint32_t count, float t) {
+    if (result == NULL || a == NULL || b == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        result[i] = quat_slerp(a[i], b[i], t);
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError quat_batch_rotate(Vec3Batch* result, Quat q, const Vec3Batch* a) {
+    // One rotation for the whole batch is cheapest as a matrix
+    Mat3 rotation = quat_to_mat3(q);
+    Unit dimensionless = {NULL, 0, 0};
+    Matrix matrix = {rotation.m, 3, 3, &dimensionless, true};
+
+    return vec3_batch_transform(result, &matrix, a);
+}
@@ -0,0 +1,347 @@
+#include "vector_batch.h"
+#include <math.h>
+
+/* Dimensionless unit standing in for a NULL batch unit */
+static const Unit batch_dimensionless = {NULL, 0, 0};
+
+static const Unit* batch_unit(const Unit* unit) {
+    return (unit != NULL) ? unit : &batch_dimensionless;
+}
+
+// Helper function to validate a batch and its storage
+static VectorError batch_validate(const Vec3Batch* batch) {
+    if (batch == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    if (batch->count > 0 && (batch->x == NULL || batch->y == NULL || batch->z == NULL)) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+// Helper function to validate two batches of the same size
+static VectorError batch_validate_pair(const Vec3Batch* a, const Vec3Batch* b) {
+    VectorError err = batch_validate(a);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    err = batch_validate(b);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    return (a->count == b->count) ? VECTOR_SUCCESS : VECTOR_DIMENSION_MISMATCH;
+}
+
+// Helper function to check that a result unit is the product of two units
+static VectorError batch_check_product(const Unit* expected, const Unit* a, const Unit* b) {
+    Unit product;
+    VectorError err = unit_multiply(&product, batch_unit(a), batch_unit(b));
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    bool compatible = unit_are_compatible(batch_unit(expected), &product);
+    unit_free(&product);
+
+    return compatible ? VECTOR_SUCCESS : VECTOR_UNIT_MISMATCH;
+}
+
+VectorError vec3_batch_init(Vec3Batch* batch, float* x, float* y, float* z, uint32_t count, const Unit* unit) {
+    if (batch == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    batch->x = x;
+    batch->y = y;
+    batch->z = z;
+    batch->count = count;
+    batch->unit = unit;
+
+    return batch_validate(batch);
+}
+
+VectorError vec3_batch_load_interleaved(Vec3Batch* batch, const float* xyz) {
+    VectorError err = batch_validate(batch);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    if (xyz == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    for (uint32_t i = 0; i < batch->count; i++) {
+        batch->x[i] = xyz[0];
+        batch->y[i] = xyz[1];
+        batch->z[i] = xyz[2];
+        xyz += 3;
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError vec3_batch_store_interleaved(float* xyz, const Vec3Batch* batch) {
+    VectorError err = batch_validate(batch);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    if (xyz == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    for (uint32_t i = 0; i < batch->count; i++) {
+        xyz[0] = batch->x[i];
+        xyz[1] = batch->y[i];
+        xyz[2] = batch->z[i];
+        xyz += 3;
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+// Helper function for the element-wise operations, which keep the unit of the inputs
+static VectorError batch_validate_elementwise(const Vec3Batch* result, const Vec3Batch* a, const Vec3Batch* b) {
+    VectorError err = batch_validate_pair(result, a);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    if (b != NULL) {
+        err = batch_validate_pair(a, b);
+        if (err != VECTOR_SUCCESS) {
+            return err;
+        }
+
+        if (!unit_are_compatible(batch_unit(a->unit), batch_unit(b->unit))) {
+            return VECTOR_UNIT_MISMATCH;
+        }
+    }
+
+    if (!unit_are_compatible(batch_unit(result->unit), batch_unit(a->unit))) {
+        return VECTOR_UNIT_MISMATCH;
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+/* Element-wise operations run component by component on the ARM DSP kernels */
+VectorError vec3_batch_add(Vec3Batch* result, const Vec3Batch* a, const Vec3Batch* b) {
+    if (b == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    VectorError err = batch_validate_elementwise(result, a, b);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    arm_add_f32(a->x, b->x, result->x, a->count);
+    arm_add_f32(a->y, b->y, result->y, a->count);
+    arm_add_f32(a->z, b->z, result->z, a->count);
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError vec3_batch_subtract(Vec3Batch* result, const Vec3Batch* a, const Vec3Batch* b) {
+    if (b == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    VectorError err = batch_validate_elementwise(result, a, b);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    arm_sub_f32(a->x, b->x, result->x, a->count);
+    arm_sub_f32(a->y, b->y, result->y, a->count);
+    arm_sub_f32(a->z, b->z, result->z, a->count);
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError vec3_batch_scale(Vec3Batch* result, const Vec3Batch* a, float scalar) {
+    VectorError err = batch_validate_elementwise(result, a, NULL);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    arm_scale_f32(a->x, scalar, result->x, a->count);
+    arm_scale_f32(a->y, scalar, result->y, a->count);
+    arm_scale_f32(a->z, scalar, result->z, a->count);
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError vec3_batch_dot(float* result, Unit* result_unit, const Vec3Batch* a, const Vec3Batch* b) {
+    if (result == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    VectorError err = batch_validate_pair(a, b);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    if (result_unit != NULL) {
+        err = unit_multiply(result_unit, batch_unit(a->unit), batch_unit(b->unit));
+        if (err != VECTOR_SUCCESS) {
+            return err;
+        }
+    }
+
+    for (uint32_t i = 0; i < a->count; i++) {
+        result[i] = a->x[i] * b->x[i] + a->y[i] * b->y[i] + a->z[i] * b->z[i];
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError vec3_batch_cross(Vec3Batch* result, const Vec3Batch* a, const Vec3Batch* b) {
+    VectorError err = batch_validate_pair(a, b);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    err = batch_validate_pair(result, a);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    err = batch_check_product(result->unit, a->unit, b->unit);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    // Components are loaded before any store, so the result may alias an input
+    for (uint32_t i = 0; i < a->count; i++) {
+        float ax = a->x[i], ay = a->y[i], az = a->z[i];
+        float bx = b->x[i], by = b->y[i], bz = b->z[i];
+
+        result->x[i] = ay * bz - az * by;
+        result->y[i] = az * bx - ax * bz;
+        result->z[i] = ax * by - ay * bx;
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError vec3_batch_magnitude(float* result, Unit* result_unit, const Vec3Batch* a) {
+    if (result == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    VectorError err = batch_validate(a);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    if (result_unit != NULL) {
+        err = unit_multiply(result_unit, batch_unit(a->unit), &batch_dimensionless);
+        if (err != VECTOR_SUCCESS) {
+            return err;
+        }
+    }
+
+    for (uint32_t i = 0; i < a->count; i++) {
+        result[i] = sqrtf(a->x[i] * a->x[i] + a->y[i] * a->y[i] + a->z[i] * a->z[i]);
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError vec3_batch_normalize(Vec3Batch* result, const Vec3Batch* a) {
+    VectorError err = batch_validate_pair(result, a);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    if (batch_unit(result->unit)->count != 0) {
+        return VECTOR_UNIT_MISMATCH;
+    }
+
+    for (uint32_t i = 0; i < a->count; i++) {
+        float x = a->x[i], y = a->y[i], z = a->z[i];
+        float squared = x * x + y * y + z * z;
+        float inverse = (squared > 0.0f) ? 1.0f / sqrtf(squared) : 0.0f;
+
+        result->x[i] = x * inverse;
+        result->y[i] = y * inverse;
+        result->z[i] = z * inverse;
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError vec3_batch_transform(Vec3Batch* result, const Matrix* matrix, const Vec3Batch* a) {
+    if (matrix == NULL || matrix->data == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    if (matrix->rows != 3 || matrix->cols != 3) {
+        return VECTOR_DIMENSION_MISMATCH;
+    }
+
+    /* Per-element matrix units would give per-component result units */
+    if (!matrix->uniform_units) {
+        return VECTOR_UNIT_MISMATCH;
+    }
+
+    VectorError err = batch_validate_pair(result, a);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    err = batch_check_product(result->unit, matrix->units, a->unit);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    // Keep the matrix in registers for the whole batch
+    const float* m = matrix->data;
+    float m00 = m[0], m01 = m[1], m02 = m[2];
+    float m10 = m[3], m11 = m[4], m12 = m[5];
+    float m20 = m[6], m21 = m[7], m22 = m[8];
+
+    for (uint32_t i = 0; i < a->count; i++) {
+        float x = a->x[i], y = a->y[i], z = a->z[i];
+
+        result->x[i] = m00 * x + m01 * y + m02 * z;
+        result->y[i] = m10 * x + m11 * y + m12 * z;
+        result->z[i] = m20 * x + m21 * y + m22 * z;
+    }
+
+    return VECTOR_SUCCESS;
+}
+
+VectorError vec3_batch_rotate(Vec3Batch* result, const float* qs, const Vec3Batch* a) {
+    if (qs == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    VectorError err = batch_validate_elementwise(result, a, NULL);
+    if (err != VECTOR_SUCCESS) {
+        return err;
+    }
+
+    // v' = v + w t + q x t with t = 2 (q x v), cheaper than the two products of q v q*
+    for (uint32_t i = 0; i < a->count; i++) {
+        float qw = qs[0], qx = qs[1], qy = qs[2], qz = qs[3];
+        float x = a->x[i], y = a->y[i], z = a->z[i];
+
+        float tx = 2.0f * (qy * z - qz * y);
+        float ty = 2.0f * (qz * x - qx * z);
+        float tz = 2.0f * (qx * y - qy * x);
+
+        result->x[i] = x + qw * tx + (qy * tz - qz * ty);
+        result->y[i] = y + qw * ty + (qz * tx - qx * tz);
+        result->z[i] = z + qw * tz + (qx * ty - qy * tx);
+        qs += 4;
+    }
+
+    return VECTOR_SUCCESS;
+}
@@ -1,4 +1,5 @@
 #include "vector_math.h"
+#include "matrix_solve.h"
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
@@ -441,6 +442,48 @@ VectorError vector_subtract(Vector* result, const Vector* a, const Vector* b) {
     return VECTOR_SUCCESS;
 }
 
+/* Optimized vector scaling using ARM DSP */
+VectorError vector_scale(Vector* result, const Vector* vector, float scalar, const Unit* scalar_unit) {
+    if (result == NULL || vector == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+
+    /* Initialize result if needed */
+    if (result->dim != vector->dim) {
+        VectorError err = vector_free(result);
+        if (err != VECTOR_SUCCESS) return err;
+
+        err = vector_init(result, vector->dim, vector->uniform_units);
+        if (err != VECTOR_SUCCESS) return err;
+    }
+
+    /* Result units are the vector units times the scalar unit */
+    uint16_t unit_count = vector->uniform_units ? 1 : vector->dim;
+    for (uint16_t i = 0; i < unit_count; i++) {
+        if (scalar_unit == NULL) {
+            /* Scaling in place by a unitless scalar leaves the units as they are */
+            if (result != vector) {
+                VectorError err = vector_set_unit(result, i, &vector->units[i]);
+                if (err != VECTOR_SUCCESS) return err;
+            }
+            continue;
+        }
+
+        Unit scaled;
+        VectorError err = unit_multiply(&scaled, &vector->units[i], scalar_unit);
+        if (err != VECTOR_SUCCESS) return err;
+
+        err = vector_set_unit(result, i, &scaled);
+        unit_free(&scaled);
+        if (err != VECTOR_SUCCESS) return err;
+    }
+
+    /* Use ARM DSP for vector scaling */
+    arm_scale_f32(vector->data, scalar, result->data, vector->dim);
+
+    return VECTOR_SUCCESS;
+}
+
 /* Optimized dot product using ARM DSP */
 VectorError vector_dot_product(float* result, Unit* result_unit, const Vector* a, const Vector* b) {
     if (result == NULL || result_unit == NULL || a == NULL || b == NULL) {
@@ -799,6 +842,80 @@ VectorError matrix_init(Matrix* matrix, uint16_t rows, uint16_t cols, bool unifo
     return VECTOR_SUCCESS;
 }
 
+/* Determinant from an LU factorization of a copy */
+VectorError matrix_determinant(const Matrix* matrix, float* result, Unit* result_unit) {
+    if (matrix == NULL || result == NULL || result_unit == NULL) {
+        return VECTOR_NULL_POINTER;
+    }
+    
+    if (matrix->rows != matrix->cols) {
+        return VECTOR_DIMENSION_MISMATCH;
+    }
+    
+    if (!matrix->uniform_units) {
+        return VECTOR_UNIT_MISMATCH;
+    }
+    
+    uint16_t n = matrix->rows;
+    
+    /* The determinant has the unit of the elements to the power n */
+    for (uint8_t i = 0; i < matrix->units->count; i++) {
+        int32_t exponent = matrix->units->components[i].exponent * (int32_t)n;
+        if (exponent > INT8_MAX || exponent < INT8_MIN) {
+            return VECTOR_INCOMPATIBLE_OPERATION;
+        }
+    }
+    
+    VectorError err = unit_init(result_unit, matrix->units->count);
+    if (err != VECTOR_SUCCESS) return err;
+    
+    for (uint8_t i = 0; i < matrix->units->count; i++) {
+        err = unit_add_component(result_unit, matrix->units->components[i].type,
+                               (int8_t)(matrix->units->components[i].exponent * n));
+        if (err != VECTOR_SUCCESS) {
+            unit_free(result_unit);
+            return err;
+        }
+    }
+    
+    /* Factor a copy, the input is const */
+    Matrix lu = *matrix;
+    uint16_t* pivots = (uint16_t*)malloc(n * sizeof(uint16_t));
+    lu.data = (float*)aligned_alloc(16, ((n * n * sizeof(float)) + 15) & ~(size_t)15);
+    if (lu.data == NULL || pivots == NULL) {
+        free(lu.data);
+        free(pivots);
+        unit_free(result_unit);
+        return VECTOR_MEMORY_ERROR;
+    }
+    
+    memcpy(lu.data, matrix->data, n * n * sizeof(float));
+    
+    int8_t sign = 1;
+    err = matrix_lu_decompose(&lu, pivots, &sign);
+    
+    if (err == VECTOR_INCOMPATIBLE_OPERATION) {
+        /* Singular */
+        *result = 0.0f;
+        err = VECTOR_SUCCESS;
+    } else if (err == VECTOR_SUCCESS) {
+        float determinant = (float)sign;
+        for (uint16_t i = 0; i < n; i++) {
+            determinant *= lu.data[(i * n) + i];
+        }
+        *result = determinant;
+    }
+    
+    free(lu.data);
+    free(pivots);
+    
+    if (err != VECTOR_SUCCESS) {
+        unit_free(result_unit);
+    }
+    
+    return err;
+}
+
 /* Helper function for efficient memory copies using DSP */
 static inline void vector_memcpy_aligned(float* dst, const float* src, uint32_t count) {
     /* Use ARM DSP copy if available for better performance */
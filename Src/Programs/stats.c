@@ -5,8 +5,14 @@
 
 #include "stats.h"
 
+#include "adc_manager.h"
+#include "ekf.h"
+#include "interp_accel.h"
+#include "kernel_placement.h"
 #include "log_manager.h"
+#include "matrix_solve.h"
 #include "scheduler.h"
+#include "spectrum_manager.h"
 #include "spinlock_manager.h"
 
 #include "hardware/adc.h"
@@ -67,9 +73,11 @@ bool stats_init(void) {
     stats_data.system_start_time_us = time_us_64();
     stats_data.collection_enabled = true;
     
-    // Initialize ADC for voltage/temperature monitoring
-    adc_init();
-    adc_set_temp_sensor_enabled(true);
+    // Initialize ADC for temperature monitoring, unless the ADC manager owns it
+    if (!adc_manager_is_running()) {
+        adc_init();
+        adc_set_temp_sensor_enabled(true);
+    }
     
     // Set default optimizations based on current system state
     stats_data.active_optimizations = OPT_NONE;
@@ -106,17 +114,33 @@ static void update_system_stats(void) {
     // Update uptime
     stats_data.system.uptime_us = current_time - stats_data.system_start_time_us;
     
-    // Read temperature
-    adc_select_input(4); // Temperature sensor is on ADC4
-    uint16_t raw = adc_read();
-    float voltage = raw * 3.3f / (1 << 12);
-    stats_data.system.temperature_c = (uint32_t) (27 - (voltage - 0.706f) / 0.001721f);
-    
-    // Estimate voltage (placeholder - actual implementation would need hardware support)
-    stats_data.system.voltage_mv = 3300; // Default 3.3V
-    
-    // Current measurement would require external hardware
-    stats_data.system.current_ma = 0; // Not available
+    if (adc_manager_is_running()) {
+        // Latest streamed samples, a blocking adc_read() would break the round robin
+        float value;
+        
+        if (adc_manager_get_role_value(ADC_ROLE_TEMPERATURE, &value)) {
+            stats_data.system.temperature_c = (uint32_t) value;
+        }
+        
+        stats_data.system.voltage_mv = adc_manager_get_role_value(ADC_ROLE_BATTERY_VOLTAGE, &value) ?
+            (uint32_t) (value * 1000.0f) : 3300; // Default 3.3V without a battery input
+        
+        stats_data.system.current_ma = (adc_manager_get_role_value(ADC_ROLE_SERVO_CURRENT, &value) && value > 0.0f) ?
+            (uint32_t) (value * 1000.0f) : 0; // Not available without current sense
+    }
+    else {
+        // Read temperature
+        adc_select_input(4); // Temperature sensor is on ADC4
+        uint16_t raw = adc_read();
+        float voltage = raw * 3.3f / (1 << 12);
+        stats_data.system.temperature_c = (uint32_t) (27 - (voltage - 0.706f) / 0.001721f);
+        
+        // Estimate voltage (placeholder - actual implementation would need hardware support)
+        stats_data.system.voltage_mv = 3300; // Default 3.3V
+        
+        // Current measurement would require external hardware
+        stats_data.system.current_ma = 0; // Not available
+    }
     
     // Calculate CPU usage based on scheduler stats
     scheduler_stats_t sched_stats;
@@ -747,6 +771,17 @@ int cmd_system_stats(int argc, char *argv[]) {
     printf("CPU Usage: %u%%\n\r", stats.cpu_usage_percent);
     printf("Core 0 Usage: %u%%\n\r", stats.core0_usage_percent);  
     printf("Core 1 Usage: %u%%\n\r", stats.core1_usage_percent);
+
+    if (spectrum_manager_is_running()) {
+        for (uint8_t i = 0; i < SPECTRUM_MANAGER_MAX_ANALYZERS; i++) {
+            spectrum_manager_result_t vibration;
+
+            if (spectrum_manager_get_result(i, &vibration)) {
+                printf("Vibration %u: %.4f rms, peak %.1f Hz (%.4f rms)\n\r", i,
+                    (double) vibration.total_rms, (double) vibration.peak_hz[0], (double) vibration.peak_rms[0]);
+            }
+        }
+    }
     
     return 0;
 }
@@ -877,6 +912,10 @@ static void stats_print_usage(void) {
     log_message(LOG_LEVEL_INFO, "HW Stats", "  detail       - Show detailed cache and processor information.");
     log_message(LOG_LEVEL_INFO, "HW Stats", "  benchmark    - Run FPU benchmark.");
     log_message(LOG_LEVEL_INFO, "HW Stats", "  monitor <n>  - Monitor cache and FPU status for n seconds.");
+    log_message(LOG_LEVEL_INFO, "HW Stats", "  xip [reset]  - Show XIP cache hit rate and functions missing most.");
+    log_message(LOG_LEVEL_INFO, "HW Stats", "  interp [n]   - Benchmark interpolator against software mapping.");
+    log_message(LOG_LEVEL_INFO, "HW Stats", "  ekf [n] [m]  - Benchmark Kalman filter predict and update.");
+    log_message(LOG_LEVEL_INFO, "HW Stats", "  linalg       - Check the linear solvers against known solutions.");
     log_message(LOG_LEVEL_INFO, "HW Stats", "If no command is given, 'status' is the default.");
 }
 
@@ -1026,6 +1065,141 @@ static int stats_monitor(int seconds) {
     return 0;
 }
 
+/**
+ * @brief Benchmark the interpolator mapping against the software paths
+ * 
+ * @param iterations Number of sample batches to convert
+ * @return 0 on success, -1 on error
+ */
+static int stats_interp_benchmark(int iterations) {
+    if (iterations <= 0 || iterations > 1000) {
+        log_message(LOG_LEVEL_ERROR, "HW Stats", "Invalid batch count. Please specify between 1 and 1000.");
+        return -1;
+    }
+
+    interp_accel_bench_t bench;
+    if (!interp_accel_benchmark((uint32_t)iterations, &bench)) {
+        return -1;
+    }
+
+    log_message(LOG_LEVEL_INFO, "HW Stats", "Interpolator benchmark (%lu samples, core %u):",
+        bench.samples, get_core_num());
+    log_message(LOG_LEVEL_INFO, "HW Stats", "Interpolator: %s, %lu ns/sample.",
+        bench.hw_available ? "Hardware" : "Software fallback", bench.hw_ns);
+    log_message(LOG_LEVEL_INFO, "HW Stats", "Integer software: %lu ns/sample.", bench.sw_ns);
+    log_message(LOG_LEVEL_INFO, "HW Stats", "Float reference: %lu ns/sample.", bench.float_ns);
+
+    if (bench.mismatches > 0) {
+        log_message(LOG_LEVEL_WARN, "HW Stats", "%lu samples differ between hardware and software.", bench.mismatches);
+    }
+
+    return 0;
+}
+
+static uint32_t stats_clock_us(void) {
+    return time_us_32();
+}
+
+/**
+ * @brief Benchmark Kalman filter predict and update on the FPU
+ * 
+ * @param n State dimension, 0 for a range of sizes
+ * @param m Measurement dimension
+ * @return 0 on success, -1 on error
+ */
+static int stats_ekf_benchmark(int n, int m) {
+    static const uint8_t sizes[][2] = {{4, 2}, {9, 3}, {16, 4}, {16, 8}};
+    const uint32_t iterations = 1000;
+
+    log_message(LOG_LEVEL_INFO, "HW Stats", "EKF benchmark (%lu cycles, core %u):", iterations, get_core_num());
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        uint8_t state = (n > 0) ? (uint8_t)n : sizes[i][0];
+        uint8_t measurement = (n > 0) ? (uint8_t)m : sizes[i][1];
+
+        EkfBench bench;
+        VectorError err = ekf_benchmark(state, measurement, iterations, stats_clock_us, &bench);
+        if (err != VECTOR_SUCCESS) {
+            log_message(LOG_LEVEL_ERROR, "HW Stats", "EKF n=%u m=%u: %s.", state, measurement, vector_error_string(err));
+            return -1;
+        }
+
+        log_message(LOG_LEVEL_INFO, "HW Stats", "n=%2u m=%u: predict %lu ns, update %lu ns%s.",
+            bench.n, bench.m, bench.predict_ns, bench.update_ns, bench.healthy ? "" : ", covariance unhealthy");
+
+        if (n > 0) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Run the linear solver self test on the FPU
+ * 
+ * @return 0 on success, -1 on error
+ */
+static int stats_linalg_check(void) {
+    float max_error = 0.0f;
+    uint32_t start = time_us_32();
+    VectorError err = matrix_solve_self_test(&max_error);
+    uint32_t elapsed = time_us_32() - start;
+
+    if (err != VECTOR_SUCCESS) {
+        log_message(LOG_LEVEL_ERROR, "HW Stats", "Linear solver check failed: %s, max relative error %.2e.",
+            vector_error_string(err), (double)max_error);
+        return -1;
+    }
+
+    log_message(LOG_LEVEL_INFO, "HW Stats", "Linear solver check passed, max relative error %.2e, %lu us.",
+        (double)max_error, elapsed);
+    return 0;
+}
+
+/**
+ * @brief Display XIP cache counters and the profiled functions missing most
+ * 
+ * @param reset Clear the counters instead of reporting
+ * @return 0 on success
+ */
+static int stats_xip(bool reset) {
+    if (reset) {
+        kernel_placement_reset();
+        log_message(LOG_LEVEL_INFO, "HW Stats", "XIP counters reset.");
+        return 0;
+    }
+
+    uint32_t hits;
+    uint32_t accesses;
+    kernel_placement_get_xip_counters(&hits, &accesses);
+
+    uint32_t misses = (accesses > hits) ? (accesses - hits) : 0;
+    float hit_rate = (accesses > 0) ? (100.0f * (float)hits / (float)accesses) : 0.0f;
+
+    log_message(LOG_LEVEL_INFO, "HW Stats", "XIP Cache: %lu accesses, %lu misses, %.2f%% hit rate.",
+        accesses, misses, (double)hit_rate);
+
+    if (!kernel_placement_profiling_enabled()) {
+        log_message(LOG_LEVEL_INFO, "HW Stats", "Per-function profile requires ROBOHAND_XIP_PROFILE.");
+        return 0;
+    }
+
+    kernel_placement_probe_info_t probes[KERNEL_PLACEMENT_MAX_PROBES];
+    int count = kernel_placement_get_profile(probes, KERNEL_PLACEMENT_MAX_PROBES);
+
+    log_message(LOG_LEVEL_INFO, "HW Stats", "Function                         Calls     Accesses  Misses    Miss/Call");
+    log_message(LOG_LEVEL_INFO, "HW Stats", "-------------------------------  --------  --------  --------  ---------");
+
+    for (int i = 0; i < count; i++) {
+        uint32_t per_call = (probes[i].calls > 0) ? (probes[i].misses / probes[i].calls) : 0;
+        log_message(LOG_LEVEL_INFO, "HW Stats", "%-31.31s  %8lu  %8lu  %8lu  %9lu",
+            probes[i].name, probes[i].calls, probes[i].accesses, probes[i].misses, per_call);
+    }
+
+    return 0;
+}
+
 /**
  * @brief Main command handler for cache/FPU shell commands
  * 
@@ -1063,6 +1237,28 @@ int cmd_hwstats(int argc, char *argv[]) {
         return stats_monitor(seconds);
     }
 
+    else if (strcmp(argv[1], "interp") == 0) {
+        int iterations = 64;  // Default batch count
+        if (argc > 2) {
+            iterations = atoi(argv[2]);
+        }
+        return stats_interp_benchmark(iterations);
+    }
+
+    else if (strcmp(argv[1], "ekf") == 0) {
+        int n = (argc > 2) ? atoi(argv[2]) : 0;
+        int m = (argc > 3) ? atoi(argv[3]) : 1;
+        return stats_ekf_benchmark(n, m);
+    }
+
+    else if (strcmp(argv[1], "linalg") == 0) {
+        return stats_linalg_check();
+    }
+
+    else if (strcmp(argv[1], "xip") == 0) {
+        return stats_xip(argc > 2 && strcmp(argv[2], "reset") == 0);
+    }
+
     else if (strcmp(argv[1], "help") == 0) {
         stats_print_usage();
         return 0;
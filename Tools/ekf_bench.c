@@ -0,0 +1,276 @@
+/**
+* @file ekf_bench.c
+* @brief Host benchmark and reference check of the VectorND extended Kalman filter
+* @date 2025-05-27
+*
+* Build on the host from the repository root:
+*   cc -O2 -IInclude/Programs/VectorND -IDependencies/cmsis-dsp/Include -o ekf_bench \
+*      Tools/ekf_bench.c Src/Programs/VectorND/ekf.c -lm
+*
+* Usage:
+*   ekf_bench [iterations]   Time predict and update for a range of sizes.
+*
+* Before timing, a random filter is run against a double precision
+* textbook Kalman filter that inverts the innovation covariance, and the
+* largest covariance difference is printed. On the device
+* "hw_stats ekf" runs the same benchmark.
+*/
+
+#include "ekf.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define N EKF_MAX_STATE
+#define M EKF_MAX_MEASUREMENT
+
+static uint32_t tool_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (((uint64_t) ts.tv_sec * 1000000u) + ((uint64_t) ts.tv_nsec / 1000u));
+}
+
+static uint32_t tool_seed = 12345;
+
+static double tool_random(void) {
+    tool_seed = (tool_seed * 1103515245u) + 12345u;
+    return ((double) ((tool_seed >> 8) & 0xFFFF) / 32768.0) - 1.0;
+}
+
+static float tool_F[N * N];
+
+static void tool_transition(void* context, const float* x, float dt, float* x_next, float* jacobian) {
+    uint8_t n = *(const uint8_t*) context;
+    (void) dt;
+
+    for (uint8_t i = 0; i < n; i++) {
+        x_next[i] = 0.0f;
+        for (uint8_t j = 0; j < n; j++) {
+            x_next[i] += tool_F[(i * n) + j] * x[j];
+            jacobian[(i * n) + j] = tool_F[(i * n) + j];
+        }
+    }
+}
+
+/* Solve A X = B in place for X by Gauss-Jordan with partial pivoting, B has cols columns */
+static void tool_solve(double* A, double* B, int n, int cols) {
+    for (int c = 0; c < n; c++) {
+        int pivot = c;
+        for (int r = c + 1; r < n; r++) {
+            if (fabs(A[(r * n) + c]) > fabs(A[(pivot * n) + c])) {
+                pivot = r;
+            }
+        }
+        for (int k = 0; k < n; k++) {
+            double t = A[(c * n) + k]; A[(c * n) + k] = A[(pivot * n) + k]; A[(pivot * n) + k] = t;
+        }
+        for (int k = 0; k < cols; k++) {
+            double t = B[(c * cols) + k]; B[(c * cols) + k] = B[(pivot * cols) + k]; B[(pivot * cols) + k] = t;
+        }
+        for (int r = 0; r < n; r++) {
+            if (r == c) {
+                continue;
+            }
+            double f = A[(r * n) + c] / A[(c * n) + c];
+            for (int k = 0; k < n; k++) {
+                A[(r * n) + k] -= f * A[(c * n) + k];
+            }
+            for (int k = 0; k < cols; k++) {
+                B[(r * cols) + k] -= f * B[(c * cols) + k];
+            }
+        }
+    }
+    for (int r = 0; r < n; r++) {
+        for (int k = 0; k < cols; k++) {
+            B[(r * cols) + k] /= A[(r * n) + r];
+        }
+    }
+}
+
+/* Textbook filter: K = P H' (H P H' + R)^-1, P = (I - K H) P */
+static void tool_reference(uint8_t n, uint8_t m, double* x, double* P, const double* Q, double dt,
+                           const double* H, const double* R, const double* y) {
+    double FP[N * N], next[N * N];
+    double S[M * M], PHt[N * M], K[N * M], KH[N * N];
+
+    for (int i = 0; i < n; i++) {
+        double xi = 0.0;
+        for (int j = 0; j < n; j++) {
+            xi += tool_F[(i * n) + j] * x[j];
+        }
+        next[i] = xi;
+    }
+    for (int i = 0; i < n; i++) {
+        x[i] = next[i];
+    }
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            FP[(i * n) + j] = 0.0;
+            for (int k = 0; k < n; k++) {
+                FP[(i * n) + j] += tool_F[(i * n) + k] * P[(k * n) + j];
+            }
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double sum = Q[(i * n) + j] * dt;
+            for (int k = 0; k < n; k++) {
+                sum += FP[(i * n) + k] * tool_F[(j * n) + k];
+            }
+            P[(i * n) + j] = sum;
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+            PHt[(i * m) + j] = 0.0;
+            for (int k = 0; k < n; k++) {
+                PHt[(i * m) + j] += P[(i * n) + k] * H[(j * n) + k];
+            }
+        }
+    }
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < m; j++) {
+            S[(i * m) + j] = R[(i * m) + j];
+            for (int k = 0; k < n; k++) {
+                S[(i * m) + j] += H[(i * n) + k] * PHt[(k * m) + j];
+            }
+        }
+    }
+
+    // K' = S^-1 (P H')', S is symmetric
+    double Kt[M * N];
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            Kt[(i * n) + j] = PHt[(j * m) + i];
+        }
+    }
+    tool_solve(S, Kt, m, n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+            K[(i * m) + j] = Kt[(j * n) + i];
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < m; j++) {
+            x[i] += K[(i * m) + j] * y[j];
+        }
+        for (int j = 0; j < n; j++) {
+            KH[(i * n) + j] = (i == j) ? 1.0 : 0.0;
+            for (int k = 0; k < m; k++) {
+                KH[(i * n) + j] -= K[(i * m) + k] * H[(k * n) + j];
+            }
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            next[(i * n) + j] = 0.0;
+            for (int k = 0; k < n; k++) {
+                next[(i * n) + j] += KH[(i * n) + k] * P[(k * n) + j];
+            }
+        }
+    }
+    for (int i = 0; i < n * n; i++) {
+        P[i] = next[i];
+    }
+}
+
+static int tool_check(uint8_t n, uint8_t m, int cycles) {
+    static Ekf ekf;
+    float p0[N], q[N], Hf[M * N], Rf[EKF_SYM_SIZE(M)], yf[M];
+    double x[N] = {0}, P[N * N] = {0}, Q[N * N] = {0}, H[M * N], R[M * M] = {0}, y[M];
+    const double dt = 0.01;
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            tool_F[(i * n) + j] = (float) (((i == j) ? 1.0 : 0.0) + 0.05 * tool_random());
+        }
+        p0[i] = 1.0f;
+        q[i] = 0.5f;
+        P[(i * n) + i] = 1.0;
+        Q[(i * n) + i] = 0.5;
+    }
+
+    for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+            Hf[(i * n) + j] = (float) tool_random();
+            H[(i * n) + j] = Hf[(i * n) + j];
+        }
+        R[(i * m) + i] = 0.1;
+        if (i > 0) {
+            R[(i * m) + i - 1] = R[((i - 1) * m) + i] = 0.03;
+        }
+        for (int j = 0; j <= i; j++) {
+            Rf[EKF_SYM_INDEX(i, j)] = (float) R[(i * m) + j];
+        }
+    }
+
+    ekf_init(&ekf, n, NULL, p0, q, tool_transition, &n);
+
+    double covariance_error = 0.0;
+
+    for (int c = 0; c < cycles; c++) {
+        ekf_predict(&ekf, (float) dt);
+
+        // Innovations against the predicted measurement of a slowly moving truth
+        for (int i = 0; i < m; i++) {
+            double predicted = 0.0;
+            for (int j = 0; j < n; j++) {
+                predicted += H[(i * n) + j] * ekf.x[j];
+            }
+            y[i] = sin(c * 0.1 + i) - predicted;
+            yf[i] = (float) y[i];
+        }
+
+        if (ekf_update(&ekf, m, yf, Hf, Rf) != VECTOR_SUCCESS) {
+            printf("n=%u m=%u: update failed\n", n, m);
+            return 1;
+        }
+
+        // The covariance of a linear model does not depend on the state, so the
+        // reference runs on its own state and only the covariances are compared
+        tool_reference(n, m, x, P, Q, dt, H, R, y);
+    }
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+            double diff = fabs(ekf_get_covariance(&ekf, (uint8_t) i, (uint8_t) j) - P[(i * n) + j]);
+            if (diff > covariance_error) {
+                covariance_error = diff;
+            }
+        }
+    }
+
+    printf("n=%-2u m=%u  covariance error %.2g after %d cycles\n", n, m, covariance_error, cycles);
+    return (covariance_error < 1e-3) ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = (argc > 1) ? (uint32_t) atoi(argv[1]) : 20000;
+    static const uint8_t sizes[][2] = {{2, 1}, {4, 2}, {6, 3}, {9, 3}, {12, 6}, {16, 4}, {16, 8}};
+    int failures = 0;
+
+    failures += tool_check(4, 2, 100);
+    failures += tool_check(9, 3, 100);
+    failures += tool_check(16, 8, 100);
+
+    printf("\n  n  m   predict ns   update ns   cycles/s   healthy\n");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        EkfBench bench;
+        if (ekf_benchmark(sizes[i][0], sizes[i][1], iterations, tool_now_us, &bench) != VECTOR_SUCCESS) {
+            printf("%3u %2u  failed\n", sizes[i][0], sizes[i][1]);
+            failures++;
+            continue;
+        }
+
+        double cycle_ns = (double) bench.predict_ns + bench.update_ns;
+        printf("%3u %2u  %11u %11u %10.0f   %s\n", bench.n, bench.m, bench.predict_ns, bench.update_ns,
+            (cycle_ns > 0.0) ? 1e9 / cycle_ns : 0.0, bench.healthy ? "yes" : "NO");
+    }
+
+    return (failures == 0) ? 0 : 1;
+}
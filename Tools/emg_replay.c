@@ -0,0 +1,173 @@
+/**
+* @file emg_replay.c
+* @brief Host replay of recorded EMG through emg_pipeline
+* @date 2025-05-27
+*
+* Build on the host from the repository root, against the CMSIS-DSP sources:
+*   DSP=Dependencies/cmsis-dsp/Source
+*   cc -O2 -D__GNUC_PYTHON__ -IInclude/Kernel/Manager -IDependencies/cmsis-dsp/Include \
+*      -IDependencies/cmsis-dsp/PrivateInclude -o emg_replay Tools/emg_replay.c \
+*      Src/Kernel/Manager/emg_pipeline.c Src/Kernel/Manager/filter_design.c \
+*      $DSP/FilteringFunctions/arm_biquad_cascade_df2T_f32.c \
+*      $DSP/FilteringFunctions/arm_biquad_cascade_df2T_init_f32.c \
+*      $DSP/BasicMathFunctions/arm_abs_f32.c \
+*      $DSP/StatisticsFunctions/arm_power_f32.c \
+*      $DSP/StatisticsFunctions/arm_mean_f32.c -lm
+*
+* Usage:
+*   emg_replay [-r rate_hz] [-c channels] [-m] [file]
+*
+* The input (stdin if no file) is CSV with one row per sample and one
+* column per channel, in volts. Lines starting with '#' and lines without
+* a number, such as a header, are skipped. -m selects the MAV envelope.
+* Prints one CSV row per block with the envelopes, activations and grasp
+* level, then a summary with the processing cost per sample and the
+* margin against real time at the given rate.
+*/
+
+#include "emg_pipeline.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static double tool_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec * 1e6) + ((double) ts.tv_nsec / 1e3);
+}
+
+/**
+ * @brief Parse one CSV row, returns the number of values read
+ */
+static int tool_parse_row(const char* line, float* values, int max) {
+    int count = 0;
+    const char* p = line;
+
+    while (count < max && *p != '\0') {
+        char* end;
+        float value = strtof(p, &end);
+
+        if (end == p) {
+            break;
+        }
+
+        values[count++] = value;
+        p = end;
+        while (*p == ',' || *p == ' ' || *p == '\t' || *p == ';') {
+            p++;
+        }
+    }
+
+    return count;
+}
+
+int main(int argc, char** argv) {
+    static emg_pipeline_t pipeline;
+    emg_pipeline_config_t config;
+    float blocks[EMG_PIPELINE_MAX_CHANNELS][EMG_PIPELINE_BLOCK];
+    float row[EMG_PIPELINE_MAX_CHANNELS];
+    const char* path = NULL;
+    int channels = 1;
+    int fill = 0;
+    unsigned long samples = 0;
+    unsigned long block_count = 0;
+    double busy_us = 0.0;
+    char line[1024];
+
+    emg_pipeline_get_default_config(&config);
+    config.sample_rate_hz = 2000.0f;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            config.sample_rate_hz = strtof(argv[++i], NULL);
+        }
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            channels = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-m") == 0) {
+            config.envelope = EMG_ENVELOPE_MAV;
+        }
+        else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [-r rate_hz] [-c channels] [-m] [file]\n", argv[0]);
+            return 1;
+        }
+        else {
+            path = argv[i];
+        }
+    }
+
+    if (channels < 1 || channels > EMG_PIPELINE_MAX_CHANNELS) {
+        fprintf(stderr, "channels must be 1 to %d\n", EMG_PIPELINE_MAX_CHANNELS);
+        return 1;
+    }
+
+    if (!emg_pipeline_init(&pipeline, &config, (uint8_t) channels)) {
+        fprintf(stderr, "invalid configuration for %.0f Hz\n", (double) config.sample_rate_hz);
+        return 1;
+    }
+
+    FILE* in = (path != NULL) ? fopen(path, "r") : stdin;
+    if (in == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    printf("time_s");
+    for (int c = 0; c < channels; c++) {
+        printf(",envelope%d,activation%d", c, c);
+    }
+    printf(",grasp\n");
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (line[0] == '#' || tool_parse_row(line, row, channels) < channels) {
+            continue;
+        }
+
+        for (int c = 0; c < channels; c++) {
+            blocks[c][fill] = row[c];
+        }
+        samples++;
+
+        if (++fill < EMG_PIPELINE_BLOCK) {
+            continue;
+        }
+        fill = 0;
+
+        double start = tool_now_us();
+        for (int c = 0; c < channels; c++) {
+            emg_pipeline_process(&pipeline, (uint8_t) c, blocks[c]);
+        }
+        float grasp = emg_pipeline_update_grasp(&pipeline);
+        busy_us += tool_now_us() - start;
+        block_count++;
+
+        printf("%.4f", (double) samples / (double) config.sample_rate_hz);
+        for (int c = 0; c < channels; c++) {
+            printf(",%.6f,%.4f", (double) pipeline.channel[c].envelope, (double) pipeline.channel[c].activation);
+        }
+        printf(",%.4f\n", (double) grasp);
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    if (block_count == 0) {
+        fprintf(stderr, "no complete %d sample block in the input\n", EMG_PIPELINE_BLOCK);
+        return 1;
+    }
+
+    // Cost per sample of every channel against the time one sample period allows
+    double us_per_sample = busy_us / (double) (block_count * EMG_PIPELINE_BLOCK);
+    double period_us = 1e6 / (double) config.sample_rate_hz;
+
+    fprintf(stderr, "%lu samples x %d channels, %lu blocks at %.0f Hz (%s)\n",
+        samples, channels, block_count, (double) config.sample_rate_hz,
+        (config.envelope == EMG_ENVELOPE_MAV) ? "MAV" : "RMS");
+    fprintf(stderr, "%.3f us/sample for all channels, %.1fx real time, %.2f%% of a %.0f us sample period\n",
+        us_per_sample, period_us / us_per_sample, 100.0 * us_per_sample / period_us, period_us);
+
+    return 0;
+}
@@ -0,0 +1,284 @@
+/**
+* @file linalg_check.c
+* @brief Host check of the VectorND linear solvers against double precision references
+* @date 2025-05-27
+*
+* Build on the host from the repository root, against the CMSIS-DSP sources:
+*   DSP=Dependencies/cmsis-dsp/Source
+*   cc -O2 -D__GNUC_PYTHON__ -IInclude/Programs/VectorND -IDependencies/cmsis-dsp/Include \
+*      -IDependencies/cmsis-dsp/PrivateInclude -o linalg_check Tools/linalg_check.c \
+*      Src/Programs/VectorND/matrix_solve.c Src/Programs/VectorND/vector_math.c \
+*      $DSP/BasicMathFunctions/arm_add_f32.c $DSP/BasicMathFunctions/arm_sub_f32.c \
+*      $DSP/BasicMathFunctions/arm_scale_f32.c $DSP/BasicMathFunctions/arm_dot_prod_f32.c -lm
+*
+* Usage:
+*   linalg_check [max_n]   Check sizes up to max_n (default 48).
+*
+* Runs matrix_solve_self_test(), then for random systems of growing size
+* compares each factorization, blocked and unblocked, with a solution and
+* determinant computed in double precision, and reports the time of each
+* factorization. Exits non-zero if a relative error exceeds the bound.
+* On the device "hw_stats linalg" runs the self test.
+*/
+
+#include "matrix_solve.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TOOL_TOLERANCE 1e-3
+
+static uint32_t tool_seed = 12345;
+
+static double tool_random(void) {
+    tool_seed = (tool_seed * 1103515245u) + 12345u;
+    return ((double) ((tool_seed >> 8) & 0xFFFF) / 32768.0) - 1.0;
+}
+
+static double tool_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec * 1e6) + ((double) ts.tv_nsec / 1e3);
+}
+
+/* Gaussian elimination with partial pivoting in double, returns the determinant */
+static double tool_reference_solve(double* a, double* b, int n) {
+    double determinant = 1.0;
+
+    for (int k = 0; k < n; k++) {
+        int pivot = k;
+        for (int i = k + 1; i < n; i++) {
+            if (fabs(a[(i * n) + k]) > fabs(a[(pivot * n) + k])) {
+                pivot = i;
+            }
+        }
+        if (pivot != k) {
+            for (int j = 0; j < n; j++) {
+                double t = a[(k * n) + j]; a[(k * n) + j] = a[(pivot * n) + j]; a[(pivot * n) + j] = t;
+            }
+            double t = b[k]; b[k] = b[pivot]; b[pivot] = t;
+            determinant = -determinant;
+        }
+        determinant *= a[(k * n) + k];
+        for (int i = k + 1; i < n; i++) {
+            double f = a[(i * n) + k] / a[(k * n) + k];
+            for (int j = k; j < n; j++) {
+                a[(i * n) + j] -= f * a[(k * n) + j];
+            }
+            b[i] -= f * b[k];
+        }
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        for (int j = i + 1; j < n; j++) {
+            b[i] -= a[(i * n) + j] * b[j];
+        }
+        b[i] /= a[(i * n) + i];
+    }
+
+    return determinant;
+}
+
+static double tool_error(const float* actual, const double* expected, int n) {
+    double error = 0.0;
+    double scale = 0.0;
+
+    for (int i = 0; i < n; i++) {
+        error = fmax(error, fabs((double) actual[i] - expected[i]));
+        scale = fmax(scale, fabs(expected[i]));
+    }
+
+    return error / ((scale > 0.0) ? scale : 1.0);
+}
+
+static Matrix tool_matrix;
+static Vector tool_vector;
+static Vector tool_solution;
+
+/* Factor and solve with one method, returning the relative error and the factorization time */
+static double tool_run(const char* name, const float* a, const float* b, int rows, int cols, const double* expected,
+                       double* us) {
+    static uint16_t pivots[1024];
+    static float tau[1024];
+    VectorError err = VECTOR_SUCCESS;
+
+    memcpy(tool_matrix.data, a, (size_t) rows * cols * sizeof(float));
+    memcpy(tool_vector.data, b, (size_t) rows * sizeof(float));
+    tool_matrix.rows = (uint16_t) rows;
+    tool_matrix.cols = (uint16_t) cols;
+    tool_vector.dim = (uint16_t) rows;
+    tool_solution.dim = (uint16_t) cols;
+
+    double start = tool_now_us();
+    if (strcmp(name, "lu") == 0) {
+        err = matrix_lu_decompose(&tool_matrix, pivots, NULL);
+    } else if (strcmp(name, "lu-blocked") == 0) {
+        err = matrix_lu_decompose_blocked(&tool_matrix, pivots, NULL, 8);
+    } else if (strcmp(name, "cholesky") == 0) {
+        err = matrix_cholesky_decompose(&tool_matrix);
+    } else if (strcmp(name, "chol-blocked") == 0) {
+        err = matrix_cholesky_decompose_blocked(&tool_matrix, 8);
+    } else {
+        err = matrix_qr_decompose(&tool_matrix, tau);
+    }
+    *us = tool_now_us() - start;
+
+    if (err == VECTOR_SUCCESS) {
+        if (strncmp(name, "lu", 2) == 0) {
+            err = matrix_lu_solve(&tool_matrix, pivots, &tool_vector);
+        } else if (strncmp(name, "ch", 2) == 0) {
+            err = matrix_cholesky_solve(&tool_matrix, &tool_vector);
+        } else {
+            err = matrix_qr_solve(&tool_solution, &tool_matrix, tau, &tool_vector, NULL);
+        }
+    }
+
+    if (err != VECTOR_SUCCESS) {
+        printf("  %s: %s\n", name, vector_error_string(err));
+        return INFINITY;
+    }
+
+    return tool_error((strcmp(name, "qr") == 0) ? tool_solution.data : tool_vector.data, expected, cols);
+}
+
+int main(int argc, char** argv) {
+    int max_n = (argc > 1) ? atoi(argv[1]) : 48;
+    int failures = 0;
+
+    if (max_n < 2 || max_n > 512) {
+        fprintf(stderr, "usage: %s [max_n], 2 to 512\n", argv[0]);
+        return 1;
+    }
+
+    float self_error;
+    VectorError err = matrix_solve_self_test(&self_error);
+    printf("self test: %s, max relative error %.2g\n", vector_error_string(err), (double) self_error);
+    failures += (err != VECTOR_SUCCESS);
+
+    int rows_max = max_n + max_n / 2;
+    matrix_init(&tool_matrix, (uint16_t) rows_max, (uint16_t) max_n, true);
+    vector_init(&tool_vector, (uint16_t) rows_max, true);
+    vector_init(&tool_solution, (uint16_t) max_n, true);
+
+    float* a = malloc((size_t) rows_max * max_n * sizeof(float));
+    float* b = malloc((size_t) rows_max * sizeof(float));
+    double* ad = malloc((size_t) rows_max * rows_max * sizeof(double));
+    double* bd = malloc((size_t) rows_max * sizeof(double));
+
+    printf("\n  n   method        rel error    factor us\n");
+
+    for (int n = 2; n <= max_n; n = (n < 8) ? n + 1 : n * 2) {
+        // General system, diagonally weighted so the float solve is well conditioned
+        for (int i = 0; i < n * n; i++) {
+            a[i] = (float) tool_random();
+        }
+        for (int i = 0; i < n; i++) {
+            a[(i * n) + i] += 2.0f;
+            b[i] = (float) tool_random();
+        }
+
+        for (int i = 0; i < n * n; i++) {
+            ad[i] = a[i];
+        }
+        for (int i = 0; i < n; i++) {
+            bd[i] = b[i];
+        }
+        double determinant = tool_reference_solve(ad, bd, n);
+
+        static const char* const square[] = {"lu", "lu-blocked"};
+        for (int m = 0; m < 2; m++) {
+            double us;
+            double error = tool_run(square[m], a, b, n, n, bd, &us);
+            printf("%3d   %-12s  %10.2g  %11.1f\n", n, square[m], error, us);
+            failures += !(error < TOOL_TOLERANCE);
+        }
+
+        // Determinant, relative to the reference, while it fits a float
+        Matrix det_matrix;
+        Unit unit;
+        float det = 0.0f;
+        matrix_init(&det_matrix, (uint16_t) n, (uint16_t) n, true);
+        memcpy(det_matrix.data, a, (size_t) n * n * sizeof(float));
+        if (fabs(determinant) > 1e37) {
+            printf("%3d   %-12s  %10s\n", n, "determinant", "overflow");
+        } else if (matrix_determinant(&det_matrix, &det, &unit) == VECTOR_SUCCESS) {
+            double error = fabs((double) det - determinant) / fabs(determinant);
+            printf("%3d   %-12s  %10.2g\n", n, "determinant", error);
+            failures += !(error < TOOL_TOLERANCE);
+            unit_free(&unit);
+        } else {
+            failures++;
+        }
+        matrix_free(&det_matrix);
+
+        // Symmetric positive definite A' A + I, same reference solver
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                double sum = (i == j) ? 1.0 : 0.0;
+                for (int k = 0; k < n; k++) {
+                    sum += (double) a[(k * n) + i] * a[(k * n) + j];
+                }
+                ad[(i * n) + j] = sum;
+            }
+        }
+        float* spd = malloc((size_t) n * n * sizeof(float));
+        for (int i = 0; i < n * n; i++) {
+            spd[i] = (float) ad[i];
+            ad[i] = spd[i];
+        }
+        for (int i = 0; i < n; i++) {
+            bd[i] = b[i];
+        }
+        tool_reference_solve(ad, bd, n);
+
+        static const char* const symmetric[] = {"cholesky", "chol-blocked"};
+        for (int m = 0; m < 2; m++) {
+            double us;
+            double error = tool_run(symmetric[m], spd, b, n, n, bd, &us);
+            printf("%3d   %-12s  %10.2g  %11.1f\n", n, symmetric[m], error, us);
+            failures += !(error < TOOL_TOLERANCE);
+        }
+        free(spd);
+
+        // Least squares with 1.5 n rows, reference from the normal equations in double
+        int rows = n + n / 2;
+        for (int i = 0; i < rows * n; i++) {
+            a[i] = (float) tool_random();
+        }
+        for (int i = 0; i < rows; i++) {
+            b[i] = (float) tool_random();
+        }
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                double sum = 0.0;
+                for (int k = 0; k < rows; k++) {
+                    sum += (double) a[(k * n) + i] * a[(k * n) + j];
+                }
+                ad[(i * n) + j] = sum;
+            }
+            double sum = 0.0;
+            for (int k = 0; k < rows; k++) {
+                sum += (double) a[(k * n) + i] * b[k];
+            }
+            bd[i] = sum;
+        }
+        tool_reference_solve(ad, bd, n);
+
+        double us;
+        double error = tool_run("qr", a, b, rows, n, bd, &us);
+        printf("%3d   %-12s  %10.2g  %11.1f\n", n, "qr", error, us);
+        failures += !(error < TOOL_TOLERANCE);
+    }
+
+    printf("\n%d failures\n", failures);
+
+    free(a);
+    free(b);
+    free(ad);
+    free(bd);
+    matrix_free(&tool_matrix);
+    vector_free(&tool_vector);
+    vector_free(&tool_solution);
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,328 @@
+/**
+* @file nn_tool.c
+* @brief Host reference runner and blob builder for nn_engine models
+* @date 2025-05-27
+*
+* Build on the host from the repository root, with the reference kernels:
+*   cc -O2 -DNN_ENGINE_REFERENCE -IInclude/Kernel/Manager -o nn_tool Tools/nn_tool.c Src/Kernel/Manager/nn_engine.c -lm
+*
+* Usage:
+*   nn_tool demo <out.bin> [length channels classes]
+*                               Write a model with random weights and a test vector, to
+*                               try the flash loading, budget and self test on a board.
+*   nn_tool check <blob>        Validate a blob, print its plan and run its test vector.
+*   nn_tool run <blob> [csv] [hop]
+*                               Classify windows of CSV feature rows (stdin if no file),
+*                               one row per time step and one column per feature.
+*
+* The reference kernels give the same integers as the CMSIS-DSP ones, so
+* the test vector written here must match on the device bit for bit,
+* which "gesture selftest" checks.
+*/
+
+#include "nn_engine.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TOOL_MAX_BLOB   (256 * 1024)
+#define TOOL_ARENA      (64 * 1024)
+
+static uint8_t tool_blob[TOOL_MAX_BLOB];
+static uint8_t __attribute__((aligned(4))) tool_arena[TOOL_ARENA];
+static uint32_t tool_seed = 12345;
+
+static int32_t tool_random(int32_t low, int32_t high) {
+    tool_seed = (tool_seed * 1103515245u) + 12345u;
+    return low + (int32_t) ((tool_seed >> 8) % (uint32_t) (high - low + 1));
+}
+
+static size_t tool_load(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return 0;
+    }
+
+    size_t len = fread(tool_blob, 1, sizeof(tool_blob), f);
+    fclose(f);
+    return len;
+}
+
+/**
+ * @brief Split a real multiplier into a Q31 mantissa and a shift
+ */
+static void tool_multiplier(double real, int32_t* multiplier, int32_t* shift) {
+    int exponent;
+    double mantissa = frexp(real, &exponent);
+    int64_t q = (int64_t) llround(mantissa * 2147483648.0);
+
+    if (q == 2147483648LL) {
+        q /= 2;
+        exponent++;
+    }
+
+    *multiplier = (int32_t) q;
+    *shift = exponent;
+}
+
+/**
+ * @brief Append weights and folded biases for one layer
+ */
+static size_t tool_weights(nn_engine_layer_t* layer, size_t pos, uint32_t window, int32_t input_zero_point) {
+    layer->weights_offset = (uint32_t) pos;
+
+    for (uint32_t i = 0; i < (uint32_t) layer->out_channels * window; i++) {
+        tool_blob[pos++] = (uint8_t) (int8_t) tool_random(-64, 64);
+    }
+
+    pos = (pos + 3u) & ~(size_t) 3u;
+    layer->bias_offset = (uint32_t) pos;
+
+    const int8_t* weights = (const int8_t*) &tool_blob[layer->weights_offset];
+    for (uint32_t o = 0; o < layer->out_channels; o++) {
+        int32_t sum = 0;
+        for (uint32_t i = 0; i < window; i++) {
+            sum += weights[(o * window) + i];
+        }
+
+        int32_t bias = tool_random(-2000, 2000) - (input_zero_point * sum);
+        memcpy(&tool_blob[pos], &bias, sizeof(bias));
+        pos += sizeof(bias);
+    }
+
+    // Output spread of about 30 steps for inputs and weights spread over about 40
+    tool_multiplier(30.0 / (sqrt((double) window) * 40.0 * 37.0), &layer->multiplier, &layer->shift);
+
+    return pos;
+}
+
+static int tool_demo(const char* path, uint16_t length, uint16_t channels, uint16_t classes) {
+    nn_engine_header_t header = {0};
+    nn_engine_layer_t layers[4];
+    size_t pos = sizeof(header) + sizeof(layers);
+
+    if (length < 9 || channels == 0 || classes < 2) {
+        fprintf(stderr, "length must be at least 9, channels at least 1, classes at least 2\n");
+        return 1;
+    }
+
+    memset(tool_blob, 0, sizeof(tool_blob));
+    memset(layers, 0, sizeof(layers));
+
+    header.magic = NN_ENGINE_MAGIC;
+    header.version = NN_ENGINE_VERSION;
+    header.layer_count = 4;
+    header.input_length = length;
+    header.input_channels = channels;
+    header.input_scale = 0.05f;
+    header.input_zero_point = 0;
+
+    // Two strided convolutions, a dense classifier and softmax
+    uint16_t t1 = (uint16_t) (((length - 5u) / 2u) + 1u);
+    uint16_t t2 = (uint16_t) (((t1 - 3u) / 2u) + 1u);
+
+    layers[0] = (nn_engine_layer_t) {.type = NN_LAYER_CONV1D, .relu = 1, .out_channels = 16, .kernel = 5, .stride = 2,
+                                     .output_zero_point = -20, .output_scale = 0.02f};
+    layers[1] = (nn_engine_layer_t) {.type = NN_LAYER_CONV1D, .relu = 1, .out_channels = 16, .kernel = 3, .stride = 2,
+                                     .output_zero_point = -20, .output_scale = 0.02f};
+    layers[2] = (nn_engine_layer_t) {.type = NN_LAYER_DENSE, .out_channels = classes, .kernel = 1, .stride = 1,
+                                     .output_zero_point = 0, .output_scale = 0.1f};
+    layers[3] = (nn_engine_layer_t) {.type = NN_LAYER_SOFTMAX, .out_channels = classes, .output_zero_point = -128,
+                                     .output_scale = 1.0f / 256.0f};
+
+    pos = tool_weights(&layers[0], pos, 5u * channels, header.input_zero_point);
+    pos = tool_weights(&layers[1], pos, 3u * 16u, layers[0].output_zero_point);
+    pos = tool_weights(&layers[2], pos, (uint32_t) t2 * 16u, layers[1].output_zero_point);
+
+    layers[3].weights_offset = (uint32_t) pos;
+    for (int d = 0; d < NN_ENGINE_SOFTMAX_TABLE; d++) {
+        uint16_t e = (uint16_t) lround(32767.0 * exp(-d * (double) layers[2].output_scale));
+        memcpy(&tool_blob[pos], &e, sizeof(e));
+        pos += sizeof(e);
+    }
+
+    // Test vector input, the expected output is filled in by the reference run below
+    header.test_offset = (uint32_t) pos;
+    for (uint32_t i = 0; i < (uint32_t) length * channels; i++) {
+        tool_blob[pos++] = (uint8_t) (int8_t) tool_random(-100, 100);
+    }
+    size_t expected = pos;
+    pos += classes;
+
+    header.size = (uint32_t) pos;
+    memcpy(tool_blob + sizeof(header), layers, sizeof(layers));
+    memcpy(tool_blob, &header, sizeof(header));
+
+    nn_engine_t engine;
+    for (int pass = 0; pass < 2; pass++) {
+        header.crc32 = nn_engine_crc32(tool_blob + sizeof(header), header.size - sizeof(header));
+        memcpy(tool_blob, &header, sizeof(header));
+
+        if (!nn_engine_load(&engine, tool_blob, pos, tool_arena, sizeof(tool_arena))) {
+            fprintf(stderr, "demo model failed validation\n");
+            return 1;
+        }
+
+        if (pass == 0) {
+            memcpy(nn_engine_input(&engine), &tool_blob[header.test_offset], (size_t) length * channels);
+            nn_engine_run(&engine, NULL, 0);
+            memcpy(&tool_blob[expected], nn_engine_output(&engine, NULL), classes);
+        }
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (f == NULL || fwrite(tool_blob, 1, pos, f) != pos) {
+        perror(path);
+        return 1;
+    }
+    fclose(f);
+
+    printf("%s: %zu bytes, %ux%u input, %u classes, %u MACs, %zu arena bytes\n",
+        path, pos, length, channels, classes, engine.macs, engine.arena_used);
+    return 0;
+}
+
+static int tool_check(const char* path) {
+    size_t len = tool_load(path);
+    nn_engine_t engine;
+
+    if (len == 0 || !nn_engine_load(&engine, tool_blob, len, tool_arena, sizeof(tool_arena))) {
+        fprintf(stderr, "%s: invalid model\n", path);
+        return 1;
+    }
+
+    static const char* const names[] = {"?", "dense", "conv1d", "relu", "softmax"};
+
+    printf("%u bytes, crc32 %08x, input %ux%u scale %g zero %d\n", engine.header->size, engine.header->crc32,
+        engine.header->input_length, engine.header->input_channels, (double) engine.header->input_scale,
+        engine.header->input_zero_point);
+
+    for (uint16_t i = 0; i < engine.header->layer_count; i++) {
+        const nn_engine_layer_t* layer = &engine.layers[i];
+
+        printf("  %-2u %-8s %3ux%-3u -> %3ux%-3u at arena %5u%s\n", i, names[layer->type <= 4 ? layer->type : 0],
+            engine.shapes[i].length, engine.shapes[i].channels, engine.shapes[i + 1].length,
+            engine.shapes[i + 1].channels, engine.offsets[i + 1], layer->relu ? ", relu" : "");
+    }
+
+    printf("%u MACs, %zu arena bytes\n", engine.macs, engine.arena_used);
+
+    uint32_t mismatches = 0;
+    int result = nn_engine_self_test(&engine, &mismatches);
+    if (result < 0) {
+        printf("no test vector\n");
+        return 0;
+    }
+
+    printf("test vector %s, %u mismatched outputs\n", (result == 1) ? "passed" : "FAILED", mismatches);
+    return (result == 1) ? 0 : 1;
+}
+
+static int tool_run(const char* path, const char* csv, int hop) {
+    size_t len = tool_load(path);
+    nn_engine_t engine;
+
+    if (len == 0 || !nn_engine_load(&engine, tool_blob, len, tool_arena, sizeof(tool_arena))) {
+        fprintf(stderr, "%s: invalid model\n", path);
+        return 1;
+    }
+
+    uint32_t length = engine.header->input_length;
+    uint32_t channels = engine.header->input_channels;
+    float* rows = calloc((size_t) length * channels, sizeof(float));
+    FILE* in = (csv != NULL) ? fopen(csv, "r") : stdin;
+    uint32_t filled = 0;
+    uint32_t since = 0;
+    unsigned long row = 0;
+    char line[1024];
+
+    if (rows == NULL || in == NULL) {
+        perror(csv);
+        return 1;
+    }
+
+    if (hop <= 0) {
+        hop = (int) ((length + 1u) / 2u);
+    }
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        float values[64];
+        uint32_t count = 0;
+        char* p = line;
+
+        if (line[0] == '#') {
+            continue;
+        }
+
+        while (count < channels && count < 64) {
+            char* end;
+            values[count] = strtof(p, &end);
+            if (end == p) {
+                break;
+            }
+            count++;
+            p = end + strspn(end, ",; \t");
+        }
+
+        if (count < channels) {
+            continue;
+        }
+
+        // Slide by one row, oldest first as on the device
+        memmove(rows, rows + channels, (size_t) (length - 1u) * channels * sizeof(float));
+        memcpy(rows + ((size_t) (length - 1u) * channels), values, channels * sizeof(float));
+        row++;
+
+        if (filled < length) {
+            filled++;
+        }
+
+        if (filled < length || ++since < (uint32_t) hop) {
+            continue;
+        }
+        since = 0;
+
+        nn_engine_quantize_input(&engine, rows);
+        nn_engine_run(&engine, NULL, 0);
+
+        uint32_t outputs;
+        const int8_t* out = nn_engine_output(&engine, &outputs);
+        int8_t best;
+        int gesture = nn_engine_argmax(&engine, &best);
+
+        printf("%lu,%d", row, gesture);
+        for (uint32_t i = 0; i < outputs; i++) {
+            printf(",%d", out[i]);
+        }
+        printf("\n");
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    free(rows);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "demo") == 0) {
+        uint16_t length = (argc > 3) ? (uint16_t) atoi(argv[3]) : 50;
+        uint16_t channels = (argc > 4) ? (uint16_t) atoi(argv[4]) : 8;
+        uint16_t classes = (argc > 5) ? (uint16_t) atoi(argv[5]) : 4;
+        return tool_demo(argv[2], length, channels, classes);
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "check") == 0) {
+        return tool_check(argv[2]);
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "run") == 0) {
+        return tool_run(argv[2], (argc > 3) ? argv[3] : NULL, (argc > 4) ? atoi(argv[4]) : 0);
+    }
+
+    fprintf(stderr, "usage: %s demo <out.bin> [length channels classes] | check <blob> | run <blob> [csv] [hop]\n", argv[0]);
+    return 1;
+}
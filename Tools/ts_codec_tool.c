@@ -0,0 +1,218 @@
+/**
+* @file ts_codec_tool.c
+* @brief Host decoder and benchmark for ts_codec streams
+* @date 2025-05-27
+*
+* Build on the host from the repository root:
+*   cc -O2 -IInclude/Kernel/Manager -o ts_codec_tool Tools/ts_codec_tool.c Src/Kernel/Manager/ts_codec.c -lm
+*
+* Usage:
+*   ts_codec_tool decode [file]   Decode the output of "blackbox dump" (stdin if no file) to CSV.
+*   ts_codec_tool bench [n]       Compress n synthetic samples and report ratio and us/sample.
+*
+* A dump is lines of "offset:hex". A line starting with '#' can carry
+* "stream=<offset>" and "count=<samples>" to locate the stream in the dump
+* and stop after the last sample.
+*/
+
+#include "ts_codec.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TOOL_MAX_DUMP (1024 * 1024)
+
+static double tool_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec * 1e6) + ((double) ts.tv_nsec / 1e3);
+}
+
+static int tool_hex(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int tool_decode(FILE* in) {
+    static uint8_t data[TOOL_MAX_DUMP];
+    static ts_codec_decoder_t dec;
+    size_t len = 0;
+    size_t stream = 0;
+    unsigned long count = 0;
+    char line[1024];
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (line[0] == '#') {
+            char* p = strstr(line, "stream=");
+            if (p != NULL) {
+                stream = strtoul(p + 7, NULL, 10);
+            }
+
+            p = strstr(line, "count=");
+            if (p != NULL) {
+                count = strtoul(p + 6, NULL, 10);
+            }
+            continue;
+        }
+
+        char* p = strchr(line, ':');
+        if (p == NULL) {
+            continue;
+        }
+
+        for (p++; tool_hex(p[0]) >= 0 && tool_hex(p[1]) >= 0 && len < TOOL_MAX_DUMP; p += 2) {
+            data[len++] = (uint8_t) ((tool_hex(p[0]) << 4) | tool_hex(p[1]));
+        }
+    }
+
+    if (stream >= len || !ts_codec_decoder_init(&dec, &data[stream], len - stream)) {
+        fprintf(stderr, "No ts_codec stream found\n");
+        return 1;
+    }
+
+    printf("time_us,channel,v0,v1,v2,v3\n");
+
+    ts_codec_sample_t sample;
+    unsigned long decoded = 0;
+
+    while ((count == 0 || decoded < count) && ts_codec_decode(&dec, &sample)) {
+        printf("%u,%u", sample.time_us, sample.channel);
+        for (int i = 0; i < sample.count; i++) {
+            printf(",%.6g", sample.values[i]);
+        }
+        printf("\n");
+        decoded++;
+    }
+
+    fprintf(stderr, "%lu samples decoded\n", decoded);
+    return (count != 0 && decoded != count) ? 1 : 0;
+}
+
+/**
+ * @brief Synthetic hand data: a 1 kHz IMU with timing jitter and a 50 Hz servo
+ */
+static void tool_generate(ts_codec_sample_t* samples, size_t n) {
+    uint32_t imu_us = 0;
+    uint32_t servo_us = 0;
+    float angle = 90.0f;
+
+    srand(1);
+
+    for (size_t i = 0; i < n; i++) {
+        ts_codec_sample_t* s = &samples[i];
+
+        if ((i % 21) == 20) {
+            servo_us += 20000;
+            if ((rand() % 4) == 0) {
+                angle += (float) ((rand() % 11) - 5);
+            }
+
+            s->time_us = servo_us;
+            s->channel = 1;
+            s->count = 1;
+            s->values[0] = angle;
+            continue;
+        }
+
+        imu_us += 1000 + (uint32_t) (rand() % 7) - 3;
+        float t = (float) imu_us / 1e6f;
+
+        s->time_us = imu_us;
+        s->channel = 0;
+        s->count = 3;
+        for (int a = 0; a < 3; a++) {
+            float noise = ((float) (rand() % 1000) - 500.0f) / 50000.0f;
+            s->values[a] = (9.81f * sinf((2.0f * t) + (float) a)) + noise;
+        }
+    }
+}
+
+static void tool_bench_mode(const char* name, const ts_codec_sample_t* samples, size_t n, float scale) {
+    static ts_codec_encoder_t enc;
+    static ts_codec_decoder_t dec;
+    uint8_t* out = malloc((n * TS_CODEC_MAX_SAMPLE_BYTES) + TS_CODEC_MAX_HEADER_BYTES + 1);
+
+    ts_codec_config_t config = {
+        .channel_bits = 1,
+        .scale_shift = 0,
+        .scale_count = 1,
+        .scales = {scale}
+    };
+
+    double start = tool_now_us();
+    size_t len = ts_codec_encoder_init(&enc, &config, out);
+    for (size_t i = 0; i < n; i++) {
+        len += ts_codec_encode(&enc, &samples[i], &out[len]);
+    }
+    len += ts_codec_finish(&enc, &out[len]);
+    double encode_us = tool_now_us() - start;
+
+    size_t raw = 0;
+    for (size_t i = 0; i < n; i++) {
+        raw += sizeof(uint32_t) + (sizeof(float) * samples[i].count);
+    }
+
+    start = tool_now_us();
+    ts_codec_decoder_init(&dec, out, len);
+    size_t decoded = 0;
+    float max_error = 0.0f;
+    ts_codec_sample_t sample;
+
+    while (decoded < n && ts_codec_decode(&dec, &sample)) {
+        for (int a = 0; a < sample.count; a++) {
+            float error = fabsf(sample.values[a] - samples[decoded].values[a]);
+            if (error > max_error) {
+                max_error = error;
+            }
+        }
+
+        if (sample.time_us != samples[decoded].time_us) {
+            max_error = INFINITY;
+        }
+        decoded++;
+    }
+    double decode_us = tool_now_us() - start;
+
+    printf("%-10s %8zu bytes  ratio %5.2f  %5.2f bits/value  encode %.3f us/sample  decode %.3f us/sample  max error %g%s\n",
+        name, len, (double) raw / (double) len, (8.0 * len) / (double) ((raw - (4 * n)) / 4),
+        encode_us / (double) n, decode_us / (double) n, max_error, (decoded == n) ? "" : "  DECODE FAILED");
+
+    free(out);
+}
+
+static int tool_bench(size_t n) {
+    ts_codec_sample_t* samples = malloc(n * sizeof(ts_codec_sample_t));
+    tool_generate(samples, n);
+
+    printf("%zu samples, raw is a u32 timestamp and f32 values\n", n);
+    tool_bench_mode("lossless", samples, n, 0.0f);
+    tool_bench_mode("x1000", samples, n, 1000.0f);
+    tool_bench_mode("x100", samples, n, 100.0f);
+
+    free(samples);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "decode") == 0) {
+        FILE* in = (argc >= 3) ? fopen(argv[2], "r") : stdin;
+        if (in == NULL) {
+            perror(argv[2]);
+            return 1;
+        }
+        return tool_decode(in);
+    }
+
+    if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+        size_t n = (argc >= 3) ? strtoul(argv[2], NULL, 10) : 100000;
+        return tool_bench(n > 0 ? n : 100000);
+    }
+
+    fprintf(stderr, "Usage: %s decode [file] | bench [samples]\n", argv[0]);
+    return 1;
+}
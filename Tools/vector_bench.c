@@ -0,0 +1,237 @@
+/**
+* @file vector_bench.c
+* @brief Host benchmark of the batched VectorND kernels against per-vector calls
+* @date 2025-05-27
+*
+* Build on the host from the repository root, against the CMSIS-DSP sources:
+*   DSP=Dependencies/cmsis-dsp/Source
+*   cc -O2 -D__GNUC_PYTHON__ -IInclude/Programs/VectorND -IDependencies/cmsis-dsp/Include \
+*      -IDependencies/cmsis-dsp/PrivateInclude -o vector_bench Tools/vector_bench.c \
+*      Src/Programs/VectorND/vector_math.c Src/Programs/VectorND/vector_batch.c \
+*      Src/Programs/VectorND/matrix_solve.c \
+*      $DSP/BasicMathFunctions/arm_add_f32.c $DSP/BasicMathFunctions/arm_sub_f32.c \
+*      $DSP/BasicMathFunctions/arm_scale_f32.c $DSP/BasicMathFunctions/arm_dot_prod_f32.c -lm
+*
+* Usage:
+*   vector_bench [n] [rounds]   Transform n vectors (default 4096) per round.
+*
+* Prints vectors per second for each operation done with one Vector per
+* call and with one batch per call, and the largest difference between
+* the two results.
+*/
+
+#include "vector_batch.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double tool_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec * 1e6) + ((double) ts.tv_nsec / 1e3);
+}
+
+static uint32_t tool_seed = 12345;
+
+static float tool_random(void) {
+    tool_seed = (tool_seed * 1103515245u) + 12345u;
+    return ((float) ((tool_seed >> 8) & 0xFFFF) / 32768.0f) - 1.0f;
+}
+
+static void tool_report(const char* name, uint32_t n, uint32_t rounds, double single_us, double batch_us, float error) {
+    double total = (double) n * rounds;
+
+    printf("%-10s %12.0f %12.0f %7.1fx   %.2g\n", name, total * 1e6 / single_us, total * 1e6 / batch_us,
+        single_us / batch_us, (double) error);
+}
+
+static float tool_error(const Vector* vectors, const Vec3Batch* batch) {
+    float error = 0.0f;
+
+    for (uint32_t i = 0; i < batch->count; i++) {
+        error = fmaxf(error, fabsf(vectors[i].data[0] - batch->x[i]));
+        error = fmaxf(error, fabsf(vectors[i].data[1] - batch->y[i]));
+        error = fmaxf(error, fabsf(vectors[i].data[2] - batch->z[i]));
+    }
+
+    return error;
+}
+
+int main(int argc, char** argv) {
+    uint32_t n = (argc > 1) ? (uint32_t) atoi(argv[1]) : 4096;
+    uint32_t rounds = (argc > 2) ? (uint32_t) atoi(argv[2]) : 50;
+
+    if (n == 0 || rounds == 0) {
+        fprintf(stderr, "usage: %s [n] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    Unit meter;
+    unit_init(&meter, 1);
+    unit_add_component(&meter, UNIT_METER, 1);
+
+    Unit area;
+    unit_multiply(&area, &meter, &meter);
+
+    // One heap Vector per point, as the per-vector API needs
+    Vector* a = calloc(n, sizeof(Vector));
+    Vector* b = calloc(n, sizeof(Vector));
+    Vector* r = calloc(n, sizeof(Vector));
+    float* storage = calloc((size_t) n * 9, sizeof(float));
+    float* scalars = calloc(n, sizeof(float));
+    float* qs = calloc((size_t) n * 4, sizeof(float));
+
+    if (a == NULL || b == NULL || r == NULL || storage == NULL || scalars == NULL || qs == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    Vec3Batch ba, bb, br, bc;
+    vec3_batch_init(&ba, storage, storage + n, storage + 2 * n, n, &meter);
+    vec3_batch_init(&bb, storage + 3 * n, storage + 4 * n, storage + 5 * n, n, &meter);
+    vec3_batch_init(&br, storage + 6 * n, storage + 7 * n, storage + 8 * n, n, &meter);
+
+    for (uint32_t i = 0; i < n; i++) {
+        vector_init(&a[i], 3, true);
+        vector_init(&b[i], 3, true);
+        vector_init(&r[i], 3, true);
+        vector_set_uniform_unit(&a[i], &meter);
+        vector_set_uniform_unit(&b[i], &meter);
+
+        for (uint16_t k = 0; k < 3; k++) {
+            a[i].data[k] = tool_random();
+            b[i].data[k] = tool_random();
+        }
+
+        ba.x[i] = a[i].data[0];
+        ba.y[i] = a[i].data[1];
+        ba.z[i] = a[i].data[2];
+        bb.x[i] = b[i].data[0];
+        bb.y[i] = b[i].data[1];
+        bb.z[i] = b[i].data[2];
+
+        // Random unit quaternions for the rotation
+        float q[4] = {tool_random(), tool_random(), tool_random(), tool_random()};
+        float inverse = 1.0f / sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        for (int k = 0; k < 4; k++) {
+            qs[(i * 4) + k] = q[k] * inverse;
+        }
+    }
+
+    printf("%u vectors x %u rounds\n", n, rounds);
+    printf("%-10s %12s %12s %8s   %s\n", "operation", "single/s", "batch/s", "speedup", "max error");
+
+    double start = tool_now_us();
+    for (uint32_t k = 0; k < rounds; k++) {
+        for (uint32_t i = 0; i < n; i++) {
+            vector_add(&r[i], &a[i], &b[i]);
+        }
+    }
+    double single_us = tool_now_us() - start;
+
+    start = tool_now_us();
+    for (uint32_t k = 0; k < rounds; k++) {
+        vec3_batch_add(&br, &ba, &bb);
+    }
+    tool_report("add", n, rounds, single_us, tool_now_us() - start, tool_error(r, &br));
+
+    start = tool_now_us();
+    for (uint32_t k = 0; k < rounds; k++) {
+        for (uint32_t i = 0; i < n; i++) {
+            vector_cross_product(&r[i], &a[i], &b[i]);
+        }
+    }
+    single_us = tool_now_us() - start;
+
+    vec3_batch_init(&bc, br.x, br.y, br.z, n, &area);
+    start = tool_now_us();
+    for (uint32_t k = 0; k < rounds; k++) {
+        vec3_batch_cross(&bc, &ba, &bb);
+    }
+    tool_report("cross", n, rounds, single_us, tool_now_us() - start, tool_error(r, &bc));
+
+    float error = 0.0f;
+    start = tool_now_us();
+    for (uint32_t k = 0; k < rounds; k++) {
+        for (uint32_t i = 0; i < n; i++) {
+            Unit unit;
+            vector_dot_product(&scalars[i], &unit, &a[i], &b[i]);
+            unit_free(&unit);
+        }
+    }
+    single_us = tool_now_us() - start;
+
+    float* dots = br.x;
+    start = tool_now_us();
+    for (uint32_t k = 0; k < rounds; k++) {
+        vec3_batch_dot(dots, NULL, &ba, &bb);
+    }
+    double batch_us = tool_now_us() - start;
+    for (uint32_t i = 0; i < n; i++) {
+        error = fmaxf(error, fabsf(scalars[i] - dots[i]));
+    }
+    tool_report("dot", n, rounds, single_us, batch_us, error);
+
+    error = 0.0f;
+    start = tool_now_us();
+    for (uint32_t k = 0; k < rounds; k++) {
+        for (uint32_t i = 0; i < n; i++) {
+            Unit unit;
+            vector_magnitude(&a[i], &scalars[i], &unit);
+            unit_free(&unit);
+        }
+    }
+    single_us = tool_now_us() - start;
+
+    start = tool_now_us();
+    for (uint32_t k = 0; k < rounds; k++) {
+        vec3_batch_magnitude(dots, NULL, &ba);
+    }
+    batch_us = tool_now_us() - start;
+    for (uint32_t i = 0; i < n; i++) {
+        error = fmaxf(error, fabsf(scalars[i] - dots[i]));
+    }
+    tool_report("magnitude", n, rounds, single_us, batch_us, error);
+
+    // The per-vector API has no normalize or rotation, so only the batch rate is shown
+    vec3_batch_init(&bc, br.x, br.y, br.z, n, NULL);
+    start = tool_now_us();
+    for (uint32_t k = 0; k < rounds; k++) {
+        vec3_batch_normalize(&bc, &ba);
+    }
+    batch_us = tool_now_us() - start;
+    printf("%-10s %12s %12.0f\n", "normalize", "-", (double) n * rounds * 1e6 / batch_us);
+
+    start = tool_now_us();
+    for (uint32_t k = 0; k < rounds; k++) {
+        vec3_batch_rotate(&br, qs, &ba);
+    }
+    batch_us = tool_now_us() - start;
+    printf("%-10s %12s %12.0f\n", "rotate", "-", (double) n * rounds * 1e6 / batch_us);
+
+    // Rotation must keep lengths
+    error = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        float before = sqrtf(ba.x[i] * ba.x[i] + ba.y[i] * ba.y[i] + ba.z[i] * ba.z[i]);
+        float after = sqrtf(br.x[i] * br.x[i] + br.y[i] * br.y[i] + br.z[i] * br.z[i]);
+        error = fmaxf(error, fabsf(before - after));
+    }
+    printf("rotation length error %.2g\n", (double) error);
+
+    for (uint32_t i = 0; i < n; i++) {
+        vector_free(&a[i]);
+        vector_free(&b[i]);
+        vector_free(&r[i]);
+    }
+    free(a);
+    free(b);
+    free(r);
+    free(storage);
+    free(scalars);
+    free(qs);
+    unit_free(&area);
+    unit_free(&meter);
+    return 0;
+}
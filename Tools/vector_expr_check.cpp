@@ -0,0 +1,246 @@
+/**
+* @file vector_expr_check.cpp
+* @brief Host check and benchmark of the fused VectorND expression templates
+* @date 2025-05-27
+*
+* Build on the host from the repository root, against the CMSIS-DSP sources:
+*   DSP=Dependencies/cmsis-dsp/Source
+*   FLAGS="-O2 -D__GNUC_PYTHON__ -IInclude/Programs/VectorND -IDependencies/cmsis-dsp/Include \
+*      -IDependencies/cmsis-dsp/PrivateInclude"
+*   cc $FLAGS -c Src/Programs/VectorND/vector_math.c Src/Programs/VectorND/matrix_solve.c \
+*      $DSP/BasicMathFunctions/arm_add_f32.c $DSP/BasicMathFunctions/arm_sub_f32.c \
+*      $DSP/BasicMathFunctions/arm_scale_f32.c $DSP/BasicMathFunctions/arm_dot_prod_f32.c
+*   c++ -std=c++17 $FLAGS -o vector_expr_check Tools/vector_expr_check.cpp *.o -lm
+*
+* Usage:
+*   vector_expr_check [rounds]   Time a + b * s - c for a range of sizes.
+*
+* Checks that the fused expressions give the results of the C API, that
+* runtime unit and dimension mismatches are reported, then times the
+* expression evaluated with vector_scale(), vector_add() and
+* vector_subtract() against one fused evaluate(). Add
+* -DVECTOR_EXPR_SHOW_ERRORS to see the compiler reject unit and dimension
+* mistakes.
+*/
+
+#include "vector_expr.hpp"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double tool_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double) ts.tv_sec * 1e6) + ((double) ts.tv_nsec / 1e3);
+}
+
+static uint32_t tool_seed = 12345;
+
+static float tool_random(void) {
+    tool_seed = (tool_seed * 1103515245u) + 12345u;
+    return ((float) ((tool_seed >> 8) & 0xFFFF) / 32768.0f) - 1.0f;
+}
+
+// Unit algebra is done entirely by the compiler
+static_assert(std::is_same<vnd::MultiplyUnits<vnd::MetersPerSecond, vnd::Seconds>, vnd::Meters>::value, "m/s * s");
+static_assert(std::is_same<vnd::DivideUnits<vnd::Meters, vnd::Meters>, vnd::Dimensionless>::value, "m / m");
+static_assert(sizeof(vnd::Fixed<3, vnd::Meters>) == 3 * sizeof(float), "Fixed carries only its data");
+static_assert(sizeof(vnd::Ref<vnd::Meters>) <= 2 * sizeof(void*), "Ref is a pointer and a size");
+
+#ifdef VECTOR_EXPR_SHOW_ERRORS
+static void tool_show_errors(void) {
+    vnd::Fixed<3, vnd::Meters> p;
+    vnd::Fixed<3, vnd::Seconds> t;
+    vnd::Fixed<4, vnd::Meters> q;
+    vnd::Quantity<vnd::Seconds> sum_t;
+
+    p = p + t;              // operands of + have different units
+    p = p + q;              // vector dimensions differ
+    p = p * 2.0f + 1.0f;    // metres plus a dimensionless scalar
+    vnd::sum(&sum_t, p);    // result unit differs from the expression unit
+}
+#endif
+
+static int tool_failures = 0;
+
+static void tool_expect(bool condition, const char* what) {
+    printf("%-52s %s\n", what, condition ? "ok" : "FAILED");
+    tool_failures += condition ? 0 : 1;
+}
+
+static void tool_fill(Vector* vector, uint16_t n, const Unit* unit) {
+    vector_init(vector, n, true);
+    vector_set_uniform_unit(vector, unit);
+    for (uint16_t i = 0; i < n; i++) {
+        vector->data[i] = tool_random();
+    }
+}
+
+static float tool_difference(const Vector* a, const Vector* b) {
+    float error = 0.0f;
+
+    for (uint16_t i = 0; i < a->dim; i++) {
+        error = fmaxf(error, fabsf(a->data[i] - b->data[i]));
+    }
+
+    return error;
+}
+
+static void tool_check(const Unit* meter, const Unit* second) {
+    Vector va = {}, vb = {}, vc = {}, vt = {};
+    Vector scaled = {}, added = {}, expected = {}, fused = {};
+    const float s = 0.75f;
+
+    tool_fill(&va, 64, meter);
+    tool_fill(&vb, 64, meter);
+    tool_fill(&vc, 64, meter);
+    tool_fill(&vt, 64, second);
+
+    vnd::ConstRef<vnd::Meters> a, b, c;
+    vnd::ConstRef<vnd::Seconds> t;
+    tool_expect((vnd::bind(&a, &va) == VECTOR_SUCCESS) && (vnd::bind(&b, &vb) == VECTOR_SUCCESS) &&
+        (vnd::bind(&c, &vc) == VECTOR_SUCCESS) && (vnd::bind(&t, &vt) == VECTOR_SUCCESS), "bind");
+
+    vnd::ConstRef<vnd::Meters> wrong_unit;
+    tool_expect(vnd::bind(&wrong_unit, &vt) == VECTOR_UNIT_MISMATCH, "bind seconds as metres is refused");
+
+    vnd::ConstRef<vnd::Meters, 3> wrong_dim;
+    tool_expect(vnd::bind(&wrong_dim, &va) == VECTOR_DIMENSION_MISMATCH, "bind 64 elements as 3 is refused");
+
+    // a + b * s - c through the C API and fused
+    vector_scale(&scaled, &vb, s, NULL);
+    vector_add(&added, &va, &scaled);
+    vector_subtract(&expected, &added, &vc);
+
+    tool_expect(vnd::evaluate(&fused, a + b * s - c) == VECTOR_SUCCESS, "evaluate a + b * s - c");
+    tool_expect(tool_difference(&fused, &expected) == 0.0f, "same result as the C API");
+    tool_expect(unit_are_compatible(fused.units, meter), "result is in metres");
+
+    // a / t, unit derived at compile time and written to the result
+    Unit velocity;
+    unit_divide(&velocity, meter, second);
+    tool_expect((vnd::evaluate(&fused, -a / t) == VECTOR_SUCCESS) && unit_are_compatible(fused.units, &velocity) &&
+        (fused.data[5] == -va.data[5] / vt.data[5]), "evaluate -a / t in metres per second");
+    unit_free(&velocity);
+
+    // Reductions
+    vnd::Quantity<vnd::MultiplyUnits<vnd::Meters, vnd::Meters>> d;
+    float reference;
+    Unit area;
+    vector_dot_product(&reference, &area, &va, &vb);
+    tool_expect((vnd::dot(&d, a, b) == VECTOR_SUCCESS) && (fabsf(d.value - reference) < 1e-5f),
+        "dot(a, b) matches vector_dot_product()");
+    unit_free(&area);
+
+    // In place, the destination appearing in the expression
+    Vector vr = {};
+    tool_fill(&vr, 64, meter);
+    float before = vr.data[7];
+    vnd::Ref<vnd::Meters> r;
+    vnd::bind(&r, &vr);
+    tool_expect((vnd::assign(r, r + a * 2.0f) == VECTOR_SUCCESS) && (vr.data[7] == before + va.data[7] * 2.0f),
+        "assign r = r + a * 2 in place");
+
+    // Runtime dimension mismatch between Dynamic views
+    Vector vshort = {};
+    tool_fill(&vshort, 16, meter);
+    vnd::ConstRef<vnd::Meters> short_ref;
+    vnd::bind(&short_ref, &vshort);
+    tool_expect(vnd::evaluate(&fused, a + short_ref) == VECTOR_DIMENSION_MISMATCH, "a + 16 elements is refused");
+    tool_expect(vnd::assign(r, short_ref) == VECTOR_DIMENSION_MISMATCH, "assign 16 elements to 64 is refused");
+
+    // Fixed size, dimensions and units checked by the compiler
+    vnd::Fixed<3, vnd::Meters> p(0.0f, 1.0f, 2.0f);
+    vnd::Fixed<3, vnd::MetersPerSecond> v(1.0f, 0.0f, -1.0f);
+    vnd::Fixed<3, vnd::MetersPerSecondSquared> acc(0.0f, 0.0f, -9.81f);
+    vnd::Quantity<vnd::Seconds> dt{0.01f};
+    vnd::Quantity<vnd::MultiplyUnits<vnd::Seconds, vnd::Seconds>> half_dt2{0.5f * 0.01f * 0.01f};
+    p = p + v * dt + acc * half_dt2;
+    tool_expect(fabsf(p[2] - (2.0f - 0.01f - 0.5f * 9.81f * 0.0001f)) < 1e-6f, "Fixed kinematics step");
+
+    vector_free(&va);
+    vector_free(&vb);
+    vector_free(&vc);
+    vector_free(&vt);
+    vector_free(&vr);
+    vector_free(&vshort);
+    vector_free(&scaled);
+    vector_free(&added);
+    vector_free(&expected);
+    vector_free(&fused);
+}
+
+static void tool_benchmark(const Unit* meter, uint32_t rounds) {
+    static const uint16_t sizes[] = {3, 16, 64, 256, 1024};
+    volatile float sink = 0.0f;
+
+    printf("\n     n   C API ns   fused ns   speedup\n");
+
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        uint16_t n = sizes[k];
+        Vector va = {}, vb = {}, vc = {};
+        tool_fill(&va, n, meter);
+        tool_fill(&vb, n, meter);
+        tool_fill(&vc, n, meter);
+
+        // The C API needs a temporary per intermediate result
+        double start = tool_now_us();
+        for (uint32_t i = 0; i < rounds; i++) {
+            Vector scaled = {}, added = {}, result = {};
+            vector_scale(&scaled, &vb, 0.75f, NULL);
+            vector_add(&added, &va, &scaled);
+            vector_subtract(&result, &added, &vc);
+            sink = sink + result.data[0];
+            vector_free(&scaled);
+            vector_free(&added);
+            vector_free(&result);
+        }
+        double c_us = tool_now_us() - start;
+
+        vnd::ConstRef<vnd::Meters> a, b, c;
+        vnd::bind(&a, &va);
+        vnd::bind(&b, &vb);
+        vnd::bind(&c, &vc);
+
+        start = tool_now_us();
+        for (uint32_t i = 0; i < rounds; i++) {
+            Vector result = {};
+            vnd::evaluate(&result, a + b * 0.75f - c);
+            sink = sink + result.data[0];
+            vector_free(&result);
+        }
+        double fused_us = tool_now_us() - start;
+
+        printf("%6u %10.0f %10.0f %8.1fx\n", n, c_us * 1e3 / rounds, fused_us * 1e3 / rounds, c_us / fused_us);
+
+        vector_free(&va);
+        vector_free(&vb);
+        vector_free(&vc);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t rounds = (argc > 1) ? (uint32_t) atoi(argv[1]) : 20000;
+
+    if (rounds == 0) {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    Unit meter, second;
+    unit_init(&meter, 1);
+    unit_add_component(&meter, UNIT_METER, 1);
+    unit_init(&second, 1);
+    unit_add_component(&second, UNIT_SECOND, 1);
+
+    tool_check(&meter, &second);
+    tool_benchmark(&meter, rounds);
+
+    unit_free(&meter);
+    unit_free(&second);
+
+    printf("\n%d failures\n", tool_failures);
+    return (tool_failures == 0) ? 0 : 1;
+}